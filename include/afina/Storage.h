@@ -1,6 +1,8 @@
 #ifndef AFINA_STORAGE_H
 #define AFINA_STORAGE_H
 
+#include <cstddef>
+#include <functional>
 #include <string>
 
 namespace Afina {
@@ -84,6 +86,31 @@ public:
      * @param value output parameter to copy value to
      */
     virtual bool Get(const std::string &key, std::string &value) = 0;
+
+    /**
+     * Receives bytes of one item, see Visit
+     */
+    using Visitor =
+        std::function<void(const char *key, std::size_t key_size, const char *value, std::size_t value_size)>;
+
+    /**
+     * Calls visitor for each stored item from the most recently used one to the least recently used.
+     * Visitor must not call the storage. Returns false if storage can't enumerate its items
+     *
+     * @param visitor to be called for each item
+     */
+    virtual bool Visit(const Visitor &) { return false; }
+
+    /**
+     * Stores key/value pair if key isn't present as the least recently used item, nothing gets evicted
+     * to make room for it. Items given in the order Visit returns them end up in the same LRU order.
+     *
+     * Method returns true if item was added
+     *
+     * @param key to be associated with value
+     * @param value to be assigned for the key
+     */
+    virtual bool Restore(const std::string &key, const std::string &value) { return PutIfAbsent(key, value); }
 };
 
 } // namespace Afina
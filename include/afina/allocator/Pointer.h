@@ -7,6 +7,13 @@ namespace Allocator {
 // to avoid expensive macros calculations and increase compile speed
 class Simple;
 
+/**
+ * Handle of the memory block allocated by Simple. Block could be moved by allocator during realloc or
+ * defrag, so its address must not be cached, get() always returns the current one.
+ *
+ * Pointer refers to the slot in allocator handle table, all copies of the same pointer share it.
+ * Once block is freed through one of them the rest become dangling
+ */
 class Pointer {
 public:
     Pointer();
@@ -17,7 +24,15 @@ public:
     Pointer &operator=(const Pointer &);
     Pointer &operator=(Pointer &&);
 
-    void *get() const { return 0; }
+    // Current block address, nullptr for empty pointer
+    void *get() const { return _slot != nullptr ? *_slot : nullptr; }
+
+private:
+    friend class Simple;
+
+    explicit Pointer(void **slot);
+
+    void **_slot;
 };
 
 } // namespace Allocator
@@ -1,8 +1,9 @@
 #ifndef AFINA_ALLOCATOR_SIMPLE_H
 #define AFINA_ALLOCATOR_SIMPLE_H
 
-#include <string>
+#include <chrono>
 #include <cstddef>
+#include <string>
 
 namespace Afina {
 namespace Allocator {
@@ -18,44 +19,150 @@ class Pointer;
  * Allocator instance doesn't take ownership of wrapped memmory and do not delete it
  * on destruction. So caller must take care of resource cleaup after allocator stop
  * being needs
+ *
+ * Blocks are placed from the beginning of the area, each one has a small header. Table of handles
+ * grows from the end of the area towards blocks, Pointer refers to the handle, so that allocator
+ * could move blocks and update handles. Free blocks are merged with free neighbours and kept in
+ * the list, first fit is used for allocation. Space between the last block and the table is used
+ * once there is no suitable free block
  */
-// TODO: Implements interface to allow usage as C++ allocators
+// Blocks move, so standard containers can't keep their memory here, see StlAllocator
 class Simple {
 public:
     Simple(void *base, const size_t size);
 
     /**
-     * TODO: semantics
+     * Allocate block of at least N bytes aligned to 16, throws AllocError with NoMemory type if there
+     * is no free space big enough. Allocator doesn't defragment memory on its own, call defrag and
+     * try again
+     *
      * @param N size_t
      */
     Pointer alloc(size_t N);
 
     /**
-     * TODO: semantics
+     * Change block size to N bytes keeping its content up to the smaller of two sizes. Block is
+     * shrinked and grown in place when neighbour space allows, otherwise it is moved. Empty pointer
+     * gets a new block. On failure AllocError is thrown and block is left untouched
+     *
      * @param p Pointer
      * @param N size_t
      */
     void realloc(Pointer &p, size_t N);
 
     /**
-     * TODO: semantics
+     * Release block and make p empty, empty pointer is ignored. AllocError with InvalidFree type is
+     * thrown for pointers that don't refer to live block of this allocator
+     *
      * @param p Pointer
      */
     void free(Pointer &p);
 
     /**
-     * TODO: semantics
+     * Move all blocks to the beginning of the area one after another, so that all free space forms
+     * a single region. Pointers get updated, addresses taken before are invalid after the call
      */
     void defrag();
 
     /**
-     * TODO: semantics
+     * Incremental version of defrag: continue compaction from the point previous step stopped at, moving
+     * blocks until max_bytes are moved or max_time passed, at least one block is moved. Allocations
+     * and frees are allowed between steps. Returns true once memory is compacted
+     *
+     * @param max_bytes size_t
+     * @param max_time std::chrono::microseconds
+     */
+    bool defrag_step(size_t max_bytes, std::chrono::microseconds max_time = std::chrono::microseconds::max());
+
+    /**
+     * Memory usage summary
+     */
+    struct Stats {
+        // Bytes in used blocks including headers, number of blocks
+        size_t used;
+        size_t used_blocks;
+
+        // Bytes in free blocks, number of them and the largest one
+        size_t free;
+        size_t free_blocks;
+        size_t largest_free;
+
+        // Space between last block and handle table
+        size_t tail;
+
+        // Bytes moved by defrag so far
+        size_t moved;
+
+        // Share of free space that can't be allocated as a single block: 1 - largest region / free space
+        double fragmentation;
+    };
+    Stats stats() const;
+
+    /**
+     * Human readable list of blocks, for debug purposes
      */
     std::string dump() const;
 
 private:
+    // Header of each block, see Simple.cpp
+    struct Block;
+
+    // Smallest block able to hold N bytes
+    static size_t block_size(size_t N);
+
+    Block *first_block() const;
+    Block *next_block(Block *b) const;
+
+    // Validate pointer and return its block, throws InvalidFree
+    Block *block_of(const Pointer &p) const;
+
+    /**
+     * Take block of the given size from the free list or from the space after the last block
+     */
+    Block *carve(size_t size);
+
+    // Cut tail of the used block beyond size off and release it
+    void split(Block *b, size_t size);
+
+    // Return block to free space, merging it with free neighbours
+    void release(Block *b);
+
+    // Memory before the given address is not compacted anymore
+    void rewind(char *at) {
+        if (_compact > at) {
+            _compact = at;
+        }
+    }
+
+    void insert_free(Block *b);
+    void remove_free(Block *b);
+
+    // Handle table slots
+    void **take_slot();
+    void put_slot(void **slot);
+
     void *_base;
     const size_t _base_len;
+
+    // Blocks occupy [_begin, _top), handles [_table, _table_end)
+    char *_begin;
+    char *_top;
+    void **_table;
+    void **_table_end;
+
+    // Free blocks and free handles lists
+    Block *_free_blocks;
+    void **_free_slots;
+
+    // There are no free blocks before this address, incremental defrag continues from it
+    char *_compact;
+
+    // Number of used blocks and their size
+    size_t _used;
+    size_t _used_blocks;
+
+    // Bytes moved by defrag
+    size_t _moved;
 };
 
 } // namespace Allocator
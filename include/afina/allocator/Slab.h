@@ -0,0 +1,158 @@
+#ifndef AFINA_ALLOCATOR_SLAB_H
+#define AFINA_ALLOCATOR_SLAB_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <afina/concurrency/ThreadLocal.h>
+
+namespace Afina {
+namespace Allocator {
+
+/**
+ * # Slab allocator
+ * Arena -> slab -> size class scheme, the same one tarantool and memcached use. Arena is a single
+ * region reserved on construction and cut into equal slabs, slab aligned to its size, so the slab
+ * of any object is found by masking its address. Each slab serves objects of one size class, classes
+ * grow geometrically, so the waste inside of the object is bounded by the factor. Slabs are taken
+ * from the arena on demand and returned there once all their objects are freed, so memory moves
+ * between classes as load changes.
+ *
+ * Each thread keeps a small magazine of free objects per class, most alloc/free calls are served
+ * from it without any locking, the class mutex is taken to refill or flush half of the magazine at
+ * once. Magazines of exited threads are returned to their classes.
+ *
+ * Arena could be backed by huge pages, so that millions of small items don't cost a TLB entry per 4KB:
+ * either explicit ones from the hugetlb pool, reserved when arena is created, or transparent ones
+ * kernel gives to advised region when it can. Explicit pages fall back to transparent if the pool
+ * has not enough of them.
+ *
+ * Allocator never asks the system for more memory than the arena, objects larger than a slab could
+ * hold are not supported
+ */
+class Slab {
+public:
+    // Placement of arena pages: first touch decides, or spread over all NUMA nodes
+    static constexpr int kAnyNode = -1;
+    static constexpr int kInterleave = -2;
+
+    // Pages arena is backed by
+    enum class Pages { kRegular, kTransparent, kHuge2M, kHuge1G };
+
+    /**
+     * @param arena_size total memory for all objects, rounded up to the slab size
+     * @param slab_size size of each slab, power of two
+     * @param factor size ratio of neighbour classes
+     * @param min_size size of the smallest class, objects are aligned to 8 bytes
+     * @param node NUMA node to place arena pages on, see Concurrency::Topology, or kAnyNode/kInterleave
+     * @param pages to back arena with, see pages() for what was really obtained
+     */
+    Slab(std::size_t arena_size, std::size_t slab_size = 1 << 20, double factor = 1.25, std::size_t min_size = 16,
+         int node = kAnyNode, Pages pages = Pages::kRegular);
+    ~Slab();
+
+    /**
+     * Allocate memory for object of N bytes, throws AllocError with NoMemory type if the arena is
+     * exhausted or N is above the largest class
+     */
+    void *alloc(std::size_t N);
+
+    /**
+     * Return object to the allocator, p must be allocated by this allocator, nullptr is ignored
+     */
+    void free(void *p);
+
+    /**
+     * Memory really taken by object of N bytes, 0 if it can't be allocated at all
+     */
+    std::size_t footprint(std::size_t N) const;
+
+    // Largest object that could be allocated
+    std::size_t max_size() const;
+
+    // Arena size and memory taken by slabs currently assigned to classes
+    std::size_t capacity() const { return _slab_count * _slab_size; }
+    std::size_t used() const { return _slabs_used.load(std::memory_order_relaxed) * _slab_size; }
+
+    // Pages arena is backed by, could differ from requested ones if hugetlb pool is short
+    Pages pages() const { return _pages; }
+
+    /**
+     * Arena bytes currently on huge pages: whole arena for explicit ones, pages kernel has already
+     * collapsed for transparent ones, read from /proc/self/smaps
+     */
+    std::size_t huge_bytes() const;
+
+    /**
+     * Return objects cached by the calling thread to their classes, and empty slabs kept by classes
+     * to the arena
+     */
+    void flush();
+
+    /**
+     * Human readable state of classes
+     */
+    std::string dump() const;
+
+private:
+    // Header at the beginning of each slab, see Slab.cpp
+    struct SlabHeader;
+
+    // Objects of the same size and slabs serving them, see Slab.cpp
+    struct SizeClass;
+
+    // Free objects cached by one thread, see Slab.cpp
+    struct Magazines;
+
+    Slab(const Slab &) = delete;
+    Slab &operator=(const Slab &) = delete;
+
+    // Index of the smallest class fitting N bytes, -1 if there is none
+    int class_of(std::size_t N) const;
+
+    /**
+     * Take up to n free objects of the class, returns number of objects taken. Class lock must be held
+     */
+    std::size_t take_locked(SizeClass &cls, void **objects, std::size_t n);
+
+    /**
+     * Return objects to their slabs. Class lock must be held
+     */
+    void put_locked(SizeClass &cls, void *const *objects, std::size_t n);
+
+    // Get empty slab from the arena, nullptr if arena is exhausted
+    SlabHeader *acquire_slab();
+    void release_slab(SlabHeader *slab);
+
+    void flush(Magazines &magazines);
+
+    const std::size_t _slab_size;
+    std::size_t _slab_count;
+
+    // Reserved region and the first slab in it
+    void *_region;
+    std::size_t _region_size;
+    char *_arena;
+    Pages _pages;
+
+    // Slabs never used yet start at _arena_next, returned ones are kept in the list
+    std::mutex _arena_mutex;
+    std::size_t _arena_next;
+    SlabHeader *_free_slabs;
+    std::atomic<std::size_t> _slabs_used;
+
+    std::vector<std::unique_ptr<SizeClass>> _classes;
+
+    // Per thread caches, must be destroyed before classes as exit hook touches them
+    std::unique_ptr<Concurrency::ThreadLocal<Magazines>> _magazines;
+};
+
+} // namespace Allocator
+} // namespace Afina
+
+#endif // AFINA_ALLOCATOR_SLAB_H
@@ -0,0 +1,73 @@
+#ifndef AFINA_ALLOCATOR_STL_ALLOCATOR_H
+#define AFINA_ALLOCATOR_STL_ALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+#include <afina/allocator/Error.h>
+#include <afina/allocator/Slab.h>
+
+namespace Afina {
+namespace Allocator {
+
+/**
+ * # Standard allocator over slab
+ * Lets standard containers keep their nodes in the slab arena. Allocator only refers to the slab, so
+ * slab must outlive all containers using it. Without slab memory comes from the heap, that way the
+ * same container type could be used in both cases.
+ *
+ * Arena exhaustion is reported with std::bad_alloc as containers expect. Simple allocator can't be
+ * used here as its blocks move
+ */
+template <typename T> class StlAllocator {
+public:
+    using value_type = T;
+
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    explicit StlAllocator(Slab *slab = nullptr) noexcept : _slab(slab) {}
+
+    template <typename U> StlAllocator(const StlAllocator<U> &other) noexcept : _slab(other.slab()) {}
+
+    T *allocate(std::size_t n) {
+        static_assert(alignof(T) <= 8, "Slab aligns objects to 8 bytes only");
+        if (_slab == nullptr) {
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        }
+
+        try {
+            return static_cast<T *>(_slab->alloc(n * sizeof(T)));
+        } catch (AllocError &) {
+            throw std::bad_alloc();
+        }
+    }
+
+    void deallocate(T *p, std::size_t) noexcept {
+        if (_slab == nullptr) {
+            ::operator delete(p);
+        } else {
+            _slab->free(p);
+        }
+    }
+
+    Slab *slab() const noexcept { return _slab; }
+
+private:
+    Slab *_slab;
+};
+
+template <typename T, typename U> bool operator==(const StlAllocator<T> &a, const StlAllocator<U> &b) noexcept {
+    return a.slab() == b.slab();
+}
+
+template <typename T, typename U> bool operator!=(const StlAllocator<T> &a, const StlAllocator<U> &b) noexcept {
+    return a.slab() != b.slab();
+}
+
+} // namespace Allocator
+} // namespace Afina
+
+#endif // AFINA_ALLOCATOR_STL_ALLOCATOR_H
@@ -1,10 +1,128 @@
 #ifndef AFINA_CONCURRENCY_CORE_LOCAL_H
 #define AFINA_CONCURRENCY_CORE_LOCAL_H
 
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include <sched.h>
+#include <unistd.h>
+
+#if defined(__has_include)
+#if __has_include(<sys/rseq.h>)
+#include <sys/rseq.h>
+#endif
+#endif
+
+// glibc registers restartable sequences area for each thread since 2.35, kernel keeps current cpu number
+// there, so it could be read with plain load instead of the call
+#if defined(RSEQ_SIG) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 11))
+#define AFINA_HAVE_RSEQ 1
+#endif
+
 namespace Afina {
 namespace Concurrency {
 
-template <typename T> class CoreLocal {};
+/**
+ * Number of the cpu calling thread is running on right now. Thread could be migrated right after the
+ * call, so result is a hint only
+ */
+inline unsigned CurrentCpu() {
+#ifdef AFINA_HAVE_RSEQ
+    const struct rseq *area =
+        reinterpret_cast<const struct rseq *>(static_cast<const char *>(__builtin_thread_pointer()) + __rseq_offset);
+    int32_t rseq_cpu = int32_t(*static_cast<const volatile uint32_t *>(&area->cpu_id));
+    if (rseq_cpu >= 0) {
+        return unsigned(rseq_cpu);
+    }
+#endif
+    int cpu = sched_getcpu();
+    return cpu >= 0 ? unsigned(cpu) : 0;
+}
+
+/**
+ * # Per cpu storage
+ * Keeps a copy of T for each cpu, each on its own cache line(s), Local returns one of the cpu thread is
+ * running on. Threads on different cpus never touch the same line, so counters built on top of it cost
+ * an uncontended atomic increment instead of fighting for a shared one.
+ *
+ * Thread could be preempted and migrated between getting the slot and using it, so the slot is still
+ * shared: T must be safe for concurrent updates, usually it is a set of atomics updated with relaxed
+ * order. Readers combine all slots with Fold and see eventually consistent picture
+ */
+template <typename T> class CoreLocal {
+public:
+    /**
+     * Create one slot per configured cpu or the given number of slots, cpus with larger numbers share
+     * slots modulo size
+     */
+    explicit CoreLocal(std::size_t size = 0) : _size(size > 0 ? size : DefaultSize()), _memory(nullptr), _slots(nullptr) {
+        _memory = new char[_size * sizeof(Slot) + kCacheLine];
+        std::size_t offset = kCacheLine - reinterpret_cast<uintptr_t>(_memory) % kCacheLine;
+        _slots = reinterpret_cast<Slot *>(_memory + offset);
+
+        std::size_t i = 0;
+        try {
+            for (; i < _size; i++) {
+                new (&_slots[i]) Slot();
+            }
+        } catch (...) {
+            Destroy(i);
+            throw;
+        }
+    }
+
+    ~CoreLocal() { Destroy(_size); }
+
+    // Slot of the cpu calling thread is running on
+    T &Local() { return _slots[CurrentCpu() % _size].value; }
+
+    // Slot by index, for iteration
+    T &operator[](std::size_t i) { return _slots[i].value; }
+    const T &operator[](std::size_t i) const { return _slots[i].value; }
+
+    std::size_t Size() const { return _size; }
+
+    /**
+     * Combine all slots: result = f(result, slot) starting from init
+     */
+    template <typename R, typename F> R Fold(R init, F f) const {
+        for (std::size_t i = 0; i < _size; i++) {
+            init = f(init, _slots[i].value);
+        }
+        return init;
+    }
+
+private:
+    static constexpr std::size_t kCacheLine = 64;
+
+    // Alignment rounds slot size up, so neighbours never share the line
+    struct alignas(kCacheLine) Slot {
+        Slot() : value() {}
+        T value;
+    };
+
+    CoreLocal(const CoreLocal &) = delete;
+    CoreLocal &operator=(const CoreLocal &) = delete;
+
+    static std::size_t DefaultSize() {
+        long n = sysconf(_SC_NPROCESSORS_CONF);
+        return n > 0 ? std::size_t(n) : 1;
+    }
+
+    void Destroy(std::size_t n) {
+        for (std::size_t i = 0; i < n; i++) {
+            _slots[i].~Slot();
+        }
+        delete[] _memory;
+    }
+
+    const std::size_t _size;
+
+    // Raw memory, slots start at the first cache line boundary inside
+    char *_memory;
+    Slot *_slots;
+};
 
 } // namespace Concurrency
 } // namespace Afina
@@ -115,7 +115,7 @@ class Executor {
         }
     };
 
-    Executor(std::string name="", size_t low_watermark=1, size_t hight_watermark=2, 
+    Executor(std::string /* name */="", size_t low_watermark=1, size_t hight_watermark=2, 
             size_t max_queue_size=10, size_t idle_time=100) : low_watermark(low_watermark),
             hight_watermark(hight_watermark), max_queue_size(max_queue_size),
             idle_time(idle_time){};
@@ -126,7 +126,7 @@ class Executor {
     void Start(){
         std::lock_guard<std::mutex> lock(mutex);
         state = State::kRun;
-        for (int i = 0; i < cnt_threads; i++)
+        for (size_t i = 0; i < cnt_threads; i++)
             std::thread(&Executor::perform, this).detach();
     };
 
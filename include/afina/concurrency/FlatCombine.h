@@ -1,10 +1,218 @@
 #ifndef AFINA_CONCURRENCY_FLAT_COMBINE_H
 #define AFINA_CONCURRENCY_FLAT_COMBINE_H
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
 namespace Afina {
 namespace Concurrency {
 
-template <typename Op> class FlatCombine {};
+/**
+ * # Flat combining
+ * Serializes operations on a sequential data structure without making every thread take the lock.
+ * Caller publishes its operation in a publication record and tries to become the combiner: the one
+ * that got the lock walks through all records and applies the whole batch of pending operations at
+ * once, others just wait for their records to be marked done. The structure and the lock stay in the
+ * combiner cache, instead of bouncing between all cores on every operation.
+ *
+ * Records are taken for the duration of one operation, thread starts looking for a free record from
+ * the same position each time, so under steady load threads keep using the same records. There are
+ * no per thread resources to cleanup on thread exit.
+ *
+ * Op is any type that describes the operation and carries its result, it is applied by the function
+ * given to constructor. Combiner calls it under the lock, so it may access the structure without any
+ * additional synchronization. Exception thrown by it is rethrown by Apply of every operation of the
+ * batch, so function that could fail on one operation should rather keep the error in the Op
+ */
+template <typename Op> class FlatCombine {
+public:
+    /**
+     * Function that applies batch of pending operations, it is called by combiner with the lock held
+     */
+    using Combiner = std::function<void(Op *const *batch, std::size_t size)>;
+
+    /**
+     * Create combiner with the given number of publication records, up to that many threads could wait
+     * for the combiner at once, the rest wait for a free record
+     */
+    explicit FlatCombine(Combiner combiner, std::size_t records = 64)
+        : _combiner(std::move(combiner)), _size(records > 0 ? records : 1), _locked(false),
+          _memory(new char[(_size + 1) * sizeof(Record)]) {
+        // Records are aligned manually, C++11 new doesn't respect alignment above the fundamental one
+        std::size_t misalign = reinterpret_cast<uintptr_t>(_memory.get()) % alignof(Record);
+        _records = reinterpret_cast<Record *>(_memory.get() + (alignof(Record) - misalign) % alignof(Record));
+        for (std::size_t i = 0; i < _size; i++) {
+            new (&_records[i]) Record();
+        }
+        _batch.reserve(_size);
+        _ops.reserve(_size);
+    }
+
+    /**
+     * Apply operation, returns once it is done either by this thread or by another combiner
+     */
+    void Apply(Op &op) {
+        // Nobody is around: no need to publish anything
+        if (TryLock()) {
+            Unlock unlock{_locked};
+            Op *self = &op;
+            _combiner(&self, 1);
+            _batches.fetch_add(1, std::memory_order_relaxed);
+            _combined.fetch_add(1, std::memory_order_relaxed);
+            Combine();
+            return;
+        }
+
+        Record &record = Acquire();
+        record.op = &op;
+        record.state.store(kPending, std::memory_order_release);
+
+        for (std::size_t spins = 0; record.state.load(std::memory_order_acquire) != kDone; spins++) {
+            if (TryLock()) {
+                Unlock unlock{_locked};
+                Combine();
+            } else if (spins >= kSpins) {
+                std::this_thread::yield();
+            }
+        }
+
+        std::exception_ptr error = std::move(record.error);
+        record.error = nullptr;
+        record.op = nullptr;
+        record.state.store(kFree, std::memory_order_release);
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Number of batches applied and number of operations in them, for diagnostics
+    std::size_t Batches() const { return _batches.load(std::memory_order_relaxed); }
+    std::size_t Combined() const { return _combined.load(std::memory_order_relaxed); }
+
+private:
+    enum State { kFree, kClaimed, kPending, kDone };
+
+    // Waiter spins that long before giving cpu to others
+    static constexpr std::size_t kSpins = 64;
+
+    // Combiner walks through records that many times while it finds new operations
+    static constexpr int kPasses = 3;
+
+    // Publication record, each lives on its own cache line as owner and combiner write it
+    struct alignas(64) Record {
+        Record() : state(kFree), op(nullptr) {}
+
+        std::atomic<int> state;
+        Op *op;
+
+        // Thrown by combiner while it applied the batch with this operation
+        std::exception_ptr error;
+    };
+
+    // Releases combiner lock on scope exit, so that exception doesn't leave it locked forever
+    struct Unlock {
+        std::atomic<bool> &locked;
+        ~Unlock() { locked.store(false, std::memory_order_release); }
+    };
+
+    FlatCombine(const FlatCombine &) = delete;
+    FlatCombine &operator=(const FlatCombine &) = delete;
+
+    // Test and test-and-set, so waiters don't bounce the line while combiner is busy
+    bool TryLock() {
+        return !_locked.load(std::memory_order_relaxed) && !_locked.exchange(true, std::memory_order_acquire);
+    }
+
+    /**
+     * Claim free record starting from the position of calling thread
+     */
+    Record &Acquire() {
+        static std::atomic<std::size_t> next_thread(0);
+        static thread_local std::size_t thread_index = next_thread.fetch_add(1, std::memory_order_relaxed);
+
+        for (std::size_t i = thread_index;; i++) {
+            Record &record = _records[i % _size];
+            int expected = kFree;
+            if (record.state.load(std::memory_order_relaxed) == kFree &&
+                record.state.compare_exchange_strong(expected, kClaimed, std::memory_order_acquire)) {
+                // Combiner scans records in use only, owner itself will see the new bound if combiner
+                // doesn't
+                std::size_t used = _used.load(std::memory_order_relaxed);
+                while (used <= i % _size &&
+                       !_used.compare_exchange_weak(used, i % _size + 1, std::memory_order_relaxed)) {
+                }
+                return record;
+            }
+            if ((i - thread_index) % _size == _size - 1) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /**
+     * Collect pending operations and apply them, must be called with the lock held
+     */
+    void Combine() {
+        for (int pass = 0; pass < kPasses; pass++) {
+            _batch.clear();
+            std::size_t used = _used.load(std::memory_order_relaxed);
+            for (std::size_t i = 0; i < used; i++) {
+                if (_records[i].state.load(std::memory_order_acquire) == kPending) {
+                    _batch.push_back(&_records[i]);
+                }
+            }
+            if (_batch.empty()) {
+                return;
+            }
+
+            _ops.clear();
+            for (Record *record : _batch) {
+                _ops.push_back(record->op);
+            }
+            // Records are marked done anyway, otherwise their owners would wait forever
+            try {
+                _combiner(_ops.data(), _ops.size());
+            } catch (...) {
+                std::exception_ptr error = std::current_exception();
+                for (Record *record : _batch) {
+                    record->error = error;
+                }
+            }
+
+            for (Record *record : _batch) {
+                record->state.store(kDone, std::memory_order_release);
+            }
+            _batches.fetch_add(1, std::memory_order_relaxed);
+            _combined.fetch_add(_batch.size(), std::memory_order_relaxed);
+        }
+    }
+
+    Combiner _combiner;
+
+    const std::size_t _size;
+
+    // Combiner lock and its scratch space
+    std::atomic<bool> _locked;
+
+    // Records with higher indexes were never taken
+    std::atomic<std::size_t> _used{0};
+    std::vector<Record *> _batch;
+    std::vector<Op *> _ops;
+
+    // Raw memory for records, records start at the first cache line boundary inside
+    std::unique_ptr<char[]> _memory;
+    Record *_records;
+
+    std::atomic<std::size_t> _batches{0};
+    std::atomic<std::size_t> _combined{0};
+};
 
 } // namespace Concurrency
 } // namespace Afina
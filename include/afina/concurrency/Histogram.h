@@ -0,0 +1,77 @@
+#ifndef AFINA_CONCURRENCY_HISTOGRAM_H
+#define AFINA_CONCURRENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Afina {
+namespace Concurrency {
+
+/**
+ * # High dynamic range histogram
+ * Records non-negative integer values, usually latencies in nanoseconds, keeping about 2 significant
+ * decimal digits for any magnitude. Values are split into power of two buckets, each of them is divided
+ * into the same number of linear sub-buckets, the same layout HdrHistogram uses. Values above 2^36 are
+ * clamped.
+ *
+ * Record is lock free and could be called from any thread, readers see eventually consistent picture
+ */
+class Histogram {
+public:
+    Histogram();
+    Histogram(const Histogram &other);
+    Histogram &operator=(const Histogram &other);
+
+    /**
+     * Add single value to the histogram
+     */
+    void Record(uint64_t value);
+
+    /**
+     * Add all values recorded by other histogram
+     */
+    void Merge(const Histogram &other);
+
+    /**
+     * Forget all recorded values, must not race with Record
+     */
+    void Reset();
+
+    // Number of values recorded, walks through all the slots
+    uint64_t Count() const;
+
+    // Average of recorded values, 0 for empty histogram
+    double Mean() const;
+
+    // Biggest recorded value up to the histogram precision
+    uint64_t Max() const { return Percentile(100.0); }
+
+    /**
+     * Value that is not less than given percent of recorded ones, up to the histogram precision
+     */
+    uint64_t Percentile(double percent) const;
+
+private:
+    // Linear sub-buckets in each power of two bucket: 2^8 keeps relative error below 1%
+    static constexpr int kSubBucketBits = 8;
+    static constexpr int kMaxValueBits = 36;
+
+    static constexpr std::size_t kSubBucketHalf = std::size_t(1) << (kSubBucketBits - 1);
+    static constexpr std::size_t kBuckets = kMaxValueBits - kSubBucketBits + 1;
+    static constexpr std::size_t kCounts = (kBuckets + 1) * kSubBucketHalf;
+
+    static std::size_t IndexOf(uint64_t value);
+
+    // Highest value that falls into the same slot as values at the given index
+    static uint64_t ValueAt(std::size_t index);
+
+    std::unique_ptr<std::atomic<uint64_t>[]> _counts;
+    std::atomic<uint64_t> _sum;
+};
+
+} // namespace Concurrency
+} // namespace Afina
+
+#endif // AFINA_CONCURRENCY_HISTOGRAM_H
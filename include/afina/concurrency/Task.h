@@ -0,0 +1,131 @@
+#ifndef AFINA_CONCURRENCY_TASK_H
+#define AFINA_CONCURRENCY_TASK_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Afina {
+namespace Concurrency {
+
+/**
+ * # Move only type erased void() callable
+ * Same as std::function<void()>, but callables that fit into kInlineSize bytes are kept inside of the
+ * object itself, so the usual std::bind of a member function with a couple of arguments is stored without
+ * heap allocation. Bigger callables are allocated on the heap
+ */
+class Task {
+public:
+    static constexpr std::size_t kInlineSize = 6 * sizeof(void *);
+
+    Task() noexcept : _ops(nullptr) {}
+
+    template <typename F, typename = typename std::enable_if<
+                              !std::is_same<typename std::decay<F>::type, Task>::value>::type>
+    Task(F &&func) : _ops(nullptr) {
+        typedef typename std::decay<F>::type Func;
+        Init<Func>(std::forward<F>(func), std::integral_constant<bool, Fits<Func>::value>());
+    }
+
+    Task(Task &&other) noexcept : _ops(other._ops) {
+        if (_ops != nullptr) {
+            _ops->move(other._storage, _storage);
+            other._ops = nullptr;
+        }
+    }
+
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            Reset();
+            _ops = other._ops;
+            if (_ops != nullptr) {
+                _ops->move(other._storage, _storage);
+                other._ops = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    ~Task() { Reset(); }
+
+    /**
+     * Run stored callable, task must not be empty
+     */
+    void operator()() { _ops->invoke(_storage); }
+
+    /**
+     * Destroy stored callable, task becomes empty
+     */
+    void Reset() noexcept {
+        if (_ops != nullptr) {
+            _ops->destroy(_storage);
+            _ops = nullptr;
+        }
+    }
+
+    explicit operator bool() const noexcept { return _ops != nullptr; }
+
+    // True if callable is stored without heap allocation
+    bool IsInline() const noexcept { return _ops != nullptr && _ops->is_inline; }
+
+private:
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    // Operations on the stored callable, single static instance for each callable type
+    struct Ops {
+        void (*invoke)(void *storage);
+        void (*move)(void *from, void *to);
+        void (*destroy)(void *storage);
+        bool is_inline;
+    };
+
+    template <typename F> struct Fits {
+        static constexpr bool value = sizeof(F) <= kInlineSize && alignof(F) <= alignof(std::max_align_t) &&
+                                      std::is_nothrow_move_constructible<F>::value;
+    };
+
+    template <typename F> struct InlineOps {
+        static void invoke(void *storage) { (*static_cast<F *>(storage))(); }
+        static void move(void *from, void *to) {
+            new (to) F(std::move(*static_cast<F *>(from)));
+            static_cast<F *>(from)->~F();
+        }
+        static void destroy(void *storage) { static_cast<F *>(storage)->~F(); }
+        static const Ops ops;
+    };
+
+    template <typename F> struct HeapOps {
+        static void invoke(void *storage) { (**static_cast<F **>(storage))(); }
+        static void move(void *from, void *to) { *static_cast<F **>(to) = *static_cast<F **>(from); }
+        static void destroy(void *storage) { delete *static_cast<F **>(storage); }
+        static const Ops ops;
+    };
+
+    template <typename Func, typename F> void Init(F &&func, std::true_type) {
+        new (_storage) Func(std::forward<F>(func));
+        _ops = &InlineOps<Func>::ops;
+    }
+
+    template <typename Func, typename F> void Init(F &&func, std::false_type) {
+        *reinterpret_cast<Func **>(_storage) = new Func(std::forward<F>(func));
+        _ops = &HeapOps<Func>::ops;
+    }
+
+    const Ops *_ops;
+    alignas(std::max_align_t) unsigned char _storage[kInlineSize];
+};
+
+template <typename F>
+const Task::Ops Task::InlineOps<F>::ops = {&Task::InlineOps<F>::invoke, &Task::InlineOps<F>::move,
+                                           &Task::InlineOps<F>::destroy, true};
+
+template <typename F>
+const Task::Ops Task::HeapOps<F>::ops = {&Task::HeapOps<F>::invoke, &Task::HeapOps<F>::move,
+                                         &Task::HeapOps<F>::destroy, false};
+
+} // namespace Concurrency
+} // namespace Afina
+
+#endif // AFINA_CONCURRENCY_TASK_H
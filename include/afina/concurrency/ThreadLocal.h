@@ -1,10 +1,146 @@
 #ifndef AFINA_CONCURRENCY_THREAD_LOCAL_H
 #define AFINA_CONCURRENCY_THREAD_LOCAL_H
 
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+#include <pthread.h>
+
 namespace Afina {
 namespace Concurrency {
 
-template <typename T> class ThreadLocal {};
+/**
+ * # Per thread object
+ * Each thread calling Get receives its own instance of T, created on the first call. Unlike thread_local
+ * variable, it could be a member of some object: every ThreadLocal keeps separate set of instances.
+ *
+ * All instances are registered, so other thread, e.g. the one collecting statistics, could walk
+ * through them with ForEach. Instance is destroyed once its thread exits, the optional exit hook
+ * gets it right before that, for example to fold per thread counters into a global one. Instances of
+ * threads still alive are destroyed together with ThreadLocal itself, so it must not be destroyed
+ * while other threads could call Get or exit.
+ *
+ * Get is a single pthread_getspecific call after the first time, the registry mutex is taken only on
+ * instance creation, destruction and iteration
+ */
+template <typename T> class ThreadLocal {
+public:
+    /**
+     * Function called with instance of the exiting thread
+     */
+    using ExitHook = std::function<void(T &)>;
+
+    explicit ThreadLocal(ExitHook on_exit = nullptr) : _on_exit(std::move(on_exit)), _head(nullptr), _size(0) {
+        if (pthread_key_create(&_key, &ThreadLocal::OnThreadExit) != 0) {
+            throw std::runtime_error("Failed to create thread specific key");
+        }
+    }
+
+    ~ThreadLocal() {
+        // No destructor calls for the deleted key, so exited threads won't touch entries anymore
+        pthread_key_delete(_key);
+        while (_head != nullptr) {
+            Entry *next = _head->next;
+            delete _head;
+            _head = next;
+        }
+    }
+
+    /**
+     * Instance of the calling thread
+     */
+    T &Get() {
+        Entry *entry = static_cast<Entry *>(pthread_getspecific(_key));
+        if (entry == nullptr) {
+            entry = Create();
+        }
+        return entry->value;
+    }
+
+    T &operator*() { return Get(); }
+    T *operator->() { return &Get(); }
+
+    /**
+     * Call f for instance of every thread, threads can't create or release instances meanwhile, but
+     * they still could use existing ones, so f must synchronize access to them if necessary
+     */
+    template <typename F> void ForEach(F f) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (Entry *entry = _head; entry != nullptr; entry = entry->next) {
+            f(entry->value);
+        }
+    }
+
+    // Number of threads having an instance
+    std::size_t Size() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _size;
+    }
+
+private:
+    // Instance of one thread, all of them are linked into the registry
+    struct Entry {
+        explicit Entry(ThreadLocal *o) : owner(o), value(), prev(nullptr), next(nullptr) {}
+
+        ThreadLocal *owner;
+        T value;
+        Entry *prev;
+        Entry *next;
+    };
+
+    ThreadLocal(const ThreadLocal &) = delete;
+    ThreadLocal &operator=(const ThreadLocal &) = delete;
+
+    Entry *Create() {
+        std::unique_ptr<Entry> entry(new Entry(this));
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (pthread_setspecific(_key, entry.get()) != 0) {
+            throw std::runtime_error("Failed to set thread specific value");
+        }
+
+        entry->next = _head;
+        if (_head != nullptr) {
+            _head->prev = entry.get();
+        }
+        _head = entry.get();
+        _size++;
+        return entry.release();
+    }
+
+    /**
+     * Called by pthread on exit of each thread that has an instance
+     */
+    static void OnThreadExit(void *ptr) {
+        std::unique_ptr<Entry> entry(static_cast<Entry *>(ptr));
+        ThreadLocal *owner = entry->owner;
+
+        std::lock_guard<std::mutex> lock(owner->_mutex);
+        if (owner->_on_exit) {
+            owner->_on_exit(entry->value);
+        }
+
+        if (entry->prev != nullptr) {
+            entry->prev->next = entry->next;
+        } else {
+            owner->_head = entry->next;
+        }
+        if (entry->next != nullptr) {
+            entry->next->prev = entry->prev;
+        }
+        owner->_size--;
+    }
+
+    ExitHook _on_exit;
+    pthread_key_t _key;
+
+    // Registry of all instances, protects list itself, not the instances
+    mutable std::mutex _mutex;
+    Entry *_head;
+    std::size_t _size;
+};
 
 } // namespace Concurrency
 } // namespace Afina
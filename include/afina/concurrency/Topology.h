@@ -0,0 +1,80 @@
+#ifndef AFINA_CONCURRENCY_TOPOLOGY_H
+#define AFINA_CONCURRENCY_TOPOLOGY_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+namespace Afina {
+namespace Concurrency {
+
+/**
+ * # NUMA topology
+ * Nodes of the machine and their CPUs as sysfs describes them. Nodes are numbered densely from 0 here,
+ * kernel ids could have gaps. Machine without NUMA support is a single node having all online CPUs.
+ *
+ * Besides discovery allows to restrict threads to CPUs of the node and to set memory policy of the
+ * region, syscalls are used directly so there is no dependency on libnuma
+ */
+class Topology {
+public:
+    /**
+     * Read topology from sysfs mounted at the given directory
+     */
+    explicit Topology(const std::string &sysfs = "/sys/devices/system");
+
+    /**
+     * Topology of this machine, read once
+     */
+    static const Topology &System();
+
+    std::size_t Nodes() const { return _cpus.size(); }
+
+    // CPUs of the node, node id as kernel knows it
+    const std::vector<int> &Cpus(std::size_t node) const { return _cpus[node]; }
+    int NodeId(std::size_t node) const { return _ids[node]; }
+
+    // Node of the given CPU, 0 for unknown CPUs
+    std::size_t NodeOf(int cpu) const;
+
+    /**
+     * Restrict thread to CPUs of the node, returns false on failure
+     */
+    bool BindThread(pthread_t thread, std::size_t node) const;
+    bool BindThread(std::size_t node) const { return BindThread(pthread_self(), node); }
+
+    /**
+     * Place pages of the region on the node, or interleave them over all nodes. Policy applies to
+     * pages not touched yet, so it must be set right after mmap. Returns false on failure
+     */
+    bool BindMemory(void *addr, std::size_t len, std::size_t node) const;
+    bool InterleaveMemory(void *addr, std::size_t len) const;
+
+    /**
+     * Node where page with given address currently is, -1 if it isn't known
+     */
+    int NodeOfPage(void *addr) const;
+
+    /**
+     * Human readable description
+     */
+    std::string dump() const;
+
+private:
+    bool SetPolicy(void *addr, std::size_t len, int mode, const std::vector<std::size_t> &nodes) const;
+
+    std::vector<int> _ids;
+    std::vector<std::vector<int>> _cpus;
+};
+
+/**
+ * Parse CPU list in sysfs format: "0-3,8,10-11"
+ */
+std::vector<int> ParseCpuList(const std::string &list);
+
+} // namespace Concurrency
+} // namespace Afina
+
+#endif // AFINA_CONCURRENCY_TOPOLOGY_H
@@ -0,0 +1,236 @@
+#ifndef AFINA_CONCURRENCY_WORK_STEALING_EXECUTOR_H
+#define AFINA_CONCURRENCY_WORK_STEALING_EXECUTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <afina/concurrency/Histogram.h>
+#include <afina/concurrency/Task.h>
+
+namespace Afina {
+namespace Concurrency {
+
+template <typename T> class InjectionQueue;
+
+/**
+ * # Work stealing thread pool
+ * Drop-in replacement for Executor with the same interface and watermarks semantics. Each thread owns
+ * Chase-Lev deque, tasks added from inside of the pool go there and are executed LIFO by the owner,
+ * idle threads steal them from the opposite end. Tasks added from outside go to the bounded lock-free
+ * injection queue, max_queue_size limits that queue only. Tasks are kept in Task objects, so the
+ * usual bound member function doesn't need heap allocation.
+ *
+ * Threads are started on demand up to hight_watermark once nobody is idle, those idle for more than
+ * idle_time milliseconds are stopped until low_watermark is left. The mutex is taken to park/wakeup
+ * threads only, busy pool never touches it
+ *
+ * Pool keeps track of each task enqueue, start and finish time, so that queue wait and execution time
+ * distributions are available together with queue depth and rejection counters
+ */
+class WorkStealingExecutor {
+public:
+    /**
+     * What to do with a task once injection queue is full
+     */
+    enum class Overflow {
+        // Execute returns false
+        kReject,
+
+        // Task gets executed right in the calling thread, Execute returns true
+        kCallerRuns,
+
+        // Caller waits for the free place in queue up to the configured timeout, then task is rejected
+        kBlock
+    };
+
+    /**
+     * Snapshot of the pool state
+     */
+    struct Stats {
+        // Tasks waiting to be executed, both in the injection queue and thread deques
+        std::size_t queue_depth;
+
+        // Running threads and those of them waiting for tasks
+        std::size_t threads;
+        std::size_t idle_threads;
+
+        // Tasks accepted by Execute, executed by pool threads, rejected and executed by callers due to
+        // overflow
+        uint64_t submitted;
+        uint64_t completed;
+        uint64_t rejected;
+        uint64_t caller_runs;
+    };
+
+    WorkStealingExecutor(std::string name = "", std::size_t low_watermark = 1, std::size_t hight_watermark = 2,
+                         std::size_t max_queue_size = 10, std::size_t idle_time = 100);
+    ~WorkStealingExecutor();
+
+    /**
+     * Start low_watermark threads and begin to accept tasks
+     */
+    void Start();
+
+    /**
+     * Signal thread pool to stop, it will stop accepting new jobs and close threads once there is nothing
+     * left to do. All enqueued jobs will be complete.
+     *
+     * In case if await flag is true, call won't return until all background jobs are done and all threads
+     * are stopped
+     */
+    void Stop(bool await = false);
+
+    /**
+     * Set behaviour on queue overflow, kReject is the default. block_timeout makes sense for kBlock only.
+     * on_reject is called by Execute each time task gets rejected, both due to overflow and stopped pool.
+     *
+     * Must be called before Start
+     */
+    void SetOverflowPolicy(Overflow policy, std::chrono::milliseconds block_timeout = std::chrono::milliseconds(0),
+                           std::function<void()> on_reject = nullptr);
+
+    /**
+     * Turn tasks timings on or off, they are on by default. Clock is read three times per task, that is
+     * noticeable for tiny tasks only.
+     *
+     * Must be called before Start
+     */
+    void EnableTimings(bool enable) { _timings = enable; }
+
+    /**
+     * Add function to be executed on the threadpool. Method returns true in case if task has been placed
+     * onto execution queue, i.e scheduled for execution and false otherwise. With kCallerRuns policy task
+     * could be executed before the call returns.
+     *
+     * That function doesn't wait for function result. Function could always be written in a way to notify
+     * caller about execution finished by itself
+     */
+    template <typename F, typename... Types> bool Execute(F &&func, Types... args) {
+        return Push(Task(std::bind(std::forward<F>(func), std::forward<Types>(args)...)));
+    }
+
+    // Number of running threads
+    std::size_t Threads() const { return _active.load(); }
+
+    Stats GetStats() const;
+
+    /**
+     * Distributions of time in nanoseconds tasks spent in queue before start, their execution time and
+     * the whole time from Execute till finish. Tasks executed by callers on overflow are not included
+     */
+    Histogram QueueTime() const;
+    Histogram RunTime() const;
+    Histogram TotalTime() const;
+
+private:
+    enum class State {
+        // Threadpool is fully operational, tasks could be added and get executed
+        kRun,
+
+        // Threadpool is on the way to be shutdown, no new task could be added, but existing will be
+        // completed as requested
+        kStopping,
+
+        // Threadpool is stopped
+        kStopped
+    };
+
+    WorkStealingExecutor(const WorkStealingExecutor &) = delete;
+    WorkStealingExecutor &operator=(const WorkStealingExecutor &) = delete;
+
+    // Thread slot with its own deque, see WorkStealingExecutor.cpp
+    struct Worker;
+
+    // Task together with its enqueue time, see WorkStealingExecutor.cpp
+    struct Job;
+
+    // Worker of the current thread, nullptr outside of any pool
+    static thread_local Worker *_current;
+
+    /**
+     * Place task to the local deque if called from the pool thread or to the injection queue otherwise
+     */
+    bool Push(Task &&task);
+
+    /**
+     * Wait for free place in the injection queue according to kBlock policy
+     */
+    bool PushBlocking(Job &job);
+
+    // Count rejected task and notify about it
+    bool Reject();
+
+    /**
+     * Execute task and record its timings
+     */
+    void Run(Worker &w, Job &job);
+
+    /**
+     * Main function that all pool threads are running
+     */
+    void Perform(Worker &w);
+
+    /**
+     * Take task from the own deque, injection queue or steal it from other threads
+     */
+    bool Find(Worker &w, Job &job);
+
+    // True if there is a task anywhere
+    bool HasWork() const;
+
+    /**
+     * Wakeup parked thread or start a new one if everybody is busy
+     */
+    void Notify();
+
+    /**
+     * Start thread in the first free slot, must be called under the mutex
+     */
+    bool SpawnLocked();
+
+    std::string _name;
+    const std::size_t _low_watermark, _hight_watermark, _idle_time;
+
+    Overflow _overflow;
+    std::chrono::milliseconds _block_timeout;
+    std::function<void()> _on_reject;
+    bool _timings;
+
+    std::unique_ptr<InjectionQueue<Job>> _queue;
+    std::vector<std::unique_ptr<Worker>> _workers;
+
+    std::atomic<State> _state;
+
+    // Number of running threads and those of them parked on condition
+    std::atomic<std::size_t> _active;
+    std::atomic<std::size_t> _sleepers;
+
+    // Number of Push calls in progress, threads must not exit while somebody still could add a task
+    std::atomic<std::size_t> _pushing;
+
+    // Number of callers waiting for free place in queue
+    std::atomic<std::size_t> _blocked;
+
+    std::atomic<uint64_t> _submitted;
+    std::atomic<uint64_t> _rejected;
+    std::atomic<uint64_t> _caller_runs;
+
+    // Protects threads start/stop and parking
+    std::mutex _mutex;
+    std::condition_variable _idle_condition;
+    std::condition_variable _stop_condition;
+    std::condition_variable _space_condition;
+};
+
+} // namespace Concurrency
+} // namespace Afina
+
+#endif // AFINA_CONCURRENCY_WORK_STEALING_EXECUTOR_H
@@ -0,0 +1,116 @@
+#ifndef AFINA_COROUTINE_CHANNEL_H
+#define AFINA_COROUTINE_CHANNEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <utility>
+
+namespace Afina {
+namespace Coroutine {
+
+/**
+ * # Bounded multi-producer multi-consumer queue for coroutines of the single engine
+ * Sender blocks while channel is full, receiver while it is empty. Once value gets in or out the first
+ * coroutine waiting on the other side is scheduled right away. Same restrictions as for Coroutine::Mutex
+ * apply
+ */
+template <typename E, typename T> class Channel {
+public:
+    /**
+     * @param engine coroutines engine
+     * @param capacity max number of values buffered, must be positive
+     */
+    Channel(E &engine, std::size_t capacity) : _engine(engine), _capacity(capacity > 0 ? capacity : 1), _closed(false) {}
+
+    /**
+     * Puts value into the channel, blocks while it is full. Returns false if channel is closed
+     */
+    bool send(T value) {
+        while (!_closed && _buffer.size() >= _capacity) {
+            Park(_senders);
+        }
+        if (_closed) {
+            return false;
+        }
+
+        _buffer.push_back(std::move(value));
+        Wake(_receivers);
+        return true;
+    }
+
+    /**
+     * Takes value out of the channel, blocks while it is empty. Returns false once channel is closed
+     * and all buffered values are consumed
+     */
+    bool recv(T &value) {
+        while (!_closed && _buffer.empty()) {
+            Park(_receivers);
+        }
+        if (_buffer.empty()) {
+            return false;
+        }
+
+        value = std::move(_buffer.front());
+        _buffer.pop_front();
+        Wake(_senders);
+        return true;
+    }
+
+    /**
+     * Rejects any further send, receivers could consume what is already buffered
+     */
+    void close() {
+        _closed = true;
+        for (void *w : _senders) {
+            _engine.unblock(w);
+        }
+        for (void *w : _receivers) {
+            _engine.unblock(w);
+        }
+        _senders.clear();
+        _receivers.clear();
+    }
+
+    std::size_t size() const { return _buffer.size(); }
+
+    bool closed() const { return _closed; }
+
+private:
+    Channel(const Channel &) = delete;
+    Channel &operator=(const Channel &) = delete;
+
+    // Block current coroutine until somebody takes it out of the given waiters list
+    void Park(std::deque<void *> &waiters) {
+        void *self = _engine.current();
+        waiters.push_back(self);
+        while (std::find(waiters.begin(), waiters.end(), self) != waiters.end()) {
+            _engine.block();
+        }
+    }
+
+    void Wake(std::deque<void *> &waiters) {
+        if (waiters.empty()) {
+            return;
+        }
+
+        void *next = waiters.front();
+        waiters.pop_front();
+        _engine.sched(next);
+    }
+
+    E &_engine;
+    std::size_t _capacity;
+    bool _closed;
+
+    std::deque<T> _buffer;
+
+    // Coroutines blocked in send and recv accordingly
+    std::deque<void *> _senders;
+    std::deque<void *> _receivers;
+};
+
+} // namespace Coroutine
+} // namespace Afina
+
+#endif // AFINA_COROUTINE_CHANNEL_H
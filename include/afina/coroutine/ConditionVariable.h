@@ -0,0 +1,79 @@
+#ifndef AFINA_COROUTINE_CONDITION_VARIABLE_H
+#define AFINA_COROUTINE_CONDITION_VARIABLE_H
+
+#include <algorithm>
+#include <deque>
+
+#include <afina/coroutine/Mutex.h>
+
+namespace Afina {
+namespace Coroutine {
+
+/**
+ * # Condition variable for coroutines of the single engine
+ * Same restrictions as for Coroutine::Mutex apply
+ */
+template <typename E> class ConditionVariable {
+public:
+    explicit ConditionVariable(E &engine) : _engine(engine) {}
+
+    /**
+     * Atomically (in terms of coroutines) releases mutex and blocks current coroutine until notified,
+     * mutex is acquired back before return
+     */
+    void wait(Mutex<E> &mutex) {
+        void *self = _engine.current();
+        _waiters.push_back(self);
+        mutex.unlock();
+
+        // Notify removes coroutine from the waiters, it could happen even before we get blocked
+        while (std::find(_waiters.begin(), _waiters.end(), self) != _waiters.end()) {
+            _engine.block();
+        }
+        mutex.lock();
+    }
+
+    template <typename Predicate> void wait(Mutex<E> &mutex, Predicate pred) {
+        while (!pred()) {
+            wait(mutex);
+        }
+    }
+
+    /**
+     * Pass control to the first waiter
+     */
+    void notify_one() {
+        if (_waiters.empty()) {
+            return;
+        }
+
+        void *next = _waiters.front();
+        _waiters.pop_front();
+        _engine.sched(next);
+    }
+
+    /**
+     * Make all waiters ready to run, they get control once current coroutine gives it up
+     */
+    void notify_all() {
+        std::deque<void *> waiters;
+        waiters.swap(_waiters);
+        for (void *w : waiters) {
+            _engine.unblock(w);
+        }
+    }
+
+private:
+    ConditionVariable(const ConditionVariable &) = delete;
+    ConditionVariable &operator=(const ConditionVariable &) = delete;
+
+    E &_engine;
+
+    // Coroutines waiting for notification in FIFO order
+    std::deque<void *> _waiters;
+};
+
+} // namespace Coroutine
+} // namespace Afina
+
+#endif // AFINA_COROUTINE_CONDITION_VARIABLE_H
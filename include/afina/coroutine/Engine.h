@@ -1,6 +1,7 @@
 #ifndef AFINA_COROUTINE_ENGINE_H
 #define AFINA_COROUTINE_ENGINE_H
 
+#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <iostream>
@@ -9,6 +10,8 @@
 
 #include <setjmp.h>
 
+#include <afina/coroutine/TimerQueue.h>
+
 namespace Afina {
 namespace Coroutine {
 
@@ -39,6 +42,12 @@ private:
         // Saved coroutine context (registers)
         jmp_buf Environment;
 
+        // Set while coroutine is in the "blocked" list
+        bool is_blocked = false;
+
+        // Set once coroutine gets unblocked by timer rather than by unblock
+        bool timed_out = false;
+
         // To include routine in the different lists, such as "alive", "blocked", e.t.c
         struct context *prev = nullptr;
         struct context *next = nullptr;
@@ -74,7 +83,33 @@ private:
      */
     unblocker_func _unblocker;
 
+    /**
+     * Deadlines of coroutines blocked with timeout
+     */
+    TimerQueue _timers;
+
 protected:
+    /**
+     * Unlink routine from the given list
+     */
+    static void Unlink(context *&head, context *ctx);
+
+    /**
+     * Push routine to the head of the given list
+     */
+    static void Link(context *&head, context *ctx);
+
+    /**
+     * Unblock coroutines which deadlines are passed
+     */
+    void ExpireTimers();
+
+    /**
+     * Called by idle context once nobody is ready to run: calls unblocker and waits for the nearest timer
+     * until some coroutine is ready or there is nothing to wait for
+     */
+    void Idle();
+
     /**
      * Save stack of the current coroutine in the given context
      */
@@ -85,11 +120,15 @@ protected:
      */
     void Restore(context &ctx);
 
+    // Copy saved stack back and jump into it, called by Restore from a frame below the saved region
+    __attribute__((noinline, noreturn)) void RestoreBelow(context &ctx);
+
     static void null_unblocker(Engine &) {}
 
 public:
     Engine(unblocker_func unblocker = null_unblocker)
-        : StackBottom(0), cur_routine(nullptr), alive(nullptr), _unblocker(unblocker) {}
+        : StackBottom(0), cur_routine(nullptr), alive(nullptr), blocked(nullptr), idle_ctx(nullptr),
+          _unblocker(unblocker) {}
     Engine(Engine &&) = delete;
     Engine(const Engine &) = delete;
 
@@ -108,7 +147,7 @@ public:
      * when it has been suspended previously.
      *
      * If routine to pass execution to is not specified (nullptr) then method should behaves like yield. In case
-     * if passed routine is the current one method does nothing
+     * if passed routine is the current one method does nothing. Blocked routine gets unblocked first
      */
     void sched(void *routine);
 
@@ -125,6 +164,27 @@ public:
      */
     void unblock(void *coro);
 
+    /**
+     * Returns currently running coroutine or nullptr if called outside of any
+     */
+    void *current() const { return cur_routine == idle_ctx ? nullptr : cur_routine; }
+
+    /**
+     * Blocks current coroutine until it gets unblocked or timeout expires. Returns false in case of timeout
+     */
+    bool block_for(std::chrono::milliseconds timeout);
+
+    /**
+     * Suspends current coroutine for the given time, other coroutines keep running meanwhile
+     */
+    void sleep_for(std::chrono::milliseconds timeout);
+
+    /**
+     * Milliseconds till the nearest timer of blocked coroutines, -1 if there are none. Unblocker should
+     * not wait for events longer than that, so it is ready to be passed to epoll_wait
+     */
+    int next_timeout() const { return _timers.Timeout(TimerQueue::clock::now()); }
+
     /**
      * Entry point into the engine. Prepare all internal mechanics and starts given function which is
      * considered as main.
@@ -145,9 +205,7 @@ public:
 
         idle_ctx = new context();
         if (setjmp(idle_ctx->Environment) > 0) {
-            if (alive == nullptr) {
-                _unblocker(*this);
-            }
+            Idle();
 
             // Here: correct finish of the coroutine section
             yield();
@@ -157,7 +215,10 @@ public:
         }
 
         // Shutdown runtime
+        delete[] std::get<0>(idle_ctx->Stack);
         delete idle_ctx;
+        idle_ctx = nullptr;
+        cur_routine = nullptr;
         this->StackBottom = 0;
     }
 
@@ -203,7 +264,7 @@ public:
             // current coroutine finished, and the pointer is not relevant now
             cur_routine = nullptr;
             pc->prev = pc->next = nullptr;
-            delete std::get<0>(pc->Stack);
+            delete[] std::get<0>(pc->Stack);
             delete pc;
 
             // We cannot return here, as this function "returned" once already, so here we must select some other
@@ -0,0 +1,72 @@
+#ifndef AFINA_COROUTINE_MUTEX_H
+#define AFINA_COROUTINE_MUTEX_H
+
+#include <algorithm>
+#include <deque>
+
+namespace Afina {
+namespace Coroutine {
+
+/**
+ * # Mutex for coroutines of the single engine
+ * Instead of sleeping in kernel waiter coroutine gets blocked in the engine, unlock passes ownership to
+ * the first waiter and schedules it right away. Works with both Engine and StackfulEngine, usable with
+ * std::lock_guard/std::unique_lock.
+ *
+ * Note that copy-stack Engine restores whole stack on switch, so with it the mutex must not live on a
+ * coroutine stack
+ */
+template <typename E> class Mutex {
+public:
+    explicit Mutex(E &engine) : _engine(engine), _locked(false) {}
+
+    void lock() {
+        if (!_locked) {
+            _locked = true;
+            return;
+        }
+
+        // Ownership is passed by unlock, which removes us from the waiters
+        void *self = _engine.current();
+        _waiters.push_back(self);
+        while (std::find(_waiters.begin(), _waiters.end(), self) != _waiters.end()) {
+            _engine.block();
+        }
+    }
+
+    bool try_lock() {
+        if (_locked) {
+            return false;
+        }
+        _locked = true;
+        return true;
+    }
+
+    void unlock() {
+        if (_waiters.empty()) {
+            _locked = false;
+            return;
+        }
+
+        void *next = _waiters.front();
+        _waiters.pop_front();
+        _engine.sched(next);
+    }
+
+private:
+    Mutex(const Mutex &) = delete;
+    Mutex &operator=(const Mutex &) = delete;
+
+    E &_engine;
+
+    // Set while somebody owns the mutex
+    bool _locked;
+
+    // Coroutines waiting for ownership in FIFO order
+    std::deque<void *> _waiters;
+};
+
+} // namespace Coroutine
+} // namespace Afina
+
+#endif // AFINA_COROUTINE_MUTEX_H
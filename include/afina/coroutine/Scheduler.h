@@ -0,0 +1,126 @@
+#ifndef AFINA_COROUTINE_SCHEDULER_H
+#define AFINA_COROUTINE_SCHEDULER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace Afina {
+namespace Coroutine {
+
+/**
+ * # M:N coroutine scheduler
+ * Runs coroutines on a fixed set of threads. Each thread owns StackfulEngine, queue of coroutines that
+ * are not started yet and epoll instance to wait for I/O on behalf of its coroutines. New coroutines are
+ * distributed round robin, thread that has nothing to do steals not started coroutines from the others.
+ * Once started coroutine stays on its thread till the end.
+ *
+ * Read/Write/Wait/Yield must be called from inside of coroutine running by scheduler only
+ */
+class Scheduler {
+public:
+    Scheduler(std::size_t workers = 1, std::size_t stack_size = 64 * 1024);
+    ~Scheduler();
+
+    /**
+     * Set function that every worker thread calls with its index before running coroutines, e.g. to
+     * set thread affinity. Must be called before Start
+     */
+    void SetThreadStart(std::function<void(std::size_t)> on_start) { _on_start = std::move(on_start); }
+
+    /**
+     * Spawns worker threads
+     */
+    void Start();
+
+    /**
+     * Stops accepting new coroutines, those already spawned will be executed till the end
+     */
+    void Stop();
+
+    /**
+     * Blocks calling thread until all coroutines are done and worker threads are stopped
+     */
+    void Join();
+
+    /**
+     * Schedule given function to be run as a new coroutine on some of worker threads. Returns false
+     * if scheduler is not running
+     */
+    bool Spawn(std::function<void()> task);
+
+    /**
+     * Suspend current coroutine until given descriptor gets one of the requested epoll events or timeout
+     * in milliseconds expires, negative timeout means wait forever. Returns false if descriptor couldn't
+     * be watched or timeout expired, in the later case errno is set to ETIMEDOUT
+     */
+    static bool Wait(int fd, uint32_t events, int timeout = -1);
+
+    /**
+     * read(2)/write(2) for non-blocking descriptors, that suspends current coroutine instead of
+     * returning EAGAIN. Once no progress could be made for timeout milliseconds -1 is returned with
+     * errno set to ETIMEDOUT
+     */
+    static ssize_t Read(int fd, void *buf, std::size_t count, int timeout = -1);
+    static ssize_t Write(int fd, const void *buf, std::size_t count, int timeout = -1);
+
+    /**
+     * Let other coroutines of the current thread run
+     */
+    static void Yield();
+
+private:
+    Scheduler(const Scheduler &) = delete;
+    Scheduler &operator=(const Scheduler &) = delete;
+
+    // Thread with its own engine, see Scheduler.cpp
+    struct Worker;
+
+    // Worker of the current thread, nullptr outside of scheduler threads
+    static thread_local Worker *_current;
+
+    /**
+     * Worker thread body
+     */
+    void OnRun(Worker &w);
+
+    /**
+     * Main coroutine of each worker: starts new coroutines from the queue
+     */
+    static void Serve(Scheduler &self, Worker &w);
+
+    /**
+     * Take not started coroutine from the own queue or steal it from another worker
+     */
+    bool Take(Worker &w, std::function<void()> &task);
+
+    /**
+     * Wait for I/O events and unblock coroutines that are ready to continue, returns number of
+     * coroutines woken up
+     */
+    static int Poll(Worker &w, int timeout);
+
+    // Wakeup worker sleeping in epoll_wait
+    static void Wakeup(Worker &w);
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+
+    // Round robin position for the next spawned coroutine
+    std::atomic<std::size_t> _next;
+
+    // Flag to stop accept new coroutines
+    std::atomic<bool> _running;
+
+    // Called by each worker thread on start
+    std::function<void(std::size_t)> _on_start;
+};
+
+} // namespace Coroutine
+} // namespace Afina
+
+#endif // AFINA_COROUTINE_SCHEDULER_H
@@ -0,0 +1,171 @@
+#ifndef AFINA_COROUTINE_STACKFUL_ENGINE_H
+#define AFINA_COROUTINE_STACKFUL_ENGINE_H
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+#include <afina/coroutine/TimerQueue.h>
+
+namespace Afina {
+namespace Coroutine {
+
+// Forward declaration, see src/coroutine/StackPool.h
+class StackPool;
+
+/**
+ * # Coroutine engine with dedicated stacks
+ * Same interface as Engine, but each coroutine runs on its own mmap'ed stack protected by a guard page,
+ * so switch doesn't copy anything: only callee-saved registers and stack pointer get swapped. Stacks are
+ * pooled and reused by subsequent coroutines. Not threadsafe
+ */
+class StackfulEngine final {
+public:
+    using unblocker_func = std::function<void(StackfulEngine &)>;
+
+private:
+    /**
+     * A single coroutine instance, see StackfulEngine.cpp
+     */
+    struct context;
+
+    /**
+     * Current coroutine
+     */
+    context *cur_routine;
+
+    /**
+     * List of routines ready to be scheduled. Note that suspended routine ends up here as well
+     */
+    context *alive;
+
+    /**
+     * List of corountines that sleep and can't be executed
+     */
+    context *blocked;
+
+    /**
+     * Context of the thread called start(), gets control once there is nothing to run
+     */
+    context *idle_ctx;
+
+    /**
+     * Finished routine which stack should be released once control leaves it
+     */
+    context *zombie;
+
+    /**
+     * Call when all coroutines are blocked
+     */
+    unblocker_func _unblocker;
+
+    /**
+     * Stacks cache
+     */
+    std::unique_ptr<StackPool> _stacks;
+
+    /**
+     * Deadlines of coroutines blocked with timeout
+     */
+    TimerQueue _timers;
+
+    /**
+     * Keeps reference parameters as references once bound into task, rest gets copied
+     */
+    template <typename T> struct bound_arg {
+        static typename std::decay<T>::type wrap(T &&v) { return std::forward<T>(v); }
+    };
+    template <typename T> struct bound_arg<T &> {
+        static std::reference_wrapper<T> wrap(T &v) { return std::ref(v); }
+    };
+
+    static void null_unblocker(StackfulEngine &) {}
+
+    // See Engine.h
+    static void Unlink(context *&head, context *ctx);
+
+    // See Engine.h
+    static void Link(context *&head, context *ctx);
+
+    // See Engine.h
+    void ExpireTimers();
+
+    /**
+     * First function executed on the new coroutine stack
+     */
+    static void Entry(void *engine);
+
+    /**
+     * Save registers of the "from" routine and pass control to the "to" one
+     */
+    void Switch(context &from, context &to);
+
+    /**
+     * Allocate coroutine for the given task and put it to the alive list
+     */
+    void *Spawn(std::function<void()> &&task);
+
+    /**
+     * Runs given task as main coroutine and serves scheduling until all coroutines are done
+     */
+    void Loop(std::function<void()> &&main);
+
+public:
+    /**
+     * @param unblocker called once all coroutines are blocked
+     * @param stack_size usable size of each coroutine stack in bytes, rounded up to the page size
+     * @param pool_size how many released stacks to keep for reuse
+     */
+    StackfulEngine(unblocker_func unblocker = null_unblocker, std::size_t stack_size = 64 * 1024,
+                   std::size_t pool_size = 64);
+    StackfulEngine(StackfulEngine &&) = delete;
+    StackfulEngine(const StackfulEngine &) = delete;
+    ~StackfulEngine();
+
+    // See Engine.h
+    void yield();
+
+    // See Engine.h
+    void sched(void *routine);
+
+    // See Engine.h
+    void block(void *coro = nullptr);
+
+    // See Engine.h
+    void unblock(void *coro);
+
+    /**
+     * Returns currently running coroutine or nullptr if called outside of any
+     */
+    void *current() const { return cur_routine == idle_ctx ? nullptr : cur_routine; }
+
+    // See Engine.h
+    bool block_for(std::chrono::milliseconds timeout);
+
+    // See Engine.h
+    void sleep_for(std::chrono::milliseconds timeout);
+
+    // See Engine.h
+    int next_timeout() const { return _timers.Timeout(TimerQueue::clock::now()); }
+
+    // See Engine.h
+    template <typename... Ta> void start(void (*main)(Ta...), Ta &&... args) {
+        Loop(std::bind(main, bound_arg<Ta>::wrap(std::forward<Ta>(args))...));
+    }
+
+    // See Engine.h
+    template <typename... Ta> void *run(void (*func)(Ta...), Ta &&... args) {
+        if (idle_ctx == nullptr) {
+            // Engine wasn't initialized yet
+            return nullptr;
+        }
+        return Spawn(std::bind(func, bound_arg<Ta>::wrap(std::forward<Ta>(args))...));
+    }
+};
+
+} // namespace Coroutine
+} // namespace Afina
+
+#endif // AFINA_COROUTINE_STACKFUL_ENGINE_H
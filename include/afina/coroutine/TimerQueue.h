@@ -0,0 +1,67 @@
+#ifndef AFINA_COROUTINE_TIMER_QUEUE_H
+#define AFINA_COROUTINE_TIMER_QUEUE_H
+
+#include <chrono>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace Afina {
+namespace Coroutine {
+
+/**
+ * # Deadlines of blocked coroutines
+ * Binary min-heap by deadline with index by coroutine, so that timer could be cancelled once coroutine
+ * gets unblocked earlier. Each coroutine has at most one timer. Not threadsafe
+ */
+class TimerQueue {
+public:
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * Set deadline for the given coroutine, replaces existing one if any
+     */
+    void Add(void *coro, clock::time_point deadline);
+
+    /**
+     * Cancel timer of the given coroutine, returns false if there was no timer
+     */
+    bool Remove(void *coro);
+
+    /**
+     * Removes and returns coroutine which deadline is not after the given moment, nullptr if there is
+     * no such coroutine
+     */
+    void *PopExpired(clock::time_point now);
+
+    /**
+     * Milliseconds till the nearest deadline rounded up, -1 if there are no timers. Suitable as
+     * epoll_wait timeout
+     */
+    int Timeout(clock::time_point now) const;
+
+    bool Empty() const { return _heap.empty(); }
+
+    std::size_t Size() const { return _heap.size(); }
+
+private:
+    struct Entry {
+        clock::time_point deadline;
+        void *coro;
+    };
+
+    void SiftUp(std::size_t pos);
+    void SiftDown(std::size_t pos);
+    void Swap(std::size_t a, std::size_t b);
+    void RemoveAt(std::size_t pos);
+
+    std::vector<Entry> _heap;
+
+    // Position of coroutine timer in the heap
+    std::unordered_map<void *, std::size_t> _index;
+};
+
+} // namespace Coroutine
+} // namespace Afina
+
+#endif // AFINA_COROUTINE_TIMER_QUEUE_H
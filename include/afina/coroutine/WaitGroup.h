@@ -0,0 +1,61 @@
+#ifndef AFINA_COROUTINE_WAIT_GROUP_H
+#define AFINA_COROUTINE_WAIT_GROUP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+
+namespace Afina {
+namespace Coroutine {
+
+/**
+ * # Waits for a collection of coroutines to finish
+ * Counter is increased by add, decreased by done, wait blocks until it drops to zero. Same restrictions as
+ * for Coroutine::Mutex apply
+ */
+template <typename E> class WaitGroup {
+public:
+    explicit WaitGroup(E &engine) : _engine(engine), _counter(0) {}
+
+    void add(std::size_t n = 1) { _counter += n; }
+
+    void done() {
+        if (_counter == 0 || --_counter > 0) {
+            return;
+        }
+
+        std::deque<void *> waiters;
+        waiters.swap(_waiters);
+        for (void *w : waiters) {
+            _engine.unblock(w);
+        }
+    }
+
+    void wait() {
+        if (_counter == 0) {
+            return;
+        }
+
+        // Coroutine is queued once, spurious wakeups find it still there and block again
+        void *self = _engine.current();
+        _waiters.push_back(self);
+        while (std::find(_waiters.begin(), _waiters.end(), self) != _waiters.end()) {
+            _engine.block();
+        }
+    }
+
+private:
+    WaitGroup(const WaitGroup &) = delete;
+    WaitGroup &operator=(const WaitGroup &) = delete;
+
+    E &_engine;
+    std::size_t _counter;
+
+    // Coroutines blocked in wait
+    std::deque<void *> _waiters;
+};
+
+} // namespace Coroutine
+} // namespace Afina
+
+#endif // AFINA_COROUTINE_WAIT_GROUP_H
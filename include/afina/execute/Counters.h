@@ -0,0 +1,48 @@
+#ifndef AFINA_EXECUTE_COUNTERS_H
+#define AFINA_EXECUTE_COUNTERS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Server wide statistics
+ * Counters are kept per cpu, so that updating them from network threads on each request costs an
+ * increment of the local cache line, no shared atomic or lock is involved. Get sums all cpus, it is
+ * meant for the stats command and logs, not for the hot path
+ */
+class Counters {
+public:
+    enum Counter {
+        // Client connections accepted
+        kConnections,
+
+        // Commands executed
+        kCommands,
+
+        // Keys found/not found by get
+        kGetHits,
+        kGetMisses,
+
+        // Bytes received from and sent to clients
+        kBytesRead,
+        kBytesWritten,
+
+        kCount
+    };
+
+    static void Add(Counter counter, uint64_t value = 1);
+
+    // Current value summed over all cpus
+    static uint64_t Get(Counter counter);
+
+    // Name as reported by stats command
+    static const char *Name(Counter counter);
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_COUNTERS_H
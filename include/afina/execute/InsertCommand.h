@@ -19,8 +19,8 @@ public:
     ~InsertCommand() {}
 
     inline const std::string &key() const { return _key; }
-    inline const uint32_t flags() const { return _flags; }
-    inline const int32_t expire() const { return _expire; }
+    inline uint32_t flags() const { return _flags; }
+    inline int32_t expire() const { return _expire; }
 
 protected:
     const std::string _key;
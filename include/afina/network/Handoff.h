@@ -0,0 +1,77 @@
+#ifndef AFINA_NETWORK_HANDOFF_H
+#define AFINA_NETWORK_HANDOFF_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Afina {
+namespace Network {
+
+/**
+ * # Graceful restart
+ * Running process listens on a unix socket for its successor. New process connects there and gets
+ * descriptors, the listening socket first, passed with SCM_RIGHTS. From that moment both accept on
+ * the same socket, so connections queue up in its backlog instead of being refused. Old process then
+ * stops: drains its connections by Server::Stop/Join, saves storage and tells the new one it is done,
+ * so that the new process could load what was saved.
+ *
+ * Protocol is a byte per step: request from the new process, descriptors from the old one in reply,
+ * done byte from the old one once it is stopped. Closed connection counts as done
+ */
+class Handoff {
+public:
+    explicit Handoff(const std::string &path);
+    ~Handoff();
+
+    /**
+     * Ask process running on the path for its descriptors. Returns false if there is no such process,
+     * throws std::runtime_error if it doesn't answer properly
+     */
+    bool TakeOver(std::vector<int> &fds);
+
+    /**
+     * Blocks until the process descriptors were taken from is done, returns at once if there was none
+     */
+    void WaitPrevious();
+
+    /**
+     * Start waiting for the next process in background. Once it asks, given descriptors are sent to it
+     * and on_takeover is called from the background thread, only the first request is served
+     */
+    void Listen(const std::vector<int> &fds, std::function<void()> on_takeover);
+
+    /**
+     * Tell the next process that this one is done. No-op if nobody took over
+     */
+    void Release();
+
+private:
+    Handoff(const Handoff &) = delete;
+    Handoff &operator=(const Handoff &) = delete;
+
+    void OnRun(std::vector<int> fds, std::function<void()> on_takeover);
+
+    std::string _path;
+
+    // Connection to the previous process
+    int _previous;
+
+    // Socket waiting for the next process and connection to it once it came
+    int _listen;
+    int _next;
+
+    std::thread _thread;
+};
+
+/**
+ * Open TCP socket listening on the given port of all interfaces, throws std::runtime_error on failure
+ */
+int OpenListenSocket(uint16_t port);
+
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_HANDOFF_H
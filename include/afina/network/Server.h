@@ -1,6 +1,8 @@
 #ifndef AFINA_NETWORK_SERVER_H
 #define AFINA_NETWORK_SERVER_H
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -11,6 +13,28 @@ class Service;
 }
 namespace Network {
 
+/**
+ * Tuning of network service, each implementation uses those options which make sense for it
+ */
+struct ServerOptions {
+    // Pool of threads serving connections: watermarks, max number of queued connections and time in
+    // milliseconds idle thread waits before exit. Zero high watermark means the number of workers
+    std::size_t low_watermark = 1;
+    std::size_t high_watermark = 0;
+    std::size_t max_queue_size = 10;
+    std::size_t idle_time = 100;
+
+    // Time in milliseconds to wait for data from client before connection is closed, 0 means forever
+    std::size_t read_timeout = 10000;
+
+    // Pin acceptor and worker threads to NUMA nodes round robin, see Concurrency::Topology
+    bool numa_affinity = false;
+
+    // Listening socket to accept connections on instead of opening a new one, e.g. the one taken over
+    // from the previous process. Server never shuts it down, another process could accept on it too
+    int listen_socket = -1;
+};
+
 /**
  * # Network processors coordinator
  * Configure resources for the network processors and coordinates all work
@@ -21,6 +45,11 @@ public:
         : pStorage(ps), pLogging(pl) {}
     virtual ~Server() {}
 
+    /**
+     * Set tuning options, must be called before Start
+     */
+    void SetOptions(const ServerOptions &options) { this->options = options; }
+
     /**
      * Starts network service. After method returns process should
      * listen on the given interface/port pair to process  incomming
@@ -55,6 +84,11 @@ protected:
      * Logging service to be used in order to report application progress
      */
     std::shared_ptr<Afina::Logging::Service> pLogging;
+
+    /**
+     * Tuning options
+     */
+    ServerOptions options;
 };
 
 } // namespace Network
@@ -1,40 +1,399 @@
 #include <afina/allocator/Simple.h>
 
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+
+#include <afina/allocator/Error.h>
 #include <afina/allocator/Pointer.h>
 
 namespace Afina {
 namespace Allocator {
 
-Simple::Simple(void *base, size_t size) : _base(base), _base_len(size) {}
+namespace {
 
-/**
- * TODO: semantics
- * @param N size_t
- */
-Pointer Simple::alloc(size_t N) { return Pointer(); }
+// Blocks and their payloads are aligned to kAlign, block size is always multiple of it
+constexpr size_t kAlign = 16;
 
-/**
- * TODO: semantics
- * @param p Pointer
- * @param N size_t
- */
-void Simple::realloc(Pointer &p, size_t N) {}
+// Smallest free block must hold header, free list links and footer
+constexpr size_t kMinBlock = 48;
 
-/**
- * TODO: semantics
- * @param p Pointer
- */
-void Simple::free(Pointer &p) {}
+// Flags in the low bits of Block::size
+constexpr size_t kFree = 1;
+constexpr size_t kPrevFree = 2;
+constexpr size_t kFlags = kFree | kPrevFree;
 
-/**
- * TODO: semantics
- */
-void Simple::defrag() {}
+// Free handle slots hold next free slot address tagged with this bit
+constexpr uintptr_t kSlotFree = 1;
+
+inline size_t align_up(size_t n, size_t a) { return (n + a - 1) & ~(a - 1); }
+
+} // namespace
 
 /**
- * TODO: semantics
+ * Block header. Used block stores address of its handle. Free block has free list links right after
+ * header and its size in the last word, so that the next block could find it. Next block has
+ * kPrevFree flag set in that case. Two free blocks are never adjacent, as well as free block and the
+ * space after the last block
  */
-std::string Simple::dump() const { return ""; }
+struct Simple::Block {
+    size_t size;
+    void **handle;
+
+    size_t bytes() const { return size & ~kFlags; }
+    char *payload() { return reinterpret_cast<char *>(this + 1); }
+
+    Block *&next_free() { return reinterpret_cast<Block **>(this + 1)[0]; }
+    Block *&prev_free() { return reinterpret_cast<Block **>(this + 1)[1]; }
+    size_t &footer() { return *reinterpret_cast<size_t *>(reinterpret_cast<char *>(this) + bytes() - sizeof(size_t)); }
+};
+
+static_assert(sizeof(size_t) * 2 == kAlign, "Block header must keep payload aligned");
+
+// See Simple.h
+Simple::Simple(void *base, size_t size)
+    : _base(base), _base_len(size), _free_blocks(nullptr), _free_slots(nullptr), _used(0), _used_blocks(0), _moved(0) {
+    uintptr_t begin = align_up(reinterpret_cast<uintptr_t>(base), kAlign);
+    uintptr_t end = (reinterpret_cast<uintptr_t>(base) + size) & ~(uintptr_t)(sizeof(void *) - 1);
+    if (end < begin) {
+        end = begin;
+    }
+
+    _begin = _top = _compact = reinterpret_cast<char *>(begin);
+    _table = _table_end = reinterpret_cast<void **>(end);
+}
+
+// See Simple.h
+Pointer Simple::alloc(size_t N) {
+    void **slot = take_slot();
+    if (slot == nullptr) {
+        throw AllocError(AllocErrorType::NoMemory, "No space for block handle");
+    }
+
+    Block *b = carve(block_size(N));
+    if (b == nullptr) {
+        put_slot(slot);
+        throw AllocError(AllocErrorType::NoMemory, "No free block of " + std::to_string(N) + " bytes");
+    }
+
+    b->handle = slot;
+    *slot = b->payload();
+    _used += b->bytes();
+    _used_blocks++;
+    return Pointer(slot);
+}
+
+// See Simple.h
+void Simple::realloc(Pointer &p, size_t N) {
+    if (p._slot == nullptr) {
+        p = alloc(N);
+        return;
+    }
+
+    Block *b = block_of(p);
+    size_t need = block_size(N);
+    size_t cur = b->bytes();
+    if (need <= cur) {
+        split(b, need);
+        _used -= cur - b->bytes();
+        return;
+    }
+
+    // Try to grow in place
+    Block *next = next_block(b);
+    if (reinterpret_cast<char *>(next) == _top) {
+        if (_top + (need - cur) <= reinterpret_cast<char *>(_table)) {
+            b->size = need | (b->size & kFlags);
+            _top = reinterpret_cast<char *>(b) + need;
+            _used += need - cur;
+            rewind(reinterpret_cast<char *>(b));
+            return;
+        }
+    } else if ((next->size & kFree) && cur + next->bytes() >= need) {
+        remove_free(next);
+        b->size = (cur + next->bytes()) | (b->size & kFlags);
+        next_block(b)->size &= ~kPrevFree;
+        split(b, need);
+        _used += b->bytes() - cur;
+        rewind(reinterpret_cast<char *>(b));
+        return;
+    }
+
+    Block *nb = carve(need);
+    if (nb == nullptr) {
+        throw AllocError(AllocErrorType::NoMemory, "No free block of " + std::to_string(N) + " bytes");
+    }
+
+    std::memcpy(nb->payload(), b->payload(), cur - sizeof(Block));
+    nb->handle = b->handle;
+    *nb->handle = nb->payload();
+    _used += nb->bytes() - cur;
+    release(b);
+}
+
+// See Simple.h
+void Simple::free(Pointer &p) {
+    if (p._slot == nullptr) {
+        return;
+    }
+
+    Block *b = block_of(p);
+    put_slot(b->handle);
+    _used -= b->bytes();
+    _used_blocks--;
+    release(b);
+    p._slot = nullptr;
+}
+
+// See Simple.h
+void Simple::defrag() {
+    char *dst = _begin;
+    for (Block *b = first_block(), *next; reinterpret_cast<char *>(b) < _top; b = next) {
+        next = next_block(b);
+        if (b->size & kFree) {
+            continue;
+        }
+
+        size_t size = b->bytes();
+        if (reinterpret_cast<char *>(b) != dst) {
+            std::memmove(dst, b, size);
+            b = reinterpret_cast<Block *>(dst);
+            *b->handle = b->payload();
+            _moved += size;
+        }
+        b->size = size;
+        dst += size;
+    }
+
+    _top = _compact = dst;
+    _free_blocks = nullptr;
+}
+
+// See Simple.h
+bool Simple::defrag_step(size_t max_bytes, std::chrono::microseconds max_time) {
+    using clock = std::chrono::steady_clock;
+    bool timed = max_time != std::chrono::microseconds::max();
+    clock::time_point deadline = timed ? clock::now() + max_time : clock::time_point();
+
+    // Skip compacted blocks up to the first hole
+    Block *gap = reinterpret_cast<Block *>(_compact);
+    while (reinterpret_cast<char *>(gap) < _top && !(gap->size & kFree)) {
+        gap = next_block(gap);
+    }
+    _compact = reinterpret_cast<char *>(gap);
+    if (_compact == _top) {
+        return true;
+    }
+
+    // Hole moves towards the end of blocks: used blocks after it slide down, free ones join it
+    remove_free(gap);
+    char *dst = _compact;
+    char *src = dst + gap->bytes();
+    size_t moved = 0;
+    while (src < _top) {
+        Block *b = reinterpret_cast<Block *>(src);
+        size_t size = b->bytes();
+        if (b->size & kFree) {
+            remove_free(b);
+            src += size;
+            continue;
+        }
+
+        if (moved > 0 && (moved >= max_bytes || (timed && clock::now() >= deadline))) {
+            break;
+        }
+
+        std::memmove(dst, b, size);
+        b = reinterpret_cast<Block *>(dst);
+        b->size = size;
+        *b->handle = b->payload();
+        dst += size;
+        src += size;
+        moved += size;
+    }
+    _moved += moved;
+
+    if (src == _top) {
+        _top = _compact = dst;
+        return true;
+    }
+
+    gap = reinterpret_cast<Block *>(dst);
+    gap->size = src - dst;
+    insert_free(gap);
+    _compact = dst;
+    return false;
+}
+
+// See Simple.h
+Simple::Stats Simple::stats() const {
+    Stats result;
+    result.used = _used;
+    result.used_blocks = _used_blocks;
+    result.free = result.free_blocks = result.largest_free = 0;
+    for (Block *b = _free_blocks; b != nullptr; b = b->next_free()) {
+        result.free += b->bytes();
+        result.free_blocks++;
+        if (b->bytes() > result.largest_free) {
+            result.largest_free = b->bytes();
+        }
+    }
+    result.tail = reinterpret_cast<char *>(_table) - _top;
+    result.moved = _moved;
+
+    size_t total = result.free + result.tail;
+    size_t largest = result.largest_free > result.tail ? result.largest_free : result.tail;
+    result.fragmentation = total > 0 ? 1.0 - double(largest) / total : 0.0;
+    return result;
+}
+
+// See Simple.h
+std::string Simple::dump() const {
+    std::stringstream out;
+    size_t used = 0, free = 0, blocks = 0;
+    for (Block *b = first_block(); reinterpret_cast<char *>(b) < _top; b = next_block(b)) {
+        out << (b->size & kFree ? "free " : "used ") << reinterpret_cast<char *>(b) - _begin << " " << b->bytes()
+            << "\n";
+        (b->size & kFree ? free : used) += b->bytes();
+        blocks++;
+    }
+    out << "blocks " << blocks << ", used " << used << ", free " << free << ", tail "
+        << reinterpret_cast<char *>(_table) - _top << ", handles " << _table_end - _table << "\n";
+    return out.str();
+}
+
+// See Simple.h
+size_t Simple::block_size(size_t N) {
+    size_t size = align_up(N + sizeof(Block), kAlign);
+    return size < kMinBlock ? kMinBlock : size;
+}
+
+// See Simple.h
+Simple::Block *Simple::first_block() const { return reinterpret_cast<Block *>(_begin); }
+
+// See Simple.h
+Simple::Block *Simple::next_block(Block *b) const {
+    return reinterpret_cast<Block *>(reinterpret_cast<char *>(b) + b->bytes());
+}
+
+// See Simple.h
+Simple::Block *Simple::block_of(const Pointer &p) const {
+    void **slot = p._slot;
+    if (slot < _table || slot >= _table_end) {
+        throw AllocError(AllocErrorType::InvalidFree, "Pointer doesn't belong to allocator");
+    }
+
+    char *payload = static_cast<char *>(*slot);
+    if ((reinterpret_cast<uintptr_t>(payload) & kSlotFree) || payload < _begin + sizeof(Block) || payload >= _top) {
+        throw AllocError(AllocErrorType::InvalidFree, "Pointer refers to released block");
+    }
+    return reinterpret_cast<Block *>(payload - sizeof(Block));
+}
+
+// See Simple.h
+Simple::Block *Simple::carve(size_t size) {
+    for (Block *b = _free_blocks; b != nullptr; b = b->next_free()) {
+        if (b->bytes() < size) {
+            continue;
+        }
+
+        remove_free(b);
+        b->size &= ~kFree;
+        next_block(b)->size &= ~kPrevFree;
+        split(b, size);
+        return b;
+    }
+
+    if (_top + size > reinterpret_cast<char *>(_table)) {
+        return nullptr;
+    }
+    Block *b = reinterpret_cast<Block *>(_top);
+    b->size = size;
+    _top += size;
+    return b;
+}
+
+// See Simple.h
+void Simple::split(Block *b, size_t size) {
+    size_t rest = b->bytes() - size;
+    if (rest < kMinBlock) {
+        return;
+    }
+
+    b->size = size | (b->size & kFlags);
+    Block *tail = next_block(b);
+    tail->size = rest;
+    release(tail);
+}
+
+// See Simple.h
+void Simple::release(Block *b) {
+    if (b->size & kPrevFree) {
+        Block *prev = reinterpret_cast<Block *>(reinterpret_cast<char *>(b) - reinterpret_cast<size_t *>(b)[-1]);
+        remove_free(prev);
+        prev->size = prev->bytes() + b->bytes();
+        b = prev;
+    }
+    rewind(reinterpret_cast<char *>(b));
+
+    Block *next = next_block(b);
+    if (reinterpret_cast<char *>(next) == _top) {
+        _top = reinterpret_cast<char *>(b);
+        return;
+    }
+
+    if (next->size & kFree) {
+        remove_free(next);
+        b->size = b->bytes() + next->bytes();
+    }
+    insert_free(b);
+}
+
+// See Simple.h
+void Simple::insert_free(Block *b) {
+    b->size = b->bytes() | kFree;
+    b->footer() = b->bytes();
+    next_block(b)->size |= kPrevFree;
+
+    b->prev_free() = nullptr;
+    b->next_free() = _free_blocks;
+    if (_free_blocks != nullptr) {
+        _free_blocks->prev_free() = b;
+    }
+    _free_blocks = b;
+}
+
+// See Simple.h
+void Simple::remove_free(Block *b) {
+    if (b->prev_free() != nullptr) {
+        b->prev_free()->next_free() = b->next_free();
+    } else {
+        _free_blocks = b->next_free();
+    }
+    if (b->next_free() != nullptr) {
+        b->next_free()->prev_free() = b->prev_free();
+    }
+}
+
+// See Simple.h
+void **Simple::take_slot() {
+    if (_free_slots != nullptr) {
+        void **slot = _free_slots;
+        _free_slots = reinterpret_cast<void **>(reinterpret_cast<uintptr_t>(*slot) & ~kSlotFree);
+        return slot;
+    }
+
+    if (reinterpret_cast<char *>(_table - 1) < _top) {
+        return nullptr;
+    }
+    return --_table;
+}
+
+// See Simple.h
+void Simple::put_slot(void **slot) {
+    *slot = reinterpret_cast<void *>(reinterpret_cast<uintptr_t>(_free_slots) | kSlotFree);
+    _free_slots = slot;
+}
 
 } // namespace Allocator
 } // namespace Afina
@@ -0,0 +1,429 @@
+#include <afina/allocator/Slab.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/mman.h>
+
+#include <afina/allocator/Error.h>
+#include <afina/concurrency/Topology.h>
+
+namespace Afina {
+namespace Allocator {
+
+namespace {
+
+// Every object is aligned to that
+constexpr std::size_t kAlignment = 8;
+
+// Slab header takes the whole cache line, so the first object doesn't share it with the header
+constexpr std::size_t kHeaderSize = 64;
+
+// Upper limit for objects cached by thread in one class, both by count and by bytes
+constexpr std::size_t kMagazineObjects = 32;
+constexpr std::size_t kMagazineBytes = 64 * 1024;
+
+std::size_t align_up(std::size_t value, std::size_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+// Explicit huge page mapping: pages are reserved from the pool right away, so mmap fails instead of
+// SIGBUS on first touch if there are not enough of them
+void *map_huge(std::size_t size, int shift) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (shift << MAP_HUGE_SHIFT);
+    return mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+}
+
+} // namespace
+
+constexpr int Slab::kAnyNode;
+constexpr int Slab::kInterleave;
+
+struct Slab::SlabHeader {
+    // Neighbours in the class list of slabs with free objects or in the arena free list
+    SlabHeader *prev;
+    SlabHeader *next;
+
+    SizeClass *cls;
+
+    // Freed objects are linked through their first word, those never allocated yet start at bump
+    void *free_list;
+    std::size_t bump;
+
+    // Objects given out of the slab
+    std::size_t used;
+};
+
+struct Slab::SizeClass {
+    std::mutex mutex;
+
+    std::size_t index;
+    std::size_t size;
+
+    // Objects in one slab and in the thread magazine, 0 means objects are never cached
+    std::size_t per_slab;
+    std::size_t magazine;
+
+    // Slabs having free objects, full ones are not linked anywhere
+    SlabHeader *partial;
+
+    std::size_t slabs;
+    std::size_t objects;
+};
+
+struct Slab::Magazines {
+    struct Magazine {
+        std::size_t count = 0;
+        void *objects[kMagazineObjects];
+    };
+
+    // Created on first use, number of classes isn't known to default constructor
+    std::vector<Magazine> classes;
+};
+
+// See Slab.h
+Slab::Slab(std::size_t arena_size, std::size_t slab_size, double factor, std::size_t min_size, int node, Pages pages)
+    : _slab_size(slab_size), _region(nullptr), _region_size(0), _arena(nullptr), _pages(pages), _arena_next(0),
+      _free_slabs(nullptr), _slabs_used(0) {
+    static_assert(kHeaderSize >= sizeof(SlabHeader), "slab header doesn't fit");
+    if (slab_size < 2 * kHeaderSize || (slab_size & (slab_size - 1)) != 0) {
+        throw std::invalid_argument("Slab size must be power of two");
+    }
+    if (factor <= 1.0) {
+        throw std::invalid_argument("Size classes factor must be greater than 1");
+    }
+
+    // Extra slab to align arena, untouched pages cost nothing
+    _slab_count = std::max<std::size_t>(1, (arena_size + slab_size - 1) / slab_size);
+    _region_size = (_slab_count + 1) * slab_size;
+    _region = MAP_FAILED;
+    if (pages == Pages::kHuge2M || pages == Pages::kHuge1G) {
+        int shift = pages == Pages::kHuge2M ? 21 : 30;
+        std::size_t size = align_up(_region_size, std::size_t(1) << shift);
+        _region = map_huge(size, shift);
+        if (_region != MAP_FAILED) {
+            _region_size = size;
+        } else {
+            _pages = Pages::kTransparent;
+        }
+    }
+    if (_region == MAP_FAILED) {
+        _region =
+            mmap(nullptr, _region_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    }
+    if (_region == MAP_FAILED) {
+        throw AllocError(AllocErrorType::NoMemory, "Failed to reserve slab arena");
+    }
+
+    // Advice is ignored if THP is disabled, arena then stays on regular pages
+    if (_pages == Pages::kTransparent) {
+        madvise(_region, _region_size, MADV_HUGEPAGE);
+    }
+
+    // Policy is only a hint, arena still works if kernel has no NUMA support
+    if (node >= 0) {
+        Concurrency::Topology::System().BindMemory(_region, _region_size, node);
+    } else if (node == kInterleave) {
+        Concurrency::Topology::System().InterleaveMemory(_region, _region_size);
+    }
+    _arena = reinterpret_cast<char *>(align_up(reinterpret_cast<uintptr_t>(_region), slab_size));
+
+    const std::size_t max_object = slab_size - kHeaderSize;
+    for (std::size_t size = align_up(std::max(min_size, kAlignment), kAlignment); size <= max_object;) {
+        std::unique_ptr<SizeClass> cls(new SizeClass());
+        cls->index = _classes.size();
+        cls->size = size;
+        cls->per_slab = max_object / size;
+        cls->magazine = std::min(kMagazineObjects, kMagazineBytes / size);
+        cls->partial = nullptr;
+        cls->slabs = 0;
+        cls->objects = 0;
+        _classes.push_back(std::move(cls));
+
+        std::size_t next = align_up(std::size_t(size * factor), kAlignment);
+        next = std::max(next, size + kAlignment);
+        if (size < max_object && next > max_object) {
+            next = max_object / kAlignment * kAlignment;
+        }
+        if (next <= size) {
+            break;
+        }
+        size = next;
+    }
+
+    _magazines.reset(new Concurrency::ThreadLocal<Magazines>([this](Magazines &magazines) { flush(magazines); }));
+}
+
+// See Slab.h
+Slab::~Slab() {
+    // Objects cached by alive threads go away together with the arena
+    _magazines.reset();
+    munmap(_region, _region_size);
+}
+
+// See Slab.h
+std::size_t Slab::huge_bytes() const {
+    if (_pages == Pages::kRegular) {
+        return 0;
+    } else if (_pages != Pages::kTransparent) {
+        return _region_size;
+    }
+
+    // Region could be split into several mappings by NUMA policy, each reports its own huge pages
+    std::ifstream smaps("/proc/self/smaps");
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(_region), end = begin + _region_size;
+    std::size_t result = 0;
+    bool inside = false;
+    std::string line;
+    while (std::getline(smaps, line)) {
+        unsigned long from, to;
+        char dash;
+        std::istringstream fields(line);
+        if (line.compare(0, 14, "AnonHugePages:") == 0) {
+            std::size_t kb = 0;
+            fields.ignore(14) >> kb;
+            result += inside ? kb * 1024 : 0;
+        } else if (line.find(':') > line.find(' ') && fields >> std::hex >> from >> dash >> to && dash == '-') {
+            inside = from >= begin && to <= end;
+        }
+    }
+    return result;
+}
+
+// See Slab.h
+void *Slab::alloc(std::size_t N) {
+    int index = class_of(N);
+    if (index < 0) {
+        throw AllocError(AllocErrorType::NoMemory, "Object is too big for slab");
+    }
+    SizeClass &cls = *_classes[index];
+
+    void *object = nullptr;
+    if (cls.magazine == 0) {
+        std::lock_guard<std::mutex> lock(cls.mutex);
+        take_locked(cls, &object, 1);
+    } else {
+        Magazines &magazines = _magazines->Get();
+        if (magazines.classes.empty()) {
+            magazines.classes.resize(_classes.size());
+        }
+
+        Magazines::Magazine &magazine = magazines.classes[index];
+        if (magazine.count == 0) {
+            std::lock_guard<std::mutex> lock(cls.mutex);
+            magazine.count = take_locked(cls, magazine.objects, std::max<std::size_t>(1, cls.magazine / 2));
+        }
+        if (magazine.count > 0) {
+            object = magazine.objects[--magazine.count];
+        }
+    }
+
+    if (object == nullptr) {
+        throw AllocError(AllocErrorType::NoMemory, "Slab arena is exhausted");
+    }
+    return object;
+}
+
+// See Slab.h
+void Slab::free(void *p) {
+    if (p == nullptr) {
+        return;
+    }
+
+    SlabHeader *slab = reinterpret_cast<SlabHeader *>(reinterpret_cast<uintptr_t>(p) & ~uintptr_t(_slab_size - 1));
+    SizeClass &cls = *slab->cls;
+    if (cls.magazine == 0) {
+        std::lock_guard<std::mutex> lock(cls.mutex);
+        put_locked(cls, &p, 1);
+        return;
+    }
+
+    Magazines &magazines = _magazines->Get();
+    if (magazines.classes.empty()) {
+        magazines.classes.resize(_classes.size());
+    }
+
+    // Full magazine gives back older half, recently freed objects are still hot
+    Magazines::Magazine &magazine = magazines.classes[cls.index];
+    if (magazine.count == cls.magazine) {
+        std::size_t half = std::max<std::size_t>(1, cls.magazine / 2);
+        {
+            std::lock_guard<std::mutex> lock(cls.mutex);
+            put_locked(cls, magazine.objects, half);
+        }
+        std::copy(magazine.objects + half, magazine.objects + magazine.count, magazine.objects);
+        magazine.count -= half;
+    }
+    magazine.objects[magazine.count++] = p;
+}
+
+// See Slab.h
+std::size_t Slab::footprint(std::size_t N) const {
+    int index = class_of(N);
+    return index < 0 ? 0 : _classes[index]->size;
+}
+
+// See Slab.h
+std::size_t Slab::max_size() const { return _classes.empty() ? 0 : _classes.back()->size; }
+
+// See Slab.h
+void Slab::flush() {
+    flush(_magazines->Get());
+
+    // Empty slabs kept by classes could serve other classes now
+    for (auto &cls : _classes) {
+        std::lock_guard<std::mutex> lock(cls->mutex);
+        SlabHeader *slab = cls->partial;
+        if (slab != nullptr && slab->used == 0 && slab->next == nullptr) {
+            cls->partial = nullptr;
+            cls->slabs--;
+            release_slab(slab);
+        }
+    }
+}
+
+// See Slab.h
+std::string Slab::dump() const {
+    std::stringstream out;
+    out << "arena " << capacity() << " bytes, " << used() << " used by slabs" << std::endl;
+    for (auto &cls : _classes) {
+        std::lock_guard<std::mutex> lock(cls->mutex);
+        if (cls->slabs > 0) {
+            out << "class " << cls->size << ": " << cls->slabs << " slabs, " << cls->objects << " objects"
+                << std::endl;
+        }
+    }
+    return out.str();
+}
+
+// See Slab.h
+int Slab::class_of(std::size_t N) const {
+    auto it = std::lower_bound(_classes.begin(), _classes.end(), N,
+                               [](const std::unique_ptr<SizeClass> &cls, std::size_t n) { return cls->size < n; });
+    return it == _classes.end() ? -1 : int(it - _classes.begin());
+}
+
+// See Slab.h
+std::size_t Slab::take_locked(SizeClass &cls, void **objects, std::size_t n) {
+    std::size_t taken = 0;
+    while (taken < n) {
+        SlabHeader *slab = cls.partial;
+        if (slab == nullptr) {
+            slab = acquire_slab();
+            if (slab == nullptr) {
+                break;
+            }
+            slab->prev = slab->next = nullptr;
+            slab->cls = &cls;
+            slab->free_list = nullptr;
+            slab->bump = 0;
+            slab->used = 0;
+            cls.partial = slab;
+            cls.slabs++;
+        }
+
+        while (taken < n && slab->used < cls.per_slab) {
+            void *object = slab->free_list;
+            if (object != nullptr) {
+                slab->free_list = *reinterpret_cast<void **>(object);
+            } else {
+                object = reinterpret_cast<char *>(slab) + kHeaderSize + slab->bump * cls.size;
+                slab->bump++;
+            }
+            slab->used++;
+            objects[taken++] = object;
+        }
+
+        // Full slab leaves the list until some object gets back
+        if (slab->used == cls.per_slab) {
+            cls.partial = slab->next;
+            if (slab->next != nullptr) {
+                slab->next->prev = nullptr;
+            }
+            slab->prev = slab->next = nullptr;
+        }
+    }
+    cls.objects += taken;
+    return taken;
+}
+
+// See Slab.h
+void Slab::put_locked(SizeClass &cls, void *const *objects, std::size_t n) {
+    for (std::size_t i = 0; i < n; i++) {
+        void *object = objects[i];
+        SlabHeader *slab =
+            reinterpret_cast<SlabHeader *>(reinterpret_cast<uintptr_t>(object) & ~uintptr_t(_slab_size - 1));
+
+        if (slab->used == cls.per_slab) {
+            slab->prev = nullptr;
+            slab->next = cls.partial;
+            if (cls.partial != nullptr) {
+                cls.partial->prev = slab;
+            }
+            cls.partial = slab;
+        }
+
+        *reinterpret_cast<void **>(object) = slab->free_list;
+        slab->free_list = object;
+        slab->used--;
+
+        // Empty slab goes back to arena unless it is the last one with free space, that saves from
+        // taking and returning the same slab on each alloc/free
+        if (slab->used == 0 && (cls.partial != slab || slab->next != nullptr)) {
+            if (slab->prev != nullptr) {
+                slab->prev->next = slab->next;
+            } else {
+                cls.partial = slab->next;
+            }
+            if (slab->next != nullptr) {
+                slab->next->prev = slab->prev;
+            }
+            cls.slabs--;
+            release_slab(slab);
+        }
+    }
+    cls.objects -= n;
+}
+
+// See Slab.h
+Slab::SlabHeader *Slab::acquire_slab() {
+    std::lock_guard<std::mutex> lock(_arena_mutex);
+    SlabHeader *slab = _free_slabs;
+    if (slab != nullptr) {
+        _free_slabs = slab->next;
+    } else if (_arena_next < _slab_count) {
+        slab = reinterpret_cast<SlabHeader *>(_arena + _arena_next * _slab_size);
+        _arena_next++;
+    } else {
+        return nullptr;
+    }
+    _slabs_used.fetch_add(1, std::memory_order_relaxed);
+    return slab;
+}
+
+// See Slab.h
+void Slab::release_slab(SlabHeader *slab) {
+    std::lock_guard<std::mutex> lock(_arena_mutex);
+    slab->next = _free_slabs;
+    _free_slabs = slab;
+    _slabs_used.fetch_sub(1, std::memory_order_relaxed);
+}
+
+// See Slab.h
+void Slab::flush(Magazines &magazines) {
+    for (std::size_t i = 0; i < magazines.classes.size(); i++) {
+        Magazines::Magazine &magazine = magazines.classes[i];
+        if (magazine.count > 0) {
+            std::lock_guard<std::mutex> lock(_classes[i]->mutex);
+            put_locked(*_classes[i], magazine.objects, magazine.count);
+            magazine.count = 0;
+        }
+    }
+}
+
+} // namespace Allocator
+} // namespace Afina
@@ -0,0 +1,146 @@
+#ifndef AFINA_CONCURRENCY_CHASE_LEV_DEQUE_H
+#define AFINA_CONCURRENCY_CHASE_LEV_DEQUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Afina {
+namespace Concurrency {
+
+/**
+ * # Chase-Lev work stealing deque
+ * Owner thread pushes and pops items at the bottom end, any other thread could steal from the top one.
+ * Neither of operations takes a lock, the only contended point is the last item which both owner and
+ * thieves resolve by CAS on top index. Memory orders follow "Correct and Efficient Work-Stealing for
+ * Weak Memory Models" by Le et al.
+ *
+ * Buffer grows when full, old buffers are kept until deque is destroyed as thieves might still read them.
+ * Items must be trivially copyable, usually pointers
+ */
+template <typename T> class ChaseLevDeque {
+public:
+    explicit ChaseLevDeque(std::size_t capacity = 64) : _top(0), _bottom(0) {
+        std::size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        _buffer.store(new Buffer(size), std::memory_order_relaxed);
+    }
+
+    ~ChaseLevDeque() {
+        delete _buffer.load(std::memory_order_relaxed);
+        for (Buffer *b : _retired) {
+            delete b;
+        }
+    }
+
+    /**
+     * Add item to the bottom, owner thread only
+     */
+    void Push(T item) {
+        int64_t b = _bottom.load(std::memory_order_relaxed);
+        int64_t t = _top.load(std::memory_order_acquire);
+        Buffer *buf = _buffer.load(std::memory_order_relaxed);
+        if (b - t > int64_t(buf->mask)) {
+            buf = Grow(buf, t, b);
+        }
+        buf->Put(b, item);
+        _bottom.store(b + 1, std::memory_order_release);
+    }
+
+    /**
+     * Take item from the bottom, owner thread only. Returns false if deque is empty
+     */
+    bool Pop(T &item) {
+        int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+        Buffer *buf = _buffer.load(std::memory_order_relaxed);
+        _bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = _top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        item = buf->Get(b);
+        if (t == b) {
+            // Last item, race against thieves
+            bool won = _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    /**
+     * Take item from the top, any thread. Returns false if deque is empty or another thread took the
+     * item first
+     */
+    bool Steal(T &item) {
+        int64_t t = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = _bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return false;
+        }
+
+        Buffer *buf = _buffer.load(std::memory_order_acquire);
+        item = buf->Get(t);
+        return _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    // Approximate number of items, exact for the owner thread
+    std::size_t Size() const {
+        int64_t b = _bottom.load(std::memory_order_relaxed);
+        int64_t t = _top.load(std::memory_order_relaxed);
+        return b > t ? std::size_t(b - t) : 0;
+    }
+
+    bool Empty() const { return Size() == 0; }
+
+private:
+    ChaseLevDeque(const ChaseLevDeque &) = delete;
+    ChaseLevDeque &operator=(const ChaseLevDeque &) = delete;
+
+    // Circular array of items, indices grow forever and get masked
+    struct Buffer {
+        explicit Buffer(std::size_t size) : mask(size - 1), items(new std::atomic<T>[size]) {}
+        ~Buffer() { delete[] items; }
+
+        T Get(int64_t i) const { return items[i & mask].load(std::memory_order_relaxed); }
+        void Put(int64_t i, T item) { items[i & mask].store(item, std::memory_order_relaxed); }
+
+        std::size_t mask;
+        std::atomic<T> *items;
+    };
+
+    Buffer *Grow(Buffer *old, int64_t t, int64_t b) {
+        Buffer *buf = new Buffer((old->mask + 1) * 2);
+        for (int64_t i = t; i < b; i++) {
+            buf->Put(i, old->Get(i));
+        }
+        _retired.push_back(old);
+        _buffer.store(buf, std::memory_order_release);
+        return buf;
+    }
+
+    // Indices are on separate cache lines as top is hammered by thieves while bottom by the owner
+    std::atomic<int64_t> _top;
+    char _top_pad[64 - sizeof(std::atomic<int64_t>)];
+
+    std::atomic<int64_t> _bottom;
+    char _bottom_pad[64 - sizeof(std::atomic<int64_t>)];
+
+    std::atomic<Buffer *> _buffer;
+
+    // Buffers replaced by bigger ones, owner thread only
+    std::vector<Buffer *> _retired;
+};
+
+} // namespace Concurrency
+} // namespace Afina
+
+#endif // AFINA_CONCURRENCY_CHASE_LEV_DEQUE_H
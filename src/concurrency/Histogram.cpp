@@ -0,0 +1,122 @@
+#include <afina/concurrency/Histogram.h>
+
+#include <cmath>
+
+namespace Afina {
+namespace Concurrency {
+
+constexpr std::size_t Histogram::kSubBucketHalf;
+constexpr std::size_t Histogram::kCounts;
+
+// See Histogram.h
+Histogram::Histogram() : _counts(new std::atomic<uint64_t>[kCounts]), _sum(0) { Reset(); }
+
+// See Histogram.h
+Histogram::Histogram(const Histogram &other) : Histogram() { Merge(other); }
+
+// See Histogram.h
+Histogram &Histogram::operator=(const Histogram &other) {
+    if (this != &other) {
+        Reset();
+        Merge(other);
+    }
+    return *this;
+}
+
+// See Histogram.h
+std::size_t Histogram::IndexOf(uint64_t value) {
+    const uint64_t max_value = (uint64_t(1) << kMaxValueBits) - 1;
+    if (value > max_value) {
+        value = max_value;
+    }
+
+    // Position of the highest bit decides power of two bucket, first bucket holds both halves of
+    // sub-buckets as there is nothing below it
+    const uint64_t sub_bucket_mask = (uint64_t(1) << kSubBucketBits) - 1;
+    int bucket = 63 - __builtin_clzll(value | sub_bucket_mask) - (kSubBucketBits - 1);
+    std::size_t sub_bucket = std::size_t(value >> bucket);
+    return (std::size_t(bucket + 1) << (kSubBucketBits - 1)) + sub_bucket - kSubBucketHalf;
+}
+
+// See Histogram.h
+uint64_t Histogram::ValueAt(std::size_t index) {
+    int bucket = int(index >> (kSubBucketBits - 1)) - 1;
+    std::size_t sub_bucket = (index & (kSubBucketHalf - 1)) + kSubBucketHalf;
+    if (bucket < 0) {
+        sub_bucket -= kSubBucketHalf;
+        bucket = 0;
+    }
+    return (uint64_t(sub_bucket) << bucket) + (uint64_t(1) << bucket) - 1;
+}
+
+// See Histogram.h
+void Histogram::Record(uint64_t value) {
+    _counts[IndexOf(value)].fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+// See Histogram.h
+void Histogram::Merge(const Histogram &other) {
+    for (std::size_t i = 0; i < kCounts; i++) {
+        uint64_t count = other._counts[i].load(std::memory_order_relaxed);
+        if (count > 0) {
+            _counts[i].fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+    _sum.fetch_add(other._sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+// See Histogram.h
+void Histogram::Reset() {
+    for (std::size_t i = 0; i < kCounts; i++) {
+        _counts[i].store(0, std::memory_order_relaxed);
+    }
+    _sum.store(0, std::memory_order_relaxed);
+}
+
+// See Histogram.h
+uint64_t Histogram::Count() const {
+    // Not kept separately to save one more atomic increment per Record
+    uint64_t total = 0;
+    for (std::size_t i = 0; i < kCounts; i++) {
+        total += _counts[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+// See Histogram.h
+double Histogram::Mean() const {
+    uint64_t total = Count();
+    return total > 0 ? double(_sum.load(std::memory_order_relaxed)) / total : 0.0;
+}
+
+// See Histogram.h
+uint64_t Histogram::Percentile(double percent) const {
+    uint64_t total = Count();
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = uint64_t(std::ceil(percent / 100.0 * total));
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    std::size_t last = 0;
+    for (std::size_t i = 0; i < kCounts; i++) {
+        uint64_t count = _counts[i].load(std::memory_order_relaxed);
+        if (count == 0) {
+            continue;
+        }
+        seen += count;
+        last = i;
+        if (seen >= rank) {
+            break;
+        }
+    }
+    return ValueAt(last);
+}
+
+} // namespace Concurrency
+} // namespace Afina
@@ -0,0 +1,113 @@
+#ifndef AFINA_CONCURRENCY_INJECTION_QUEUE_H
+#define AFINA_CONCURRENCY_INJECTION_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Afina {
+namespace Concurrency {
+
+/**
+ * # Bounded multi-producer multi-consumer queue of tasks
+ * Dmitry Vyukov's array based queue: each cell carries sequence number telling whether it is ready for
+ * the producer or consumer at the given position, so the only shared writes are CAS on enqueue/dequeue
+ * positions. Items are moved right into cells, so no allocation happens on push/pop
+ */
+template <typename T> class InjectionQueue {
+public:
+    explicit InjectionQueue(std::size_t capacity)
+        : _capacity(capacity > 0 ? capacity : 1), _ncells(_capacity > 1 ? _capacity : 2), _cells(new Cell[_ncells]),
+          _enqueue_pos(0), _dequeue_pos(0) {
+        for (std::size_t i = 0; i < _ncells; i++) {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Move item into the queue, returns false if queue is full. Item is left untouched in that case
+     */
+    bool Push(T &&item) {
+        std::size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = _cells[pos % _ncells];
+            std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = intptr_t(seq) - intptr_t(pos);
+            if (diff == 0 && _ncells > _capacity && pos - _dequeue_pos.load(std::memory_order_acquire) >= _capacity) {
+                return false;
+            } else if (diff == 0) {
+                if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.item = std::move(item);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * Move item out of the queue, returns false if queue is empty
+     */
+    bool Pop(T &item) {
+        std::size_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = _cells[pos % _ncells];
+            std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = intptr_t(seq) - intptr_t(pos + 1);
+            if (diff == 0) {
+                if (_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    item = std::move(cell.item);
+                    cell.sequence.store(pos + _ncells, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Approximate number of queued items
+    std::size_t Size() const {
+        std::size_t head = _dequeue_pos.load(std::memory_order_relaxed);
+        std::size_t tail = _enqueue_pos.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    bool Empty() const { return Size() == 0; }
+
+    std::size_t Capacity() const { return _capacity; }
+
+private:
+    InjectionQueue(const InjectionQueue &) = delete;
+    InjectionQueue &operator=(const InjectionQueue &) = delete;
+
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T item;
+    };
+
+    const std::size_t _capacity;
+
+    // Algorithm can't tell full cell from the free one with the single cell, so there are at least two
+    const std::size_t _ncells;
+    std::unique_ptr<Cell[]> _cells;
+
+    // Producers and consumers positions live on separate cache lines
+    char _cells_pad[64];
+    std::atomic<std::size_t> _enqueue_pos;
+    char _enqueue_pad[64 - sizeof(std::atomic<std::size_t>)];
+    std::atomic<std::size_t> _dequeue_pos;
+    char _dequeue_pad[64 - sizeof(std::atomic<std::size_t>)];
+};
+
+} // namespace Concurrency
+} // namespace Afina
+
+#endif // AFINA_CONCURRENCY_INJECTION_QUEUE_H
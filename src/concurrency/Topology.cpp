@@ -0,0 +1,173 @@
+#include <afina/concurrency/Topology.h>
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace Afina {
+namespace Concurrency {
+
+namespace {
+
+bool read_line(const std::string &path, std::string &line) {
+    std::ifstream in(path);
+    return in && std::getline(in, line);
+}
+
+} // namespace
+
+// See Topology.h
+std::vector<int> ParseCpuList(const std::string &list) {
+    std::vector<int> cpus;
+    std::stringstream in(list);
+    std::string range;
+    while (std::getline(in, range, ',')) {
+        range.erase(std::remove_if(range.begin(), range.end(), [](char c) { return std::isspace(c); }),
+                    range.end());
+        if (range.empty()) {
+            continue;
+        }
+
+        size_t dash = range.find('-');
+        int first = std::atoi(range.c_str());
+        int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// See Topology.h
+Topology::Topology(const std::string &sysfs) {
+    std::vector<std::pair<int, std::vector<int>>> nodes;
+    std::string node_dir = sysfs + "/node";
+    if (DIR *dir = opendir(node_dir.c_str())) {
+        while (struct dirent *entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+                !std::all_of(name.begin() + 4, name.end(), [](char c) { return std::isdigit(c); })) {
+                continue;
+            }
+
+            std::string cpulist;
+            if (read_line(node_dir + "/" + name + "/cpulist", cpulist)) {
+                nodes.emplace_back(std::atoi(name.c_str() + 4), ParseCpuList(cpulist));
+            }
+        }
+        closedir(dir);
+    }
+    std::sort(nodes.begin(), nodes.end());
+
+    // No NUMA: single node of all online CPUs
+    if (nodes.empty()) {
+        std::string online;
+        std::vector<int> cpus;
+        if (read_line(sysfs + "/cpu/online", online)) {
+            cpus = ParseCpuList(online);
+        }
+        if (cpus.empty()) {
+            for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++) {
+                cpus.push_back(cpu);
+            }
+        }
+        nodes.emplace_back(0, std::move(cpus));
+    }
+
+    for (auto &node : nodes) {
+        _ids.push_back(node.first);
+        _cpus.push_back(std::move(node.second));
+    }
+}
+
+// See Topology.h
+const Topology &Topology::System() {
+    static Topology topology;
+    return topology;
+}
+
+// See Topology.h
+std::size_t Topology::NodeOf(int cpu) const {
+    for (std::size_t node = 0; node < _cpus.size(); node++) {
+        if (std::find(_cpus[node].begin(), _cpus[node].end(), cpu) != _cpus[node].end()) {
+            return node;
+        }
+    }
+    return 0;
+}
+
+// See Topology.h
+bool Topology::BindThread(pthread_t thread, std::size_t node) const {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : _cpus[node % _cpus.size()]) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+
+// See Topology.h
+bool Topology::BindMemory(void *addr, std::size_t len, std::size_t node) const {
+    return SetPolicy(addr, len, MPOL_PREFERRED, {node % _ids.size()});
+}
+
+// See Topology.h
+bool Topology::InterleaveMemory(void *addr, std::size_t len) const {
+    std::vector<std::size_t> all;
+    for (std::size_t node = 0; node < _ids.size(); node++) {
+        all.push_back(node);
+    }
+    return SetPolicy(addr, len, MPOL_INTERLEAVE, all);
+}
+
+// See Topology.h
+int Topology::NodeOfPage(void *addr) const {
+    int id = -1;
+    if (syscall(SYS_get_mempolicy, &id, nullptr, 0, addr, MPOL_F_NODE | MPOL_F_ADDR) != 0) {
+        return -1;
+    }
+
+    auto it = std::find(_ids.begin(), _ids.end(), id);
+    return it == _ids.end() ? -1 : int(it - _ids.begin());
+}
+
+// See Topology.h
+std::string Topology::dump() const {
+    std::stringstream out;
+    for (std::size_t node = 0; node < _ids.size(); node++) {
+        out << "node " << _ids[node] << ": " << _cpus[node].size() << " cpus";
+        for (int cpu : _cpus[node]) {
+            out << " " << cpu;
+        }
+        out << std::endl;
+    }
+    return out.str();
+}
+
+// See Topology.h
+bool Topology::SetPolicy(void *addr, std::size_t len, int mode, const std::vector<std::size_t> &nodes) const {
+    const std::size_t bits = sizeof(unsigned long) * CHAR_BIT;
+    std::vector<unsigned long> mask(*std::max_element(_ids.begin(), _ids.end()) / bits + 1, 0);
+    for (std::size_t node : nodes) {
+        mask[_ids[node] / bits] |= 1UL << (_ids[node] % bits);
+    }
+
+    // Kernel ignores the last bit of maxnode
+    return syscall(SYS_mbind, addr, len, mode, mask.data(), mask.size() * bits + 1, 0) == 0;
+}
+
+} // namespace Concurrency
+} // namespace Afina
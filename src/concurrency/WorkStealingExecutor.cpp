@@ -0,0 +1,434 @@
+#include <afina/concurrency/WorkStealingExecutor.h>
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "ChaseLevDeque.h"
+#include "InjectionQueue.h"
+
+namespace Afina {
+namespace Concurrency {
+
+/**
+ * Task waiting for execution
+ */
+struct WorkStealingExecutor::Job {
+    Task task;
+
+    // Time Execute was called at, steady clock nanoseconds
+    int64_t enqueued = 0;
+};
+
+/**
+ * Pool thread slot. Deque outlives thread, so thieves could always look into it
+ */
+struct WorkStealingExecutor::Worker {
+    Worker(WorkStealingExecutor *pool, std::size_t idx)
+        : owner(pool), index(idx), running(false), seed(uint32_t(idx) * 2654435761u + 1), completed(0) {}
+
+    ~Worker() {
+        for (Job *job : free_jobs) {
+            delete job;
+        }
+    }
+
+    /**
+     * Pseudo random victim to steal from, xorshift is enough to spread thieves across the pool
+     */
+    std::size_t NextVictim() {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    WorkStealingExecutor *owner;
+
+    // Position in WorkStealingExecutor::_workers
+    std::size_t index;
+
+    // Tasks added by the thread running in the slot
+    ChaseLevDeque<Job *> deque;
+
+    // Jobs are pushed into deque by pointer, released ones are cached by the thread which took them, so
+    // push/pop is allocation free in the steady state
+    std::vector<Job *> free_jobs;
+
+    // True while slot has thread, protected by pool mutex
+    bool running;
+
+    uint32_t seed;
+
+    std::thread thread;
+
+    // Timings of tasks executed by the slot threads, merged on request
+    Histogram queue_time;
+    Histogram run_time;
+    Histogram total_time;
+    std::atomic<uint64_t> completed;
+};
+
+thread_local WorkStealingExecutor::Worker *WorkStealingExecutor::_current = nullptr;
+
+namespace {
+
+// How many times thread looks for work before it parks
+const int kSpins = 64;
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+const std::size_t kMaxCachedJobs = 256;
+
+} // namespace
+
+// See WorkStealingExecutor.h
+WorkStealingExecutor::WorkStealingExecutor(std::string name, std::size_t low_watermark, std::size_t hight_watermark,
+                                           std::size_t max_queue_size, std::size_t idle_time)
+    : _name(name), _low_watermark(low_watermark), _hight_watermark(hight_watermark > 0 ? hight_watermark : 1),
+      _idle_time(idle_time), _overflow(Overflow::kReject), _block_timeout(0), _timings(true),
+      _queue(new InjectionQueue<Job>(max_queue_size)), _state(State::kStopped), _active(0), _sleepers(0),
+      _pushing(0), _blocked(0), _submitted(0), _rejected(0), _caller_runs(0) {
+    _workers.reserve(_hight_watermark);
+    for (std::size_t i = 0; i < _hight_watermark; i++) {
+        _workers.emplace_back(new Worker(this, i));
+    }
+}
+
+// See WorkStealingExecutor.h
+WorkStealingExecutor::~WorkStealingExecutor() { Stop(true); }
+
+// See WorkStealingExecutor.h
+void WorkStealingExecutor::Start() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _state.store(State::kRun);
+    while (_active.load() < _low_watermark && SpawnLocked()) {
+    }
+}
+
+// See WorkStealingExecutor.h
+void WorkStealingExecutor::Stop(bool await) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_state.load() == State::kRun) {
+        _state.store(State::kStopping);
+        // Somebody has to drain queue and mark pool stopped
+        if (_active.load() == 0) {
+            SpawnLocked();
+        }
+        _idle_condition.notify_all();
+        _space_condition.notify_all();
+    }
+
+    // Thread can't wait for itself
+    if (!await || (_current != nullptr && _current->owner == this)) {
+        return;
+    }
+
+    while (_state.load() != State::kStopped) {
+        _stop_condition.wait(lock);
+    }
+    lock.unlock();
+
+    for (auto &w : _workers) {
+        if (w->thread.joinable()) {
+            w->thread.join();
+        }
+    }
+}
+
+// See WorkStealingExecutor.h
+void WorkStealingExecutor::SetOverflowPolicy(Overflow policy, std::chrono::milliseconds block_timeout,
+                                             std::function<void()> on_reject) {
+    _overflow = policy;
+    _block_timeout = block_timeout;
+    _on_reject = on_reject;
+}
+
+// See WorkStealingExecutor.h
+WorkStealingExecutor::Stats WorkStealingExecutor::GetStats() const {
+    Stats stats;
+    stats.queue_depth = _queue->Size();
+    stats.threads = _active.load();
+    stats.idle_threads = _sleepers.load();
+    stats.submitted = _submitted.load();
+    stats.completed = 0;
+    stats.rejected = _rejected.load();
+    stats.caller_runs = _caller_runs.load();
+    for (auto &w : _workers) {
+        stats.queue_depth += w->deque.Size();
+        stats.completed += w->completed.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+// See WorkStealingExecutor.h
+Histogram WorkStealingExecutor::QueueTime() const {
+    Histogram result;
+    for (auto &w : _workers) {
+        result.Merge(w->queue_time);
+    }
+    return result;
+}
+
+// See WorkStealingExecutor.h
+Histogram WorkStealingExecutor::RunTime() const {
+    Histogram result;
+    for (auto &w : _workers) {
+        result.Merge(w->run_time);
+    }
+    return result;
+}
+
+// See WorkStealingExecutor.h
+Histogram WorkStealingExecutor::TotalTime() const {
+    Histogram result;
+    for (auto &w : _workers) {
+        result.Merge(w->total_time);
+    }
+    return result;
+}
+
+// See WorkStealingExecutor.h
+bool WorkStealingExecutor::Push(Task &&task) {
+    _pushing.fetch_add(1);
+    if (_state.load() != State::kRun) {
+        _pushing.fetch_sub(1);
+        return Reject();
+    }
+
+    bool pushed = true;
+    Job job;
+    Worker *w = _current;
+    if (w != nullptr && w->owner == this) {
+        Job *local;
+        if (w->free_jobs.empty()) {
+            local = new Job();
+        } else {
+            local = w->free_jobs.back();
+            w->free_jobs.pop_back();
+        }
+        local->task = std::move(task);
+        local->enqueued = _timings ? now_ns() : 0;
+        w->deque.Push(local);
+    } else {
+        job.task = std::move(task);
+        job.enqueued = _timings ? now_ns() : 0;
+        pushed = _queue->Push(std::move(job));
+        if (!pushed && _overflow == Overflow::kBlock) {
+            pushed = PushBlocking(job);
+        }
+    }
+
+    if (pushed) {
+        _submitted.fetch_add(1, std::memory_order_relaxed);
+        Notify();
+    }
+    _pushing.fetch_sub(1);
+
+    if (pushed) {
+        return true;
+    } else if (_overflow == Overflow::kCallerRuns && _state.load() == State::kRun) {
+        _caller_runs.fetch_add(1, std::memory_order_relaxed);
+        job.task();
+        return true;
+    }
+    return Reject();
+}
+
+// See WorkStealingExecutor.h
+bool WorkStealingExecutor::PushBlocking(Job &job) {
+    auto deadline = std::chrono::steady_clock::now() + _block_timeout;
+
+    // Pairs with the fence in Find: either thread taking task sees us blocked or we see free place
+    _blocked.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    bool pushed = false;
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!(pushed = _queue->Push(std::move(job))) && _state.load() == State::kRun) {
+        if (_space_condition.wait_until(lock, deadline) == std::cv_status::timeout) {
+            pushed = _queue->Push(std::move(job));
+            break;
+        }
+    }
+    _blocked.fetch_sub(1);
+    return pushed;
+}
+
+// See WorkStealingExecutor.h
+bool WorkStealingExecutor::Reject() {
+    _rejected.fetch_add(1, std::memory_order_relaxed);
+    if (_on_reject) {
+        _on_reject();
+    }
+    return false;
+}
+
+// See WorkStealingExecutor.h
+void WorkStealingExecutor::Notify() {
+    // Pairs with the fence in Perform: either parking thread sees the task or we see it parking
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_sleepers.load() > 0) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _idle_condition.notify_one();
+    } else if (_active.load() < _hight_watermark) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_sleepers.load() == 0 && _state.load() != State::kStopped) {
+            SpawnLocked();
+        }
+    }
+}
+
+// See WorkStealingExecutor.h
+bool WorkStealingExecutor::SpawnLocked() {
+    for (auto &w : _workers) {
+        if (!w->running) {
+            // Previous thread of the slot has already left the pool, but still might be finishing
+            if (w->thread.joinable()) {
+                w->thread.join();
+            }
+
+            w->running = true;
+            _active.fetch_add(1);
+            w->thread = std::thread(&WorkStealingExecutor::Perform, this, std::ref(*w));
+            return true;
+        }
+    }
+    return false;
+}
+
+// See WorkStealingExecutor.h
+void WorkStealingExecutor::Run(Worker &w, Job &job) {
+    if (!_timings) {
+        job.task();
+        job.task.Reset();
+        w.completed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    int64_t start = now_ns();
+    job.task();
+    job.task.Reset();
+    int64_t finish = now_ns();
+
+    w.queue_time.Record(uint64_t(start - job.enqueued));
+    w.run_time.Record(uint64_t(finish - start));
+    w.total_time.Record(uint64_t(finish - job.enqueued));
+    w.completed.fetch_add(1, std::memory_order_relaxed);
+}
+
+// See WorkStealingExecutor.h
+void WorkStealingExecutor::Perform(Worker &w) {
+    _current = &w;
+
+    Job job;
+    for (;;) {
+        bool found = Find(w, job);
+        for (int i = 0; i < kSpins && !found; i++) {
+            std::this_thread::yield();
+            found = Find(w, job);
+        }
+
+        if (found) {
+            Run(w, job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _sleepers.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (HasWork()) {
+            _sleepers.fetch_sub(1);
+            continue;
+        }
+
+        if (_state.load() != State::kRun) {
+            _sleepers.fetch_sub(1);
+
+            // Task might be on the way into the queue yet
+            lock.unlock();
+            while (_pushing.load() > 0) {
+                std::this_thread::yield();
+            }
+            if (HasWork()) {
+                continue;
+            }
+
+            lock.lock();
+            w.running = false;
+            if (_active.fetch_sub(1) == 1) {
+                _state.store(State::kStopped);
+                _stop_condition.notify_all();
+            }
+            break;
+        }
+
+        auto wait_res = _idle_condition.wait_for(lock, std::chrono::milliseconds(_idle_time));
+        _sleepers.fetch_sub(1);
+        if (wait_res == std::cv_status::timeout && _active.load() > _low_watermark && !HasWork()) {
+            w.running = false;
+            _active.fetch_sub(1);
+            break;
+        }
+    }
+
+    _current = nullptr;
+}
+
+// See WorkStealingExecutor.h
+bool WorkStealingExecutor::Find(Worker &w, Job &job) {
+    Job *local;
+    if (w.deque.Pop(local)) {
+        job = std::move(*local);
+    } else if (_queue->Pop(job)) {
+        if (_overflow == Overflow::kBlock) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (_blocked.load() > 0) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _space_condition.notify_one();
+            }
+        }
+        return true;
+    } else {
+        std::size_t n = _workers.size();
+        std::size_t start = w.NextVictim() % n;
+        std::size_t i = 0;
+        for (; i < n; i++) {
+            Worker &victim = *_workers[(start + i) % n];
+            if (&victim != &w && victim.deque.Steal(local)) {
+                job = std::move(*local);
+                break;
+            }
+        }
+        if (i == n) {
+            return false;
+        }
+    }
+
+    // Job taken from deque goes back to the cache of the current thread
+    if (w.free_jobs.size() < kMaxCachedJobs) {
+        w.free_jobs.push_back(local);
+    } else {
+        delete local;
+    }
+    return true;
+}
+
+// See WorkStealingExecutor.h
+bool WorkStealingExecutor::HasWork() const {
+    if (!_queue->Empty()) {
+        return true;
+    }
+    for (auto &w : _workers) {
+        if (!w->deque.Empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace Concurrency
+} // namespace Afina
@@ -1,19 +1,216 @@
 #include <afina/coroutine/Engine.h>
 
+#include <alloca.h>
 #include <setjmp.h>
 #include <stdio.h>
 #include <string.h>
 
+#include <thread>
+
 namespace Afina {
 namespace Coroutine {
 
-void Engine::Store(context &ctx) {}
+// See Engine.h
+void Engine::Unlink(context *&head, context *ctx) {
+    if (ctx->prev != nullptr) {
+        ctx->prev->next = ctx->next;
+    }
+    if (ctx->next != nullptr) {
+        ctx->next->prev = ctx->prev;
+    }
+    if (head == ctx) {
+        head = ctx->next;
+    }
+    ctx->prev = ctx->next = nullptr;
+}
+
+// See Engine.h
+void Engine::Link(context *&head, context *ctx) {
+    ctx->prev = nullptr;
+    ctx->next = head;
+    if (head != nullptr) {
+        head->prev = ctx;
+    }
+    head = ctx;
+}
+
+void Engine::Store(context &ctx) {
+    char StackEndsHere;
+
+    // Stack grows down on all supported platforms, so the bottom is the highest address
+    ctx.Low = &StackEndsHere;
+    ctx.Hight = StackBottom;
+
+    // Reuse copy buffer unless it is too small or way too big for the current stack
+    uint32_t need = ctx.Hight - ctx.Low;
+    char *&buffer = std::get<0>(ctx.Stack);
+    uint32_t &capacity = std::get<1>(ctx.Stack);
+    if (capacity < need || capacity > 2 * need) {
+        delete[] buffer;
+        buffer = new char[need];
+        capacity = need;
+    }
+
+    memcpy(buffer, ctx.Low, need);
+}
+
+void Engine::Restore(context &ctx) {
+    // Current frame must be out of the way before saved stack could be copied back, otherwise
+    // memcpy would overwrite itself. Move stack pointer below the saved region and copy from the
+    // deeper frame
+    char StackEndsHere;
+    if (&StackEndsHere + 256 >= ctx.Low) {
+        volatile char *pad = static_cast<char *>(alloca(&StackEndsHere - ctx.Low + 512));
+        pad[0] = 0;
+    }
+    RestoreBelow(ctx);
+}
+
+void Engine::RestoreBelow(context &ctx) {
+    memcpy(ctx.Low, std::get<0>(ctx.Stack), ctx.Hight - ctx.Low);
+    cur_routine = &ctx;
+    longjmp(ctx.Environment, 1);
+}
+
+// See Engine.h
+void Engine::ExpireTimers() {
+    auto now = TimerQueue::clock::now();
+    void *coro;
+    while ((coro = _timers.PopExpired(now)) != nullptr) {
+        // Coroutine could be unblocked already but not run yet, then it isn't late
+        context *ctx = static_cast<context *>(coro);
+        if (ctx->is_blocked) {
+            ctx->timed_out = true;
+            unblock(ctx);
+        }
+    }
+}
+
+// See Engine.h
+void Engine::Idle() {
+    for (;;) {
+        ExpireTimers();
+        if (alive != nullptr) {
+            return;
+        }
+
+        _unblocker(*this);
+        ExpireTimers();
+        if (alive != nullptr || _timers.Empty()) {
+            return;
+        }
+
+        // Nobody but timers is going to wake routines up
+        std::this_thread::sleep_for(std::chrono::milliseconds(next_timeout()));
+    }
+}
+
+// See Engine.h
+bool Engine::block_for(std::chrono::milliseconds timeout) {
+    context *ctx = cur_routine;
+    if (ctx == nullptr || ctx == idle_ctx) {
+        return false;
+    }
+
+    ctx->timed_out = false;
+    _timers.Add(ctx, TimerQueue::clock::now() + timeout);
+    block();
+    _timers.Remove(ctx);
+    return !ctx->timed_out;
+}
+
+// See Engine.h
+void Engine::sleep_for(std::chrono::milliseconds timeout) {
+    auto deadline = TimerQueue::clock::now() + timeout;
+    for (auto now = TimerQueue::clock::now(); now < deadline; now = TimerQueue::clock::now()) {
+        block_for(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now + std::chrono::microseconds(999)));
+    }
+}
+
+void Engine::yield() {
+    if (!_timers.Empty()) {
+        ExpireTimers();
+    }
+
+    // Prefer routine next to the current one to let everybody run eventually
+    context *next = alive;
+    if (cur_routine != nullptr && !cur_routine->is_blocked && cur_routine->next != nullptr) {
+        next = cur_routine->next;
+    }
+    if (next == cur_routine) {
+        next = next->next;
+    }
+
+    if (next != nullptr) {
+        sched(next);
+        return;
+    }
+
+    // Nobody is ready to run. If current routine has been just blocked it can't continue, so
+    // pass control to the idle context which calls unblocker
+    if (cur_routine != nullptr && cur_routine != idle_ctx && cur_routine->is_blocked) {
+        if (setjmp(cur_routine->Environment) > 0) {
+            return;
+        }
+        Store(*cur_routine);
+        Restore(*idle_ctx);
+    }
+}
+
+void Engine::sched(void *routine_) {
+    context *ctx = static_cast<context *>(routine_);
+    if (ctx == nullptr) {
+        yield();
+        return;
+    }
+
+    if (ctx == cur_routine) {
+        return;
+    }
+
+    if (ctx->is_blocked) {
+        unblock(ctx);
+    }
+
+    // Idle context is never saved: it always resumes from the setjmp point in start()
+    if (cur_routine != nullptr && cur_routine != idle_ctx) {
+        if (setjmp(cur_routine->Environment) > 0) {
+            return;
+        }
+        Store(*cur_routine);
+    }
+    Restore(*ctx);
+}
+
+void Engine::block(void *coro) {
+    context *ctx = static_cast<context *>(coro);
+    if (ctx == nullptr) {
+        ctx = cur_routine;
+    }
+
+    if (ctx == nullptr || ctx == idle_ctx || ctx->is_blocked) {
+        return;
+    }
+
+    Unlink(alive, ctx);
+    Link(blocked, ctx);
+    ctx->is_blocked = true;
 
-void Engine::Restore(context &ctx) {}
+    if (ctx == cur_routine) {
+        yield();
+    }
+}
 
-void Engine::yield() {}
+void Engine::unblock(void *coro) {
+    context *ctx = static_cast<context *>(coro);
+    if (ctx == nullptr || !ctx->is_blocked) {
+        return;
+    }
 
-void Engine::sched(void *routine_) {}
+    Unlink(blocked, ctx);
+    Link(alive, ctx);
+    ctx->is_blocked = false;
+}
 
 } // namespace Coroutine
 } // namespace Afina
@@ -0,0 +1,337 @@
+#include <afina/coroutine/Scheduler.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <afina/coroutine/StackfulEngine.h>
+
+namespace Afina {
+namespace Coroutine {
+
+/**
+ * Thread with its own coroutine engine, run queue and epoll instance
+ */
+struct Scheduler::Worker {
+    Worker(std::size_t idx, std::size_t stack_size)
+        : engine([this](StackfulEngine &) { Unblock(); }, stack_size), index(idx), epoll_fd(-1), event_fd(-1),
+          idle(false), waiting(0), main(nullptr) {}
+
+    /**
+     * Called by engine once all coroutines are blocked: sleep in epoll until some could continue or the
+     * nearest timer expires, engine takes care of timers itself
+     */
+    void Unblock() {
+        idle.store(true);
+        while (waiting > 0 || main != nullptr) {
+            int timeout = engine.next_timeout();
+            if (Scheduler::Poll(*this, timeout) > 0 || timeout >= 0) {
+                break;
+            }
+        }
+        idle.store(false);
+    }
+
+    StackfulEngine engine;
+
+    // Position in Scheduler::_workers
+    std::size_t index;
+
+    // Descriptors to wait for I/O and wakeup signals on
+    int epoll_fd;
+    int event_fd;
+
+    // Coroutines spawned but not started yet
+    std::mutex queue_mutex;
+    std::deque<std::function<void()>> queue;
+
+    // True while thread sleeps in epoll with nothing to run
+    std::atomic<bool> idle;
+
+    // Number of coroutines suspended in Wait
+    std::size_t waiting;
+
+    // Main coroutine serving queue, nullptr once it is done
+    void *main;
+
+    std::thread thread;
+};
+
+thread_local Scheduler::Worker *Scheduler::_current = nullptr;
+
+namespace {
+
+void run_task(std::function<void()> task) { task(); }
+
+} // namespace
+
+// See Scheduler.h
+Scheduler::Scheduler(std::size_t workers, std::size_t stack_size) : _next(0), _running(false) {
+    _workers.reserve(workers);
+    for (std::size_t i = 0; i < workers; i++) {
+        _workers.emplace_back(new Worker(i, stack_size));
+    }
+}
+
+// See Scheduler.h
+Scheduler::~Scheduler() {
+    Stop();
+    Join();
+    for (auto &w : _workers) {
+        if (w->epoll_fd != -1) {
+            close(w->epoll_fd);
+        }
+        if (w->event_fd != -1) {
+            close(w->event_fd);
+        }
+    }
+}
+
+// See Scheduler.h
+void Scheduler::Start() {
+    for (auto &w : _workers) {
+        w->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (w->epoll_fd == -1) {
+            throw std::runtime_error("Failed to create epoll file descriptor: " + std::string(strerror(errno)));
+        }
+
+        w->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (w->event_fd == -1) {
+            throw std::runtime_error("Failed to create event file descriptor: " + std::string(strerror(errno)));
+        }
+
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr;
+        if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, w->event_fd, &event)) {
+            throw std::runtime_error("Failed to add eventfd descriptor to epoll");
+        }
+    }
+
+    _running.store(true);
+    for (auto &w : _workers) {
+        w->thread = std::thread(&Scheduler::OnRun, this, std::ref(*w));
+    }
+}
+
+// See Scheduler.h
+void Scheduler::Stop() {
+    _running.store(false);
+    for (auto &w : _workers) {
+        // Spawn checks flag under the queue lock, so once lock is passed nobody is able to add
+        // coroutine after worker decided to stop
+        { std::lock_guard<std::mutex> lock(w->queue_mutex); }
+        if (w->event_fd != -1) {
+            Wakeup(*w);
+        }
+    }
+}
+
+// See Scheduler.h
+void Scheduler::Join() {
+    for (auto &w : _workers) {
+        if (w->thread.joinable()) {
+            w->thread.join();
+        }
+    }
+}
+
+// See Scheduler.h
+bool Scheduler::Spawn(std::function<void()> task) {
+    if (_workers.empty()) {
+        return false;
+    }
+
+    Worker &w = *_workers[_next.fetch_add(1) % _workers.size()];
+    {
+        std::lock_guard<std::mutex> lock(w.queue_mutex);
+        if (!_running.load()) {
+            return false;
+        }
+        w.queue.push_back(std::move(task));
+    }
+    Wakeup(w);
+
+    // Target is busy, let somebody idle steal the coroutine
+    if (!w.idle.load()) {
+        for (auto &other : _workers) {
+            if (other.get() != &w && other->idle.load()) {
+                Wakeup(*other);
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+// See Scheduler.h
+bool Scheduler::Wait(int fd, uint32_t events, int timeout) {
+    Worker *w = _current;
+    if (w == nullptr) {
+        return false;
+    }
+
+    struct epoll_event event;
+    event.events = events | EPOLLONESHOT;
+    event.data.ptr = w->engine.current();
+    if (epoll_ctl(w->epoll_fd, EPOLL_CTL_MOD, fd, &event)) {
+        if (errno != ENOENT || epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, fd, &event)) {
+            return false;
+        }
+    }
+
+    w->waiting++;
+    bool ready = true;
+    if (timeout < 0) {
+        w->engine.block();
+    } else {
+        ready = w->engine.block_for(std::chrono::milliseconds(timeout));
+    }
+    w->waiting--;
+
+    if (!ready) {
+        // Descriptor is still armed with pointer to this coroutine, that must not outlive it
+        epoll_ctl(w->epoll_fd, EPOLL_CTL_DEL, fd, &event);
+        errno = ETIMEDOUT;
+    }
+    return ready;
+}
+
+// See Scheduler.h
+ssize_t Scheduler::Read(int fd, void *buf, std::size_t count, int timeout) {
+    for (;;) {
+        ssize_t n = read(fd, buf, count);
+        if (n >= 0) {
+            return n;
+        } else if (errno == EINTR) {
+            continue;
+        } else if ((errno != EAGAIN && errno != EWOULDBLOCK) || !Wait(fd, EPOLLIN | EPOLLRDHUP, timeout)) {
+            return -1;
+        }
+    }
+}
+
+// See Scheduler.h
+ssize_t Scheduler::Write(int fd, const void *buf, std::size_t count, int timeout) {
+    const char *data = static_cast<const char *>(buf);
+    std::size_t written = 0;
+    while (written < count) {
+        ssize_t n = write(fd, data + written, count - written);
+        if (n >= 0) {
+            written += n;
+        } else if (errno == EINTR) {
+            continue;
+        } else if ((errno != EAGAIN && errno != EWOULDBLOCK) || !Wait(fd, EPOLLOUT, timeout)) {
+            return -1;
+        }
+    }
+    return written;
+}
+
+// See Scheduler.h
+void Scheduler::Yield() {
+    Worker *w = _current;
+    if (w == nullptr) {
+        return;
+    }
+
+    // Busy coroutines must not starve those waiting for I/O
+    Poll(*w, 0);
+    w->engine.yield();
+}
+
+// See Scheduler.h
+void Scheduler::OnRun(Worker &w) {
+    if (_on_start) {
+        _on_start(w.index);
+    }
+    _current = &w;
+    w.engine.start(&Scheduler::Serve, *this, w);
+    _current = nullptr;
+}
+
+// See Scheduler.h
+void Scheduler::Serve(Scheduler &self, Worker &w) {
+    w.main = w.engine.current();
+    for (;;) {
+        Poll(w, 0);
+
+        bool running = self._running.load();
+        std::function<void()> task;
+        if (self.Take(w, task)) {
+            w.engine.run(&run_task, std::move(task));
+            w.engine.yield();
+        } else if (!running) {
+            break;
+        } else {
+            // Eventfd signal unblocks us
+            w.engine.block();
+        }
+    }
+    w.main = nullptr;
+}
+
+// See Scheduler.h
+bool Scheduler::Take(Worker &w, std::function<void()> &task) {
+    {
+        std::lock_guard<std::mutex> lock(w.queue_mutex);
+        if (!w.queue.empty()) {
+            task = std::move(w.queue.front());
+            w.queue.pop_front();
+            return true;
+        }
+    }
+
+    // Steal from the opposite end to keep victim's order mostly intact
+    for (std::size_t i = 1; i < _workers.size(); i++) {
+        Worker &victim = *_workers[(w.index + i) % _workers.size()];
+        std::lock_guard<std::mutex> lock(victim.queue_mutex);
+        if (!victim.queue.empty()) {
+            task = std::move(victim.queue.back());
+            victim.queue.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+// See Scheduler.h
+int Scheduler::Poll(Worker &w, int timeout) {
+    std::array<struct epoll_event, 64> events;
+    int nevents = epoll_wait(w.epoll_fd, &events[0], events.size(), timeout);
+
+    int woken = 0;
+    for (int i = 0; i < nevents; i++) {
+        if (events[i].data.ptr == nullptr) {
+            eventfd_t value;
+            eventfd_read(w.event_fd, &value);
+            if (w.main != nullptr) {
+                w.engine.unblock(w.main);
+                woken++;
+            }
+        } else {
+            w.engine.unblock(events[i].data.ptr);
+            woken++;
+        }
+    }
+    return woken;
+}
+
+// See Scheduler.h
+void Scheduler::Wakeup(Worker &w) {
+    if (eventfd_write(w.event_fd, 1)) {
+        throw std::runtime_error("Failed to wakeup worker");
+    }
+}
+
+} // namespace Coroutine
+} // namespace Afina
@@ -0,0 +1,60 @@
+#include "StackPool.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace Afina {
+namespace Coroutine {
+
+// See StackPool.h
+StackPool::StackPool(std::size_t stack_size, std::size_t max_cached) : _max_cached(max_cached) {
+    _page_size = sysconf(_SC_PAGESIZE);
+    _stack_size = (stack_size + _page_size - 1) / _page_size * _page_size;
+    _free.reserve(max_cached);
+}
+
+// See StackPool.h
+StackPool::~StackPool() {
+    for (char *stack : _free) {
+        munmap(stack - _page_size, _stack_size + _page_size);
+    }
+}
+
+// See StackPool.h
+char *StackPool::Acquire() {
+    if (!_free.empty()) {
+        char *stack = _free.back();
+        _free.pop_back();
+        return stack;
+    }
+
+    void *area = mmap(nullptr, _stack_size + _page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK,
+                      -1, 0);
+    if (area == MAP_FAILED) {
+        throw std::runtime_error("Failed to map coroutine stack: " + std::string(strerror(errno)));
+    }
+
+    if (mprotect(area, _page_size, PROT_NONE) == -1) {
+        munmap(area, _stack_size + _page_size);
+        throw std::runtime_error("Failed to protect coroutine stack guard: " + std::string(strerror(errno)));
+    }
+
+    return static_cast<char *>(area) + _page_size;
+}
+
+// See StackPool.h
+void StackPool::Release(char *stack) {
+    if (_free.size() < _max_cached) {
+        _free.push_back(stack);
+    } else {
+        munmap(stack - _page_size, _stack_size + _page_size);
+    }
+}
+
+} // namespace Coroutine
+} // namespace Afina
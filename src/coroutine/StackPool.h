@@ -0,0 +1,50 @@
+#ifndef AFINA_COROUTINE_STACK_POOL_H
+#define AFINA_COROUTINE_STACK_POOL_H
+
+#include <cstddef>
+#include <vector>
+
+namespace Afina {
+namespace Coroutine {
+
+/**
+ * # Cache of coroutine stacks
+ * Each stack is a separate anonymous mapping with PROT_NONE guard page below the usable area, so
+ * overflow ends up in SIGSEGV instead of silent memory corruption. Released stacks are kept for reuse
+ * up to the configured limit. Not threadsafe
+ */
+class StackPool {
+public:
+    StackPool(std::size_t stack_size, std::size_t max_cached);
+    ~StackPool();
+
+    /**
+     * Returns lowest address of usable stack area, StackSize() bytes are available above it
+     */
+    char *Acquire();
+
+    /**
+     * Return stack previously got from Acquire back to the pool
+     */
+    void Release(char *stack);
+
+    std::size_t StackSize() const { return _stack_size; }
+
+    // Number of stacks cached for reuse
+    std::size_t Cached() const { return _free.size(); }
+
+private:
+    StackPool(const StackPool &) = delete;
+    StackPool &operator=(const StackPool &) = delete;
+
+    std::size_t _page_size;
+    std::size_t _stack_size;
+    std::size_t _max_cached;
+
+    std::vector<char *> _free;
+};
+
+} // namespace Coroutine
+} // namespace Afina
+
+#endif // AFINA_COROUTINE_STACK_POOL_H
@@ -0,0 +1,344 @@
+#include <afina/coroutine/StackfulEngine.h>
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+#include "StackPool.h"
+
+#if !defined(__x86_64__)
+#include <ucontext.h>
+#endif
+
+#if defined(__x86_64__)
+// Context switch for x86-64 SysV ABI: push callee-saved registers together with SSE/x87 control words
+// onto the current stack, remember stack pointer in *from_sp, take new one and pop the same from there.
+// Newly created coroutine gets frame prepared in Spawn, so that "ret" enters trampoline which calls
+// entry function from r13 with argument from r12
+extern "C" void afina_coro_switch(void **from_sp, void *to_sp);
+extern "C" void afina_coro_trampoline();
+
+asm(R"(
+    .text
+    .globl afina_coro_switch
+    .type afina_coro_switch, @function
+afina_coro_switch:
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    subq $16, %rsp
+    stmxcsr (%rsp)
+    fnstcw 4(%rsp)
+    movq %rsp, (%rdi)
+    movq %rsi, %rsp
+    ldmxcsr (%rsp)
+    fldcw 4(%rsp)
+    addq $16, %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .size afina_coro_switch, .-afina_coro_switch
+
+    .globl afina_coro_trampoline
+    .type afina_coro_trampoline, @function
+afina_coro_trampoline:
+    movq %r12, %rdi
+    andq $-16, %rsp
+    callq *%r13
+    ud2
+    .size afina_coro_trampoline, .-afina_coro_trampoline
+)");
+#endif
+
+namespace Afina {
+namespace Coroutine {
+
+/**
+ * A single coroutine instance which could be scheduled for execution
+ */
+struct StackfulEngine::context {
+#if defined(__x86_64__)
+    // Saved stack pointer, all the rest lives on the stack itself
+    void *sp = nullptr;
+#else
+    ucontext_t uc;
+#endif
+
+    // Lowest address of the coroutine stack, nullptr for idle context which runs on the thread stack
+    char *stack = nullptr;
+
+    // Body of the coroutine
+    std::function<void()> task;
+
+    // Set while coroutine is in the "blocked" list
+    bool is_blocked = false;
+
+    // Set once coroutine gets unblocked by timer rather than by unblock
+    bool timed_out = false;
+
+    // To include routine in the different lists, such as "alive", "blocked", e.t.c
+    context *prev = nullptr;
+    context *next = nullptr;
+};
+
+// See Engine.h
+void StackfulEngine::Unlink(context *&head, context *ctx) {
+    if (ctx->prev != nullptr) {
+        ctx->prev->next = ctx->next;
+    }
+    if (ctx->next != nullptr) {
+        ctx->next->prev = ctx->prev;
+    }
+    if (head == ctx) {
+        head = ctx->next;
+    }
+    ctx->prev = ctx->next = nullptr;
+}
+
+// See Engine.h
+void StackfulEngine::Link(context *&head, context *ctx) {
+    ctx->prev = nullptr;
+    ctx->next = head;
+    if (head != nullptr) {
+        head->prev = ctx;
+    }
+    head = ctx;
+}
+
+// See StackfulEngine.h
+StackfulEngine::StackfulEngine(unblocker_func unblocker, std::size_t stack_size, std::size_t pool_size)
+    : cur_routine(nullptr), alive(nullptr), blocked(nullptr), idle_ctx(nullptr), zombie(nullptr),
+      _unblocker(unblocker), _stacks(new StackPool(stack_size, pool_size)) {}
+
+// See StackfulEngine.h
+StackfulEngine::~StackfulEngine() {}
+
+// See StackfulEngine.h
+void StackfulEngine::Entry(void *engine) {
+    StackfulEngine *self = static_cast<StackfulEngine *>(engine);
+    context *ctx = self->cur_routine;
+    ctx->task();
+
+    // Routine is done, but its stack is still in use right now, so leave it to the idle context to
+    // release. Control never gets back here
+    if (ctx->is_blocked) {
+        Unlink(self->blocked, ctx);
+    } else {
+        Unlink(self->alive, ctx);
+    }
+    self->zombie = ctx;
+    self->Switch(*ctx, *self->idle_ctx);
+}
+
+// See StackfulEngine.h
+void StackfulEngine::Switch(context &from, context &to) {
+    cur_routine = &to;
+#if defined(__x86_64__)
+    afina_coro_switch(&from.sp, to.sp);
+#else
+    swapcontext(&from.uc, &to.uc);
+#endif
+}
+
+#if !defined(__x86_64__)
+// makecontext passes int arguments only, so entry function and its argument come in halves
+static void ucontext_entry(int fn_hi, int fn_lo, int arg_hi, int arg_lo) {
+    uintptr_t fn = (uintptr_t(uint32_t(fn_hi)) << 32) | uintptr_t(uint32_t(fn_lo));
+    uintptr_t arg = (uintptr_t(uint32_t(arg_hi)) << 32) | uintptr_t(uint32_t(arg_lo));
+    reinterpret_cast<void (*)(void *)>(fn)(reinterpret_cast<void *>(arg));
+}
+#endif
+
+// See StackfulEngine.h
+void *StackfulEngine::Spawn(std::function<void()> &&task) {
+    context *ctx = new context();
+    ctx->task = std::move(task);
+    ctx->stack = _stacks->Acquire();
+
+#if defined(__x86_64__)
+    // Initial frame as afina_coro_switch expects it: control words, r15..rbp, return address
+    uint64_t *frame = reinterpret_cast<uint64_t *>(ctx->stack + _stacks->StackSize()) - 10;
+    std::memset(frame, 0, 10 * sizeof(uint64_t));
+    frame[0] = 0x1F80 | (uint64_t(0x037F) << 32); // default MXCSR and x87 control word
+    frame[4] = reinterpret_cast<uint64_t>(&StackfulEngine::Entry);
+    frame[5] = reinterpret_cast<uint64_t>(this);
+    frame[8] = reinterpret_cast<uint64_t>(&afina_coro_trampoline);
+    ctx->sp = frame;
+#else
+    getcontext(&ctx->uc);
+    ctx->uc.uc_stack.ss_sp = ctx->stack;
+    ctx->uc.uc_stack.ss_size = _stacks->StackSize();
+    ctx->uc.uc_link = nullptr;
+    uintptr_t fn = reinterpret_cast<uintptr_t>(&StackfulEngine::Entry);
+    uintptr_t arg = reinterpret_cast<uintptr_t>(this);
+    makecontext(&ctx->uc, reinterpret_cast<void (*)()>(&ucontext_entry), 4, int(uint64_t(fn) >> 32), int(fn),
+                int(uint64_t(arg) >> 32), int(arg));
+#endif
+
+    Link(alive, ctx);
+    return ctx;
+}
+
+// See StackfulEngine.h
+void StackfulEngine::Loop(std::function<void()> &&main) {
+    context idle;
+    idle_ctx = &idle;
+    cur_routine = idle_ctx;
+
+    void *pc = Spawn(std::move(main));
+    sched(pc);
+
+    // Here we are once nobody else is able to run or some routine has finished
+    for (;;) {
+        if (zombie != nullptr) {
+            _stacks->Release(zombie->stack);
+            delete zombie;
+            zombie = nullptr;
+        }
+
+        ExpireTimers();
+        if (alive == nullptr) {
+            _unblocker(*this);
+            ExpireTimers();
+        }
+        if (alive == nullptr) {
+            if (_timers.Empty()) {
+                break;
+            }
+
+            // Nobody but timers is going to wake routines up
+            std::this_thread::sleep_for(std::chrono::milliseconds(next_timeout()));
+            continue;
+        }
+        sched(alive);
+    }
+
+    // Shutdown runtime, routines left blocked are never going to finish
+    while (blocked != nullptr) {
+        context *ctx = blocked;
+        Unlink(blocked, ctx);
+        _stacks->Release(ctx->stack);
+        delete ctx;
+    }
+    idle_ctx = nullptr;
+    cur_routine = nullptr;
+}
+
+// See Engine.h
+void StackfulEngine::ExpireTimers() {
+    auto now = TimerQueue::clock::now();
+    void *coro;
+    while ((coro = _timers.PopExpired(now)) != nullptr) {
+        // Coroutine could be unblocked already but not run yet, then it isn't late
+        context *ctx = static_cast<context *>(coro);
+        if (ctx->is_blocked) {
+            ctx->timed_out = true;
+            unblock(ctx);
+        }
+    }
+}
+
+// See Engine.h
+bool StackfulEngine::block_for(std::chrono::milliseconds timeout) {
+    context *ctx = cur_routine;
+    if (ctx == nullptr || ctx == idle_ctx) {
+        return false;
+    }
+
+    ctx->timed_out = false;
+    _timers.Add(ctx, TimerQueue::clock::now() + timeout);
+    block();
+    _timers.Remove(ctx);
+    return !ctx->timed_out;
+}
+
+// See Engine.h
+void StackfulEngine::sleep_for(std::chrono::milliseconds timeout) {
+    auto deadline = TimerQueue::clock::now() + timeout;
+    for (auto now = TimerQueue::clock::now(); now < deadline; now = TimerQueue::clock::now()) {
+        block_for(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now + std::chrono::microseconds(999)));
+    }
+}
+
+// See Engine.h
+void StackfulEngine::yield() {
+    if (!_timers.Empty()) {
+        ExpireTimers();
+    }
+
+    // Prefer routine next to the current one to let everybody run eventually
+    context *next = alive;
+    if (cur_routine != idle_ctx && !cur_routine->is_blocked && cur_routine->next != nullptr) {
+        next = cur_routine->next;
+    }
+    if (next == cur_routine) {
+        next = next->next;
+    }
+
+    if (next != nullptr) {
+        sched(next);
+    } else if (cur_routine != idle_ctx && cur_routine->is_blocked) {
+        // Nobody is ready to run and current routine can't continue, let idle context call unblocker
+        Switch(*cur_routine, *idle_ctx);
+    }
+}
+
+// See Engine.h
+void StackfulEngine::sched(void *routine_) {
+    context *ctx = static_cast<context *>(routine_);
+    if (ctx == nullptr) {
+        yield();
+        return;
+    }
+
+    if (ctx == cur_routine) {
+        return;
+    }
+
+    if (ctx->is_blocked) {
+        unblock(ctx);
+    }
+    Switch(*cur_routine, *ctx);
+}
+
+// See Engine.h
+void StackfulEngine::block(void *coro) {
+    context *ctx = static_cast<context *>(coro);
+    if (ctx == nullptr) {
+        ctx = cur_routine;
+    }
+
+    if (ctx == nullptr || ctx == idle_ctx || ctx->is_blocked) {
+        return;
+    }
+
+    Unlink(alive, ctx);
+    Link(blocked, ctx);
+    ctx->is_blocked = true;
+
+    if (ctx == cur_routine) {
+        yield();
+    }
+}
+
+// See Engine.h
+void StackfulEngine::unblock(void *coro) {
+    context *ctx = static_cast<context *>(coro);
+    if (ctx == nullptr || !ctx->is_blocked) {
+        return;
+    }
+
+    Unlink(blocked, ctx);
+    Link(alive, ctx);
+    ctx->is_blocked = false;
+}
+
+} // namespace Coroutine
+} // namespace Afina
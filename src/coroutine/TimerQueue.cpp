@@ -0,0 +1,107 @@
+#include <afina/coroutine/TimerQueue.h>
+
+#include <utility>
+
+namespace Afina {
+namespace Coroutine {
+
+// See TimerQueue.h
+void TimerQueue::Add(void *coro, clock::time_point deadline) {
+    auto it = _index.find(coro);
+    if (it != _index.end()) {
+        RemoveAt(it->second);
+    }
+
+    _heap.push_back(Entry{deadline, coro});
+    _index[coro] = _heap.size() - 1;
+    SiftUp(_heap.size() - 1);
+}
+
+// See TimerQueue.h
+bool TimerQueue::Remove(void *coro) {
+    auto it = _index.find(coro);
+    if (it == _index.end()) {
+        return false;
+    }
+
+    RemoveAt(it->second);
+    return true;
+}
+
+// See TimerQueue.h
+void *TimerQueue::PopExpired(clock::time_point now) {
+    if (_heap.empty() || _heap[0].deadline > now) {
+        return nullptr;
+    }
+
+    void *coro = _heap[0].coro;
+    RemoveAt(0);
+    return coro;
+}
+
+// See TimerQueue.h
+int TimerQueue::Timeout(clock::time_point now) const {
+    if (_heap.empty()) {
+        return -1;
+    }
+    if (_heap[0].deadline <= now) {
+        return 0;
+    }
+
+    auto left = std::chrono::duration_cast<std::chrono::microseconds>(_heap[0].deadline - now).count();
+    return int((left + 999) / 1000);
+}
+
+void TimerQueue::RemoveAt(std::size_t pos) {
+    _index.erase(_heap[pos].coro);
+
+    std::size_t last = _heap.size() - 1;
+    if (pos != last) {
+        _heap[pos] = _heap[last];
+        _index[_heap[pos].coro] = pos;
+    }
+    _heap.pop_back();
+
+    if (pos < _heap.size()) {
+        SiftDown(pos);
+        SiftUp(pos);
+    }
+}
+
+void TimerQueue::SiftUp(std::size_t pos) {
+    while (pos > 0) {
+        std::size_t parent = (pos - 1) / 2;
+        if (_heap[parent].deadline <= _heap[pos].deadline) {
+            break;
+        }
+        Swap(pos, parent);
+        pos = parent;
+    }
+}
+
+void TimerQueue::SiftDown(std::size_t pos) {
+    for (;;) {
+        std::size_t smallest = pos;
+        std::size_t left = 2 * pos + 1, right = 2 * pos + 2;
+        if (left < _heap.size() && _heap[left].deadline < _heap[smallest].deadline) {
+            smallest = left;
+        }
+        if (right < _heap.size() && _heap[right].deadline < _heap[smallest].deadline) {
+            smallest = right;
+        }
+        if (smallest == pos) {
+            break;
+        }
+        Swap(pos, smallest);
+        pos = smallest;
+    }
+}
+
+void TimerQueue::Swap(std::size_t a, std::size_t b) {
+    std::swap(_heap[a], _heap[b]);
+    _index[_heap[a].coro] = a;
+    _index[_heap[b].coro] = b;
+}
+
+} // namespace Coroutine
+} // namespace Afina
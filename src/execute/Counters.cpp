@@ -0,0 +1,63 @@
+#include <afina/execute/Counters.h>
+
+#include <atomic>
+
+#include <afina/concurrency/CoreLocal.h>
+
+namespace Afina {
+namespace Execute {
+
+namespace {
+
+// All counters of one cpu share the line, they are touched by the same threads anyway
+struct Slot {
+    Slot() {
+        for (std::size_t i = 0; i < Counters::kCount; i++) {
+            values[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<uint64_t> values[Counters::kCount];
+};
+
+Concurrency::CoreLocal<Slot> &Slots() {
+    static Concurrency::CoreLocal<Slot> slots;
+    return slots;
+}
+
+} // namespace
+
+// See Counters.h
+void Counters::Add(Counter counter, uint64_t value) {
+    Slots().Local().values[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+// See Counters.h
+uint64_t Counters::Get(Counter counter) {
+    return Slots().Fold(uint64_t(0), [counter](uint64_t sum, const Slot &slot) {
+        return sum + slot.values[counter].load(std::memory_order_relaxed);
+    });
+}
+
+// See Counters.h
+const char *Counters::Name(Counter counter) {
+    switch (counter) {
+    case kConnections:
+        return "total_connections";
+    case kCommands:
+        return "cmd_total";
+    case kGetHits:
+        return "get_hits";
+    case kGetMisses:
+        return "get_misses";
+    case kBytesRead:
+        return "bytes_read";
+    case kBytesWritten:
+        return "bytes_written";
+    default:
+        return "unknown";
+    }
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -1,4 +1,5 @@
 #include <afina/Storage.h>
+#include <afina/execute/Counters.h>
 #include <afina/execute/Get.h>
 
 #include <iostream>
@@ -21,7 +22,7 @@ to indicate the end of response.
 
 */
 
-void Get::Execute(Storage &storage, const std::string &args, std::string &out) {
+void Get::Execute(Storage &storage, const std::string &, std::string &out) {
     std::stringstream keyStream;
     copy(_keys.begin(), _keys.end(), std::ostream_iterator<std::string>(keyStream, " "));
     std::cout << "Get(" << keyStream.str() << ")" << std::endl;
@@ -30,8 +31,11 @@ void Get::Execute(Storage &storage, const std::string &args, std::string &out) {
 
     std::string value;
     for (auto &key : _keys) {
-        if (!storage.Get(key, value))
+        if (!storage.Get(key, value)) {
+            Counters::Add(Counters::kGetMisses);
             continue;
+        }
+        Counters::Add(Counters::kGetHits);
         outStream << "VALUE " << key << " 0 " << value.size() << "\r\n";
         outStream << value << "\r\n";
     }
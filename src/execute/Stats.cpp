@@ -1,14 +1,31 @@
 #include <afina/Storage.h>
+#include <afina/execute/Counters.h>
 #include <afina/execute/Stats.h>
 
-#include <iostream>
-#include <iterator>
 #include <sstream>
+#include <string>
 
 namespace Afina {
 namespace Execute {
 
-void Stats::Execute(Storage &storage, const std::string &args, std::string &out) { out.assign("END"); }
+/* memcached protocol:
+
+STAT <name> <value>\r\n
+
+line for each statistic, the list is terminated with "END\r\n"
+
+*/
+
+void Stats::Execute(Storage &, const std::string &, std::string &out) {
+    std::stringstream outStream;
+    for (int i = 0; i < Counters::kCount; i++) {
+        Counters::Counter counter = Counters::Counter(i);
+        outStream << "STAT " << Counters::Name(counter) << " " << Counters::Get(counter) << "\r\n";
+    }
+    outStream << "END"; // networking layer should add the last \r\n
+
+    out = outStream.str();
+}
 
 } // namespace Execute
 } // namespace Afina
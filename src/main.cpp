@@ -1,32 +1,99 @@
+#include <algorithm>
 #include <chrono>
+#include <fstream>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <atomic>
 #include <semaphore.h>
 #include <signal.h>
 #include <thread>
+#include <unistd.h>
 
 #include <cxxopts.hpp>
 
 #include <afina/Storage.h>
 #include <afina/Version.h>
+#include <afina/concurrency/Topology.h>
 #include <afina/logging/Service.h>
+#include <afina/network/Handoff.h>
 #include <afina/network/Server.h>
 
 #include "logging/ServiceImpl.h"
 #include "network/mt_blocking/ServerImpl.h"
+#include "network/mt_coroutine/ServerImpl.h"
 #include "network/mt_nonblocking/ServerImpl.h"
 #include "network/st_blocking/ServerImpl.h"
 #include "network/st_coroutine/ServerImpl.h"
 #include "network/st_nonblocking/ServerImpl.h"
 
+#include "storage/Dictionary.h"
+#include "storage/FlatCombineLRU.h"
+#include "storage/SharedLRU.h"
 #include "storage/SimpleLRU.h"
+#include "storage/Snapshot.h"
 #include "storage/ThreadSafeSimpleLRU.h"
 #include "storage/StripedLockLRU.h"
+#include "storage/TieredLRU.h"
+#include "storage/Wal.h"
 
 using namespace Afina;
 
+/**
+ * Parse size with optional K, M or G suffix
+ */
+size_t parse_size(const std::string &text) {
+    size_t pos = 0;
+    unsigned long long size = std::stoull(text, &pos);
+    std::string suffix = text.substr(pos);
+    if (suffix == "K" || suffix == "k") {
+        size <<= 10;
+    } else if (suffix == "M" || suffix == "m") {
+        size <<= 20;
+    } else if (suffix == "G" || suffix == "g") {
+        size <<= 30;
+    } else if (!suffix.empty()) {
+        throw std::runtime_error("Invalid size: " + text);
+    }
+    return size;
+}
+
+/**
+ * Read config file and turn it into command line arguments. Each line is "option = value", option is
+ * the long name of command line option, empty lines and lines started with # are skipped
+ */
+std::vector<std::string> load_config(const std::string &path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Failed to open config " + path);
+    }
+
+    std::vector<std::string> args;
+    std::string line;
+    for (int n = 1; std::getline(in, line); n++) {
+        auto trim = [](const std::string &s) {
+            size_t begin = s.find_first_not_of(" \t\r");
+            size_t end = s.find_last_not_of(" \t\r");
+            return begin == std::string::npos ? std::string() : s.substr(begin, end - begin + 1);
+        };
+
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            throw std::runtime_error(path + ":" + std::to_string(n) + ": option = value expected");
+        }
+        args.push_back("--" + trim(line.substr(0, eq)) + "=" + trim(line.substr(eq + 1)));
+    }
+    return args;
+}
+
 /**
  * Whole application class
  */
@@ -46,22 +113,140 @@ public:
         logger.format = "[%H:%M:%S %z] [thread %t] [%n] [%l] %v";
         logService.reset(new Logging::ServiceImpl(logConfig));
 
-        // Step 1: configure storage
+        auto non_negative = [&options](const std::string &name) {
+            int value = options[name].as<int>();
+            if (value < 0) {
+                throw std::runtime_error("Option " + name + " must not be negative");
+            }
+            return size_t(value);
+        };
+
+        // Threads: blocking servers serve a connection per worker, so there are at least two
+        port = options["port"].as<int>();
+        acceptors = std::max<size_t>(1, non_negative("acceptors"));
+        workers = non_negative("workers");
+        if (workers == 0) {
+            workers = std::max(2u, std::thread::hardware_concurrency());
+        }
+
+        // Step 1: configure storage, size bounds memory taken by items including all overhead
+        size_t storage_size = parse_size(options["storage-size"].as<std::string>());
+        size_t shards = non_negative("shards") > 0 ? non_negative("shards") : workers;
+
+        // Each shard needs 1M at least, hosts with many cpus would get too many of them by default
+        shards = std::max<size_t>(1, std::min<size_t>(shards, storage_size / (1 << 20)));
+
+        std::string numa = options["numa"].as<std::string>();
+        if (numa != "on" && numa != "off") {
+            throw std::runtime_error("Unknown numa mode");
+        }
+
         std::string storage_type = "st_lru";
         if (options.count("storage") > 0) {
             storage_type = options["storage"].as<std::string>();
         }
 
+        // Huge pages save TLB misses on big arenas, explicit ones fall back to transparent
+        huge_pages = options["huge-pages"].as<std::string>();
+        Afina::Allocator::Slab::Pages pages = Afina::Allocator::Slab::Pages::kRegular;
+        if (huge_pages == "thp") {
+            pages = Afina::Allocator::Slab::Pages::kTransparent;
+        } else if (huge_pages == "2M") {
+            pages = Afina::Allocator::Slab::Pages::kHuge2M;
+        } else if (huge_pages == "1G") {
+            pages = Afina::Allocator::Slab::Pages::kHuge1G;
+        } else if (huge_pages != "off") {
+            throw std::runtime_error("Unknown huge pages mode");
+        }
+
+        // With NUMA on sharded storage gets arena per node, the others spread single arena over nodes
+        const Concurrency::Topology &topology = Concurrency::Topology::System();
+        std::string allocator = options["allocator"].as<std::string>();
+        if (allocator == "slab") {
+            if (numa == "off") {
+                slabs.push_back(std::make_shared<Afina::Allocator::Slab>(storage_size, 1 << 20, 1.25, 16,
+                                                                         Afina::Allocator::Slab::kAnyNode, pages));
+            } else if (storage_type == "mt_slru") {
+                for (size_t node = 0; node < topology.Nodes(); node++) {
+                    slabs.push_back(std::make_shared<Afina::Allocator::Slab>(storage_size / topology.Nodes(), 1 << 20,
+                                                                             1.25, 16, node, pages));
+                }
+            } else {
+                slabs.push_back(std::make_shared<Afina::Allocator::Slab>(
+                    storage_size, 1 << 20, 1.25, 16, Afina::Allocator::Slab::kInterleave, pages));
+            }
+        } else if (allocator == "heap") {
+            if (huge_pages != "off") {
+                throw std::runtime_error("Huge pages need slab allocator");
+            }
+            slabs.push_back(nullptr);
+        } else {
+            throw std::runtime_error("Unknown allocator");
+        }
+        std::shared_ptr<Afina::Allocator::Slab> slab = slabs.front();
+
+        // Snapshot and log are written in background, so storage must be thread safe
+        std::string snapshot = options["snapshot"].as<std::string>();
+        std::string wal = options["wal"].as<std::string>();
+        if (!snapshot.empty() && !wal.empty()) {
+            throw std::runtime_error("Log keeps its own snapshot, --snapshot and --wal can't be used together");
+        }
+        // Values are compressed by LRU storages in process memory only, dictionary is trained in background
+        size_t compress = parse_size(options["compress"].as<std::string>());
+        if (compress > 0 && (storage_type == "shm_lru" || storage_type == "tiered_lru")) {
+            throw std::runtime_error("Compression isn't supported by " + storage_type);
+        }
+        size_t dictionary = parse_size(options["dictionary"].as<std::string>());
+        if (dictionary > 0 && compress == 0) {
+            throw std::runtime_error("Compression dictionary needs --compress");
+        }
+
+        if (storage_type == "st_lru" && (!snapshot.empty() || !wal.empty() || dictionary > 0)) {
+            storage_type = "mt_lru";
+        }
+
         if (storage_type == "st_lru") {
-            storage = std::make_shared<Afina::Backend::SimpleLRU>();
+            storage = std::make_shared<Afina::Backend::SimpleLRU>(storage_size, slab, storage_size, compress);
         } else if (storage_type == "mt_lru") {
-            storage = std::make_shared<Afina::Backend::ThreadSafeSimplLRU>();
+            storage = std::make_shared<Afina::Backend::ThreadSafeSimplLRU>(storage_size, slab, storage_size, compress);
         } else if (storage_type == "mt_slru") {
-            storage = Afina::Backend::StripedLockLRU::create_storage();
+            storage =
+                Afina::Backend::StripedLockLRU::create_storage(shards, storage_size, slabs, storage_size, compress);
+        } else if (storage_type == "mt_fclru") {
+            storage = std::make_shared<Afina::Backend::FlatCombineLRU>(storage_size, slab, storage_size, compress);
+        } else if (storage_type == "shm_lru") {
+            // Items are in the segment, not in the arena, they survive crash of the process
+            storage = std::make_shared<Afina::Backend::SharedLRU>(options["shm-path"].as<std::string>(), storage_size,
+                                                                  logService);
+        } else if (storage_type == "tiered_lru") {
+            // Items evicted from memory go to the file on SSD, misses read them back from there
+            storage = std::make_shared<Afina::Backend::TieredLRU>(storage_size, options["flash-path"].as<std::string>(),
+                                                                  parse_size(options["flash-size"].as<std::string>()),
+                                                                  slab, storage_size);
         } else {
             throw std::runtime_error("Unknown storage type");
         }
 
+        // Values of one schema share most of their bytes, dictionary trained on them compresses them better
+        if (dictionary > 0) {
+            storage = std::make_shared<Afina::Backend::DictionaryStorage>(
+                storage, dictionary, std::chrono::seconds(std::max<size_t>(1, non_negative("dictionary-interval"))),
+                logService);
+        }
+
+        // Warm restart: items survive restarts in the snapshot file
+        if (!snapshot.empty()) {
+            storage = std::make_shared<Afina::Backend::SnapshotStorage>(
+                storage, snapshot, std::chrono::seconds(non_negative("snapshot-interval")), logService);
+        }
+
+        // Durability: every change is logged, log is synced in background and compacted into snapshot
+        if (!wal.empty()) {
+            storage = std::make_shared<Afina::Backend::WalStorage>(
+                storage, wal, std::chrono::milliseconds(std::max<size_t>(1, non_negative("wal-sync"))),
+                parse_size(options["wal-compact"].as<std::string>()), logService);
+        }
+
         // Step 2: Configure network
         std::string network_type = "st_block";
         if (options.count("network") > 0) {
@@ -78,24 +263,71 @@ public:
             server = std::make_shared<Afina::Network::MTnonblock::ServerImpl>(storage, logService);
         } else if (network_type == "st_coroutine") {
             server = std::make_shared<Afina::Network::STcoroutine::ServerImpl>(storage, logService);
+        } else if (network_type == "mt_coroutine") {
+            server = std::make_shared<Afina::Network::MTcoroutine::ServerImpl>(storage, logService);
         } else {
             throw std::runtime_error("Unknown network type");
         }
+
+        Network::ServerOptions server_options;
+        server_options.low_watermark = non_negative("executor-low");
+        server_options.high_watermark = non_negative("executor-high");
+        server_options.max_queue_size = non_negative("executor-queue");
+        server_options.idle_time = non_negative("executor-idle");
+        server_options.read_timeout = non_negative("read-timeout");
+        server_options.numa_affinity = numa == "on";
+
+        // Listening socket is opened here for every server, so all of them get the same options. On
+        // graceful restart it is taken from the running process instead and handed over to the next one
+        std::vector<int> fds;
+        if (!options["handoff"].as<std::string>().empty()) {
+            handoff.reset(new Network::Handoff(options["handoff"].as<std::string>()));
+            taken_over = handoff->TakeOver(fds);
+
+            // Only the listening socket is used, the previous process could send more
+            for (std::size_t i = 1; i < fds.size(); i++) {
+                close(fds[i]);
+            }
+        }
+        listen_socket = taken_over ? fds[0] : Network::OpenListenSocket(port);
+        server_options.listen_socket = listen_socket;
+        server->SetOptions(server_options);
     }
 
-    // Start services in correct order
-    void Start() {
+    // Start services in correct order. Taking over from the running process network starts first,
+    // storage waits until the old process saves it
+    void Start(std::function<void()> on_takeover) {
         logService->Start();
         auto log = logService->select("root");
         log->warn("Start afina server {}", Afina::get_version());
 
-        log->warn("Start storage");
-        storage->Start();
+        for (auto &slab : slabs) {
+            if (slab && slab->pages() != Afina::Allocator::Slab::Pages::kRegular) {
+                bool explicit_pages = slab->pages() != Afina::Allocator::Slab::Pages::kTransparent;
+                log->warn("Storage arena of {} MB is on {} huge pages{}", slab->capacity() >> 20,
+                          explicit_pages ? huge_pages : "transparent",
+                          explicit_pages || huge_pages == "thp" ? "" : ", hugetlb pool has not enough of explicit ones");
+            }
+        }
+
+        if (!taken_over) {
+            log->warn("Start storage");
+            storage->Start();
+        }
+
+        log->warn("Start network on {}, {} acceptors, {} workers", port, acceptors, workers);
+        server->Start(port, acceptors, workers);
+
+        if (taken_over) {
+            log->warn("Took listening socket over, waiting for previous process to stop");
+            handoff->WaitPrevious();
+            log->warn("Start storage");
+            storage->Start();
+        }
 
-        // TODO: configure network service
-        const uint16_t port = 8080;
-        log->warn("Start network on {}", port);
-        server->Start(port, 2, 2);
+        if (handoff) {
+            handoff->Listen({listen_socket}, on_takeover);
+        }
     }
 
     // Stop services in correct order
@@ -106,6 +338,15 @@ public:
         server->Join();
 
         storage->Stop();
+        for (auto &slab : slabs) {
+            if (slab && slab->pages() != Afina::Allocator::Slab::Pages::kRegular) {
+                log->warn("Storage arena used {} MB, huge pages hold {} MB", slab->used() >> 20,
+                          slab->huge_bytes() >> 20);
+            }
+        }
+        if (handoff) {
+            handoff->Release();
+        }
         logService->Stop();
     }
 
@@ -115,6 +356,18 @@ private:
 
     std::shared_ptr<Afina::Storage> storage;
     std::shared_ptr<Network::Server> server;
+
+    // Arenas storage items are kept in, empty or nullptr for heap
+    std::vector<std::shared_ptr<Afina::Allocator::Slab>> slabs;
+    std::string huge_pages;
+
+    uint16_t port;
+    uint32_t acceptors;
+    uint32_t workers;
+
+    std::unique_ptr<Network::Handoff> handoff;
+    int listen_socket;
+    bool taken_over = false;
 };
 
 // Signal set that to notify application about time to stop
@@ -122,7 +375,7 @@ sem_t stop_semaphore;
 volatile sig_atomic_t stop_reason = 0;
 
 // Catch user desire to stop the server
-void on_term(int signum, siginfo_t *siginfo, void *data) {
+void on_term(int signum, siginfo_t *, void *) {
     stop_reason = signum;
     sem_post(&stop_semaphore);
 }
@@ -133,10 +386,79 @@ int main(int argc, char **argv) {
     try {
         // TODO: use custom cxxopts::value to print options possible values in help message
         // and simplify validation below
+        options.add_options()("c,config", "Config file of option = value lines, command line overrides it",
+                              cxxopts::value<std::string>());
         options.add_options()("s,storage", "Type of storage service to use", cxxopts::value<std::string>());
+        options.add_options()("storage-size", "Memory for stored items including overhead, K, M, G suffixes allowed",
+                              cxxopts::value<std::string>()->default_value("64M"));
+        options.add_options()("shards", "Number of mt_slru storage shards, number of workers if 0, one per 1M at most",
+                              cxxopts::value<int>()->default_value("0"));
+        options.add_options()("allocator", "Where items are kept: heap or slab arena of storage-size",
+                              cxxopts::value<std::string>()->default_value("heap"));
+        options.add_options()("huge-pages", "Back slab arena with huge pages: off, thp, 2M or 1G",
+                              cxxopts::value<std::string>()->default_value("off"));
+        options.add_options()("compress", "Keep values of this size and larger compressed, 0 is off, K suffix allowed",
+                              cxxopts::value<std::string>()->default_value("0"));
+        options.add_options()("dictionary", "Size of compression dictionary trained on stored values, 0 is off",
+                              cxxopts::value<std::string>()->default_value("0"));
+        options.add_options()("dictionary-interval", "Seconds between trainings of compression dictionary",
+                              cxxopts::value<int>()->default_value("60"));
+        options.add_options()("shm-path", "Segment file of shm_lru storage, on tmpfs or hugetlbfs",
+                              cxxopts::value<std::string>()->default_value("/dev/shm/afina"));
+        options.add_options()("flash-path", "File of tiered_lru flash tier on local SSD, recreated on start",
+                              cxxopts::value<std::string>()->default_value("/var/tmp/afina.flash"));
+        options.add_options()("flash-size", "Size of tiered_lru flash tier, K, M, G suffixes allowed",
+                              cxxopts::value<std::string>()->default_value("1G"));
+        options.add_options()("snapshot", "File to load items from on start and save them to on stop, none if empty",
+                              cxxopts::value<std::string>()->default_value(""));
+        options.add_options()("snapshot-interval", "Seconds between periodic snapshots, 0 saves on stop only",
+                              cxxopts::value<int>()->default_value("0"));
+        options.add_options()("wal", "Prefix of write-ahead log files making changes durable, none if empty",
+                              cxxopts::value<std::string>()->default_value(""));
+        options.add_options()("wal-sync", "Milliseconds between syncs of the log, one sync commits all changes made",
+                              cxxopts::value<int>()->default_value("10"));
+        options.add_options()("wal-compact", "Log size to compact it into snapshot at, K, M, G suffixes allowed",
+                              cxxopts::value<std::string>()->default_value("64M"));
         options.add_options()("n,network", "Type of network service to use", cxxopts::value<std::string>());
+        options.add_options()("p,port", "TCP port to listen on", cxxopts::value<int>()->default_value("8080"));
+        options.add_options()("acceptors", "Number of threads accepting connections",
+                              cxxopts::value<int>()->default_value("1"));
+        options.add_options()("workers", "Number of threads serving connections, number of CPUs if 0",
+                              cxxopts::value<int>()->default_value("0"));
+        options.add_options()("executor-low", "Threads executor keeps running",
+                              cxxopts::value<int>()->default_value("1"));
+        options.add_options()("executor-high", "Max threads of executor, number of workers if 0",
+                              cxxopts::value<int>()->default_value("0"));
+        options.add_options()("executor-queue", "Max tasks waiting in executor queue",
+                              cxxopts::value<int>()->default_value("10"));
+        options.add_options()("executor-idle", "Milliseconds idle executor thread waits before exit",
+                              cxxopts::value<int>()->default_value("100"));
+        options.add_options()("read-timeout", "Milliseconds to wait for client data, 0 waits forever",
+                              cxxopts::value<int>()->default_value("10000"));
+        options.add_options()("handoff", "Unix socket to take listening socket over from running afina and "
+                                         "to hand it over to the next one, none if empty",
+                              cxxopts::value<std::string>()->default_value(""));
+        options.add_options()("numa", "on: pin threads to NUMA nodes and place storage memory on them, off",
+                              cxxopts::value<std::string>()->default_value("off"));
         options.add_options()("h,help", "Print usage info");
-        options.parse(argc, argv);
+
+        // Config file goes first, so that command line options override it
+        std::vector<char *> cli(argv, argv + argc);
+        int cli_argc = argc;
+        char **cli_argv = cli.data();
+        options.parse(cli_argc, cli_argv);
+        if (options.count("config") > 0) {
+            std::vector<std::string> config = load_config(options["config"].as<std::string>());
+            std::vector<char *> args{argv[0]};
+            for (auto &arg : config) {
+                args.push_back(&arg[0]);
+            }
+            args.insert(args.end(), argv + 1, argv + argc);
+
+            int args_argc = args.size();
+            char **args_argv = args.data();
+            options.parse(args_argc, args_argv);
+        }
 
         if (options.count("help") > 0) {
             std::cerr << options.help() << std::endl;
@@ -145,11 +467,19 @@ int main(int argc, char **argv) {
     } catch (cxxopts::OptionParseException &ex) {
         std::cerr << "Error: " << ex.what() << std::endl;
         return 1;
+    } catch (std::runtime_error &ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
     }
 
     // Start boot sequence
     Application app;
-    app.Configure(options);
+    try {
+        app.Configure(options);
+    } catch (std::exception &ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
 
     // POSIX specific staff
     {
@@ -172,7 +502,7 @@ int main(int argc, char **argv) {
     // Run app
     try {
         // Start services
-        app.Start();
+        app.Start([]() { sem_post(&stop_semaphore); });
 
         // Freeze main thread until one of signals arrive
         while (stop_reason == 0 && ((sem_wait(&stop_semaphore) == -1) && (errno == EINTR))) {
@@ -0,0 +1,225 @@
+#include <afina/network/Handoff.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Afina {
+namespace Network {
+
+namespace {
+
+constexpr char kRequest = 'T';
+constexpr char kReply = 'F';
+constexpr char kDone = 'D';
+
+// Descriptors sent at most
+constexpr std::size_t kMaxFds = 8;
+
+struct sockaddr_un unix_address(const std::string &path) {
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Handoff socket path is too long: " + path);
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+    return addr;
+}
+
+} // namespace
+
+// See Handoff.h
+Handoff::Handoff(const std::string &path) : _path(path), _previous(-1), _listen(-1), _next(-1) {}
+
+// See Handoff.h
+Handoff::~Handoff() {
+    if (_listen != -1) {
+        shutdown(_listen, SHUT_RDWR);
+    }
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+    for (int fd : {_previous, _listen, _next}) {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+}
+
+// See Handoff.h
+bool Handoff::TakeOver(std::vector<int> &fds) {
+    struct sockaddr_un addr = unix_address(_path);
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock == -1) {
+        throw std::runtime_error("Failed to open handoff socket: " + std::string(strerror(errno)));
+    }
+
+    // Nobody there: socket file is missing or stale
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        close(sock);
+        return false;
+    }
+
+    char reply = 0;
+    char control[CMSG_SPACE(kMaxFds * sizeof(int))];
+    struct iovec iov = {&reply, 1};
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (send(sock, &kRequest, 1, MSG_NOSIGNAL) != 1 || recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != 1) {
+        close(sock);
+        throw std::runtime_error("Running process didn't hand its sockets over");
+    }
+
+    std::vector<int> received;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            std::size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const int *data = reinterpret_cast<const int *>(CMSG_DATA(cmsg));
+            received.insert(received.end(), data, data + count);
+        }
+    }
+    if (reply != kReply || received.empty()) {
+        for (int fd : received) {
+            close(fd);
+        }
+        close(sock);
+        throw std::runtime_error("Running process didn't hand its sockets over");
+    }
+
+    fds = std::move(received);
+
+    _previous = sock;
+    return true;
+}
+
+// See Handoff.h
+void Handoff::WaitPrevious() {
+    if (_previous == -1) {
+        return;
+    }
+
+    // Either done byte or connection closed by the exited process
+    char done;
+    while (recv(_previous, &done, 1, 0) == -1 && errno == EINTR) {
+    }
+    close(_previous);
+    _previous = -1;
+}
+
+// See Handoff.h
+void Handoff::Listen(const std::vector<int> &fds, std::function<void()> on_takeover) {
+    if (fds.empty() || fds.size() > kMaxFds) {
+        throw std::invalid_argument("Wrong number of descriptors to hand over");
+    }
+
+    // Path could still belong to the previous process, it is not going to use it anymore
+    struct sockaddr_un addr = unix_address(_path);
+    unlink(_path.c_str());
+    _listen = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (_listen == -1) {
+        throw std::runtime_error("Failed to open handoff socket: " + std::string(strerror(errno)));
+    }
+    if (bind(_listen, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(_listen, 1) == -1) {
+        throw std::runtime_error("Failed to listen on " + _path + ": " + std::string(strerror(errno)));
+    }
+
+    _thread = std::thread(&Handoff::OnRun, this, fds, std::move(on_takeover));
+}
+
+// See Handoff.h
+void Handoff::Release() {
+    if (_thread.joinable()) {
+        shutdown(_listen, SHUT_RDWR);
+        _thread.join();
+    }
+    if (_next != -1) {
+        send(_next, &kDone, 1, MSG_NOSIGNAL);
+        close(_next);
+        _next = -1;
+    }
+}
+
+// See Handoff.h
+void Handoff::OnRun(std::vector<int> fds, std::function<void()> on_takeover) {
+    for (;;) {
+        int sock = accept4(_listen, nullptr, nullptr, SOCK_CLOEXEC);
+        if (sock == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            // Listener is shut down
+            return;
+        }
+
+        // Something else connected, wait for the real successor
+        char request = 0;
+        if (recv(sock, &request, 1, 0) != 1 || request != kRequest) {
+            close(sock);
+            continue;
+        }
+
+        char control[CMSG_SPACE(kMaxFds * sizeof(int))];
+        std::memset(control, 0, sizeof(control));
+        struct iovec iov = {const_cast<char *>(&kReply), 1};
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(fds.size() * sizeof(int));
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(fds.size() * sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), fds.data(), fds.size() * sizeof(int));
+
+        if (sendmsg(sock, &msg, MSG_NOSIGNAL) != 1) {
+            close(sock);
+            continue;
+        }
+
+        _next = sock;
+        on_takeover();
+        return;
+    }
+}
+
+// See Handoff.h
+int OpenListenSocket(uint16_t port) {
+    struct sockaddr_in server_addr;
+    std::memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;         // IPv4
+    server_addr.sin_port = htons(port);       // TCP port number
+    server_addr.sin_addr.s_addr = INADDR_ANY; // Bind to any address
+
+    int sock = socket(PF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (sock == -1) {
+        throw std::runtime_error("Failed to open socket: " + std::string(strerror(errno)));
+    }
+
+    int opts = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opts, sizeof(opts)) == -1 ||
+        bind(sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1 || listen(sock, 128) == -1) {
+        int error = errno;
+        close(sock);
+        throw std::runtime_error("Failed to listen on port " + std::to_string(port) + ": " + strerror(error));
+    }
+    return sock;
+}
+
+} // namespace Network
+} // namespace Afina
@@ -1,5 +1,6 @@
 #include "ServerImpl.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <iostream>
@@ -7,10 +8,13 @@
 #include <stdexcept>
 
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <pthread.h>
 #include <signal.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -19,6 +23,7 @@
 
 #include <afina/Storage.h>
 #include <afina/execute/Command.h>
+#include <afina/execute/Counters.h>
 #include <afina/logging/Service.h>
 
 #include "protocol/Parser.h"
@@ -28,13 +33,13 @@ namespace Network {
 namespace MTblocking {
 
 // See Server.h
-ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl) : Server(ps, pl), executor() {}
+ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl) : Server(ps, pl) {}
 
 // See Server.h
 ServerImpl::~ServerImpl() {}
 
 // See Server.h
-void ServerImpl::Start(uint16_t port, uint32_t n_accept, uint32_t n_workers) {
+void ServerImpl::Start(uint16_t, uint32_t, uint32_t n_workers) {
     limits = n_workers;
 
     _logger = pLogging->select("network");
@@ -47,34 +52,28 @@ void ServerImpl::Start(uint16_t port, uint32_t n_accept, uint32_t n_workers) {
         throw std::runtime_error("Unable to mask SIGPIPE");
     }
 
-    struct sockaddr_in server_addr;
-    std::memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;         // IPv4
-    server_addr.sin_port = htons(port);       // TCP port number
-    server_addr.sin_addr.s_addr = INADDR_ANY; // Bind to any address
-
-    _server_socket = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
+    // Listening socket is opened by Network::OpenListenSocket or inherited from the previous process,
+    // see Handoff.h
+    _server_socket = options.listen_socket;
     if (_server_socket == -1) {
-        throw std::runtime_error("Failed to open socket");
+        throw std::runtime_error("Listening socket isn't given");
     }
 
-    int opts = 1;
-    if (setsockopt(_server_socket, SOL_SOCKET, SO_REUSEADDR, &opts, sizeof(opts)) == -1) {
+    // Acceptor waits in poll, accept must not block if another process took the connection first
+    fcntl(_server_socket, F_SETFL, fcntl(_server_socket, F_GETFL) | O_NONBLOCK);
+    _event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_event_fd == -1) {
         close(_server_socket);
-        throw std::runtime_error("Socket setsockopt() failed");
+        throw std::runtime_error("Failed to create event file descriptor");
     }
 
-    if (bind(_server_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
-        close(_server_socket);
-        throw std::runtime_error("Socket bind() failed");
-    }
-
-    if (listen(_server_socket, 5) == -1) {
-        close(_server_socket);
-        throw std::runtime_error("Socket listen() failed");
-    }
+    // Each connection takes a pool thread, so there are as many threads as connections allowed
+    std::size_t high_watermark = options.high_watermark > 0 ? options.high_watermark : n_workers;
+    executor.reset(new Concurrency::WorkStealingExecutor("mt_blocking", std::min(options.low_watermark, high_watermark),
+                                                         high_watermark, options.max_queue_size, options.idle_time));
 
     running.store(true);
+    executor->Start();
     _thread = std::thread(&ServerImpl::OnRun, this);
 }
 
@@ -85,19 +84,27 @@ void ServerImpl::Stop() {
     for (std::set<int> :: iterator it = connections.begin(); it != connections.end(); it++){
         shutdown(*it, SHUT_RD);
     }
-    shutdown(_server_socket, SHUT_RDWR);
-    executor.Stop(false);
+    if (eventfd_write(_event_fd, 1)) {
+        throw std::runtime_error("Failed to wakeup acceptor");
+    }
+    if (executor) {
+        executor->Stop(false);
+    }
 }
 
 // See Server.h
 void ServerImpl::Join() {
-    //assert(_thread.joinable());
-    //_thread.join();
+    if (_thread.joinable()) {
+        _thread.join();
+    }
     std::unique_lock<std::mutex> lk(server_mutex);
     while (!connections.empty())
         cv.wait(lk);
     close(_server_socket);
-    executor.Stop(false);
+    close(_event_fd);
+    if (executor) {
+        executor->Stop(false);
+    }
 }
 
 // See Server.h
@@ -105,7 +112,14 @@ void ServerImpl::OnRun() {
     while (running.load()) {
         _logger->debug("waiting for connection...");
 
-        // The call to accept() blocks until the incoming connection arrives
+        // Listener could be shared with the next process during graceful restart, so it can't be shut
+        // down to wake acceptor up, stop event is watched together with it instead
+        struct pollfd fds[2] = {{_server_socket, POLLIN, 0}, {_event_fd, POLLIN, 0}};
+        if (poll(fds, 2, -1) == -1 || fds[1].revents != 0) {
+            continue;
+        }
+
+        // Connection is ready, unless another acceptor got it first
         int client_socket;
         struct sockaddr client_addr;
         socklen_t client_addr_len = sizeof(client_addr);
@@ -114,6 +128,7 @@ void ServerImpl::OnRun() {
         }
 
         // Got new connection
+        Execute::Counters::Add(Execute::Counters::kConnections);
         if (_logger->should_log(spdlog::level::debug)) {
             std::string host = "unknown", port = "-1";
 
@@ -127,26 +142,44 @@ void ServerImpl::OnRun() {
         }
 
         // Configure read timeout
-        {
+        if (options.read_timeout > 0) {
             struct timeval tv;
-            tv.tv_sec = 10; // TODO: make it configurable
-            tv.tv_usec = 0;
+            tv.tv_sec = options.read_timeout / 1000;
+            tv.tv_usec = (options.read_timeout % 1000) * 1000;
             setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, (const char *)&tv, sizeof tv);
         }
 
+        bool accepted = false;
         {
             std::lock_guard<std::mutex> lk(server_mutex);
             if ((connections.size() < limits) && (running)){
                 connections.insert(client_socket);
-                //std::thread(&ServerImpl::Work, this, client_socket).detach();
-                executor.Execute(&ServerImpl::Work, this, client_socket);
+                accepted = true;
             }
-            else
-                close(client_socket);
+        }
+        if (!accepted) {
+            close(client_socket);
+            continue;
+        }
+
+        // Task is submitted without the lock: with kCallerRuns policy it runs right here, and Work takes
+        // the lock to remove the connection
+        if (!executor->Execute(&ServerImpl::Work, this, client_socket)) {
+            // Nobody is going to serve connection, so it must not hold Join forever
+            _logger->warn("Executor rejected connection on descriptor {}", client_socket);
+            std::lock_guard<std::mutex> lk(server_mutex);
+            connections.erase(client_socket);
+            close(client_socket);
+            cv.notify_all();
         }
     }
 
     // Cleanup on exit...
+    auto stats = executor->GetStats();
+    auto queue_time = executor->QueueTime();
+    _logger->warn("Executor: {} tasks completed, {} rejected, {} threads, queue wait p50={}us p99={}us max={}us",
+                  stats.completed, stats.rejected, stats.threads, queue_time.Percentile(50) / 1000,
+                  queue_time.Percentile(99) / 1000, queue_time.Max() / 1000);
     _logger->warn("Network stopped");
 }
 
@@ -157,15 +190,23 @@ void ServerImpl::Work(int client_socket){
     // - command_to_execute: last command parsed out of stream
     // - arg_remains: how many bytes to read from stream to get command argument
     // - argument_for_command: buffer stores argument
+    //
+    // Parser and buffers are taken from the thread scratch, previous connection could leave them in
+    // any state
     std::size_t arg_remains;
-    Protocol::Parser parser;
-    std::string argument_for_command;
+    Scratch &local = scratch.Get();
+    Protocol::Parser &parser = local.parser;
+    std::string &argument_for_command = local.argument_for_command;
+    std::string &result = local.result;
     std::unique_ptr<Execute::Command> command_to_execute;
+    parser.Reset();
+    argument_for_command.clear();
     try {
         int readed_bytes = -1;
         char client_buffer[4096] = "";
         while ((readed_bytes = read(client_socket, client_buffer, sizeof(client_buffer))) > 0) {
            _logger->debug("Got {} bytes from socket", readed_bytes);
+           Execute::Counters::Add(Execute::Counters::kBytesRead, readed_bytes);
             // Single block of data readed from the socket could trigger inside actions a multiple times,
             // for example:
             // - read#0: [<command1 start>]
@@ -209,7 +250,7 @@ void ServerImpl::Work(int client_socket){
                 if (command_to_execute && arg_remains == 0) {
                     _logger->debug("Start command execution");
 
-                    std::string result;
+                    result.clear();
                     if (argument_for_command.size()) {
                         argument_for_command.resize(argument_for_command.size() - 2);
                     }
@@ -217,6 +258,8 @@ void ServerImpl::Work(int client_socket){
 
                     // Send response
                     result += "\r\n";
+                    Execute::Counters::Add(Execute::Counters::kCommands);
+                    Execute::Counters::Add(Execute::Counters::kBytesWritten, result.size());
                     if (send(client_socket, result.data(), result.size(), 0) <= 0) {
                         throw std::runtime_error("Failed to send response");
                     }
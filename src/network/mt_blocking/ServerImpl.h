@@ -6,9 +6,13 @@
 #include <mutex>
 #include <condition_variable>
 #include <set>
+#include <string>
 
 #include <afina/network/Server.h>
-#include <../../afina/include/afina/concurrency/Executor.h>
+#include <afina/concurrency/ThreadLocal.h>
+#include <afina/concurrency/WorkStealingExecutor.h>
+
+#include "protocol/Parser.h"
 
 namespace spdlog {
 class logger;
@@ -45,6 +49,14 @@ protected:
     void OnRun();
 
 private:
+    // Connection state buffers, each executor thread serves one connection at a time, so it keeps
+    // them between connections and reuses already allocated memory
+    struct Scratch {
+        Protocol::Parser parser;
+        std::string argument_for_command;
+        std::string result;
+    };
+
     // Logger instance
     std::shared_ptr<spdlog::logger> _logger;
 
@@ -56,6 +68,9 @@ private:
     // Server socket to accept connections on
     int _server_socket;
 
+    // Wakes acceptor up on Stop
+    int _event_fd;
+
     // Thread to run network on
     std::thread _thread;
 
@@ -67,7 +82,11 @@ private:
 
     std::condition_variable cv;
 
-    Concurrency::Executor executor;
+    // Must outlive executor threads
+    Concurrency::ThreadLocal<Scratch> scratch;
+
+    // Created on start as its size depends on options
+    std::unique_ptr<Concurrency::WorkStealingExecutor> executor;
 };
 
 } // namespace MTblocking
@@ -0,0 +1,257 @@
+#include "ServerImpl.h"
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <spdlog/logger.h>
+
+#include <afina/Storage.h>
+#include <afina/concurrency/Topology.h>
+#include <afina/execute/Command.h>
+#include <afina/execute/Counters.h>
+#include <afina/logging/Service.h>
+
+#include "protocol/Parser.h"
+
+namespace Afina {
+namespace Network {
+namespace MTcoroutine {
+
+// See Server.h
+ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl) : Server(ps, pl) {}
+
+// See Server.h
+ServerImpl::~ServerImpl() {}
+
+// See Server.h
+void ServerImpl::Start(uint16_t, uint32_t, uint32_t n_workers) {
+    _logger = pLogging->select("network");
+    _logger->info("Start mt_coroutine network service");
+
+    sigset_t sig_mask;
+    sigemptyset(&sig_mask);
+    sigaddset(&sig_mask, SIGPIPE);
+    if (pthread_sigmask(SIG_BLOCK, &sig_mask, NULL) != 0) {
+        throw std::runtime_error("Unable to mask SIGPIPE");
+    }
+
+    // Listening socket is opened by Network::OpenListenSocket or inherited from the previous process,
+    // see Handoff.h
+    _server_socket = options.listen_socket;
+    if (_server_socket == -1) {
+        throw std::runtime_error("Listening socket isn't given");
+    }
+
+    // Acceptor waits in poll, accept must not block if another process took the connection first
+    fcntl(_server_socket, F_SETFL, fcntl(_server_socket, F_GETFL) | O_NONBLOCK);
+    _event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_event_fd == -1) {
+        close(_server_socket);
+        throw std::runtime_error("Failed to create event file descriptor");
+    }
+
+    // Workers are spread over NUMA nodes round robin if asked so, acceptor goes to the first one
+    const Concurrency::Topology &topology = Concurrency::Topology::System();
+    _scheduler.reset(new Coroutine::Scheduler(n_workers));
+    if (options.numa_affinity) {
+        _scheduler->SetThreadStart([&topology](std::size_t worker) { topology.BindThread(worker % topology.Nodes()); });
+    }
+    _scheduler->Start();
+
+    running.store(true);
+    _thread = std::thread(&ServerImpl::OnRun, this);
+    if (options.numa_affinity) {
+        topology.BindThread(_thread.native_handle(), 0);
+    }
+}
+
+// See Server.h
+void ServerImpl::Stop() {
+    running.store(false);
+    {
+        std::lock_guard<std::mutex> lk(_connections_mutex);
+        for (int client_socket : _connections) {
+            shutdown(client_socket, SHUT_RD);
+        }
+    }
+    if (eventfd_write(_event_fd, 1)) {
+        throw std::runtime_error("Failed to wakeup acceptor");
+    }
+    _scheduler->Stop();
+}
+
+// See Server.h
+void ServerImpl::Join() {
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+    _scheduler->Join();
+    close(_server_socket);
+    close(_event_fd);
+}
+
+// See ServerImpl.h
+void ServerImpl::OnRun() {
+    while (running.load()) {
+        _logger->debug("waiting for connection...");
+
+        // Listener could be shared with the next process during graceful restart, so it can't be shut
+        // down to wake acceptor up, stop event is watched together with it instead
+        struct pollfd fds[2] = {{_server_socket, POLLIN, 0}, {_event_fd, POLLIN, 0}};
+        if (poll(fds, 2, -1) == -1 || fds[1].revents != 0) {
+            continue;
+        }
+
+        // Connection is ready, unless another acceptor got it first
+        int client_socket;
+        struct sockaddr client_addr;
+        socklen_t client_addr_len = sizeof(client_addr);
+        if ((client_socket = accept4(_server_socket, (struct sockaddr *)&client_addr, &client_addr_len,
+                                     SOCK_NONBLOCK | SOCK_CLOEXEC)) == -1) {
+            continue;
+        }
+
+        // Got new connection
+        Execute::Counters::Add(Execute::Counters::kConnections);
+        if (_logger->should_log(spdlog::level::debug)) {
+            std::string host = "unknown", port = "-1";
+
+            char hbuf[NI_MAXHOST], sbuf[NI_MAXSERV];
+            if (getnameinfo(&client_addr, client_addr_len, hbuf, sizeof(hbuf), sbuf, sizeof(sbuf),
+                            NI_NUMERICHOST | NI_NUMERICSERV) == 0) {
+                host = hbuf;
+                port = sbuf;
+            }
+            _logger->debug("Accepted connection on descriptor {} (host={}, port={})\n", client_socket, host, port);
+        }
+
+        std::lock_guard<std::mutex> lk(_connections_mutex);
+        if (running.load() && _scheduler->Spawn(std::bind(&ServerImpl::Work, this, client_socket))) {
+            _connections.insert(client_socket);
+        } else {
+            close(client_socket);
+        }
+    }
+
+    // Cleanup on exit...
+    _logger->warn("Network stopped");
+}
+
+// See ServerImpl.h
+void ServerImpl::Work(int client_socket) {
+    // Here is connection state
+    // - parser: parse state of the stream
+    // - command_to_execute: last command parsed out of stream
+    // - arg_remains: how many bytes to read from stream to get command argument
+    // - argument_for_command: buffer stores argument
+    std::size_t arg_remains;
+    Protocol::Parser parser;
+    std::string argument_for_command;
+    std::unique_ptr<Execute::Command> command_to_execute;
+    try {
+        // Idle connections get closed once read timeout expires, 0 waits forever
+        const int read_timeout = options.read_timeout > 0 ? int(options.read_timeout) : -1;
+        int readed_bytes = -1;
+        char client_buffer[4096] = "";
+        while ((readed_bytes = Coroutine::Scheduler::Read(client_socket, client_buffer, sizeof(client_buffer),
+                                                          read_timeout)) > 0) {
+            _logger->debug("Got {} bytes from socket", readed_bytes);
+            Execute::Counters::Add(Execute::Counters::kBytesRead, readed_bytes);
+            // Single block of data readed from the socket could trigger inside actions a multiple times,
+            // for example:
+            // - read#0: [<command1 start>]
+            // - read#1: [<command1 end> <argument> <command2> <argument for command 2> <command3> ... ]
+            while (readed_bytes > 0) {
+                _logger->debug("Process {} bytes", readed_bytes);
+                // There is no command yet
+                if (!command_to_execute) {
+                    std::size_t parsed = 0;
+                    if (parser.Parse(client_buffer, readed_bytes, parsed)) {
+                        // There is no command to be launched, continue to parse input stream
+                        // Here we are, current chunk finished some command, process it
+                        _logger->debug("Found new command: {} in {} bytes", parser.Name(), parsed);
+                        command_to_execute = parser.Build(arg_remains);
+                        if (arg_remains > 0) {
+                            arg_remains += 2;
+                        }
+                    }
+
+                    // Parsed might fails to consume any bytes from input stream. In real life that could happens,
+                    // for example, because we are working with UTF-16 chars and only 1 byte left in stream
+                    if (parsed == 0) {
+                        break;
+                    } else {
+                        std::memmove(client_buffer, client_buffer + parsed, readed_bytes - parsed);
+                        readed_bytes -= parsed;
+                    }
+                }
+
+                // There is command, but we still wait for argument to arrive...
+                if (command_to_execute && arg_remains > 0) {
+                    _logger->debug("Fill argument: {} bytes of {}", readed_bytes, arg_remains);
+                    // There is some parsed command, and now we are reading argument
+                    std::size_t to_read = std::min(arg_remains, std::size_t(readed_bytes));
+                    argument_for_command.append(client_buffer, to_read);
+                    std::memmove(client_buffer, client_buffer + to_read, readed_bytes - to_read);
+                    arg_remains -= to_read;
+                    readed_bytes -= to_read;
+                }
+
+                // Thre is command & argument - RUN!
+                if (command_to_execute && arg_remains == 0) {
+                    _logger->debug("Start command execution");
+
+                    std::string result;
+                    if (argument_for_command.size()) {
+                        argument_for_command.resize(argument_for_command.size() - 2);
+                    }
+                    command_to_execute->Execute(*pStorage, argument_for_command, result);
+
+                    // Send response
+                    result += "\r\n";
+                    Execute::Counters::Add(Execute::Counters::kCommands);
+                    Execute::Counters::Add(Execute::Counters::kBytesWritten, result.size());
+                    if (Coroutine::Scheduler::Write(client_socket, result.data(), result.size()) <= 0) {
+                        throw std::runtime_error("Failed to send response");
+                    }
+
+                    // Prepare for the next command
+                    command_to_execute.reset();
+                    argument_for_command.resize(0);
+                    parser.Reset();
+                }
+            } // while (readed_bytes)
+        }
+
+        if (readed_bytes == 0) {
+            _logger->debug("Connection closed");
+        } else {
+            throw std::runtime_error(std::string(strerror(errno)));
+        }
+    } catch (std::runtime_error &ex) {
+        _logger->error("Failed to process connection on descriptor {}: {}", client_socket, ex.what());
+    }
+
+    std::lock_guard<std::mutex> lk(_connections_mutex);
+    _connections.erase(client_socket);
+    close(client_socket);
+}
+
+} // namespace MTcoroutine
+} // namespace Network
+} // namespace Afina
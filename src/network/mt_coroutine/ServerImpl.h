@@ -0,0 +1,78 @@
+#ifndef AFINA_NETWORK_MT_COROUTINE_SERVER_H
+#define AFINA_NETWORK_MT_COROUTINE_SERVER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include <afina/coroutine/Scheduler.h>
+#include <afina/network/Server.h>
+
+namespace spdlog {
+class logger;
+}
+
+namespace Afina {
+namespace Network {
+namespace MTcoroutine {
+
+/**
+ * # Network resource manager implementation
+ * Coroutine per connection server, coroutines are spread over worker threads by M:N scheduler
+ */
+class ServerImpl : public Server {
+public:
+    ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl);
+    ~ServerImpl();
+
+    // See Server.h
+    void Start(uint16_t port, uint32_t acceptors, uint32_t workers) override;
+
+    // See Server.h
+    void Stop() override;
+
+    // See Server.h
+    void Join() override;
+
+protected:
+    /**
+     * Method is running in the connection acceptor thread
+     */
+    void OnRun();
+
+    /**
+     * Connection coroutine
+     */
+    void Work(int client_socket);
+
+private:
+    // Logger instance
+    std::shared_ptr<spdlog::logger> _logger;
+
+    // Atomic flag to notify threads when it is time to stop
+    std::atomic<bool> running;
+
+    // Server socket to accept connections on
+    int _server_socket;
+
+    // Wakes acceptor up on Stop
+    int _event_fd;
+
+    // Thread to accept connections on
+    std::thread _thread;
+
+    // Coroutines executor
+    std::unique_ptr<Coroutine::Scheduler> _scheduler;
+
+    // Active connections, to be shutdown on Stop
+    std::mutex _connections_mutex;
+    std::set<int> _connections;
+};
+
+} // namespace MTcoroutine
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_MT_COROUTINE_SERVER_H
@@ -11,6 +11,7 @@
 
 #include <spdlog/logger.h>
 
+#include <afina/concurrency/Topology.h>
 #include <afina/logging/Service.h>
 
 #include "Connection.h"
@@ -47,12 +48,15 @@ Worker &Worker::operator=(Worker &&other) {
 }
 
 // See Worker.h
-void Worker::Start(int epoll_fd) {
+void Worker::Start(int epoll_fd, int node) {
     if (isRunning.exchange(true) == false) {
         assert(_epoll_fd == -1);
         _epoll_fd = epoll_fd;
         _logger = _pLogging->select("network.worker");
         _thread = std::thread(&Worker::OnRun, this);
+        if (node >= 0 && !Concurrency::Topology::System().BindThread(_thread.native_handle(), node)) {
+            _logger->warn("Failed to bind worker to node {}", node);
+        }
     }
 }
 
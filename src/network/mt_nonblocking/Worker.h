@@ -36,9 +36,9 @@ public:
     /**
      * Spaws new background thread that is doing epoll on the given server
      * socket. Once connection accepted it must be registered and being processed
-     * on this thread
+     * on this thread. Thread is pinned to the given NUMA node unless it is negative
      */
-    void Start(int epoll_fd);
+    void Start(int epoll_fd, int node = -1);
 
     /**
      * Signal background thread to stop. After that signal thread must stop to
@@ -7,10 +7,13 @@
 #include <stdexcept>
 
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <pthread.h>
 #include <signal.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -19,6 +22,7 @@
 
 #include <afina/Storage.h>
 #include <afina/execute/Command.h>
+#include <afina/execute/Counters.h>
 #include <afina/logging/Service.h>
 
 #include "protocol/Parser.h"
@@ -34,7 +38,7 @@ ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Loggi
 ServerImpl::~ServerImpl() {}
 
 // See Server.h
-void ServerImpl::Start(uint16_t port, uint32_t n_accept, uint32_t n_workers) {
+void ServerImpl::Start(uint16_t, uint32_t, uint32_t) {
     _logger = pLogging->select("network");
     _logger->info("Start st_blocking network service");
 
@@ -48,57 +52,19 @@ void ServerImpl::Start(uint16_t port, uint32_t n_accept, uint32_t n_workers) {
         throw std::runtime_error("Unable to mask SIGPIPE");
     }
 
-    // For IPv4 we use struct sockaddr_in:
-    // struct sockaddr_in {
-    //     short int          sin_family;  // Address family, AF_INET
-    //     unsigned short int sin_port;    // Port number
-    //     struct in_addr     sin_addr;    // Internet address
-    //     unsigned char      sin_zero[8]; // Same size as struct sockaddr
-    // };
-    //
-    // Note we need to convert the port to network order
-    struct sockaddr_in server_addr;
-    std::memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;         // IPv4
-    server_addr.sin_port = htons(port);       // TCP port number
-    server_addr.sin_addr.s_addr = INADDR_ANY; // Bind to any address
-
-    // Arguments are:
-    // - Family: IPv4
-    // - Type: Full-duplex stream (reliable)
-    // - Protocol: TCP
-    _server_socket = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
+    // Listening socket is opened by Network::OpenListenSocket or inherited from the previous process,
+    // see Handoff.h
+    _server_socket = options.listen_socket;
     if (_server_socket == -1) {
-        throw std::runtime_error("Failed to open socket");
+        throw std::runtime_error("Listening socket isn't given");
     }
 
-    // when the server closes the socket,the connection must stay in the TIME_WAIT state to
-    // make sure the client received the acknowledgement that the connection has been terminated.
-    // During this time, this port is unavailable to other processes, unless we specify this option
-    //
-    // This option let kernel knows that we are OK that multiple threads/processes are listen on the
-    // same port. In a such case kernel will balance input traffic between all listeners (except those who
-    // are closed already)
-    int opts = 1;
-    if (setsockopt(_server_socket, SOL_SOCKET, SO_REUSEADDR, &opts, sizeof(opts)) == -1) {
+    // Acceptor waits in poll, accept must not block if another process took the connection first
+    fcntl(_server_socket, F_SETFL, fcntl(_server_socket, F_GETFL) | O_NONBLOCK);
+    _event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_event_fd == -1) {
         close(_server_socket);
-        throw std::runtime_error("Socket setsockopt() failed");
-    }
-
-    // Bind the socket to the address. In other words let kernel know data for what address we'd
-    // like to see in the socket
-    if (bind(_server_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
-        close(_server_socket);
-        throw std::runtime_error("Socket bind() failed");
-    }
-
-    // Start listening. The second parameter is the "backlog", or the maximum number of
-    // connections that we'll allow to queue up. Note that listen() doesn't block until
-    // incoming connections arrive. It just makesthe OS aware that this process is willing
-    // to accept connections on this socket (which is bound to a specific IP and port)
-    if (listen(_server_socket, 5) == -1) {
-        close(_server_socket);
-        throw std::runtime_error("Socket listen() failed");
+        throw std::runtime_error("Failed to create event file descriptor");
     }
 
     running.store(true);
@@ -108,7 +74,9 @@ void ServerImpl::Start(uint16_t port, uint32_t n_accept, uint32_t n_workers) {
 // See Server.h
 void ServerImpl::Stop() {
     running.store(false);
-    shutdown(_server_socket, SHUT_RDWR);
+    if (eventfd_write(_event_fd, 1)) {
+        throw std::runtime_error("Failed to wakeup acceptor");
+    }
 }
 
 // See Server.h
@@ -116,6 +84,7 @@ void ServerImpl::Join() {
     assert(_thread.joinable());
     _thread.join();
     close(_server_socket);
+    close(_event_fd);
 }
 
 // See Server.h
@@ -132,7 +101,14 @@ void ServerImpl::OnRun() {
     while (running.load()) {
         _logger->debug("waiting for connection...");
 
-        // The call to accept() blocks until the incoming connection arrives
+        // Listener could be shared with the next process during graceful restart, so it can't be shut
+        // down to wake acceptor up, stop event is watched together with it instead
+        struct pollfd fds[2] = {{_server_socket, POLLIN, 0}, {_event_fd, POLLIN, 0}};
+        if (poll(fds, 2, -1) == -1 || fds[1].revents != 0) {
+            continue;
+        }
+
+        // Connection is ready, unless another acceptor got it first
         int client_socket;
         struct sockaddr client_addr;
         socklen_t client_addr_len = sizeof(client_addr);
@@ -141,6 +117,7 @@ void ServerImpl::OnRun() {
         }
 
         // Got new connection
+        Execute::Counters::Add(Execute::Counters::kConnections);
         if (_logger->should_log(spdlog::level::debug)) {
             std::string host = "unknown", port = "-1";
 
@@ -154,10 +131,10 @@ void ServerImpl::OnRun() {
         }
 
         // Configure read timeout
-        {
+        if (options.read_timeout > 0) {
             struct timeval tv;
-            tv.tv_sec = 5; // TODO: make it configurable
-            tv.tv_usec = 0;
+            tv.tv_sec = options.read_timeout / 1000;
+            tv.tv_usec = (options.read_timeout % 1000) * 1000;
             setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, (const char *)&tv, sizeof tv);
         }
 
@@ -170,6 +147,7 @@ void ServerImpl::OnRun() {
             char client_buffer[4096];
             while ((readed_bytes = read(client_socket, client_buffer, sizeof(client_buffer))) > 0) {
                 _logger->debug("Got {} bytes from socket", readed_bytes);
+                Execute::Counters::Add(Execute::Counters::kBytesRead, readed_bytes);
 
                 // Single block of data readed from the socket could trigger inside actions a multiple times,
                 // for example:
@@ -224,6 +202,8 @@ void ServerImpl::OnRun() {
 
                         // Send response
                         result += "\r\n";
+                        Execute::Counters::Add(Execute::Counters::kCommands);
+                        Execute::Counters::Add(Execute::Counters::kBytesWritten, result.size());
                         if (send(client_socket, result.data(), result.size(), 0) <= 0) {
                             throw std::runtime_error("Failed to send response");
                         }
@@ -50,6 +50,9 @@ private:
     // Server socket to accept connections on
     int _server_socket;
 
+    // Wakes acceptor up on Stop
+    int _event_fd;
+
     // Thread to run network on
     std::thread _thread;
 };
@@ -0,0 +1,210 @@
+#include "Dictionary.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#include <spdlog/logger.h>
+
+#include <afina/logging/Service.h>
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+// Dictionary is made of segments, each segment is scored by sequences it contains
+constexpr std::size_t kSequence = 8;
+constexpr std::size_t kSegment = 64;
+
+struct Occurrence {
+    // Number of samples sequence occurs in, zero once it is taken into dictionary
+    uint32_t samples;
+
+    // Last sample counted + 1
+    uint32_t last;
+};
+
+uint64_t sequence_at(const char *p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Total compressed size of values
+std::size_t compressed_size(const std::vector<std::string> &values, const Lz4::Dictionary *dictionary) {
+    std::size_t total = 0;
+    std::string buffer;
+    for (auto &value : values) {
+        buffer.resize(Lz4::Bound(value.size()));
+        total += Lz4::Compress(value.data(), value.size(), &buffer[0], dictionary);
+    }
+    return total;
+}
+
+} // namespace
+
+// See Dictionary.h
+std::string TrainDictionary(const std::vector<std::string> &samples, std::size_t size) {
+    std::unordered_map<uint64_t, Occurrence> occurrences;
+    std::size_t total = 0;
+    for (std::size_t s = 0; s < samples.size(); s++) {
+        const std::string &sample = samples[s];
+        for (std::size_t i = 0; i + kSequence <= sample.size(); i++) {
+            Occurrence &occurrence = occurrences[sequence_at(sample.data() + i)];
+            if (occurrence.last != s + 1) {
+                occurrence.last = s + 1;
+                occurrence.samples++;
+            }
+        }
+        total += sample.size();
+    }
+    auto score = [&occurrences](const char *p) {
+        uint32_t samples = occurrences[sequence_at(p)].samples;
+        return samples > 1 ? samples : 0;
+    };
+
+    std::string dictionary;
+    std::size_t segments = std::max<std::size_t>(1, size / kSegment);
+    std::size_t s = 0, offset = 0;
+    for (std::size_t range = 0; range < segments && dictionary.size() + kSequence <= size; range++) {
+        // Best segment of the samples starting in the range
+        std::size_t best = 0, best_sample = 0, best_pos = 0, best_size = 0;
+        for (; s < samples.size() && offset * segments < (range + 1) * total; s++) {
+            const std::string &sample = samples[s];
+            offset += sample.size();
+            if (sample.size() < kSequence) {
+                continue;
+            }
+
+            // Window slides over sequence starts, segment covers its sequences fully
+            std::size_t window = std::min(kSegment, sample.size()) - kSequence + 1;
+            std::vector<uint32_t> scores(sample.size() - kSequence + 1);
+            std::size_t sum = 0;
+            for (std::size_t i = 0; i < scores.size(); i++) {
+                scores[i] = score(sample.data() + i);
+                sum += scores[i];
+                if (i >= window) {
+                    sum -= scores[i - window];
+                }
+                if (i + 1 >= window && sum > best) {
+                    best = sum;
+                    best_sample = s;
+                    best_pos = i + 1 - window;
+                    best_size = window + kSequence - 1;
+                }
+            }
+        }
+
+        if (best == 0) {
+            continue;
+        }
+        const std::string &sample = samples[best_sample];
+        best_size = std::min(best_size, size - dictionary.size());
+        dictionary.append(sample, best_pos, best_size);
+        for (std::size_t i = best_pos; i + kSequence <= best_pos + best_size; i++) {
+            occurrences[sequence_at(sample.data() + i)].samples = 0;
+        }
+    }
+    return dictionary;
+}
+
+// See Dictionary.h
+DictionaryStorage::DictionaryStorage(std::shared_ptr<Afina::Storage> storage, std::size_t size,
+                                     std::chrono::seconds interval, std::shared_ptr<Logging::Service> logging)
+    : _storage(std::move(storage)), _compression(dynamic_cast<DictionaryCompression *>(_storage.get())),
+      _size(size), _interval(interval), _logging(std::move(logging)), _rotations(0), _stopping(false) {
+    if (_compression == nullptr) {
+        throw std::runtime_error("Storage doesn't support compression dictionary");
+    }
+}
+
+// See Dictionary.h
+DictionaryStorage::~DictionaryStorage() {
+    if (_thread.joinable()) {
+        Stop();
+    }
+}
+
+// See Dictionary.h
+void DictionaryStorage::Start() {
+    if (_logging) {
+        _logger = _logging->select("storage");
+    }
+    _storage->Start();
+
+    std::lock_guard<std::mutex> lk(_mutex);
+    _stopping.store(false);
+    _thread = std::thread(&DictionaryStorage::OnRun, this);
+}
+
+// See Dictionary.h
+void DictionaryStorage::Stop() {
+    if (_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lk(_mutex);
+            _stopping.store(true);
+        }
+        _stopped.notify_all();
+        _thread.join();
+    }
+    _storage->Stop();
+}
+
+// See Dictionary.h
+bool DictionaryStorage::Train() {
+    std::lock_guard<std::mutex> train_lock(_train_mutex);
+    auto start = std::chrono::steady_clock::now();
+
+    // Dictionary is checked on samples it wasn't trained on
+    std::vector<std::string> samples = _compression->SampleValues(kSamples);
+    std::vector<std::string> train, check;
+    for (std::size_t i = 0; i < samples.size(); i++) {
+        (i % 2 == 0 ? train : check).push_back(std::move(samples[i]));
+    }
+    auto dictionary = std::make_shared<const Lz4::Dictionary>(TrainDictionary(train, _size));
+    if (check.empty() || dictionary->Data().empty()) {
+        return false;
+    }
+
+    std::size_t current = compressed_size(check, _dictionary.get());
+    std::size_t trained = compressed_size(check, dictionary.get());
+    if (trained > current * (1 - kMinGain)) {
+        if (_logger) {
+            _logger->debug("Trained dictionary takes {} of {} bytes, current one is kept", trained, current);
+        }
+        return false;
+    }
+
+    _compression->SetDictionary(dictionary);
+    _dictionary = dictionary;
+    _rotations++;
+
+    std::size_t items = 0;
+    for (std::size_t n = 1; n > 0 && !_stopping.load();) {
+        n = _compression->Recompress(kBatch);
+        items += n;
+    }
+    if (_logger) {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        _logger->warn("New dictionary of {} bytes shrinks samples from {} to {} bytes, {} items recompressed in {} ms",
+                      dictionary->Data().size(), current, trained, items, ms.count());
+    }
+    return true;
+}
+
+// See Dictionary.h
+void DictionaryStorage::OnRun() {
+    std::unique_lock<std::mutex> lk(_mutex);
+    while (!_stopped.wait_for(lk, _interval, [this]() { return _stopping.load(); })) {
+        lk.unlock();
+        Train();
+        lk.lock();
+    }
+}
+
+} // namespace Backend
+} // namespace Afina
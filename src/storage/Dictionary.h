@@ -0,0 +1,155 @@
+#ifndef AFINA_STORAGE_DICTIONARY_H
+#define AFINA_STORAGE_DICTIONARY_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <afina/Storage.h>
+
+#include "Lz4.h"
+
+namespace spdlog {
+class logger;
+}
+
+namespace Afina {
+namespace Logging {
+class Service;
+}
+
+namespace Backend {
+
+/**
+ * Build compression dictionary of given size from sample values. Samples are cut into 8 byte
+ * sequences, each sequence is scored by the number of samples it occurs in. Samples are split into
+ * as many ranges as the dictionary has segments, and the segment with the best total score of its
+ * sequences is taken from each range. Sequences taken once score nothing afterwards, so the
+ * dictionary doesn't repeat itself. Sequences found in a single sample are never taken. Could
+ * return less than size bytes, nothing if samples have nothing in common
+ */
+std::string TrainDictionary(const std::vector<std::string> &samples, std::size_t size);
+
+/**
+ * Storage which keeps values compressed with shared dictionary and could change it. Items compressed
+ * with previous dictionary stay readable until they are recompressed. Methods are called by
+ * DictionaryStorage background thread
+ */
+class DictionaryCompression {
+public:
+    virtual ~DictionaryCompression() {}
+
+    // Original values of up to count recently used items large enough to be compressed
+    virtual std::vector<std::string> SampleValues(std::size_t count) = 0;
+
+    // Compress new values with the given dictionary and start recompression of stored ones
+    virtual void SetDictionary(std::shared_ptr<const Lz4::Dictionary> dictionary) = 0;
+
+    // Recompress next items with the current dictionary, returns number of items looked at, 0 at the end
+    virtual std::size_t Recompress(std::size_t count) = 0;
+};
+
+/**
+ * # Storage with trained compression dictionary
+ * Small values barely compress one by one, but values of one schema share most of their bytes.
+ * Background thread samples stored values every interval, trains dictionary on them and compares
+ * compressed size of other samples with the new dictionary and with the current one. Better
+ * dictionary becomes the current one: new values are compressed with it, and stored items are
+ * recompressed by small batches, so clients wait for one batch at most. Old dictionary is dropped
+ * once no item refers to it
+ */
+class DictionaryStorage : public Afina::Storage {
+public:
+    /**
+     * @param storage to be wrapped, must be thread safe and implement DictionaryCompression, throws
+     * std::runtime_error otherwise
+     * @param size of the dictionary
+     * @param interval between trainings
+     * @param logging service to report trainings, could be null
+     */
+    DictionaryStorage(std::shared_ptr<Afina::Storage> storage, std::size_t size,
+                      std::chrono::seconds interval = std::chrono::seconds(60),
+                      std::shared_ptr<Logging::Service> logging = nullptr);
+    ~DictionaryStorage();
+
+    // Starts wrapped storage and background thread
+    void Start() override;
+
+    // Stops background thread and wrapped storage
+    void Stop() override;
+
+    // see SimpleLRU.h
+    bool Put(const std::string &key, const std::string &value) override { return _storage->Put(key, value); }
+
+    // see SimpleLRU.h
+    bool PutIfAbsent(const std::string &key, const std::string &value) override {
+        return _storage->PutIfAbsent(key, value);
+    }
+
+    // see SimpleLRU.h
+    bool Set(const std::string &key, const std::string &value) override { return _storage->Set(key, value); }
+
+    // see SimpleLRU.h
+    bool Delete(const std::string &key) override { return _storage->Delete(key); }
+
+    // see SimpleLRU.h
+    bool Get(const std::string &key, std::string &value) override { return _storage->Get(key, value); }
+
+    // see SimpleLRU.h
+    bool Visit(const Visitor &visitor) override { return _storage->Visit(visitor); }
+
+    // see SimpleLRU.h
+    bool Restore(const std::string &key, const std::string &value) override { return _storage->Restore(key, value); }
+
+    /**
+     * Train dictionary and recompress items with it if it is better than the current one, blocks until
+     * that is done. Returns whether dictionary was changed
+     */
+    bool Train();
+
+    // Number of dictionaries taken so far
+    std::size_t Rotations() const { return _rotations.load(); }
+
+private:
+    // Samples taken for each training, half of them trains dictionary, the other half checks it
+    static constexpr std::size_t kSamples = 2048;
+
+    // Items recompressed under one lock of the storage
+    static constexpr std::size_t kBatch = 256;
+
+    // New dictionary must shrink samples by this share at least
+    static constexpr double kMinGain = 0.05;
+
+    // Background thread: trains dictionary every interval
+    void OnRun();
+
+    std::shared_ptr<Afina::Storage> _storage;
+    DictionaryCompression *_compression;
+    std::size_t _size;
+    std::chrono::seconds _interval;
+    std::shared_ptr<Logging::Service> _logging;
+    std::shared_ptr<spdlog::logger> _logger;
+
+    // Only one training at a time, current dictionary
+    std::mutex _train_mutex;
+    std::shared_ptr<const Lz4::Dictionary> _dictionary;
+    std::atomic<std::size_t> _rotations;
+
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _stopped;
+
+    // Background thread and recompression stop once it is set
+    std::atomic<bool> _stopping;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_DICTIONARY_H
@@ -0,0 +1,160 @@
+#ifndef AFINA_STORAGE_FLAT_COMBINE_LRU_H
+#define AFINA_STORAGE_FLAT_COMBINE_LRU_H
+
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <string>
+
+#include <afina/concurrency/FlatCombine.h>
+
+#include "SimpleLRU.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # SimpleLRU behind flat combiner
+ * Thread safe version of SimpleLRU: each call is published as an operation and executed by the thread
+ * that currently holds combiner lock together with all other pending ones. Every call, Get included,
+ * reorders LRU list, so all of them go through the combiner. Values are compressed before the call is
+ * published and decompressed once it is done, so the combiner doesn't do that for other threads
+ */
+class FlatCombineLRU : public Afina::Storage {
+public:
+    FlatCombineLRU(size_t max_size = 1024, std::shared_ptr<Allocator::Slab> slab = nullptr, size_t max_memory = 0,
+                   size_t compress_threshold = 0)
+        : _lru(max_size, std::move(slab), max_memory, compress_threshold), _combiner([this](Operation *const *batch, std::size_t size) { Execute(batch, size); }) {}
+    ~FlatCombineLRU() {}
+
+    // see SimpleLRU.h
+    bool Put(const std::string &key, const std::string &value) override {
+        SimpleLRU::PackedValue packed;
+        _lru.PackValue(value, packed);
+        return Apply(Operation::kPut, key, &packed, nullptr);
+    }
+
+    // see SimpleLRU.h
+    bool PutIfAbsent(const std::string &key, const std::string &value) override {
+        SimpleLRU::PackedValue packed;
+        _lru.PackValue(value, packed);
+        return Apply(Operation::kPutIfAbsent, key, &packed, nullptr);
+    }
+
+    // see SimpleLRU.h
+    bool Set(const std::string &key, const std::string &value) override {
+        SimpleLRU::PackedValue packed;
+        _lru.PackValue(value, packed);
+        return Apply(Operation::kSet, key, &packed, nullptr);
+    }
+
+    // see SimpleLRU.h
+    bool Delete(const std::string &key) override { return Apply(Operation::kDelete, key, nullptr, nullptr); }
+
+    // see SimpleLRU.h
+    bool Get(const std::string &key, std::string &value) override {
+        SimpleLRU::PackedValue packed;
+        if (!Apply(Operation::kGet, key, &packed, &value)) {
+            return false;
+        }
+        if (packed.compressed) {
+            SimpleLRU::UnpackValue(packed, value);
+        }
+        return true;
+    }
+
+    // see SimpleLRU.h, only copying of each batch goes through the combiner, visitor is called outside
+    bool Visit(const Visitor &visitor) override {
+        return _lru.VisitLocked(
+            [this](const std::function<void()> &f) {
+                Operation op{Operation::kRun, nullptr, nullptr, nullptr, &f, false, nullptr};
+                Run(op);
+            },
+            visitor);
+    }
+
+    // see SimpleLRU.h
+    bool Restore(const std::string &key, const std::string &value) override {
+        SimpleLRU::PackedValue packed;
+        _lru.PackValue(value, packed);
+        return Apply(Operation::kRestore, key, &packed, nullptr);
+    }
+
+    // Combiner statistics, see FlatCombine.h
+    std::size_t Batches() const { return _combiner.Batches(); }
+    std::size_t Combined() const { return _combiner.Combined(); }
+
+private:
+    // Pending call, arguments stay on the caller stack while it waits. Value is packed by the caller,
+    // Get copies compressed value into it. Exception thrown by the call is kept for the caller
+    struct Operation {
+        enum Type { kPut, kPutIfAbsent, kSet, kDelete, kGet, kRun, kRestore };
+
+        Type type;
+        const std::string *key;
+        SimpleLRU::PackedValue *packed;
+        std::string *out;
+        const std::function<void()> *task;
+        bool result;
+        std::exception_ptr error;
+    };
+
+    bool Apply(Operation::Type type, const std::string &key, SimpleLRU::PackedValue *packed, std::string *out) {
+        Operation op{type, &key, packed, out, nullptr, false, nullptr};
+        Run(op);
+        return op.result;
+    }
+
+    // Apply operation through the combiner, rethrow its exception in the calling thread
+    void Run(Operation &op) {
+        _combiner.Apply(op);
+        if (op.error) {
+            std::rethrow_exception(op.error);
+        }
+    }
+
+    // Called by combiner with the lock held, failure of one operation doesn't affect others
+    void Execute(Operation *const *batch, std::size_t size) {
+        for (std::size_t i = 0; i < size; i++) {
+            try {
+                Execute(*batch[i]);
+            } catch (...) {
+                batch[i]->error = std::current_exception();
+            }
+        }
+    }
+
+    void Execute(Operation &op) {
+    switch (op.type) {
+        case Operation::kPut:
+            op.result = _lru.PutPacked(*op.key, *op.packed);
+            break;
+        case Operation::kPutIfAbsent:
+            op.result = _lru.PutIfAbsentPacked(*op.key, *op.packed);
+            break;
+        case Operation::kSet:
+            op.result = _lru.SetPacked(*op.key, *op.packed);
+            break;
+        case Operation::kDelete:
+            op.result = _lru.Delete(*op.key);
+            break;
+        case Operation::kGet:
+            op.result = _lru.GetPacked(*op.key, *op.out, *op.packed);
+            break;
+        case Operation::kRun:
+            (*op.task)();
+            break;
+        case Operation::kRestore:
+            op.result = _lru.RestorePacked(*op.key, *op.packed);
+            break;
+        }
+    }
+
+    SimpleLRU _lru;
+    Concurrency::FlatCombine<Operation> _combiner;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_FLAT_COMBINE_LRU_H
@@ -0,0 +1,39 @@
+#ifndef AFINA_STORAGE_HASH_H
+#define AFINA_STORAGE_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * Hash of the key bytes used by all caches: 64 bit multiplicative hash over 8 byte words, keys are short
+ * so there is no need in wider blocks. SharedLRU keeps lower 32 bits in the segment, so the function is
+ * part of the segment layout
+ */
+inline uint64_t HashKey(const char *data, std::size_t size) {
+    const uint64_t mul = 0x9E3779B97F4A7C15ULL;
+    uint64_t h = size * mul;
+    std::size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ word) * mul;
+        h ^= h >> 29;
+    }
+    if (i < size) {
+        uint64_t word = 0;
+        std::memcpy(&word, data + i, size - i);
+        h = (h ^ word) * mul;
+        h ^= h >> 29;
+    }
+    h ^= h >> 32;
+    return h;
+}
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_HASH_H
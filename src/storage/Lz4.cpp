@@ -0,0 +1,280 @@
+#include "Lz4.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace Afina {
+namespace Backend {
+namespace Lz4 {
+
+namespace {
+
+// Format limits: match is 4 bytes at least, offset fits 16 bits, last 5 bytes are always literals
+// and last match starts 12 bytes before the end at least
+constexpr std::size_t kMinMatch = 4;
+constexpr std::size_t kMaxOffset = 65535;
+constexpr std::size_t kLastLiterals = 5;
+constexpr std::size_t kMatchLimit = 12;
+
+// Hash table is 16KB at most, small inputs use smaller one: it is cleared on every call
+constexpr int kMinHashLog = 8;
+constexpr int kMaxHashLog = 12;
+
+// Dictionary table is larger: it is built once, and more of the dictionary sequences could be found
+constexpr int kMaxDictionaryLog = 16;
+
+// Literals to skip grow after this many misses in a row, incompressible data is passed faster
+constexpr int kSkipTrigger = 6;
+
+uint32_t read32(const char *p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint64_t read64(const char *p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Length of the common prefix of a and b, compared by words, b + length stays below end
+std::size_t common(const char *a, const char *b, const char *end) {
+    const char *start = b;
+    while (b + 8 <= end) {
+        uint64_t diff = read64(a) ^ read64(b);
+        if (diff != 0) {
+            // Words are little endian, first different byte is the lowest one
+            return b - start + (__builtin_ctzll(diff) >> 3);
+        }
+        a += 8;
+        b += 8;
+    }
+    while (b < end && *a == *b) {
+        a++;
+        b++;
+    }
+    return b - start;
+}
+
+uint32_t hash(uint32_t sequence, int log) { return (sequence * 2654435761U) >> (32 - log); }
+
+// Length over 15 continues in bytes of 255 and the remainder
+char *write_length(char *op, std::size_t length) {
+    for (; length >= 255; length -= 255) {
+        *op++ = char(255);
+    }
+    *op++ = char(length);
+    return op;
+}
+
+char *write_sequence(char *op, const char *literals, std::size_t literal_size, std::size_t offset,
+                     std::size_t match_size) {
+    char *token = op++;
+    std::size_t match_code = match_size - kMinMatch;
+    *token = char(((literal_size < 15 ? literal_size : 15) << 4) | (match_code < 15 ? match_code : 15));
+    if (literal_size >= 15) {
+        op = write_length(op, literal_size - 15);
+    }
+    std::memcpy(op, literals, literal_size);
+    op += literal_size;
+
+    *op++ = char(offset & 0xff);
+    *op++ = char(offset >> 8);
+    if (match_code >= 15) {
+        op = write_length(op, match_code - 15);
+    }
+    return op;
+}
+
+char *write_last(char *op, const char *literals, std::size_t literal_size) {
+    *op++ = char((literal_size < 15 ? literal_size : 15) << 4);
+    if (literal_size >= 15) {
+        op = write_length(op, literal_size - 15);
+    }
+    std::memcpy(op, literals, literal_size);
+    return op + literal_size;
+}
+
+// Read length continuation, returns false if block ends in the middle
+bool read_length(const unsigned char *&ip, const unsigned char *end, std::size_t &length) {
+    unsigned char b;
+    do {
+        if (ip == end) {
+            return false;
+        }
+        b = *ip++;
+        length += b;
+    } while (b == 255);
+    return true;
+}
+
+} // namespace
+
+// See Lz4.h
+Dictionary::Dictionary(const std::string &data)
+    : _data(data.size() > kMaxOffset ? data.substr(data.size() - kMaxOffset) : data), _log(kMinHashLog) {
+    while (_log < kMaxDictionaryLog && (std::size_t(1) << _log) < _data.size()) {
+        _log++;
+    }
+    _table.assign(std::size_t(1) << _log, 0);
+    for (std::size_t i = 0; i + kMinMatch <= _data.size(); i++) {
+        _table[hash(read32(_data.data() + i), _log)] = uint32_t(i + 1);
+    }
+}
+
+// See Lz4.h
+std::size_t Bound(std::size_t size) { return size + size / 255 + 16; }
+
+// See Lz4.h
+std::size_t Compress(const char *src, std::size_t size, char *dst, const Dictionary *dictionary) {
+    char *op = dst;
+    std::size_t anchor = 0;
+    if (size >= kMatchLimit + 1) {
+        int log = kMinHashLog;
+        while (log < kMaxHashLog && (std::size_t(1) << log) < size) {
+            log++;
+        }
+        uint32_t table[1 << kMaxHashLog];
+        std::memset(table, 0, sizeof(uint32_t) << log);
+
+        std::size_t limit = size - kMatchLimit;
+        std::size_t match_end = size - kLastLiterals;
+        std::size_t ip = 0;
+        std::size_t misses = 0;
+
+        while (ip < limit) {
+            uint32_t sequence = read32(src + ip);
+            uint32_t h = hash(sequence, log);
+            std::size_t ref = table[h];
+            table[h] = uint32_t(ip);
+            if (ref >= ip || ip - ref > kMaxOffset || read32(src + ref) != sequence) {
+                // Dictionary is searched once the data itself has no match. Its bytes precede the
+                // data, match ends at the end of dictionary at most
+                if (dictionary != nullptr) {
+                    const std::string &words = dictionary->_data;
+                    std::size_t pos = dictionary->_table[hash(sequence, dictionary->_log)];
+                    if (pos != 0 && ip + words.size() - (pos - 1) <= kMaxOffset &&
+                        read32(words.data() + pos - 1) == sequence) {
+                        pos--;
+                        while (ip > anchor && pos > 0 && src[ip - 1] == words[pos - 1]) {
+                            ip--;
+                            pos--;
+                        }
+                        std::size_t end = std::min(match_end, ip + words.size() - pos);
+                        std::size_t match =
+                            kMinMatch + common(words.data() + pos + kMinMatch, src + ip + kMinMatch, src + end);
+                        op = write_sequence(op, src + anchor, ip - anchor, ip + words.size() - pos, match);
+                        ip += match;
+                        anchor = ip;
+                        misses = 0;
+                        continue;
+                    }
+                }
+                ip += 1 + (misses++ >> kSkipTrigger);
+                continue;
+            }
+            misses = 0;
+
+            // Extend match both ways, backwards into literals not yet written
+            while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) {
+                ip--;
+                ref--;
+            }
+            std::size_t match = kMinMatch + common(src + ref + kMinMatch, src + ip + kMinMatch, src + match_end);
+
+            op = write_sequence(op, src + anchor, ip - anchor, ip - ref, match);
+            ip += match;
+            anchor = ip;
+            if (ip < limit) {
+                table[hash(read32(src + ip - 2), log)] = uint32_t(ip - 2);
+            }
+        }
+    }
+    op = write_last(op, src + anchor, size - anchor);
+    return op - dst;
+}
+
+// See Lz4.h
+bool Decompress(const char *src, std::size_t src_size, char *dst, std::size_t size, const Dictionary *dictionary) {
+    const unsigned char *ip = reinterpret_cast<const unsigned char *>(src);
+    const unsigned char *end = ip + src_size;
+    std::size_t op = 0;
+    while (ip < end) {
+        unsigned char token = *ip++;
+        std::size_t literal_size = token >> 4;
+        if (literal_size == 15 && !read_length(ip, end, literal_size)) {
+            return false;
+        }
+        if (literal_size > std::size_t(end - ip) || literal_size > size - op) {
+            return false;
+        }
+
+        // Short literals are copied by fixed 16 bytes while both buffers have room for that, bytes
+        // after the literals are overwritten later
+        if (literal_size <= 16 && end - ip >= 16 && size - op >= 16) {
+            std::memcpy(dst + op, ip, 16);
+        } else {
+            std::memcpy(dst + op, ip, literal_size);
+        }
+        ip += literal_size;
+        op += literal_size;
+
+        // Block ends with literals
+        if (ip == end) {
+            break;
+        }
+
+        if (end - ip < 2) {
+            return false;
+        }
+        std::size_t offset = ip[0] | (std::size_t(ip[1]) << 8);
+        ip += 2;
+        std::size_t match_size = token & 15;
+        if (match_size == 15 && !read_length(ip, end, match_size)) {
+            return false;
+        }
+        match_size += kMinMatch;
+        if (offset == 0 || match_size > size - op) {
+            return false;
+        }
+
+        // Match starts in the dictionary and could go on at the start of the data
+        if (offset > op) {
+            std::size_t back = offset - op;
+            if (dictionary == nullptr || back > dictionary->Data().size()) {
+                return false;
+            }
+            std::size_t from_dictionary = std::min(back, match_size);
+            std::memcpy(dst + op, dictionary->Data().data() + dictionary->Data().size() - back, from_dictionary);
+            for (std::size_t i = 0; i < match_size - from_dictionary; i++) {
+                dst[op + from_dictionary + i] = dst[i];
+            }
+            op += match_size;
+            continue;
+        }
+
+        // Match could overlap bytes it produces, then it repeats them. Word copies are fine once
+        // the word being read is written already, so offset must be 8 bytes at least
+        char *out = dst + op;
+        const char *ref = out - offset;
+        if (offset >= 8 && size - op >= match_size + 8) {
+            for (std::size_t i = 0; i < match_size; i += 8) {
+                std::memcpy(out + i, ref + i, 8);
+            }
+        } else if (offset >= match_size) {
+            std::memcpy(out, ref, match_size);
+        } else {
+            for (std::size_t i = 0; i < match_size; i++) {
+                out[i] = ref[i];
+            }
+        }
+        op += match_size;
+    }
+    return op == size;
+}
+
+} // namespace Lz4
+} // namespace Backend
+} // namespace Afina
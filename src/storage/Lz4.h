@@ -0,0 +1,67 @@
+#ifndef AFINA_STORAGE_LZ4_H
+#define AFINA_STORAGE_LZ4_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Block compression
+ * Compressor writes LZ4 block format: sequences of literals and a match back into the data already
+ * decoded, so any LZ4 block decoder reads its output. Matches are found by a single hash table of
+ * 4 byte sequences without chains, that is the fast level: speed matters more than ratio for items
+ * compressed on every store.
+ *
+ * Block doesn't keep the size of the original data, caller must store it.
+ *
+ * Short data has little to refer back to, dictionary fixes that: it is taken as bytes preceding the
+ * data, so matches reach into it the same way LZ4 dictionary does. Block compressed with dictionary
+ * is decompressed with the same one only
+ */
+namespace Lz4 {
+
+/**
+ * Bytes shared by many blocks and the hash table of their sequences, built once. Immutable, so one
+ * dictionary could be used by any number of threads
+ */
+class Dictionary {
+public:
+    // Matches reach 64KB back at most, older bytes of longer dictionary are dropped
+    explicit Dictionary(const std::string &data);
+
+    const std::string &Data() const { return _data; }
+
+private:
+    friend std::size_t Compress(const char *src, std::size_t size, char *dst, const Dictionary *dictionary);
+
+    std::string _data;
+
+    // Position + 1 of the last sequence with given hash of _log bits, 0 if there is none
+    int _log;
+    std::vector<uint32_t> _table;
+};
+
+// Largest compressed size of the data of given size, incompressible data grows a bit
+std::size_t Bound(std::size_t size);
+
+/**
+ * Compress data into dst of Bound(size) bytes at least, returns compressed size
+ */
+std::size_t Compress(const char *src, std::size_t size, char *dst, const Dictionary *dictionary = nullptr);
+
+/**
+ * Decompress block into dst of exactly size bytes. Returns false if block is damaged or doesn't
+ * decode into size bytes, dst is never written past its end
+ */
+bool Decompress(const char *src, std::size_t src_size, char *dst, std::size_t size,
+                const Dictionary *dictionary = nullptr);
+
+} // namespace Lz4
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_LZ4_H
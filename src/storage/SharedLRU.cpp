@@ -0,0 +1,847 @@
+#include "SharedLRU.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <spdlog/logger.h>
+
+#include <afina/logging/Service.h>
+
+#include "Hash.h"
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+constexpr char kMagic[8] = {'A', 'F', 'I', 'N', 'A', 'S', 'H', 'M'};
+constexpr uint32_t kVersion = 1;
+
+// Segment size is multiple of it, so that the file could be on hugetlbfs
+constexpr std::size_t kSegmentAlign = 2 << 20;
+
+// Item of the largest class takes whole page
+constexpr std::size_t kPageSize = 1 << 20;
+
+constexpr std::size_t kMaxClasses = 64;
+constexpr std::size_t kMinSlot = 64;
+constexpr double kClassFactor = 1.25;
+
+// Segment bytes per hash bucket
+constexpr std::size_t kBytesPerBucket = 256;
+
+// Written stamps grow up from it, stamps of restored items go down
+constexpr uint64_t kStampBase = uint64_t(1) << 62;
+
+constexpr std::size_t align(std::size_t value, std::size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Segment is read by the process started after a crash, stores must not be reordered across state changes
+inline void barrier() { std::atomic_thread_fence(std::memory_order_release); }
+
+std::runtime_error io_error(const std::string &what, const std::string &path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+struct SharedLRU::SizeClass {
+    // Slot bytes including item header
+    uint64_t size;
+
+    // Free slots linked through hnext
+    offset_t free;
+
+    // Most and least recently used items
+    offset_t head;
+    offset_t tail;
+
+    uint64_t items;
+};
+
+struct SharedLRU::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t layout;
+    uint64_t size;
+
+    // Set while segment is being changed
+    uint64_t dirty;
+
+    // Times segment was attached
+    uint64_t epoch;
+
+    // Next stamps of written and restored items
+    uint64_t seq;
+    uint64_t low;
+
+    uint64_t buckets;
+    offset_t buckets_offset;
+    offset_t page_map_offset;
+    offset_t pages_offset;
+    uint64_t page_size;
+    uint64_t pages;
+    uint64_t pages_used;
+
+    uint64_t classes_count;
+    uint64_t items;
+    uint64_t bytes;
+    SizeClass classes[kMaxClasses];
+};
+
+struct SharedLRU::Item {
+    // Next item in bucket chain or in class free list
+    offset_t hnext;
+
+    // Neighbours in class LRU list
+    offset_t prev;
+    offset_t next;
+
+    // Last write or access, the larger the more recent
+    uint64_t stamp;
+
+    uint32_t hash;
+    uint32_t key_size;
+    uint32_t value_size;
+    uint8_t cls;
+    uint8_t used;
+    uint16_t reserved;
+
+    char *Data() { return reinterpret_cast<char *>(this + 1); }
+};
+
+namespace {
+
+// Structure sizes are part of the layout, segment written by a different build isn't trusted
+template <typename Header, typename Item> constexpr uint32_t layout() {
+    return uint32_t((sizeof(Header) << 16) | (sizeof(Item) << 8) | kMaxClasses);
+}
+
+} // namespace
+
+// See SharedLRU.h
+SharedLRU::SharedLRU(const std::string &path, std::size_t size, std::shared_ptr<Logging::Service> logging)
+    : _path(path), _size(align(std::max(size, kSegmentAlign), kSegmentAlign)), _logging(std::move(logging)), _fd(-1),
+      _base(nullptr), _header(nullptr), _state(State::kDetached), _visiting(false) {}
+
+// See SharedLRU.h
+SharedLRU::~SharedLRU() { Stop(); }
+
+// See SharedLRU.h
+void SharedLRU::Start() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (_header != nullptr) {
+        return;
+    }
+    if (_logging) {
+        _logger = _logging->select("storage");
+    }
+
+    // Lock lives as long as the descriptor, so crashed process doesn't keep it
+    int fd = open(_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd == -1) {
+        throw io_error("Failed to open", _path);
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        close(fd);
+        throw std::runtime_error("Shared storage " + _path + " is used by another process");
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw io_error("Failed to stat", _path);
+    }
+    bool resized = std::size_t(st.st_size) != _size;
+    if (resized && ftruncate(fd, _size) != 0) {
+        close(fd);
+        throw io_error("Failed to resize", _path);
+    }
+
+    void *base = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        throw io_error("Failed to map", _path);
+    }
+    _fd = fd;
+    _base = static_cast<char *>(base);
+    _header = reinterpret_cast<Header *>(_base);
+
+    if (resized || !Valid()) {
+        Init();
+        _state = State::kCreated;
+    } else if (_header->dirty != 0) {
+        Repair();
+        _state = State::kRepaired;
+    } else {
+        _state = State::kAttached;
+    }
+    _header->epoch++;
+
+    if (_logger) {
+        switch (_state) {
+        case State::kCreated:
+            _logger->warn("Created shared storage {} of {} bytes", _path, _size);
+            break;
+        case State::kRepaired:
+            _logger->warn("Shared storage {} wasn't detached cleanly, repaired {} items", _path, _header->items);
+            break;
+        default:
+            _logger->warn("Attached shared storage {} epoch {} with {} items", _path, _header->epoch,
+                          _header->items);
+        }
+    }
+}
+
+// See SharedLRU.h
+void SharedLRU::Stop() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (_header == nullptr) {
+        return;
+    }
+
+    EndVisit();
+    _header->dirty = 0;
+    munmap(_base, _size);
+    close(_fd);
+    _fd = -1;
+    _base = nullptr;
+    _header = nullptr;
+    _state = State::kDetached;
+}
+
+// See SharedLRU.h
+bool SharedLRU::Put(const std::string &key, const std::string &value) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (_header == nullptr || key.size() > UINT32_MAX) {
+        return false;
+    }
+
+    uint32_t hash = Hash(key.data(), key.size());
+    Begin();
+    bool result = Store(key.data(), key.size(), hash, value, Find(key.data(), key.size(), hash), false);
+    End();
+    return result;
+}
+
+// See SharedLRU.h
+bool SharedLRU::PutIfAbsent(const std::string &key, const std::string &value) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (_header == nullptr || key.size() > UINT32_MAX) {
+        return false;
+    }
+
+    uint32_t hash = Hash(key.data(), key.size());
+    if (Find(key.data(), key.size(), hash) != nullptr) {
+        return false;
+    }
+    Begin();
+    bool result = Store(key.data(), key.size(), hash, value, nullptr, false);
+    End();
+    return result;
+}
+
+// See SharedLRU.h
+bool SharedLRU::Set(const std::string &key, const std::string &value) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (_header == nullptr || key.size() > UINT32_MAX) {
+        return false;
+    }
+
+    uint32_t hash = Hash(key.data(), key.size());
+    Item *old = Find(key.data(), key.size(), hash);
+    if (old == nullptr) {
+        return false;
+    }
+    Begin();
+    bool result = Store(key.data(), key.size(), hash, value, old, false);
+    End();
+    return result;
+}
+
+// See SharedLRU.h
+bool SharedLRU::Delete(const std::string &key) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (_header == nullptr || key.size() > UINT32_MAX) {
+        return false;
+    }
+
+    Item *item = Find(key.data(), key.size(), Hash(key.data(), key.size()));
+    if (item == nullptr) {
+        return false;
+    }
+    Begin();
+    Remove(item);
+    End();
+    return true;
+}
+
+// See SharedLRU.h
+bool SharedLRU::Get(const std::string &key, std::string &value) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (_header == nullptr || key.size() > UINT32_MAX) {
+        return false;
+    }
+
+    Item *item = Find(key.data(), key.size(), Hash(key.data(), key.size()));
+    if (item == nullptr) {
+        return false;
+    }
+    value.assign(item->Data() + item->key_size, item->value_size);
+
+    // Item moves to the head ahead of the walk, so it is copied now
+    CopyUnvisited(item);
+    Begin();
+    Unlink(item);
+    item->stamp = _header->seq++;
+    LinkHead(item);
+    End();
+    return true;
+}
+
+// See SharedLRU.h
+bool SharedLRU::Visit(const Visitor &visitor) {
+    std::lock_guard<std::mutex> visit_lock(_visit_mutex);
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        if (_header == nullptr) {
+            return false;
+        }
+        _visit_cursors.assign(_header->classes_count, 0);
+        for (std::size_t i = 0; i < _header->classes_count; i++) {
+            _visit_cursors[i] = _header->classes[i].head;
+        }
+        _visiting = true;
+    }
+
+    // Lock is held while batch is copied, visitor is called without it
+    std::string batch;
+    for (bool more = true; more;) {
+        batch.clear();
+        {
+            std::lock_guard<std::mutex> lk(_mutex);
+            if (!_visiting) {
+                return false;
+            }
+            more = NextVisitBatch(batch);
+        }
+        try {
+            for (std::size_t offset = 0; offset < batch.size();) {
+                std::size_t key_size, value_size;
+                std::memcpy(&key_size, batch.data() + offset, sizeof(key_size));
+                std::memcpy(&value_size, batch.data() + offset + sizeof(key_size), sizeof(value_size));
+                const char *key = batch.data() + offset + sizeof(key_size) + sizeof(value_size);
+                visitor(key, key_size, key + key_size, value_size);
+                offset += sizeof(key_size) + sizeof(value_size) + key_size + value_size;
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lk(_mutex);
+            EndVisit();
+            throw;
+        }
+    }
+    return true;
+}
+
+// See SharedLRU.h
+bool SharedLRU::NextVisitBatch(std::string &batch) {
+    batch.append(_visit_pending);
+    _visit_pending.clear();
+
+    // Each class list is ordered by stamps, so heads of the rest of the lists are merged
+    auto older = [this](std::size_t a, std::size_t b) {
+        return ItemAt(_visit_cursors[a])->stamp < ItemAt(_visit_cursors[b])->stamp;
+    };
+    std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(older)> heads(older);
+    for (std::size_t i = 0; i < _visit_cursors.size(); i++) {
+        if (_visit_cursors[i] != 0) {
+            heads.push(i);
+        }
+    }
+
+    while (!heads.empty() && batch.size() < kVisitBatch) {
+        std::size_t cls = heads.top();
+        heads.pop();
+        Item *item = ItemAt(_visit_cursors[cls]);
+        _visit_cursors[cls] = item->next;
+        CopyItem(batch, item);
+        if (item->next != 0) {
+            heads.push(cls);
+        }
+    }
+    if (!heads.empty()) {
+        return true;
+    }
+    EndVisit();
+    return false;
+}
+
+// See SharedLRU.h
+void SharedLRU::EndVisit() {
+    _visiting = false;
+    std::vector<offset_t>().swap(_visit_cursors);
+    std::string().swap(_visit_pending);
+}
+
+// See SharedLRU.h
+void SharedLRU::CopyItem(std::string &batch, Item *item) {
+    std::size_t key_size = item->key_size, value_size = item->value_size;
+    batch.append(reinterpret_cast<const char *>(&key_size), sizeof(key_size));
+    batch.append(reinterpret_cast<const char *>(&value_size), sizeof(value_size));
+    batch.append(item->Data(), key_size + value_size);
+}
+
+// See SharedLRU.h
+void SharedLRU::CopyUnvisited(Item *item) {
+    // Lists are ordered by stamps, items from the cursor to the tail aren't visited yet
+    offset_t cursor = _visiting ? _visit_cursors[item->cls] : 0;
+    if (cursor != 0 && item->stamp <= ItemAt(cursor)->stamp) {
+        CopyItem(_visit_pending, item);
+    }
+}
+
+// See SharedLRU.h
+bool SharedLRU::Restore(const std::string &key, const std::string &value) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (_header == nullptr || key.size() > UINT32_MAX) {
+        return false;
+    }
+
+    uint32_t hash = Hash(key.data(), key.size());
+    if (Find(key.data(), key.size(), hash) != nullptr) {
+        return false;
+    }
+    Begin();
+    bool result = Store(key.data(), key.size(), hash, value, nullptr, true);
+    End();
+    return result;
+}
+
+// See SharedLRU.h
+std::size_t SharedLRU::Items() const {
+    std::lock_guard<std::mutex> lk(_mutex);
+    return _header == nullptr ? 0 : _header->items;
+}
+
+// See SharedLRU.h
+uint64_t SharedLRU::Epoch() const {
+    std::lock_guard<std::mutex> lk(_mutex);
+    return _header == nullptr ? 0 : _header->epoch;
+}
+
+// See SharedLRU.h
+std::size_t SharedLRU::MaxItem() const { return kPageSize - sizeof(Item); }
+
+// See SharedLRU.h
+SharedLRU::Item *SharedLRU::ItemAt(offset_t offset) const {
+    return offset == 0 ? nullptr : reinterpret_cast<Item *>(_base + offset);
+}
+
+// See SharedLRU.h
+SharedLRU::offset_t SharedLRU::OffsetOf(const Item *item) const {
+    return item == nullptr ? 0 : reinterpret_cast<const char *>(item) - _base;
+}
+
+// See SharedLRU.h
+SharedLRU::offset_t *SharedLRU::Bucket(uint32_t hash) const {
+    return reinterpret_cast<offset_t *>(_base + _header->buckets_offset) + (hash & (_header->buckets - 1));
+}
+
+// See SharedLRU.h
+uint32_t SharedLRU::Hash(const char *data, std::size_t size) {
+    // Stored hashes are part of the segment layout, see Hash.h
+    return uint32_t(HashKey(data, size));
+}
+
+// See SharedLRU.h
+SharedLRU::Item *SharedLRU::Find(const char *key, std::size_t key_size, uint32_t hash) const {
+    for (Item *item = ItemAt(*Bucket(hash)); item != nullptr; item = ItemAt(item->hnext)) {
+        if (item->hash == hash && item->key_size == key_size && std::memcmp(item->Data(), key, key_size) == 0) {
+            return item;
+        }
+    }
+    return nullptr;
+}
+
+// See SharedLRU.h
+int SharedLRU::ClassOf(std::size_t data_size) const {
+    std::size_t size = sizeof(Item) + data_size;
+    for (std::size_t i = 0; i < _header->classes_count; i++) {
+        if (_header->classes[i].size >= size) {
+            return int(i);
+        }
+    }
+    return -1;
+}
+
+// See SharedLRU.h
+SharedLRU::Item *SharedLRU::Allocate(int cls, bool evict, const Item *keep) {
+    SizeClass &sc = _header->classes[cls];
+    if (sc.free == 0 && _header->pages_used < _header->pages) {
+        // Slots are marked free before the page is counted as used, repair never sees garbage
+        CarvePage(_header->pages_used, cls);
+        barrier();
+        _header->pages_used++;
+    }
+
+    if (sc.free == 0 && evict) {
+        Item *victim = ItemAt(sc.tail);
+        if (victim != nullptr && victim == keep) {
+            victim = ItemAt(victim->prev);
+        }
+
+        // Least recently used item of another class is older, its page moves here as a whole
+        int from = -1;
+        for (std::size_t i = 0; i < _header->classes_count; i++) {
+            Item *tail = ItemAt(_header->classes[i].tail);
+            if (int(i) != cls && tail != nullptr && (victim == nullptr || tail->stamp < victim->stamp) &&
+                (from < 0 || tail->stamp < ItemAt(_header->classes[from].tail)->stamp)) {
+                from = int(i);
+            }
+        }
+        if ((from < 0 || !MovePage(from, cls, keep)) && victim != nullptr) {
+            Remove(victim);
+        }
+    }
+
+    Item *item = ItemAt(sc.free);
+    if (item != nullptr) {
+        sc.free = item->hnext;
+    }
+    return item;
+}
+
+// See SharedLRU.h
+void SharedLRU::CarvePage(std::size_t page, int cls) {
+    SizeClass &sc = _header->classes[cls];
+    char *start = _base + _header->pages_offset + page * _header->page_size;
+    for (std::size_t slot = _header->page_size / sc.size; slot-- > 0;) {
+        Item *item = reinterpret_cast<Item *>(start + slot * sc.size);
+        item->used = 0;
+        item->cls = uint8_t(cls);
+        item->hnext = sc.free;
+        sc.free = OffsetOf(item);
+    }
+    barrier();
+    reinterpret_cast<uint8_t *>(_base + _header->page_map_offset)[page] = uint8_t(cls);
+}
+
+// See SharedLRU.h
+bool SharedLRU::MovePage(int from, int to, const Item *keep) {
+    SizeClass &sc = _header->classes[from];
+    std::size_t page = (sc.tail - _header->pages_offset) / _header->page_size;
+    offset_t start = _header->pages_offset + page * _header->page_size;
+    offset_t end = start + _header->page_size;
+    if (keep != nullptr && OffsetOf(keep) >= start && OffsetOf(keep) < end) {
+        return false;
+    }
+
+    // Items are freed first, then their slots leave the free list, repair of a page with no used
+    // slots is safe whatever class it is assigned to
+    for (offset_t offset = start; offset + sc.size <= end; offset += sc.size) {
+        Item *item = ItemAt(offset);
+        if (item->used != 0) {
+            Remove(item);
+        }
+    }
+    for (offset_t *link = &sc.free; *link != 0;) {
+        if (*link >= start && *link < end) {
+            *link = ItemAt(*link)->hnext;
+        } else {
+            link = &ItemAt(*link)->hnext;
+        }
+    }
+    CarvePage(page, to);
+    return true;
+}
+
+// See SharedLRU.h
+bool SharedLRU::Store(const char *key, std::size_t key_size, uint32_t hash, const std::string &value, Item *old,
+                      bool tail) {
+    int cls = ClassOf(key_size + value.size());
+    if (cls < 0) {
+        return false;
+    }
+    if (old != nullptr) {
+        CopyUnvisited(old);
+    }
+
+    // Old item is the only one to evict: it goes first, the key is lost if we crash right now
+    Item *item = Allocate(cls, !tail, old);
+    if (item == nullptr && old != nullptr && old->cls == cls && !tail) {
+        Remove(old);
+        old = nullptr;
+        item = Allocate(cls, true, nullptr);
+    }
+    if (item == nullptr) {
+        return false;
+    }
+
+    item->hnext = 0;
+    item->prev = 0;
+    item->next = 0;
+    item->stamp = tail ? _header->low-- : _header->seq++;
+    item->hash = hash;
+    item->key_size = uint32_t(key_size);
+    item->value_size = uint32_t(value.size());
+    item->cls = uint8_t(cls);
+    std::memcpy(item->Data(), key, key_size);
+    std::memcpy(item->Data() + key_size, value.data(), value.size());
+
+    // Both copies could be used for a moment, repair keeps the one with larger stamp
+    barrier();
+    item->used = 1;
+    barrier();
+    if (old != nullptr) {
+        Remove(old);
+    }
+
+    HashInsert(item);
+    if (tail) {
+        LinkTail(item);
+    } else {
+        LinkHead(item);
+    }
+    _header->classes[cls].items++;
+    _header->items++;
+    _header->bytes += key_size + value.size();
+    return true;
+}
+
+// See SharedLRU.h
+void SharedLRU::Remove(Item *item) {
+    item->used = 0;
+    barrier();
+
+    HashRemove(item);
+    Unlink(item);
+    SizeClass &sc = _header->classes[item->cls];
+    sc.items--;
+    _header->items--;
+    _header->bytes -= item->key_size + item->value_size;
+    item->hnext = sc.free;
+    sc.free = OffsetOf(item);
+}
+
+// See SharedLRU.h
+void SharedLRU::LinkHead(Item *item) {
+    SizeClass &sc = _header->classes[item->cls];
+    offset_t offset = OffsetOf(item);
+    item->prev = 0;
+    item->next = sc.head;
+    if (sc.head != 0) {
+        ItemAt(sc.head)->prev = offset;
+    } else {
+        sc.tail = offset;
+    }
+    sc.head = offset;
+}
+
+// See SharedLRU.h
+void SharedLRU::LinkTail(Item *item) {
+    SizeClass &sc = _header->classes[item->cls];
+    offset_t offset = OffsetOf(item);
+    item->next = 0;
+    item->prev = sc.tail;
+    if (sc.tail != 0) {
+        ItemAt(sc.tail)->next = offset;
+    } else {
+        sc.head = offset;
+    }
+    sc.tail = offset;
+}
+
+// See SharedLRU.h
+void SharedLRU::Unlink(Item *item) {
+    SizeClass &sc = _header->classes[item->cls];
+    if (_visiting && _visit_cursors[item->cls] == OffsetOf(item)) {
+        _visit_cursors[item->cls] = item->next;
+    }
+    if (item->prev != 0) {
+        ItemAt(item->prev)->next = item->next;
+    } else {
+        sc.head = item->next;
+    }
+    if (item->next != 0) {
+        ItemAt(item->next)->prev = item->prev;
+    } else {
+        sc.tail = item->prev;
+    }
+    item->prev = 0;
+    item->next = 0;
+}
+
+// See SharedLRU.h
+void SharedLRU::HashInsert(Item *item) {
+    offset_t *bucket = Bucket(item->hash);
+    item->hnext = *bucket;
+    *bucket = OffsetOf(item);
+}
+
+// See SharedLRU.h
+void SharedLRU::HashRemove(Item *item) {
+    offset_t offset = OffsetOf(item);
+    for (offset_t *link = Bucket(item->hash); *link != 0; link = &ItemAt(*link)->hnext) {
+        if (*link == offset) {
+            *link = item->hnext;
+            break;
+        }
+    }
+    item->hnext = 0;
+}
+
+// See SharedLRU.h
+void SharedLRU::Plan(Header &header, std::size_t size) {
+    header.size = size;
+    header.page_size = kPageSize;
+
+    std::size_t buckets = 1024;
+    while (buckets * 2 * kBytesPerBucket <= size) {
+        buckets *= 2;
+    }
+    header.buckets = buckets;
+    header.buckets_offset = align(sizeof(Header), 4096);
+    header.page_map_offset = header.buckets_offset + buckets * sizeof(offset_t);
+
+    // Page map takes a byte per page, counted as if the whole segment was pages
+    std::size_t max_pages = size / kPageSize;
+    header.pages_offset = align(header.page_map_offset + max_pages, 4096);
+    header.pages = header.pages_offset < size ? (size - header.pages_offset) / kPageSize : 0;
+
+    std::size_t count = 0;
+    for (double slot = kMinSlot; count < kMaxClasses; slot *= kClassFactor) {
+        std::size_t aligned = align(std::size_t(slot), 8);
+        if (count > 0 && aligned <= header.classes[count - 1].size) {
+            continue;
+        }
+        if (aligned >= kPageSize || count + 1 == kMaxClasses) {
+            header.classes[count++].size = kPageSize;
+            break;
+        }
+        header.classes[count++].size = aligned;
+    }
+    header.classes_count = count;
+}
+
+// See SharedLRU.h
+bool SharedLRU::Valid() const {
+    Header expected;
+    std::memset(&expected, 0, sizeof(expected));
+    Plan(expected, _size);
+
+    const Header &h = *_header;
+    if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0 || h.version != kVersion || h.layout != layout<Header, Item>() ||
+        h.size != expected.size || h.page_size != expected.page_size || h.buckets != expected.buckets ||
+        h.buckets_offset != expected.buckets_offset || h.page_map_offset != expected.page_map_offset ||
+        h.pages_offset != expected.pages_offset || h.pages != expected.pages || h.pages_used > h.pages ||
+        h.classes_count != expected.classes_count) {
+        return false;
+    }
+    for (std::size_t i = 0; i < h.classes_count; i++) {
+        if (h.classes[i].size != expected.classes[i].size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// See SharedLRU.h
+void SharedLRU::Init() {
+    // Magic goes last, segment is invalid until everything else is written
+    std::memset(_base, 0, sizeof(Header));
+    Plan(*_header, _size);
+    std::memset(_base + _header->buckets_offset, 0, _header->pages_offset - _header->buckets_offset);
+    _header->version = kVersion;
+    _header->layout = layout<Header, Item>();
+    _header->seq = kStampBase;
+    _header->low = kStampBase - 1;
+    barrier();
+    std::memcpy(_header->magic, kMagic, sizeof(kMagic));
+}
+
+// See SharedLRU.h
+void SharedLRU::Repair() {
+    _header->items = 0;
+    _header->bytes = 0;
+    for (std::size_t i = 0; i < _header->classes_count; i++) {
+        SizeClass &sc = _header->classes[i];
+        sc.free = sc.head = sc.tail = 0;
+        sc.items = 0;
+    }
+    std::memset(_base + _header->buckets_offset, 0, _header->buckets * sizeof(offset_t));
+
+    // Every slot of used pages is either a complete item or free
+    std::vector<std::pair<uint64_t, offset_t>> used;
+    const uint8_t *page_map = reinterpret_cast<const uint8_t *>(_base + _header->page_map_offset);
+    for (std::size_t page = 0; page < _header->pages_used; page++) {
+        std::size_t cls = page_map[page];
+        if (cls >= _header->classes_count) {
+            continue;
+        }
+
+        SizeClass &sc = _header->classes[cls];
+        char *start = _base + _header->pages_offset + page * _header->page_size;
+        for (std::size_t slot = _header->page_size / sc.size; slot-- > 0;) {
+            Item *item = reinterpret_cast<Item *>(start + slot * sc.size);
+            if (item->used != 0 && item->cls == cls &&
+                sizeof(Item) + std::size_t(item->key_size) + item->value_size <= sc.size &&
+                item->hash == Hash(item->Data(), item->key_size)) {
+                used.emplace_back(item->stamp, OffsetOf(item));
+                _header->seq = std::max(_header->seq, item->stamp + 1);
+                continue;
+            }
+            item->used = 0;
+            item->cls = uint8_t(cls);
+            item->hnext = sc.free;
+            sc.free = OffsetOf(item);
+        }
+    }
+
+    // Oldest go first, so lists end up in stamp order and newer copy of a key replaces older one
+    std::sort(used.begin(), used.end());
+    for (auto &entry : used) {
+        Item *item = ItemAt(entry.second);
+        _header->low = std::min(_header->low, item->stamp - 1);
+
+        Item *old = Find(item->Data(), item->key_size, item->hash);
+        if (old != nullptr) {
+            Remove(old);
+        }
+        HashInsert(item);
+        LinkHead(item);
+        _header->classes[item->cls].items++;
+        _header->items++;
+        _header->bytes += item->key_size + item->value_size;
+    }
+
+    barrier();
+    _header->dirty = 0;
+}
+
+// See SharedLRU.h
+void SharedLRU::Begin() {
+    _header->dirty = 1;
+    barrier();
+}
+
+// See SharedLRU.h
+void SharedLRU::End() {
+    barrier();
+    _header->dirty = 0;
+}
+
+} // namespace Backend
+} // namespace Afina
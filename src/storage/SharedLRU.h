@@ -0,0 +1,203 @@
+#ifndef AFINA_STORAGE_SHARED_LRU_H
+#define AFINA_STORAGE_SHARED_LRU_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <afina/Storage.h>
+
+namespace spdlog {
+class logger;
+}
+
+namespace Afina {
+namespace Logging {
+class Service;
+}
+
+namespace Backend {
+
+/**
+ * # LRU in a shared memory segment
+ * Whole cache: header, hash index and items, lives in a file mapped shared, e.g. in /dev/shm or on
+ * hugetlbfs. Links are offsets from the segment start, so nothing depends on the address it is mapped
+ * at, and the process restarted after a crash attaches to the same segment and keeps serving the items
+ * that were there.
+ *
+ * Segment is cut into pages, each page serves items of one size class, classes grow geometrically like
+ * in the slab allocator. Every class has its own free list and LRU list, a new item takes a free slot
+ * of its class or a fresh page. Once all pages are taken, least recently used item of the same class is
+ * evicted, unless the least recently used item of another class is older: then its page is emptied and
+ * moves to the class that needs it, so pages follow the mix of value sizes.
+ *
+ * Crash consistency: header is marked dirty while a change is in progress. New value is written to a
+ * fresh slot and marked used only once complete, freed slot is marked unused before it is unlinked.
+ * Each item carries a stamp of its last write or access. Segment found dirty on attach is repaired:
+ * index and lists are rebuilt from used slots, of two copies of a key the one with the newer stamp
+ * wins, LRU order is restored by stamps. Segment with a different layout or version is reinitialized.
+ *
+ * Segment is attached by Start and detached by Stop, before Start all calls fail. File is locked, so
+ * only one process uses it at a time. Methods are thread safe
+ */
+class SharedLRU : public Afina::Storage {
+public:
+    // What Start found in the segment
+    enum class State { kDetached, kCreated, kAttached, kRepaired };
+
+    /**
+     * @param path of the segment file
+     * @param size of the segment, rounded up to 2MB so that file could be on hugetlbfs
+     * @param logging service to report attach, could be null
+     */
+    SharedLRU(const std::string &path, std::size_t size, std::shared_ptr<Logging::Service> logging = nullptr);
+    ~SharedLRU();
+
+    // Map and validate segment, throws std::runtime_error on failure
+    void Start() override;
+
+    // Mark segment clean and unmap it
+    void Stop() override;
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override;
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) override;
+
+    /**
+     * Implements Afina::Storage interface, per class lists are merged by access stamps. Items are copied
+     * in batches under the lock, visitor is called without it. Items moved to the head ahead of the walk
+     * get into the next batch with the value they had before, items added during the walk are not visited
+     */
+    bool Visit(const Visitor &visitor) override;
+
+    // Implements Afina::Storage interface
+    bool Restore(const std::string &key, const std::string &value) override;
+
+    State GetState() const { return _state; }
+
+    // Number of items, times segment was attached
+    std::size_t Items() const;
+    uint64_t Epoch() const;
+
+    // Largest key and value bytes item could have
+    std::size_t MaxItem() const;
+
+private:
+    SharedLRU(const SharedLRU &) = delete;
+    SharedLRU &operator=(const SharedLRU &) = delete;
+
+    struct Header;
+    struct SizeClass;
+    struct Item;
+
+    // Offset based link, 0 is null
+    using offset_t = uint64_t;
+
+    Item *ItemAt(offset_t offset) const;
+    offset_t OffsetOf(const Item *item) const;
+    offset_t *Bucket(uint32_t hash) const;
+
+    static uint32_t Hash(const char *data, std::size_t size);
+
+    Item *Find(const char *key, std::size_t key_size, uint32_t hash) const;
+
+    // Class of item with given key and value bytes, -1 if it is too big
+    int ClassOf(std::size_t data_size) const;
+
+    /**
+     * Take slot of the class: free one, from a new page or, if evict is set, evicting least recently
+     * used item of the class but never the keep one. Returns nullptr on failure
+     */
+    Item *Allocate(int cls, bool evict, const Item *keep);
+
+    // Put all slots of the page to the class free list and mark the page as the class one
+    void CarvePage(std::size_t page, int cls);
+
+    /**
+     * Evict all items of the page holding least recently used item of the from class and give the page
+     * to the other class. Returns false if the keep item is there
+     */
+    bool MovePage(int from, int to, const Item *keep);
+
+    /**
+     * Write new item with given bytes and link it: replaces the old one if given, goes to the list
+     * head or to the tail. Returns false if there is no slot
+     */
+    bool Store(const char *key, std::size_t key_size, uint32_t hash, const std::string &value, Item *old,
+               bool tail);
+
+    // Unlink item and free its slot
+    void Remove(Item *item);
+
+    void LinkHead(Item *item);
+    void LinkTail(Item *item);
+    void Unlink(Item *item);
+    void HashInsert(Item *item);
+    void HashRemove(Item *item);
+
+    // Append records of the next items of the walk to the batch, returns false once the walk is over
+    bool NextVisitBatch(std::string &batch);
+    void EndVisit();
+
+    // Append record of the item: key size, value size, key and value bytes
+    static void CopyItem(std::string &batch, Item *item);
+
+    // Item is about to move ahead of the walk or to be replaced, copy it if it isn't visited yet
+    void CopyUnvisited(Item *item);
+
+    // Geometry of the segment of given size: header, index, page map and pages
+    static void Plan(Header &header, std::size_t size);
+
+    // Build fresh segment or fix damaged one
+    void Init();
+    void Repair();
+
+    // Whether mapped segment has the layout this build expects
+    bool Valid() const;
+
+    // Dirty marks around changes, see class description
+    void Begin();
+    void End();
+
+    std::string _path;
+    std::size_t _size;
+    std::shared_ptr<Logging::Service> _logging;
+    std::shared_ptr<spdlog::logger> _logger;
+
+    int _fd;
+    char *_base;
+    Header *_header;
+    State _state;
+
+    mutable std::mutex _mutex;
+
+    // Bytes of items copied under the lock at once by Visit
+    static constexpr std::size_t kVisitBatch = 64 << 10;
+
+    // Walk in batches: next item to copy of each class and items copied ahead of the walk, see Visit
+    bool _visiting;
+    std::vector<offset_t> _visit_cursors;
+    std::string _visit_pending;
+
+    // Only one walk at a time
+    std::mutex _visit_mutex;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_SHARED_LRU_H
@@ -1,132 +1,769 @@
 #include "SimpleLRU.h"
 
+#include <algorithm>
+#include <functional>
+#include <new>
+#include <stdexcept>
+
+#include <afina/allocator/Error.h>
+
+#include "Hash.h"
+#include "Lz4.h"
+
 namespace Afina {
 namespace Backend {
 
+// See SimpleLRU.h
+SimpleLRU::~SimpleLRU() {
+    // Items and index nodes are all in the arena which goes away with the slab
+    if (_slab && _slab.use_count() == 1) {
+        return;
+    }
+
+    _lru_index.~lru_index();
+    while (_lru_head != nullptr) {
+        lru_node *next = _lru_head->next;
+        FreeElem(_lru_head);
+        _lru_head = next;
+    }
+    _lru_tail = nullptr;
+}
+
 // See MapBasedGlobalLockImpl.h
-bool SimpleLRU::Put(const std::string &key, const std::string &value) { 
-    size_t elem_size = key.size() + value.size();
-    if (elem_size > _max_size)
+bool SimpleLRU::Put(const std::string &key, const std::string &value) {
+    return PutWith(key, [this, &value]() { return Pack(value); });
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::PutPacked(const std::string &key, const PackedValue &value) {
+    return PutWith(key, [this, &value]() { return Unwrap(value); });
+}
+
+// See SimpleLRU.h
+template <typename Packer> bool SimpleLRU::PutWith(const std::string &key, Packer pack) {
+    lru_value stored = pack();
+    size_t elem_size = key.size() + stored.size;
+    if (key.size() > UINT32_MAX || OverLimit(elem_size, ItemFootprint(elem_size)))
         return false;
-    
-    auto elem = _lru_index.find(std::reference_wrapper<const std::string>(key));
+
+    lru_key index_key = MakeKey(key.data(), key.size());
+    auto elem = _lru_index.find(index_key);
     if (elem == _lru_index.end())
-        return PutIfAbsentElem(key, value);
+        return PutIfAbsentElem(index_key, stored);
     else
-        return SetElem(key, value, &(elem->second.get()));
+        return SetElem(elem, stored);
 }
 
 // See MapBasedGlobalLockImpl.h
-bool SimpleLRU::PutIfAbsent(const std::string &key, const std::string &value) { 
-    size_t elem_size = key.size() + value.size();
-    if (elem_size > _max_size)
+bool SimpleLRU::PutIfAbsent(const std::string &key, const std::string &value) {
+    return PutIfAbsentWith(key, [this, &value]() { return Pack(value); });
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::PutIfAbsentPacked(const std::string &key, const PackedValue &value) {
+    return PutIfAbsentWith(key, [this, &value]() { return Unwrap(value); });
+}
+
+// See SimpleLRU.h
+template <typename Packer> bool SimpleLRU::PutIfAbsentWith(const std::string &key, Packer pack) {
+    if (key.size() > UINT32_MAX)
         return false;
 
-    auto elem = _lru_index.find(std::reference_wrapper<const std::string>(key));
+    lru_key index_key = MakeKey(key.data(), key.size());
+    auto elem = _lru_index.find(index_key);
     if (elem != _lru_index.end())
         return false;
-    return PutIfAbsentElem(key, value);
+
+    // Value is compressed only once it is going to be stored
+    lru_value stored = pack();
+    size_t elem_size = key.size() + stored.size;
+    if (OverLimit(elem_size, ItemFootprint(elem_size)))
+        return false;
+    return PutIfAbsentElem(index_key, stored);
 }
 
 // See MapBasedGlobalLockImpl.h
-bool SimpleLRU::Set(const std::string &key, const std::string &value) { 
-    size_t elem_size = key.size() + value.size();
-    if (elem_size > _max_size)
+bool SimpleLRU::Set(const std::string &key, const std::string &value) {
+    return SetWith(key, [this, &value]() { return Pack(value); });
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::SetPacked(const std::string &key, const PackedValue &value) {
+    return SetWith(key, [this, &value]() { return Unwrap(value); });
+}
+
+// See SimpleLRU.h
+template <typename Packer> bool SimpleLRU::SetWith(const std::string &key, Packer pack) {
+    if (key.size() > UINT32_MAX)
         return false;
 
-    auto elem = _lru_index.find(std::reference_wrapper<const std::string>(key));
+    auto elem = _lru_index.find(MakeKey(key.data(), key.size()));
     if (elem == _lru_index.end())
         return false;
-    return SetElem(key, value, &(elem->second.get()));
+
+    lru_value stored = pack();
+    size_t elem_size = key.size() + stored.size;
+    if (OverLimit(elem_size, ItemFootprint(elem_size)))
+        return false;
+    return SetElem(elem, stored);
 }
 
 // See MapBasedGlobalLockImpl.h
-bool SimpleLRU::Delete(const std::string &key) { 
-    auto elem = _lru_index.find(std::reference_wrapper<const std::string>(key));
+bool SimpleLRU::Delete(const std::string &key) {
+    if (key.size() > UINT32_MAX)
+        return false;
+
+    auto elem = _lru_index.find(MakeKey(key.data(), key.size()));
     if (elem == _lru_index.end())
         return false;
-    return DeleteElem(&(elem->second.get()));
+    return DeleteElem(elem->second);
 }
 
-bool SimpleLRU::PutIfAbsentElem(const std::string &key, const std::string &value) { 
-    size_t elem_size = key.size() + value.size();
-    while (_cur_size + elem_size > _max_size)
-        this->DeleteElem(_lru_tail);
-    lru_node* cur = new lru_node({key, value, nullptr, nullptr}); 
-    lru_node* old = nullptr;
-    if (_cur_size  == 0){
-        _lru_head.reset(cur);
-        _lru_tail = cur;
+// See MapBasedGlobalLockImpl.h
+bool SimpleLRU::Visit(const Visitor &visitor) {
+    for (lru_node *cur = _lru_head; cur != nullptr; cur = cur->next)
+        VisitElem(visitor, cur);
+    return true;
+}
+
+// See MapBasedGlobalLockImpl.h
+bool SimpleLRU::Restore(const std::string &key, const std::string &value) {
+    return RestoreWith(key, [this, &value]() { return Pack(value); });
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::RestorePacked(const std::string &key, const PackedValue &value) {
+    return RestoreWith(key, [this, &value]() { return Unwrap(value); });
+}
+
+// See SimpleLRU.h
+template <typename Packer> bool SimpleLRU::RestoreWith(const std::string &key, Packer pack) {
+    lru_value stored = pack();
+    size_t elem_size = key.size() + stored.size;
+    size_t elem_memory = ItemFootprint(elem_size);
+    if (key.size() > UINT32_MAX || OverLimit(_cur_size + elem_size, _cur_memory + elem_memory))
+        return false;
+
+    lru_key index_key = MakeKey(key.data(), key.size());
+    if (_lru_index.find(index_key) != _lru_index.end())
+        return false;
+
+    // Current tail is kept, so allocation doesn't evict anything
+    lru_node *cur = AllocateElem(elem_size, _lru_tail);
+    if (cur == nullptr)
+        return false;
+    cur->key_hash = index_key.hash;
+    cur->key_size = index_key.size;
+    std::memcpy(const_cast<char *>(cur->key()), key.data(), key.size());
+    StoreValue(cur, stored);
+
+    // Item in the tail isn't evicted for index node, see IndexElem
+    LinkTail(cur);
+    if (!IndexElem(cur, _lru_index.end())) {
+        Unlink(cur);
+        FreeElem(cur);
+        return false;
     }
-    else {
-        old = _lru_head.release();
-        _lru_head.reset(cur);
-        old->prev = cur;
-        cur->next.reset(old);
+    _cur_size += elem_size;
+    _cur_memory += ItemFootprint(cur->capacity);
+    return true;
+}
+
+bool SimpleLRU::PutIfAbsentElem(const lru_key &key, const lru_value &value) {
+    size_t elem_size = key.size + value.size;
+    size_t elem_memory = ItemFootprint(elem_size);
+    while (OverLimit(_cur_size + elem_size, _cur_memory + elem_memory))
+        this->EvictElem();
+
+    lru_node *cur = AllocateElem(elem_size, nullptr);
+    if (cur == nullptr)
+        return false;
+    cur->key_hash = key.hash;
+    cur->key_size = key.size;
+    std::memcpy(const_cast<char *>(cur->key()), key.data, key.size);
+    StoreValue(cur, value);
+
+    LinkHead(cur);
+    if (!IndexElem(cur, _lru_index.end())) {
+        Unlink(cur);
+        FreeElem(cur);
+        return false;
     }
-    _lru_index.emplace(std::reference_wrapper<const std::string>(cur->key), std::reference_wrapper<lru_node>(*cur));
-    _cur_size = _cur_size + key.size() + value.size();
-    return true; 
+    _cur_size += elem_size;
+    _cur_memory += ItemFootprint(cur->capacity);
+    return true;
 }
 
-bool SimpleLRU::SetElem(const std::string &key, const std::string &value, lru_node* elem) { 
-    size_t elem_size = value.size();
+bool SimpleLRU::SetElem(lru_index::iterator it, const lru_value &value) {
+    lru_node *elem = it->second;
     this->MoveElem(elem);
-    while (_cur_size + elem_size - elem->value.size() > _max_size)
-        this->DeleteElem(_lru_tail);
-    elem->value = value;
-    return true; 
+
+    // Element is the list head now, so it is evicted last
+    bool relocate = elem->key_size + value.size > elem->capacity;
+    size_t old_memory = ItemFootprint(elem->capacity);
+    size_t new_memory = relocate ? ItemFootprint(elem->key_size + value.size) : old_memory;
+    while (OverLimit(_cur_size + value.size - elem->value_size, _cur_memory + new_memory - old_memory))
+        this->EvictElem();
+
+    // Value doesn't fit into the block, element moves to the new one
+    if (relocate) {
+        lru_node *cur = AllocateElem(elem->key_size + value.size, elem);
+        if (cur == nullptr)
+            return false;
+        cur->key_hash = elem->key_hash;
+        cur->key_size = elem->key_size;
+        cur->value_size = elem->value_size;
+        std::memcpy(const_cast<char *>(cur->key()), elem->key(), elem->key_size);
+
+        Unlink(elem);
+        LinkHead(cur);
+        auto hint = std::next(it);
+        _lru_index.erase(it);
+        _cur_size = _cur_size - elem->key_size - elem->value_size;
+        _cur_memory -= old_memory;
+        FreeElem(elem);
+        if (!IndexElem(cur, hint)) {
+            Unlink(cur);
+            FreeElem(cur);
+            return false;
+        }
+        _cur_size = _cur_size + cur->key_size + cur->value_size;
+        _cur_memory += ItemFootprint(cur->capacity);
+        elem = cur;
+    }
+
+    _cur_size = _cur_size + value.size - elem->value_size;
+    StoreValue(elem, value);
+    return true;
 }
 
-bool SimpleLRU::DeleteElem(lru_node* cur) { 
-    lru_node* next = cur->next.release();
-    cur->next.reset();
-    lru_node* old = cur->prev;
-    cur->prev = nullptr;
-    _cur_size = _cur_size - cur->key.size() - cur->value.size();
-    _lru_index.erase(std::reference_wrapper<const std::string>(cur->key));
-    if (old != nullptr)
-        old->next.reset(next);
-    else
-        _lru_head.reset(next);
-    if (next != nullptr)
-        next->prev = old;
-    else
-        _lru_tail = old;
+bool SimpleLRU::DeleteElem(lru_node *cur) {
+    Unlink(cur);
+    _cur_size = _cur_size - cur->key_size - cur->value_size;
+    _cur_memory -= ItemFootprint(cur->capacity);
+    _lru_index.erase(MakeKey(cur));
+    FreeElem(cur);
+    return true;
+}
+
+// See SimpleLRU.h
+void SimpleLRU::EvictElem() {
+    if (_on_evict)
+        VisitElem(_on_evict, _lru_tail);
+    this->DeleteElem(_lru_tail);
+}
+
+// See SimpleLRU.h
+std::size_t SimpleLRU::Compress(const std::string &value, const Lz4::Dictionary *dictionary, std::string &packed) {
+    uint32_t size = value.size();
+    packed.resize(sizeof(size) + Lz4::Bound(value.size()));
+    std::memcpy(&packed[0], &size, sizeof(size));
+    return sizeof(size) + Lz4::Compress(value.data(), value.size(), &packed[sizeof(size)], dictionary);
+}
+
+// See SimpleLRU.h
+void SimpleLRU::Decompress(const char *data, std::size_t size, const Lz4::Dictionary *dictionary,
+                           std::string &value) {
+    uint32_t original;
+    std::memcpy(&original, data, sizeof(original));
+    value.resize(original);
+    if (!Lz4::Decompress(data + sizeof(original), size - sizeof(original), &value[0], original, dictionary))
+        throw std::runtime_error("Compressed value is damaged");
+}
+
+// See SimpleLRU.h
+SimpleLRU::lru_value SimpleLRU::Pack(const std::string &value) {
+    lru_value raw{value.data(), value.size(), false, 0};
+    if (_compress_threshold == 0 || value.size() < _compress_threshold || value.size() > UINT32_MAX)
+        return raw;
+
+    const lru_dictionary *current = _dictionaries.empty() ? nullptr : &_dictionaries.back();
+    std::size_t packed = Compress(value, current ? current->dictionary.get() : nullptr, _packed);
+    if (packed >= value.size())
+        return raw;
+    return lru_value{_packed.data(), packed, true, uint16_t(current ? current->id : 0)};
+}
+
+// See SimpleLRU.h
+void SimpleLRU::PackValue(const std::string &value, PackedValue &packed) const {
+    packed.original = &value;
+    packed.compressed = false;
+    if (_compress_threshold == 0 || value.size() < _compress_threshold || value.size() > UINT32_MAX)
+        return;
+
+    packed.dictionary = std::atomic_load(&_current_dictionary);
+    std::size_t size = Compress(value, packed.dictionary.get(), packed.data);
+    packed.data.resize(size);
+    packed.compressed = size < value.size();
+}
+
+// See SimpleLRU.h
+void SimpleLRU::UnpackValue(const PackedValue &packed, std::string &value) {
+    Decompress(packed.data.data(), packed.data.size(), packed.dictionary.get(), value);
+}
+
+// See SimpleLRU.h
+SimpleLRU::lru_value SimpleLRU::Unwrap(const PackedValue &value) {
+    if (!value.compressed)
+        return lru_value{value.original->data(), value.original->size(), false, 0};
+
+    // Dictionary has changed since the value was compressed
+    const lru_dictionary *current = _dictionaries.empty() ? nullptr : &_dictionaries.back();
+    if (value.dictionary != (current ? current->dictionary : nullptr))
+        return Pack(*value.original);
+    return lru_value{value.data.data(), value.data.size(), true, uint16_t(current ? current->id : 0)};
+}
+
+// See SimpleLRU.h
+const std::shared_ptr<const Lz4::Dictionary> &SimpleLRU::FindDictionary(uint16_t id) const {
+    static const std::shared_ptr<const Lz4::Dictionary> none;
+    if (id == 0)
+        return none;
+    auto it = std::find_if(_dictionaries.begin(), _dictionaries.end(),
+                           [id](const lru_dictionary &d) { return d.id == id; });
+    if (it == _dictionaries.end())
+        throw std::runtime_error("Compression dictionary is missing");
+    return it->dictionary;
+}
+
+// See SimpleLRU.h
+void SimpleLRU::Unpack(lru_node *elem, std::string &value) {
+    Decompress(elem->value(), elem->value_size, FindDictionary(elem->dictionary).get(), value);
+}
+
+// See SimpleLRU.h
+void SimpleLRU::VisitElem(const Visitor &visitor, lru_node *elem) {
+    if (!elem->compressed) {
+        visitor(elem->key(), elem->key_size, elem->value(), elem->value_size);
+        return;
+    }
+    Unpack(elem, _unpacked);
+    visitor(elem->key(), elem->key_size, _unpacked.data(), _unpacked.size());
+}
+
+// See SimpleLRU.h
+void SimpleLRU::CopyElem(std::string &batch, lru_node *elem) {
+    VisitElem(
+        [&batch](const char *key, std::size_t key_size, const char *value, std::size_t value_size) {
+            batch.append(reinterpret_cast<const char *>(&key_size), sizeof(key_size));
+            batch.append(reinterpret_cast<const char *>(&value_size), sizeof(value_size));
+            batch.append(key, key_size);
+            batch.append(value, value_size);
+        },
+        elem);
+}
+
+// See SimpleLRU.h
+void SimpleLRU::BeginVisit() {
+    if (_visiting)
+        EndVisit();
+
+    // Items not visited by the previous walk are marked by EndVisit, so all of them have the old parity
+    _visit_parity = !_visit_parity;
+    _visit_cursor = _lru_head;
+    _visiting = true;
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::NextVisitBatch(std::string &batch, std::size_t max_bytes) {
+    std::size_t start = batch.size();
+    batch.append(_visit_pending);
+    _visit_pending.clear();
+
+    // Items restored during the walk are skipped, their number is bounded as well
+    for (std::size_t looked = 0; _visit_cursor != nullptr && batch.size() - start < max_bytes && looked < 1024;
+         looked++) {
+        lru_node *cur = _visit_cursor;
+        _visit_cursor = cur->next;
+        if (cur->visited == _visit_parity)
+            continue;
+        cur->visited = _visit_parity;
+        CopyElem(batch, cur);
+    }
+    if (_visit_cursor != nullptr)
+        return true;
+    _visiting = false;
+    std::string().swap(_visit_pending);
+    return false;
+}
+
+// See SimpleLRU.h
+void SimpleLRU::EndVisit() {
+    for (lru_node *cur = _visit_cursor; cur != nullptr; cur = cur->next)
+        cur->visited = _visit_parity;
+    _visit_cursor = nullptr;
+    _visiting = false;
+    std::string().swap(_visit_pending);
+}
+
+// See SimpleLRU.h
+std::size_t SimpleLRU::VisitRecord(const std::string &batch, std::size_t offset, const Visitor &visitor) {
+    std::size_t key_size, value_size;
+    std::memcpy(&key_size, batch.data() + offset, sizeof(key_size));
+    std::memcpy(&value_size, batch.data() + offset + sizeof(key_size), sizeof(value_size));
+    const char *key = batch.data() + offset + sizeof(key_size) + sizeof(value_size);
+    visitor(key, key_size, key + key_size, value_size);
+    return offset + sizeof(key_size) + sizeof(value_size) + key_size + value_size;
+}
+
+// See SimpleLRU.h
+void SimpleLRU::StoreValue(lru_node *elem, const lru_value &value) {
+    if (value.dictionary != 0)
+        _dictionaries.back().items++;
+    if (elem->dictionary != 0)
+        ReleaseDictionary(elem->dictionary);
+    elem->value_size = value.size;
+    elem->compressed = value.compressed;
+    elem->dictionary = value.dictionary;
+    std::memcpy(elem->value(), value.data, value.size);
+}
+
+// See SimpleLRU.h
+void SimpleLRU::ReleaseDictionary(uint16_t id) {
+    auto it = std::find_if(_dictionaries.begin(), _dictionaries.end(),
+                           [id](const lru_dictionary &d) { return d.id == id; });
+    if (--it->items == 0 && std::next(it) != _dictionaries.end())
+        _dictionaries.erase(it);
+}
+
+// See SimpleLRU.h
+std::vector<std::string> SimpleLRU::SampleValues(std::size_t count) {
+    return SampleLocked([](const std::function<void()> &f) { f(); }, count);
+}
+
+// See SimpleLRU.h
+void SimpleLRU::BeginSample(std::size_t count) {
+    _sample_cursor = (_compress_threshold == 0 || count == 0) ? nullptr : _lru_head;
+    _sample_step = std::max<std::size_t>(1, _lru_index.size() / std::max<std::size_t>(1, count));
+    _sample_skip = 0;
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::NextSamples(std::vector<std::string> &samples, std::size_t count) {
+    for (std::size_t looked = 0; _sample_cursor != nullptr && samples.size() < count && looked < kSampleBatch;
+         looked++) {
+        lru_node *cur = _sample_cursor;
+        _sample_cursor = cur->next;
+        if (_sample_skip > 0) {
+            _sample_skip--;
+            continue;
+        }
+        _sample_skip = _sample_step - 1;
+        if (cur->compressed)
+            Unpack(cur, _unpacked);
+        else
+            _unpacked.assign(cur->value(), cur->value_size);
+        if (_unpacked.size() >= _compress_threshold)
+            samples.push_back(_unpacked);
+    }
+    if (_sample_cursor != nullptr && samples.size() < count)
+        return true;
+    _sample_cursor = nullptr;
+    return false;
+}
+
+// See SimpleLRU.h
+void SimpleLRU::SetDictionary(std::shared_ptr<const Lz4::Dictionary> dictionary) {
+    // Previous dictionary might have no items, it isn't needed once it isn't current
+    _dictionaries.erase(std::remove_if(_dictionaries.begin(), _dictionaries.end(),
+                                       [](const lru_dictionary &d) { return d.items == 0; }),
+                        _dictionaries.end());
+
+    // Id wraps around, ids in use are skipped
+    auto used = [this](uint16_t id) {
+        return id == 0 || std::any_of(_dictionaries.begin(), _dictionaries.end(),
+                                      [id](const lru_dictionary &d) { return d.id == id; });
+    };
+    while (used(_next_dictionary_id))
+        _next_dictionary_id++;
+
+    std::atomic_store(&_current_dictionary, dictionary);
+    _dictionaries.push_back(lru_dictionary{_next_dictionary_id++, std::move(dictionary), 0});
+    _recompress_cursor = _lru_tail;
+}
+
+// See SimpleLRU.h
+std::size_t SimpleLRU::Recompress(std::size_t count) {
+    if (_dictionaries.empty())
+        return 0;
+
+    uint16_t current = _dictionaries.back().id;
+    std::size_t visited = 0;
+    for (; _recompress_cursor != nullptr && visited < count; visited++) {
+        lru_node *cur = _recompress_cursor;
+        _recompress_cursor = cur->prev;
+        if (cur->dictionary == current)
+            continue;
+
+        if (cur->compressed)
+            Unpack(cur, _unpacked);
+        else
+            _unpacked.assign(cur->value(), cur->value_size);
+        lru_value stored = Pack(_unpacked);
+
+        // Item without dictionary is rewritten only if that saves space
+        if (cur->dictionary == 0) {
+            if (stored.dictionary == current && stored.size < cur->value_size)
+                RewriteElem(cur, stored);
+            continue;
+        }
+
+        // Item with the old dictionary is rewritten anyway, so that the old dictionary could be dropped:
+        // raw if it doesn't fit compressed with the current one, and dropped as evicted if even that fails
+        if (stored.dictionary == current && RewriteElem(cur, stored))
+            continue;
+        if (RewriteElem(cur, lru_value{_unpacked.data(), _unpacked.size(), false, 0}))
+            continue;
+        if (_on_evict)
+            VisitElem(_on_evict, cur);
+        DeleteElem(cur);
+    }
+    return visited;
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::RewriteElem(lru_node *cur, const lru_value &stored) {
+    std::size_t elem_size = cur->key_size + stored.size;
+    std::size_t size = _cur_size + stored.size - cur->value_size;
+    std::size_t old_memory = ItemFootprint(cur->capacity);
+    std::size_t new_memory = ItemFootprint(elem_size);
+    bool fits = elem_size <= cur->capacity;
+
+    // Item moves to the block of its new size, so memory saved goes back to the allocator. Nothing is
+    // evicted for that, item stays in its block if it fits there
+    lru_node *moved = nullptr;
+    if (!fits || new_memory != old_memory) {
+        if (!OverLimit(size, _cur_memory + new_memory - old_memory))
+            moved = AllocateElem(elem_size, _lru_tail);
+        if (moved == nullptr && !fits)
+            return false;
+    }
+    if (moved == nullptr) {
+        if (OverLimit(size, _cur_memory))
+            return false;
+        _cur_size = size;
+        StoreValue(cur, stored);
+        return true;
+    }
+
+    moved->key_hash = cur->key_hash;
+    moved->key_size = cur->key_size;
+    std::memcpy(const_cast<char *>(moved->key()), cur->key(), cur->key_size);
+    StoreValue(moved, stored);
+    ReplaceElem(cur, moved);
+
+    // Key bytes are the same, so index entry is kept and points to the new block
+    auto it = _lru_index.find(MakeKey(cur));
+    const_cast<lru_key &>(it->first).data = moved->key();
+    it->second = moved;
+    _cur_size = size;
+    _cur_memory = _cur_memory + ItemFootprint(moved->capacity) - old_memory;
+    FreeElem(cur);
     return true;
 }
 
 // See MapBasedGlobalLockImpl.h
-bool SimpleLRU::Get(const std::string &key, std::string &value) { 
-    auto elem = _lru_index.find(std::reference_wrapper<const std::string>(key));
-    if (elem == _lru_index.end()){
+bool SimpleLRU::Get(const std::string &key, std::string &value) {
+    if (key.size() > UINT32_MAX)
+        return false;
+
+    auto elem = _lru_index.find(MakeKey(key.data(), key.size()));
+    if (elem == _lru_index.end()) {
         return false;
     }
-    lru_node* cur = &(elem->second.get());
+    lru_node *cur = elem->second;
     this->MoveElem(cur);
-    value = cur->value;
-    return true; 
+    if (cur->compressed)
+        Unpack(cur, value);
+    else
+        value.assign(cur->value(), cur->value_size);
+    return true;
 }
 
-void SimpleLRU::MoveElem(lru_node* cur) { 
-    lru_node* old = cur->prev;
-    if (old == nullptr)
+// See SimpleLRU.h
+bool SimpleLRU::GetPacked(const std::string &key, std::string &value, PackedValue &packed) {
+    packed.compressed = false;
+    if (key.size() > UINT32_MAX)
+        return false;
+
+    auto elem = _lru_index.find(MakeKey(key.data(), key.size()));
+    if (elem == _lru_index.end()) {
+        return false;
+    }
+    lru_node *cur = elem->second;
+    this->MoveElem(cur);
+    if (!cur->compressed) {
+        value.assign(cur->value(), cur->value_size);
+        return true;
+    }
+    packed.data.assign(cur->value(), cur->value_size);
+    packed.compressed = true;
+    packed.dictionary = FindDictionary(cur->dictionary);
+    return true;
+}
+
+void SimpleLRU::MoveElem(lru_node *cur) {
+    // Walk would miss the item once it is ahead of the cursor, so it is copied now
+    if (_visiting && cur->visited != _visit_parity) {
+        cur->visited = _visit_parity;
+        CopyElem(_visit_pending, cur);
+    }
+    if (cur == _lru_head)
         return;
+    Unlink(cur);
+    LinkHead(cur);
+}
+
+// See SimpleLRU.h
+SimpleLRU::lru_key SimpleLRU::MakeKey(const char *data, std::size_t size) {
+    return lru_key{data, uint32_t(HashKey(data, size)), uint32_t(size)};
+}
+
+// See SimpleLRU.h
+std::size_t SimpleLRU::ItemFootprint(std::size_t data_size) const {
+    // Red-black tree node: color, three links and the value
+    const std::size_t index_node = 4 * sizeof(void *) + sizeof(lru_index::value_type);
+    return BlockFootprint(sizeof(lru_node) + data_size) + BlockFootprint(index_node);
+}
+
+// See SimpleLRU.h
+std::size_t SimpleLRU::BlockFootprint(std::size_t size) const {
+    if (_slab) {
+        return _slab->footprint(size);
+    }
+
+    // Heap chunk has a size word before user data, chunks are 16 bytes aligned and at least 32 bytes
+    std::size_t chunk = (size + sizeof(std::size_t) + 15) & ~std::size_t(15);
+    return chunk < 32 ? 32 : chunk;
+}
+
+// See SimpleLRU.h
+SimpleLRU::lru_node *SimpleLRU::AllocateElem(std::size_t data_size, lru_node *keep) {
+    std::size_t block_size = sizeof(lru_node) + data_size;
+    if (!_slab) {
+        lru_node *cur = static_cast<lru_node *>(::operator new(block_size));
+        cur->capacity = data_size;
+        cur->dictionary = 0;
+        cur->compressed = 0;
+        cur->visited = _visit_parity;
+        return cur;
+    }
 
-    lru_node* next = cur->next.release();
-    cur->next.reset();
+    if (block_size > _slab->max_size())
+        return nullptr;
+    for (;;) {
+        try {
+            lru_node *cur = static_cast<lru_node *>(_slab->alloc(block_size));
+            cur->capacity = _slab->footprint(block_size) - sizeof(lru_node);
+            cur->dictionary = 0;
+            cur->compressed = 0;
+            cur->visited = _visit_parity;
+            return cur;
+        } catch (Allocator::AllocError &) {
+            if (_lru_tail == nullptr || _lru_tail == keep)
+                return nullptr;
+
+            // Evicted blocks must get back to their slabs, otherwise empty slabs can't move to
+            // the class that needs memory
+            this->EvictElem();
+            _slab->flush();
+        }
+    }
+}
+
+// See SimpleLRU.h
+void SimpleLRU::FreeElem(lru_node *cur) {
+    if (cur->dictionary != 0)
+        ReleaseDictionary(cur->dictionary);
+    if (_slab)
+        _slab->free(cur);
+    else
+        ::operator delete(cur);
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::IndexElem(lru_node *cur, lru_index::iterator hint) {
+    for (;;) {
+        try {
+            _lru_index.emplace_hint(hint, MakeKey(cur), cur);
+            return true;
+        } catch (std::bad_alloc &) {
+            if (!_slab) {
+                throw;
+            }
+            if (_lru_tail == cur) {
+                return false;
+            }
+
+            // Hint could point to the evicted item
+            hint = _lru_index.end();
+            this->EvictElem();
+            _slab->flush();
+        }
+    }
+}
+
+// See SimpleLRU.h
+void SimpleLRU::LinkHead(lru_node *cur) {
     cur->prev = nullptr;
-    old->next.release();
-    old->next.reset(next);
-    if (next != nullptr)
-        next->prev = old;
+    cur->next = _lru_head;
+    if (_lru_head != nullptr)
+        _lru_head->prev = cur;
     else
-        _lru_tail = old;
+        _lru_tail = cur;
+    _lru_head = cur;
+}
+
+// See SimpleLRU.h
+void SimpleLRU::LinkTail(lru_node *cur) {
+    cur->prev = _lru_tail;
+    cur->next = nullptr;
+    if (_lru_tail != nullptr)
+        _lru_tail->next = cur;
+    else
+        _lru_head = cur;
+    _lru_tail = cur;
+}
 
-    old = _lru_head.release();
-    _lru_head.reset(cur);
-    old->prev = cur;
-    cur->next.reset(old);
+// See SimpleLRU.h
+void SimpleLRU::ReplaceElem(lru_node *cur, lru_node *by) {
+    if (cur == _recompress_cursor)
+        _recompress_cursor = by;
+    if (cur == _visit_cursor)
+        _visit_cursor = by;
+    if (cur == _sample_cursor)
+        _sample_cursor = by;
+    by->visited = cur->visited;
+    by->prev = cur->prev;
+    by->next = cur->next;
+    if (by->prev != nullptr)
+        by->prev->next = by;
+    else
+        _lru_head = by;
+    if (by->next != nullptr)
+        by->next->prev = by;
+    else
+        _lru_tail = by;
+    cur->prev = cur->next = nullptr;
+}
+
+// See SimpleLRU.h
+void SimpleLRU::Unlink(lru_node *cur) {
+    if (cur == _recompress_cursor)
+        _recompress_cursor = cur->prev;
+    if (cur == _visit_cursor)
+        _visit_cursor = cur->next;
+    if (cur == _sample_cursor)
+        _sample_cursor = cur->next;
+    if (cur->prev != nullptr)
+        cur->prev->next = cur->next;
+    else
+        _lru_head = cur->next;
+    if (cur->next != nullptr)
+        cur->next->prev = cur->prev;
+    else
+        _lru_tail = cur->prev;
+    cur->prev = cur->next = nullptr;
 }
 
 } // namespace Backend
@@ -1,63 +1,184 @@
 #ifndef AFINA_STORAGE_SIMPLE_LRU_H
 #define AFINA_STORAGE_SIMPLE_LRU_H
 
+#include <cstdint>
+#include <cstring>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include <afina/Storage.h>
+#include <afina/allocator/Slab.h>
+#include <afina/allocator/StlAllocator.h>
+
+#include "Dictionary.h"
+
 namespace Afina {
 namespace Backend {
 
 /**
  * # Map based implementation
  * That is NOT thread safe implementaiton!!
+ *
+ * Each item is a single memory block: list node followed by key and value bytes. Blocks are taken
+ * from the slab allocator if one is given, in that case slab arena bounds memory of all items and
+ * least recently used ones are evicted once it is exhausted. Several caches could share one slab.
+ * Without slab blocks come from the heap.
+ *
+ * Index nodes are kept in the same slab, so the arena is a hard ceiling for all memory of the cache.
+ * Cache being the only owner of the slab doesn't free items one by one on destruction, the whole
+ * arena is released at once.
+ *
+ * Besides the limit on key and value bytes cache could be given a memory limit. It bounds memory
+ * really taken by items: item block and index node, both as allocator rounds them
+ *
+ * Values of compression threshold size and larger are kept compressed if that makes them smaller,
+ * flag in the item block tells how value is kept. Limits count bytes really kept, so compressible
+ * values take less of them. Get and Visit return values as they were stored
+ *
+ * Compression dictionary could be set, see DictionaryCompression. Item block tells which dictionary
+ * its value is compressed with, dictionary is kept while any item refers to it
  */
-class SimpleLRU : public Afina::Storage {
+class SimpleLRU : public Afina::Storage, public DictionaryCompression {
 
 private:
-    // LRU cache node
-    using lru_node = struct lru_node {
-        const std::string key;
-        std::string value;
-        lru_node* prev;
-        std::unique_ptr<lru_node> next;
+    // LRU cache node, key and value bytes follow it in the same block
+    struct lru_node {
+        lru_node *prev;
+        lru_node *next;
+
+        // Key hash and size, short key is in the same cache line
+        uint32_t key_hash;
+        uint32_t key_size;
+        std::size_t value_size;
+
+        // Bytes available for key and value in the block, whether value bytes are compressed and id of
+        // the dictionary they are compressed with, 0 if there is none. Item is visited by the current
+        // walk once its flag equals to the walk parity, see BeginVisit
+        std::size_t capacity : 46;
+        std::size_t dictionary : 16;
+        std::size_t compressed : 1;
+        std::size_t visited : 1;
+
+        const char *key() const { return reinterpret_cast<const char *>(this + 1); }
+        char *value() { return reinterpret_cast<char *>(this + 1) + key_size; }
+    };
+
+    // Key bytes owned either by node or by the caller during lookup. Hash and size are kept in the
+    // index node, so key bytes are read only when they match. Longer keys are rejected
+    struct lru_key {
+        const char *data;
+        uint32_t hash;
+        uint32_t size;
+    };
+
+    // Value bytes as they are kept: original or compressed ones prefixed by original size
+    struct lru_value {
+        const char *data;
+        std::size_t size;
+        bool compressed;
+        uint16_t dictionary;
+    };
+
+    // Compression dictionary and number of items compressed with it
+    struct lru_dictionary {
+        uint16_t id;
+        std::shared_ptr<const Lz4::Dictionary> dictionary;
+        std::size_t items;
     };
 
+    // Keys are ordered by hash and size first, there is no need in lexicographic order
+    struct lru_key_less {
+        bool operator()(const lru_key &a, const lru_key &b) const {
+            if (a.hash != b.hash) {
+                return a.hash < b.hash;
+            }
+            if (a.size != b.size) {
+                return a.size < b.size;
+            }
+            return std::memcmp(a.data, b.data, a.size) < 0;
+        }
+    };
+
+    using lru_index = std::map<lru_key, lru_node *, lru_key_less,
+                               Allocator::StlAllocator<std::pair<const lru_key, lru_node *>>>;
+
     // Maximum number of bytes could be stored in this cache.
     // i.e all (keys+values) must be not greater than the _max_size
     std::size_t _max_size = 15000000;
     std::size_t _cur_size = 0;
 
-    // Main storage of lru_nodes, elements in this list ordered descending by "freshness": in the head
+    // Limit of memory taken by items including all overhead, 0 means no limit
+    std::size_t _max_memory = 0;
+    std::size_t _cur_memory = 0;
+
+    // Main storage of lru_nodes, elements in this list ordered descending by "freshness": in the tail
     // element that wasn't used for longest time.
     //
     // List owns all nodes
-    std::unique_ptr<lru_node> _lru_head;
-    lru_node* _lru_tail = nullptr;
+    lru_node *_lru_head = nullptr;
+    lru_node *_lru_tail = nullptr;
 
-    // Index of nodes from list above, allows fast random access to elements by lru_node#key
-    std::map<std::reference_wrapper<const std::string>, std::reference_wrapper<lru_node>, std::less<std::string>> _lru_index;
+    // Allocator of item blocks and index nodes, heap is used if there is none
+    std::shared_ptr<Allocator::Slab> _slab;
 
-public:
-    SimpleLRU(size_t max_size = 1024) : _max_size(max_size) {}
+    // Gets items evicted from the tail, see SetEvictionHandler
+    Visitor _on_evict;
 
-    ~SimpleLRU() {
-        _lru_index.clear();
-        //_lru_head.reset(); // TODO: Here is stack overflow
+    // Smallest value to compress, 0 if values are kept as is
+    std::size_t _compress_threshold = 0;
 
-        if (_lru_tail != nullptr){
-            while (_lru_tail->prev != nullptr){
-                _lru_tail = _lru_tail->prev;
-                _lru_tail->next.get()->prev=nullptr;
-                _lru_tail->next.reset();
-            }
-        _lru_tail = nullptr;
-        _lru_head.reset();
-        }
+    // Buffers for compressed value being stored and for value decompressed for visitor
+    std::string _packed;
+    std::string _unpacked;
+
+    // Dictionaries items are compressed with, the last one is used for new values. Ids are never 0
+    std::vector<lru_dictionary> _dictionaries;
+
+    // The last one of dictionaries, read by PackValue without the cache lock
+    std::shared_ptr<const Lz4::Dictionary> _current_dictionary;
+    uint16_t _next_dictionary_id = 1;
+
+    // Next item to recompress with the current dictionary, items are walked from the tail to the head,
+    // so items moved to the head are not missed
+    lru_node *_recompress_cursor = nullptr;
+
+    // Sampling in batches: next item to look at and items to skip before the next sample, see NextSamples
+    lru_node *_sample_cursor = nullptr;
+    std::size_t _sample_step = 1;
+    std::size_t _sample_skip = 0;
+
+    // Only one sampling at a time, see SampleLocked
+    std::mutex _sample_mutex;
+
+    // Walk in batches: next item to copy, items are walked from the head to the tail. Items moved to the
+    // head ahead of the walk are copied into pending records at once, see NextVisitBatch
+    bool _visiting = false;
+    bool _visit_parity = false;
+    lru_node *_visit_cursor = nullptr;
+    std::string _visit_pending;
+
+    // Only one walk at a time, see VisitLocked
+    std::mutex _visit_mutex;
+
+    // Index of nodes from list above, allows fast random access to elements by lru_node#key.
+    // Destroyed manually, see ~SimpleLRU
+    union {
+        lru_index _lru_index;
+    };
+
+public:
+    SimpleLRU(size_t max_size = 1024, std::shared_ptr<Allocator::Slab> slab = nullptr, size_t max_memory = 0,
+              size_t compress_threshold = 0)
+        : _max_size(max_size), _max_memory(max_memory), _slab(std::move(slab)),
+          _compress_threshold(compress_threshold) {
+        new (&_lru_index) lru_index(lru_key_less(), lru_index::allocator_type(_slab.get()));
     }
 
+    ~SimpleLRU();
+
     // Implements Afina::Storage interface
     bool Put(const std::string &key, const std::string &value) override;
 
@@ -70,16 +191,225 @@ public:
     // Implements Afina::Storage interface
     bool Delete(const std::string &key) override;
 
-    bool PutIfAbsentElem(const std::string &key, const std::string &value);
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) override;
 
-    bool SetElem(const std::string &key, const std::string &value, lru_node* elem);
+    // Implements Afina::Storage interface
+    bool Visit(const Visitor &visitor) override;
 
-    bool DeleteElem(lru_node* elem);
+    // Implements Afina::Storage interface
+    bool Restore(const std::string &key, const std::string &value) override;
 
-    void MoveElem(lru_node* elem);
+    /**
+     * Value compressed by PackValue, so that thread safe wrappers compress and decompress values
+     * without their lock. Compressed bytes are stored only if they are made with the current dictionary,
+     * otherwise original value is compressed once more
+     */
+    struct PackedValue {
+        const std::string *original = nullptr;
+        std::string data;
+        bool compressed = false;
+        std::shared_ptr<const Lz4::Dictionary> dictionary;
+    };
 
-    // Implements Afina::Storage interface
-    bool Get(const std::string &key, std::string &value) override;
+    // Compress value as Put would do, doesn't touch the cache and could be called without its lock
+    void PackValue(const std::string &value, PackedValue &packed) const;
+
+    // Same as Put, PutIfAbsent, Set and Restore for the value packed by PackValue
+    bool PutPacked(const std::string &key, const PackedValue &value);
+    bool PutIfAbsentPacked(const std::string &key, const PackedValue &value);
+    bool SetPacked(const std::string &key, const PackedValue &value);
+    bool RestorePacked(const std::string &key, const PackedValue &value);
+
+    /**
+     * Same as Get, but value kept compressed is copied into packed as it is and must be decompressed by
+     * UnpackValue then, packed.compressed tells that
+     */
+    bool GetPacked(const std::string &key, std::string &value, PackedValue &packed);
+    static void UnpackValue(const PackedValue &packed, std::string &value);
+
+    // Memory taken by items including all overhead
+    std::size_t MemoryUsed() const { return _cur_memory; }
+
+    // Keys and values bytes kept, values counted as they are kept
+    std::size_t SizeUsed() const { return _cur_size; }
+
+    /**
+     * Handler is called with each item evicted to make room for another one, before the item is
+     * freed. Items deleted or replaced by clients are not passed there. Handler must not call the cache
+     */
+    void SetEvictionHandler(Visitor handler) { _on_evict = std::move(handler); }
+
+    /**
+     * Memory item with given number of key and value bytes would take: item block and index node,
+     * rounded up as allocator does
+     */
+    std::size_t ItemFootprint(std::size_t data_size) const;
+
+    // Original values of every n-th item, so that samples cover the whole list, see Dictionary.h
+    std::vector<std::string> SampleValues(std::size_t count) override;
+
+    // See Dictionary.h
+    void SetDictionary(std::shared_ptr<const Lz4::Dictionary> dictionary) override;
+
+    /**
+     * Recompression never evicts other items. Item with the old dictionary which has no room to be
+     * recompressed is kept raw, or dropped as evicted if there is no room for that either, so that the
+     * old dictionary is released, see Dictionary.h
+     */
+    std::size_t Recompress(std::size_t count) override;
+
+    // Items looked at by one NextSamples call
+    static constexpr std::size_t kSampleBatch = 1024;
+
+    /**
+     * Sample values in batches, so that caller could release its lock between them. BeginSample starts
+     * the walk, NextSamples appends samples of the next items and returns false once count samples
+     * are taken or the walk is over
+     */
+    void BeginSample(std::size_t count);
+    bool NextSamples(std::vector<std::string> &samples, std::size_t count);
+
+    // Sample values in batches, locked(f) must call f with the cache locked, see VisitLocked
+    template <typename Locked> std::vector<std::string> SampleLocked(Locked locked, std::size_t count) {
+        std::lock_guard<std::mutex> lk(_sample_mutex);
+        std::vector<std::string> samples;
+        locked([this, count]() { BeginSample(count); });
+        for (bool more = true; more;) {
+            locked([this, &samples, count, &more]() { more = NextSamples(samples, count); });
+        }
+        return samples;
+    }
+
+    // Number of dictionaries items are compressed with, including the current one
+    std::size_t Dictionaries() const { return _dictionaries.size(); }
+
+    // Bytes of items copied at once by VisitLocked
+    static constexpr std::size_t kVisitBatch = 64 << 10;
+
+    /**
+     * Walk over items in batches, so that caller could release its lock between them. BeginVisit starts
+     * the walk, NextVisitBatch appends records of the next items to the batch, max_bytes or a bit more,
+     * and returns false once the walk is over. Items moved to the head ahead of the walk get into the
+     * next batch with the value they had before, items added during the walk are not visited. Walk that
+     * isn't over must be ended by EndVisit, that takes time proportional to the items left
+     */
+    void BeginVisit();
+    bool NextVisitBatch(std::string &batch, std::size_t max_bytes);
+    void EndVisit();
+
+    // Call visitor with the record at the given offset of the batch, returns offset of the next one
+    static std::size_t VisitRecord(const std::string &batch, std::size_t offset, const Visitor &visitor);
+
+    /**
+     * Visit items in batches, locked(f) must call f with the cache locked. Lock is held while batch is
+     * copied, visitor is called without it, so clients aren't blocked by slow visitor
+     */
+    template <typename Locked> bool VisitLocked(Locked locked, const Visitor &visitor) {
+        std::lock_guard<std::mutex> lk(_visit_mutex);
+        locked([this]() { BeginVisit(); });
+        std::string batch;
+        for (bool more = true; more;) {
+            batch.clear();
+            locked([this, &batch, &more]() { more = NextVisitBatch(batch, kVisitBatch); });
+            try {
+                for (std::size_t offset = 0; offset < batch.size();) {
+                    offset = VisitRecord(batch, offset, visitor);
+                }
+            } catch (...) {
+                if (more) {
+                    locked([this]() { EndVisit(); });
+                }
+                throw;
+            }
+        }
+        return true;
+    }
+
+private:
+    // Put, PutIfAbsent, Set and Restore of the value pack() returns, it is called once value is to be stored
+    template <typename Packer> bool PutWith(const std::string &key, Packer pack);
+    template <typename Packer> bool PutIfAbsentWith(const std::string &key, Packer pack);
+    template <typename Packer> bool SetWith(const std::string &key, Packer pack);
+    template <typename Packer> bool RestoreWith(const std::string &key, Packer pack);
+
+    bool PutIfAbsentElem(const lru_key &key, const lru_value &value);
+
+    bool SetElem(lru_index::iterator it, const lru_value &value);
+
+    // Value bytes to keep, compressed into _packed if that saves space
+    lru_value Pack(const std::string &value);
+
+    // Value bytes to keep of the value packed by PackValue
+    lru_value Unwrap(const PackedValue &value);
+
+    // Compress value into packed bytes prefixed by original size, returns number of bytes
+    static std::size_t Compress(const std::string &value, const Lz4::Dictionary *dictionary, std::string &packed);
+
+    // Decompress packed bytes made by Compress
+    static void Decompress(const char *data, std::size_t size, const Lz4::Dictionary *dictionary,
+                           std::string &value);
+
+    // Dictionary with the given id, empty one for 0
+    const std::shared_ptr<const Lz4::Dictionary> &FindDictionary(uint16_t id) const;
+
+    // Decompress value of compressed item
+    void Unpack(lru_node *elem, std::string &value);
+
+    // Store value into item block or into a new block of its size, never evicts. Returns false on failure
+    bool RewriteElem(lru_node *elem, const lru_value &value);
+
+    // Call visitor with original value of the item
+    void VisitElem(const Visitor &visitor, lru_node *elem);
+
+    // Append record of the item with its original value, see VisitRecord
+    void CopyElem(std::string &batch, lru_node *elem);
+
+    // Copy value bytes into item block, moves item from one dictionary to another
+    void StoreValue(lru_node *elem, const lru_value &value);
+
+    // Item compressed with the dictionary is gone, unused dictionary is dropped unless it is current
+    void ReleaseDictionary(uint16_t id);
+
+    bool DeleteElem(lru_node *elem);
+
+    // Delete least recently used element, eviction handler gets it first
+    void EvictElem();
+
+    void MoveElem(lru_node *elem);
+
+    // Whether cache with given total of keys and values and given memory is over its limits
+    bool OverLimit(std::size_t size, std::size_t memory) const {
+        return size > _max_size || (_max_memory > 0 && memory > _max_memory);
+    }
+
+    // Memory really taken by the block of given size
+    std::size_t BlockFootprint(std::size_t size) const;
+
+    /**
+     * Allocate block for node with given number of key and value bytes, evicts least recently used
+     * items until allocator has enough memory but never the keep one. Returns nullptr on failure
+     */
+    lru_node *AllocateElem(std::size_t data_size, lru_node *keep);
+    void FreeElem(lru_node *elem);
+
+    /**
+     * Add linked node to the index, evicts least recently used items if there is no memory for
+     * index node. Returns false on failure
+     */
+    bool IndexElem(lru_node *elem, lru_index::iterator hint);
+
+    // Index key of the given bytes
+    static lru_key MakeKey(const char *data, std::size_t size);
+    static lru_key MakeKey(const lru_node *elem) { return lru_key{elem->key(), elem->key_hash, elem->key_size}; }
+
+    // Put detached node to the list head or tail
+    void LinkHead(lru_node *elem);
+    void LinkTail(lru_node *elem);
+    void Unlink(lru_node *elem);
+
+    // Put detached node to the place of the linked one, which is detached
+    void ReplaceElem(lru_node *elem, lru_node *by);
 };
 
 } // namespace Backend
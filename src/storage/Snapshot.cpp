@@ -0,0 +1,408 @@
+#include "Snapshot.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <spdlog/logger.h>
+
+#include <afina/logging/Service.h>
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+constexpr char kMagic[8] = {'A', 'F', 'I', 'N', 'A', 'S', 'N', 'P'};
+constexpr uint32_t kVersion = 1;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+struct BlockHeader {
+    uint32_t size;
+    uint32_t items;
+    uint32_t crc;
+    uint32_t reserved;
+};
+
+struct RecordHeader {
+    uint32_t key_size;
+    uint32_t value_size;
+};
+
+// Block is written once its records take that much
+constexpr std::size_t kBlockSize = 64 * 1024;
+
+// Records restored under one lock of the deleted keys
+constexpr std::size_t kLoadBatch = 256;
+
+std::runtime_error io_error(const std::string &what, const std::string &path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+// See Snapshot.h
+uint32_t Crc32(const void *data, std::size_t size, uint32_t crc) {
+    static const struct Table {
+        uint32_t entries[256];
+        Table() {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                entries[i] = c;
+            }
+        }
+    } table;
+
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    crc = ~crc;
+    for (std::size_t i = 0; i < size; i++) {
+        crc = table.entries[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// See Snapshot.h
+SnapshotWriter::SnapshotWriter(const std::string &path)
+    : _path(path), _tmp_path(path + ".tmp"), _file(nullptr), _block_items(0), _items(0) {
+    _file = std::fopen(_tmp_path.c_str(), "wb");
+    if (_file == nullptr) {
+        throw io_error("Failed to create", _tmp_path);
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.reserved = 0;
+    if (std::fwrite(&header, sizeof(header), 1, _file) != 1) {
+        throw io_error("Failed to write", _tmp_path);
+    }
+    _block.reserve(kBlockSize * 2);
+}
+
+// See Snapshot.h
+SnapshotWriter::~SnapshotWriter() {
+    // Not finished file is garbage
+    if (_file != nullptr) {
+        std::fclose(_file);
+        unlink(_tmp_path.c_str());
+    }
+}
+
+// See Snapshot.h
+void SnapshotWriter::Add(const char *key, std::size_t key_size, const char *value, std::size_t value_size) {
+    RecordHeader record{uint32_t(key_size), uint32_t(value_size)};
+    _block.append(reinterpret_cast<const char *>(&record), sizeof(record));
+    _block.append(key, key_size);
+    _block.append(value, value_size);
+    _block_items++;
+    _items++;
+
+    if (_block.size() >= kBlockSize) {
+        FlushBlock();
+    }
+}
+
+// See Snapshot.h
+void SnapshotWriter::Finish() {
+    FlushBlock();
+    if (std::fflush(_file) != 0 || fsync(fileno(_file)) != 0) {
+        throw io_error("Failed to write", _tmp_path);
+    }
+
+    int rc = std::fclose(_file);
+    _file = nullptr;
+    if (rc != 0 || std::rename(_tmp_path.c_str(), _path.c_str()) != 0) {
+        unlink(_tmp_path.c_str());
+        throw io_error("Failed to save", _path);
+    }
+}
+
+// See Snapshot.h
+void SnapshotWriter::FlushBlock() {
+    if (_block_items == 0) {
+        return;
+    }
+
+    BlockHeader header{uint32_t(_block.size()), _block_items, Crc32(_block.data(), _block.size()), 0};
+    if (std::fwrite(&header, sizeof(header), 1, _file) != 1 ||
+        std::fwrite(_block.data(), _block.size(), 1, _file) != 1) {
+        throw io_error("Failed to write", _tmp_path);
+    }
+    _block.clear();
+    _block_items = 0;
+}
+
+// See Snapshot.h
+SnapshotReader::SnapshotReader(const std::string &path)
+    : _data(nullptr), _size(0), _pos(sizeof(FileHeader)), _block_end(sizeof(FileHeader)), _damaged(false) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw io_error("Failed to open", path);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw io_error("Failed to stat", path);
+    }
+    _size = st.st_size;
+    if (_size < sizeof(FileHeader)) {
+        close(fd);
+        throw std::runtime_error("Not a snapshot: " + path);
+    }
+
+    void *data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw io_error("Failed to map", path);
+    }
+    _data = static_cast<const char *>(data);
+    madvise(data, _size, MADV_SEQUENTIAL);
+
+    FileHeader header;
+    std::memcpy(&header, _data, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) {
+        munmap(data, _size);
+        throw std::runtime_error("Not a snapshot or unsupported version: " + path);
+    }
+}
+
+// See Snapshot.h
+SnapshotReader::~SnapshotReader() { munmap(const_cast<char *>(_data), _size); }
+
+// See Snapshot.h
+bool SnapshotReader::Next(const char *&key, std::size_t &key_size, const char *&value, std::size_t &value_size) {
+    if (_pos == _block_end && !NextBlock()) {
+        return false;
+    }
+
+    // Checksum matched, but sizes are still checked not to go out of the block
+    RecordHeader record;
+    if (_block_end - _pos < sizeof(record)) {
+        _damaged = true;
+        return false;
+    }
+    std::memcpy(&record, _data + _pos, sizeof(record));
+    std::size_t size = sizeof(record) + std::size_t(record.key_size) + record.value_size;
+    if (_block_end - _pos < size) {
+        _damaged = true;
+        return false;
+    }
+
+    key = _data + _pos + sizeof(record);
+    key_size = record.key_size;
+    value = key + key_size;
+    value_size = record.value_size;
+    _pos += size;
+    return true;
+}
+
+// See Snapshot.h
+bool SnapshotReader::NextBlock() {
+    if (_damaged || _pos == _size) {
+        return false;
+    }
+
+    BlockHeader header;
+    if (_size - _pos < sizeof(header)) {
+        _damaged = true;
+        return false;
+    }
+    std::memcpy(&header, _data + _pos, sizeof(header));
+    if (_size - _pos - sizeof(header) < header.size ||
+        Crc32(_data + _pos + sizeof(header), header.size) != header.crc) {
+        _damaged = true;
+        return false;
+    }
+
+    _pos += sizeof(header);
+    _block_end = _pos + header.size;
+    return _pos < _block_end || NextBlock();
+}
+
+// See Snapshot.h
+std::size_t SaveSnapshot(Storage &storage, const std::string &path) {
+    SnapshotWriter writer(path);
+    std::string error;
+    bool visited = storage.Visit([&](const char *key, std::size_t key_size, const char *value, std::size_t value_size) {
+        // Exception must not leave the storage locked, so it is rethrown once visit is over
+        if (error.empty()) {
+            try {
+                writer.Add(key, key_size, value, value_size);
+            } catch (std::runtime_error &ex) {
+                error = ex.what();
+            }
+        }
+    });
+
+    if (!visited) {
+        throw std::runtime_error("Storage doesn't support snapshots");
+    }
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+    writer.Finish();
+    return writer.Items();
+}
+
+// See Snapshot.h
+SnapshotStorage::SnapshotStorage(std::shared_ptr<Afina::Storage> storage, const std::string &path,
+                                 std::chrono::seconds interval, std::shared_ptr<Logging::Service> logging)
+    : _storage(std::move(storage)), _path(path), _interval(interval), _logging(std::move(logging)), _running(false),
+      _loading(false), _tracking(true), _loaded(0) {}
+
+// See Snapshot.h
+SnapshotStorage::~SnapshotStorage() {
+    if (_thread.joinable()) {
+        Stop();
+    }
+}
+
+// See Snapshot.h
+void SnapshotStorage::Start() {
+    if (_logging) {
+        _logger = _logging->select("storage");
+    }
+    _storage->Start();
+
+    std::lock_guard<std::mutex> lk(_mutex);
+    _running = true;
+    _loading = true;
+    _tracking.store(true);
+    _thread = std::thread(&SnapshotStorage::OnRun, this);
+}
+
+// See Snapshot.h
+void SnapshotStorage::Stop() {
+    // Storage that wasn't started has nothing to save, old snapshot must not be overwritten
+    if (!_thread.joinable()) {
+        _storage->Stop();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _running = false;
+    }
+    _changed.notify_all();
+    _thread.join();
+
+    Save();
+    _storage->Stop();
+}
+
+// See Snapshot.h
+bool SnapshotStorage::Delete(const std::string &key) {
+    if (!_tracking.load()) {
+        return _storage->Delete(key);
+    }
+
+    // Loader restores items under the same lock, so the key is either already there or skipped
+    std::lock_guard<std::mutex> lk(_deleted_mutex);
+    if (_tracking.load()) {
+        _deleted.insert(key);
+    }
+    return _storage->Delete(key);
+}
+
+// See Snapshot.h
+void SnapshotStorage::WaitLoaded() {
+    std::unique_lock<std::mutex> lk(_mutex);
+    _changed.wait(lk, [this]() { return !_loading; });
+}
+
+// See Snapshot.h
+void SnapshotStorage::OnRun() {
+    Load();
+    {
+        std::lock_guard<std::mutex> lk(_deleted_mutex);
+        _tracking.store(false);
+        _deleted.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _loading = false;
+    }
+    _changed.notify_all();
+
+    if (_interval.count() == 0) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lk(_mutex);
+    while (!_changed.wait_for(lk, _interval, [this]() { return !_running; })) {
+        lk.unlock();
+        Save();
+        lk.lock();
+    }
+}
+
+// See Snapshot.h
+void SnapshotStorage::Load() {
+    if (access(_path.c_str(), F_OK) != 0) {
+        if (_logger) {
+            _logger->warn("No snapshot {}, starting empty", _path);
+        }
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    try {
+        SnapshotReader reader(_path);
+        const char *key, *value;
+        std::size_t key_size, value_size;
+        for (bool more = true; more;) {
+            std::lock_guard<std::mutex> lk(_deleted_mutex);
+            for (std::size_t i = 0; i < kLoadBatch && (more = reader.Next(key, key_size, value, value_size)); i++) {
+                std::string k(key, key_size);
+                if (_deleted.count(k) == 0 && _storage->Restore(k, std::string(value, value_size))) {
+                    _loaded++;
+                }
+            }
+        }
+
+        if (_logger) {
+            if (reader.Damaged()) {
+                _logger->error("Snapshot {} is damaged, loaded items before damaged block", _path);
+            }
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+            _logger->warn("Loaded {} items from snapshot {} in {} ms", _loaded.load(), _path, ms.count());
+        }
+    } catch (std::runtime_error &ex) {
+        if (_logger) {
+            _logger->error("Failed to load snapshot: {}", ex.what());
+        }
+    }
+}
+
+// See Snapshot.h
+void SnapshotStorage::Save() {
+    auto start = std::chrono::steady_clock::now();
+    try {
+        std::size_t items = SaveSnapshot(*_storage, _path);
+        if (_logger) {
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+            _logger->warn("Saved {} items to snapshot {} in {} ms", items, _path, ms.count());
+        }
+    } catch (std::runtime_error &ex) {
+        if (_logger) {
+            _logger->error("Failed to save snapshot: {}", ex.what());
+        }
+    }
+}
+
+} // namespace Backend
+} // namespace Afina
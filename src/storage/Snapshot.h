@@ -0,0 +1,213 @@
+#ifndef AFINA_STORAGE_SNAPSHOT_H
+#define AFINA_STORAGE_SNAPSHOT_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+#include <afina/Storage.h>
+
+namespace spdlog {
+class logger;
+}
+
+namespace Afina {
+namespace Logging {
+class Service;
+}
+
+namespace Backend {
+
+/**
+ * CRC-32 (IEEE) of the given bytes, continues from the given crc
+ */
+uint32_t Crc32(const void *data, std::size_t size, uint32_t crc = 0);
+
+/**
+ * # Snapshot file writer
+ * File is a header followed by blocks, each block is a header and records. Record is key size,
+ * value size, both uint32, and their bytes. Block header has payload size, number of records and
+ * payload checksum, so a damaged block is detected before anything is taken from it. Numbers are in
+ * the host byte order: file is meant to be mapped by the same machine.
+ *
+ * Items are written in the order Visit gives them, the most recently used first. File is written
+ * aside and renamed on Finish, so the previous snapshot stays intact if writing fails
+ */
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(const std::string &path);
+    ~SnapshotWriter();
+
+    /**
+     * Append one item, throws std::runtime_error on I/O failure
+     */
+    void Add(const char *key, std::size_t key_size, const char *value, std::size_t value_size);
+
+    /**
+     * Flush, sync and move file to its place, throws std::runtime_error on I/O failure
+     */
+    void Finish();
+
+    std::size_t Items() const { return _items; }
+
+private:
+    SnapshotWriter(const SnapshotWriter &) = delete;
+    SnapshotWriter &operator=(const SnapshotWriter &) = delete;
+
+    void FlushBlock();
+
+    std::string _path;
+    std::string _tmp_path;
+    std::FILE *_file;
+
+    // Records of the current block
+    std::string _block;
+    uint32_t _block_items;
+
+    std::size_t _items;
+};
+
+/**
+ * # Snapshot file reader
+ * File is mapped, not read: pages are faulted in as records are taken, so the first items are
+ * available right away whatever the file size is. Block checksum is verified when the block is
+ * entered, reading stops at the first damaged block, items before it are still good
+ */
+class SnapshotReader {
+public:
+    /**
+     * Map the file, throws std::runtime_error if it can't be mapped or isn't a snapshot
+     */
+    explicit SnapshotReader(const std::string &path);
+    ~SnapshotReader();
+
+    /**
+     * Take next item, pointers are valid while the reader lives. Returns false at the end of file
+     * or at the damaged block
+     */
+    bool Next(const char *&key, std::size_t &key_size, const char *&value, std::size_t &value_size);
+
+    // Whether reading stopped because of damaged data
+    bool Damaged() const { return _damaged; }
+
+private:
+    SnapshotReader(const SnapshotReader &) = delete;
+    SnapshotReader &operator=(const SnapshotReader &) = delete;
+
+    // Enter the next block, false if there is none or it is damaged
+    bool NextBlock();
+
+    const char *_data;
+    std::size_t _size;
+
+    // Position in the file and the end of the current block
+    std::size_t _pos;
+    std::size_t _block_end;
+    bool _damaged;
+};
+
+/**
+ * Write all items of the storage to the snapshot file, returns number of items written. Throws
+ * std::runtime_error on failure
+ */
+std::size_t SaveSnapshot(Storage &storage, const std::string &path);
+
+/**
+ * # Storage with warm restart
+ * Wraps storage, loads snapshot file into it on Start and saves it there on Stop and, if interval is
+ * given, periodically. Loading goes in background: storage serves requests right away, items arrive
+ * from the hottest to the coldest through Restore, so whatever clients write meanwhile wins over the
+ * snapshot and keeps its LRU position. Keys deleted by clients while loading are not brought back.
+ *
+ * Stop lets loading finish before the final save, otherwise not yet loaded items would be lost
+ */
+class SnapshotStorage : public Afina::Storage {
+public:
+    /**
+     * @param storage to be wrapped, must be thread safe and support Visit
+     * @param path of the snapshot file
+     * @param interval between periodic saves, zero saves on Stop only
+     * @param logging service to report progress, could be null
+     */
+    SnapshotStorage(std::shared_ptr<Afina::Storage> storage, const std::string &path,
+                    std::chrono::seconds interval = std::chrono::seconds(0),
+                    std::shared_ptr<Logging::Service> logging = nullptr);
+    ~SnapshotStorage();
+
+    // Starts wrapped storage and background loading
+    void Start() override;
+
+    // Waits for loading, saves snapshot and stops wrapped storage
+    void Stop() override;
+
+    // see SimpleLRU.h
+    bool Put(const std::string &key, const std::string &value) override { return _storage->Put(key, value); }
+
+    // see SimpleLRU.h
+    bool PutIfAbsent(const std::string &key, const std::string &value) override {
+        return _storage->PutIfAbsent(key, value);
+    }
+
+    // see SimpleLRU.h
+    bool Set(const std::string &key, const std::string &value) override { return _storage->Set(key, value); }
+
+    // see SimpleLRU.h
+    bool Delete(const std::string &key) override;
+
+    // see SimpleLRU.h
+    bool Get(const std::string &key, std::string &value) override { return _storage->Get(key, value); }
+
+    // see SimpleLRU.h
+    bool Visit(const Visitor &visitor) override { return _storage->Visit(visitor); }
+
+    // see SimpleLRU.h
+    bool Restore(const std::string &key, const std::string &value) override { return _storage->Restore(key, value); }
+
+    // Number of items taken from the snapshot so far
+    std::size_t Loaded() const { return _loaded.load(); }
+
+    // Blocks until background loading is done
+    void WaitLoaded();
+
+private:
+    // Background thread: loads snapshot, then saves it periodically till Stop
+    void OnRun();
+    void Load();
+    void Save();
+
+    std::shared_ptr<Afina::Storage> _storage;
+    std::string _path;
+    std::chrono::seconds _interval;
+    std::shared_ptr<Logging::Service> _logging;
+    std::shared_ptr<spdlog::logger> _logger;
+
+    std::thread _thread;
+
+    // Protects flags below, background thread waits on it for the next save or stop
+    std::mutex _mutex;
+    std::condition_variable _changed;
+    bool _running;
+    bool _loading;
+
+    // Keys deleted until loading is over, so that loader doesn't bring them back. Clients could come
+    // before Start, taking over from the running process network starts first. Fast path in Delete
+    // checks the atomic flag only
+    std::mutex _deleted_mutex;
+    std::atomic<bool> _tracking;
+    std::set<std::string> _deleted;
+
+    std::atomic<std::size_t> _loaded;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_SNAPSHOT_H
@@ -3,11 +3,15 @@
 
 #include <afina/Storage.h>
 #include "ThreadSafeSimpleLRU.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <mutex>
 #include <vector>
 namespace Afina {
 namespace Backend {
 
-int hash(std::string key)
+inline int hash(std::string key)
 {
   int len = key.size(), hashf = 0;
   if (len <= 1)
@@ -18,20 +22,43 @@ int hash(std::string key)
   return hashf;
 };
 
-class StripedLockLRU : public Afina::Storage{
+class StripedLockLRU : public Afina::Storage, public DictionaryCompression {
 public:
     StripedLockLRU(StripedLockLRU&&) = default;
-    StripedLockLRU(size_t shards_cnt = 2, size_t max_size = 2*1024*1024) {
+    // All shards allocate items from the same slab if it is given, so arena bounds the whole storage.
+    // Size and memory limits are split between shards evenly
+    StripedLockLRU(size_t shards_cnt = 2, size_t max_size = 2*1024*1024, std::shared_ptr<Allocator::Slab> slab = nullptr,
+                   size_t max_memory = 0, size_t compress_threshold = 0)
+        : StripedLockLRU(shards_cnt, max_size, std::vector<std::shared_ptr<Allocator::Slab>>{slab}, max_memory,
+                         compress_threshold) {}
+
+    // Shard i allocates from slabs[i % slabs.size()], e.g. one slab per NUMA node
+    StripedLockLRU(size_t shards_cnt, size_t max_size, const std::vector<std::shared_ptr<Allocator::Slab>> &slabs,
+                   size_t max_memory = 0, size_t compress_threshold = 0) {
         shards.resize(shards_cnt);
         for (size_t i=0; i < shards_cnt; i++)
-            shards[i] = std::unique_ptr<ThreadSafeSimplLRU>(new ThreadSafeSimplLRU(max_size/shards_cnt));;
+            shards[i] = std::unique_ptr<ThreadSafeSimplLRU>(new ThreadSafeSimplLRU(
+                max_size/shards_cnt, slabs[i % slabs.size()], max_memory/shards_cnt, compress_threshold));
     }
 
-    static std::unique_ptr<StripedLockLRU> create_storage(size_t shards_cnt = 2, size_t max_size = 2*1024*1024) {
+    static std::unique_ptr<StripedLockLRU> create_storage(size_t shards_cnt = 2, size_t max_size = 2*1024*1024,
+                                                          std::shared_ptr<Allocator::Slab> slab = nullptr,
+                                                          size_t max_memory = 0, size_t compress_threshold = 0) {
         if ((max_size / shards_cnt) < 1024*1024)
-            throw std::runtime_error("error");
+            throw std::runtime_error("Storage size must be at least 1M per shard");
         else 
-            return std::unique_ptr<StripedLockLRU>(new StripedLockLRU(shards_cnt, max_size));
+            return std::unique_ptr<StripedLockLRU>(
+                new StripedLockLRU(shards_cnt, max_size, slab, max_memory, compress_threshold));
+    }
+
+    static std::unique_ptr<StripedLockLRU> create_storage(size_t shards_cnt, size_t max_size,
+                                                          const std::vector<std::shared_ptr<Allocator::Slab>> &slabs,
+                                                          size_t max_memory = 0, size_t compress_threshold = 0) {
+        if ((max_size / shards_cnt) < 1024*1024)
+            throw std::runtime_error("Storage size must be at least 1M per shard");
+        else
+            return std::unique_ptr<StripedLockLRU>(
+                new StripedLockLRU(shards_cnt, max_size, slabs, max_memory, compress_threshold));
     }
 
     ~StripedLockLRU() {}
@@ -71,9 +98,81 @@ public:
         return shards[k]->Get(key, value);
     }
 
+    // see SimpleLRU.h. Shards are walked in batches, shard is locked only while its batch is copied,
+    // items of all shards are visited round robin, so the order is close to the global LRU one
+    bool Visit(const Visitor &visitor) override {
+        std::lock_guard<std::mutex> lk(visit_mutex);
+        for (auto &shard : shards) {
+            shard->BeginVisit();
+        }
+
+        std::vector<std::string> batches(shards.size());
+        std::vector<size_t> pos(shards.size(), 0);
+        std::vector<char> walking(shards.size(), 1);
+        try {
+            for (bool more = true; more;) {
+                more = false;
+                for (size_t i = 0; i < shards.size(); i++) {
+                    if (pos[i] == batches[i].size()) {
+                        if (!walking[i])
+                            continue;
+                        batches[i].clear();
+                        pos[i] = 0;
+                        walking[i] = shards[i]->NextVisitBatch(batches[i], SimpleLRU::kVisitBatch / shards.size());
+                        more = true;
+                        if (batches[i].empty())
+                            continue;
+                    }
+                    pos[i] = SimpleLRU::VisitRecord(batches[i], pos[i], visitor);
+                    more = true;
+                }
+            }
+        } catch (...) {
+            for (size_t i = 0; i < shards.size(); i++) {
+                if (walking[i])
+                    shards[i]->EndVisit();
+            }
+            throw;
+        }
+        return true;
+    }
+
+    // see SimpleLRU.h
+    bool Restore(const std::string &key, const std::string &value) override {
+        size_t k = hash(key) % shards.size();
+        return shards[k]->Restore(key, value);
+    }
+
+    // see SimpleLRU.h, each shard gives its share of samples
+    std::vector<std::string> SampleValues(std::size_t count) override {
+        std::vector<std::string> samples;
+        for (auto &shard : shards) {
+            std::vector<std::string> part = shard->SampleValues((count + shards.size() - 1) / shards.size());
+            std::move(part.begin(), part.end(), std::back_inserter(samples));
+        }
+        return samples;
+    }
+
+    // see SimpleLRU.h, all shards share the dictionary
+    void SetDictionary(std::shared_ptr<const Lz4::Dictionary> dictionary) override {
+        for (auto &shard : shards)
+            shard->SetDictionary(dictionary);
+    }
+
+    // see SimpleLRU.h, each shard recompresses its share of items under its own lock
+    std::size_t Recompress(std::size_t count) override {
+        size_t visited = 0;
+        for (auto &shard : shards)
+            visited += shard->Recompress((count + shards.size() - 1) / shards.size());
+        return visited;
+    }
+
 private:
     // TODO: sinchronization primitives
     std::vector<std::unique_ptr<ThreadSafeSimplLRU> > shards;
+
+    // Only one walk over shards at a time, see Visit
+    std::mutex visit_mutex;
 };
 
 } // namespace Backend
@@ -1,6 +1,7 @@
 #ifndef AFINA_STORAGE_THREAD_SAFE_SIMPLE_LRU_H
 #define AFINA_STORAGE_THREAD_SAFE_SIMPLE_LRU_H
 
+#include <functional>
 #include <map>
 #include <mutex>
 #include <string>
@@ -13,33 +14,38 @@ namespace Backend {
 
 /**
  * # SimpleLRU thread safe version
- *
- *
+ * Values are compressed before storage is locked and decompressed after it is unlocked, so that
+ * only copying of value bytes is done under the lock
  */
 class ThreadSafeSimplLRU : public SimpleLRU {
 public:
-    ThreadSafeSimplLRU(size_t max_size = 1024) : SimpleLRU(max_size) {}
+    ThreadSafeSimplLRU(size_t max_size = 1024, std::shared_ptr<Allocator::Slab> slab = nullptr, size_t max_memory = 0,
+                       size_t compress_threshold = 0)
+        : SimpleLRU(max_size, std::move(slab), max_memory, compress_threshold) {}
     ~ThreadSafeSimplLRU() {}
 
     // see SimpleLRU.h
     bool Put(const std::string &key, const std::string &value) override {
-        // TODO: sinchronization
+        PackedValue packed;
+        PackValue(value, packed);
         std::lock_guard<std::mutex> lk(storage_mutex);
-        return SimpleLRU::Put(key, value);
+        return SimpleLRU::PutPacked(key, packed);
     }
 
     // see SimpleLRU.h
     bool PutIfAbsent(const std::string &key, const std::string &value) override {
-        // TODO: sinchronization
+        PackedValue packed;
+        PackValue(value, packed);
         std::lock_guard<std::mutex> lk(storage_mutex);
-        return SimpleLRU::PutIfAbsent(key, value);
+        return SimpleLRU::PutIfAbsentPacked(key, packed);
     }
 
     // see SimpleLRU.h
     bool Set(const std::string &key, const std::string &value) override {
-        // TODO: sinchronization
+        PackedValue packed;
+        PackValue(value, packed);
         std::lock_guard<std::mutex> lk(storage_mutex);
-        return SimpleLRU::Set(key, value);
+        return SimpleLRU::SetPacked(key, packed);
     }
 
     // see SimpleLRU.h
@@ -51,10 +57,75 @@ public:
 
     // see SimpleLRU.h
     bool Get(const std::string &key, std::string &value) override {
-        // TODO: sinchronization
+        PackedValue packed;
+        {
+            std::lock_guard<std::mutex> lk(storage_mutex);
+            if (!SimpleLRU::GetPacked(key, value, packed)) {
+                return false;
+            }
+        }
+        if (packed.compressed) {
+            UnpackValue(packed, value);
+        }
+        return true;
+    }
+
+    // see SimpleLRU.h, storage is locked while each batch is copied, not while visitor is called
+    bool Visit(const Visitor &visitor) override {
+        return VisitLocked(
+            [this](const std::function<void()> &f) {
+                std::lock_guard<std::mutex> lk(storage_mutex);
+                f();
+            },
+            visitor);
+    }
+
+    // see SimpleLRU.h
+    void BeginVisit() {
+        std::lock_guard<std::mutex> lk(storage_mutex);
+        SimpleLRU::BeginVisit();
+    }
+
+    // see SimpleLRU.h
+    bool NextVisitBatch(std::string &batch, std::size_t max_bytes) {
+        std::lock_guard<std::mutex> lk(storage_mutex);
+        return SimpleLRU::NextVisitBatch(batch, max_bytes);
+    }
+
+    // see SimpleLRU.h
+    void EndVisit() {
+        std::lock_guard<std::mutex> lk(storage_mutex);
+        SimpleLRU::EndVisit();
+    }
+
+    // see SimpleLRU.h
+    bool Restore(const std::string &key, const std::string &value) override {
+        PackedValue packed;
+        PackValue(value, packed);
+        std::lock_guard<std::mutex> lk(storage_mutex);
+        return SimpleLRU::RestorePacked(key, packed);
+    }
+
+    // see SimpleLRU.h, storage is locked for one batch of items at a time
+    std::vector<std::string> SampleValues(std::size_t count) override {
+        return SampleLocked(
+            [this](const std::function<void()> &f) {
+                std::lock_guard<std::mutex> lk(storage_mutex);
+                f();
+            },
+            count);
+    }
+
+    // see SimpleLRU.h
+    void SetDictionary(std::shared_ptr<const Lz4::Dictionary> dictionary) override {
+        std::lock_guard<std::mutex> lk(storage_mutex);
+        SimpleLRU::SetDictionary(std::move(dictionary));
+    }
+
+    // see SimpleLRU.h, storage is locked for one batch only
+    std::size_t Recompress(std::size_t count) override {
         std::lock_guard<std::mutex> lk(storage_mutex);
-        //std::this_thread::sleep_for(std::chrono::seconds(2));
-        return SimpleLRU::Get(key, value);;
+        return SimpleLRU::Recompress(count);
     }
 
 private:
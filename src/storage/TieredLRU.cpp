@@ -0,0 +1,494 @@
+#include "TieredLRU.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Hash.h"
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+// O_DIRECT needs buffers, offsets and sizes aligned to the logical block of the device
+constexpr std::size_t kBlock = 4096;
+
+// Record header: key size and value size, key and value bytes follow
+constexpr std::size_t kRecordHeader = 2 * sizeof(uint32_t);
+
+// Index has an entry per that many bytes of flash, entries are grouped into buckets of four cache lines
+constexpr std::size_t kFlashPerEntry = 128;
+constexpr std::size_t kBucketEntries = 16;
+
+// Full segments waiting for write at most, evicted items are dropped once writer is that far behind
+constexpr std::size_t kMaxSealed = 2;
+
+// Limit of memory tier: segment buffers, the active one and sealed ones, take their share of max_memory
+std::size_t memory_limit(std::size_t max_memory, std::size_t segment_size) {
+    std::size_t buffers = (kMaxSealed + 1) * segment_size;
+    if (max_memory == 0) {
+        return 0;
+    }
+    if (max_memory <= buffers) {
+        throw std::runtime_error("Memory limit must exceed " + std::to_string(buffers) + " bytes of flash buffers");
+    }
+    return max_memory - buffers;
+}
+
+char *allocate_buffer(std::size_t size) {
+    void *data = nullptr;
+    if (posix_memalign(&data, kBlock, size) != 0) {
+        throw std::bad_alloc();
+    }
+    return static_cast<char *>(data);
+}
+
+} // namespace
+
+// See TieredLRU.h
+TieredLRU::TieredLRU(std::size_t max_size, const std::string &path, std::size_t flash_size,
+                     std::shared_ptr<Allocator::Slab> slab, std::size_t max_memory, std::size_t segment_size,
+                     bool direct)
+    : _memory(max_size, std::move(slab), memory_limit(max_memory, segment_size)), _path(path),
+      _segment_size(segment_size), _slots(segment_size > 0 ? flash_size / segment_size : 0), _direct(direct), _fd(-1),
+      _closing(false), _reading(0), _bucket_shift(0), _oldest(0), _active{0, 0, nullptr}, _flushing(false),
+      _flash_hits(0), _flash_dropped(0) {
+    if (_segment_size == 0 || _segment_size % kBlock != 0 || _segment_size > UINT32_MAX) {
+        throw std::runtime_error("Flash segment size must be multiple of 4K");
+    }
+    if (_slots < 2) {
+        throw std::runtime_error("Flash tier must fit two segments at least");
+    }
+
+    std::size_t buckets = 2;
+    _bucket_shift = 63;
+    while (buckets * kBucketEntries * kFlashPerEntry < _slots * _segment_size) {
+        buckets *= 2;
+        _bucket_shift--;
+    }
+    _index.assign(buckets * kBucketEntries, Entry{0, 0, 0, 0});
+    _written.assign(_slots, UINT64_MAX);
+    _memory.SetEvictionHandler([this](const char *key, std::size_t key_size, const char *value,
+                                      std::size_t value_size) { Evict(key, key_size, value, value_size); });
+}
+
+// See TieredLRU.h
+TieredLRU::~TieredLRU() {
+    Stop();
+    std::free(_active.data);
+    for (auto &segment : _sealed) {
+        std::free(segment.data);
+    }
+    for (char *data : _spare) {
+        std::free(data);
+    }
+}
+
+// See TieredLRU.h
+void TieredLRU::Start() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_fd != -1) {
+        return;
+    }
+
+    // Page cache would only duplicate items, but not every file system supports O_DIRECT
+    int fd = -1;
+    if (_direct) {
+        fd = open(_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_DIRECT | O_CLOEXEC, 0600);
+        if (fd == -1 && errno == EINVAL) {
+            _direct = false;
+        }
+    }
+    if (!_direct) {
+        fd = open(_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    }
+    if (fd == -1) {
+        throw std::runtime_error("Failed to open flash file " + _path + ": " + std::strerror(errno));
+    }
+    if (ftruncate(fd, _slots * _segment_size) != 0) {
+        int err = errno;
+        close(fd);
+        throw std::runtime_error("Failed to size flash file " + _path + ": " + std::strerror(err));
+    }
+    _fd = fd;
+
+    _active.seq = 0;
+    _active.used = 0;
+    if (_active.data == nullptr) {
+        _active.data = allocate_buffer(_segment_size);
+    }
+    _oldest = 0;
+}
+
+// See TieredLRU.h
+void TieredLRU::Stop() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_fd == -1) {
+        return;
+    }
+
+    // Write or read in progress uses the descriptor without the lock, its number must not be reused
+    // until they are done
+    _closing = true;
+    _idle.wait(lock, [this]() { return !_flushing && _reading == 0; });
+    close(_fd);
+    _fd = -1;
+    _closing = false;
+
+    // Items in the file are gone with it
+    std::fill(_index.begin(), _index.end(), Entry{0, 0, 0, 0});
+    std::fill(_written.begin(), _written.end(), UINT64_MAX);
+    for (auto &segment : _sealed) {
+        _spare.push_back(segment.data);
+    }
+    _sealed.clear();
+}
+
+// See MapBasedGlobalLockImpl.h
+bool TieredLRU::Put(const std::string &key, const std::string &value) {
+    std::unique_lock<std::mutex> lk(_mutex);
+
+    // Flash copy is stale now, item of another key with the same hash is dropped too
+    Entry *entry = Find(HashKey(key.data(), key.size()));
+    if (entry != nullptr) {
+        entry->size = 0;
+    }
+    bool result = _memory.Put(key, value);
+    Flush(lk);
+    return result;
+}
+
+// See MapBasedGlobalLockImpl.h
+bool TieredLRU::PutIfAbsent(const std::string &key, const std::string &value) {
+    std::unique_lock<std::mutex> lk(_mutex);
+    std::string current;
+    bool result = !Load(lk, key, current) && _memory.PutIfAbsent(key, value);
+    Flush(lk);
+    return result;
+}
+
+// See MapBasedGlobalLockImpl.h
+bool TieredLRU::Set(const std::string &key, const std::string &value) {
+    std::unique_lock<std::mutex> lk(_mutex);
+    bool result = _memory.Set(key, value);
+    if (!result) {
+        std::string current;
+        result = Load(lk, key, current) && _memory.Set(key, value);
+    }
+    Flush(lk);
+    return result;
+}
+
+// See MapBasedGlobalLockImpl.h
+bool TieredLRU::Delete(const std::string &key) {
+    std::unique_lock<std::mutex> lk(_mutex);
+    bool result = _memory.Delete(key);
+    if (!result) {
+        // Flash record must be read to tell the key from another one with the same hash, item isn't
+        // brought to memory for that
+        uint64_t hash = HashKey(key.data(), key.size());
+        std::string record;
+        if (ReadFlash(lk, key, hash, record)) {
+            Find(hash)->size = 0;
+            result = true;
+        } else {
+            result = _memory.Delete(key);
+        }
+    }
+    Flush(lk);
+    return result;
+}
+
+// See MapBasedGlobalLockImpl.h
+bool TieredLRU::Get(const std::string &key, std::string &value) {
+    std::unique_lock<std::mutex> lk(_mutex);
+    bool result = Load(lk, key, value);
+    Flush(lk);
+    return result;
+}
+
+// See MapBasedGlobalLockImpl.h
+bool TieredLRU::Visit(const Visitor &visitor) {
+    // Lock is held while batch is copied only
+    return _memory.VisitLocked(
+        [this](const std::function<void()> &f) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            f();
+        },
+        visitor);
+}
+
+// See MapBasedGlobalLockImpl.h
+bool TieredLRU::Restore(const std::string &key, const std::string &value) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // Restore never evicts, nothing goes to flash here
+    return Find(HashKey(key.data(), key.size())) == nullptr && _memory.Restore(key, value);
+}
+
+// See TieredLRU.h
+std::size_t TieredLRU::FlashItems() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return std::count_if(_index.begin(), _index.end(),
+                         [this](const Entry &entry) { return SegmentOf(entry) <= _active.seq; });
+}
+
+// See TieredLRU.h
+std::size_t TieredLRU::FlashHits() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _flash_hits;
+}
+
+// See TieredLRU.h
+std::size_t TieredLRU::FlashDropped() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _flash_dropped;
+}
+
+// See TieredLRU.h
+void TieredLRU::Evict(const char *key, std::size_t key_size, const char *value, std::size_t value_size) {
+    std::size_t size = kRecordHeader + key_size + value_size;
+    if (_fd == -1 || _closing || size > _segment_size) {
+        return;
+    }
+    if (_active.used + size > _segment_size) {
+        // Disk is slower than evictions, item is lost as in plain LRU rather than buffered without limit
+        if (_sealed.size() >= kMaxSealed) {
+            _flash_dropped++;
+            return;
+        }
+        NextSegment();
+    }
+
+    uint32_t sizes[2] = {static_cast<uint32_t>(key_size), static_cast<uint32_t>(value_size)};
+    char *record = _active.data + _active.used;
+    std::memcpy(record, sizes, kRecordHeader);
+    std::memcpy(record + kRecordHeader, key, key_size);
+    std::memcpy(record + kRecordHeader + key_size, value, value_size);
+
+    Insert(HashKey(key, key_size),
+           Location{_active.seq, static_cast<uint32_t>(_active.used), static_cast<uint32_t>(size)});
+    _active.used += size;
+}
+
+// See TieredLRU.h
+void TieredLRU::NextSegment() {
+    _sealed.push_back(_active);
+    if (_spare.empty()) {
+        _active.data = allocate_buffer(_segment_size);
+    } else {
+        _active.data = _spare.back();
+        _spare.pop_back();
+    }
+    _active.seq++;
+    _active.used = 0;
+
+    // New segment goes to the slot of the oldest one, its items are gone from now on. Segments are
+    // written in order, so the oldest one is on disk before the new one overwrites it
+    if (_active.seq >= _slots) {
+        _oldest++;
+    }
+}
+
+// See TieredLRU.h
+uint64_t TieredLRU::SegmentOf(const Entry &entry) const {
+    uint64_t age = static_cast<uint32_t>(static_cast<uint32_t>(_active.seq) - entry.segment);
+    if (entry.size == 0 || age > _active.seq - _oldest) {
+        return _active.seq + 1;
+    }
+
+    // Segment which write failed left the slot with whatever was there before
+    uint64_t seq = _active.seq - age;
+    if (InMemory(seq) == nullptr && _written[seq % _slots] != seq) {
+        return _active.seq + 1;
+    }
+    return seq;
+}
+
+// See TieredLRU.h
+TieredLRU::Entry *TieredLRU::Bucket(uint64_t hash) {
+    // Bits of the key hash are not mixed well enough for sequential keys, bucket takes the upper bits of
+    // their product with the golden ratio
+    return &_index[((hash * 0x9E3779B97F4A7C15ULL) >> _bucket_shift) * kBucketEntries];
+}
+
+// See TieredLRU.h
+TieredLRU::Entry *TieredLRU::Find(uint64_t hash) {
+    Entry *bucket = Bucket(hash);
+    uint32_t tag = static_cast<uint32_t>(hash >> 32);
+    for (std::size_t i = 0; i < kBucketEntries; i++) {
+        if (bucket[i].tag == tag && SegmentOf(bucket[i]) <= _active.seq) {
+            return &bucket[i];
+        }
+    }
+    return nullptr;
+}
+
+// See TieredLRU.h
+void TieredLRU::Insert(uint64_t hash, const Location &location) {
+    // Entry of the key itself, then empty one, then one of the oldest segment
+    Entry *entry = Find(hash);
+    if (entry == nullptr) {
+        Entry *bucket = Bucket(hash);
+        entry = bucket;
+        for (std::size_t i = 1; i < kBucketEntries && SegmentOf(*entry) <= _active.seq; i++) {
+            if (SegmentOf(bucket[i]) < SegmentOf(*entry) || SegmentOf(bucket[i]) > _active.seq) {
+                entry = &bucket[i];
+            }
+        }
+    }
+    *entry = Entry{static_cast<uint32_t>(hash >> 32), static_cast<uint32_t>(location.segment), location.offset,
+                   location.size};
+}
+
+// See TieredLRU.h
+void TieredLRU::Flush(std::unique_lock<std::mutex> &lk) {
+    if (_flushing) {
+        return;
+    }
+
+    _flushing = true;
+    while (!_sealed.empty() && _fd != -1 && !_closing) {
+        // Segment stays in the queue and is read from memory until it is written
+        Segment segment = _sealed.front();
+        int fd = _fd;
+        lk.unlock();
+
+        off_t offset = static_cast<off_t>((segment.seq % _slots) * _segment_size);
+        std::size_t done = 0;
+        while (done < _segment_size) {
+            ssize_t n = pwrite(fd, segment.data + done, _segment_size - done, offset + done);
+            if (n <= 0 && errno == EINTR) {
+                continue;
+            } else if (n <= 0) {
+                break;
+            }
+            done += n;
+        }
+
+        lk.lock();
+        if (done == _segment_size) {
+            _written[segment.seq % _slots] = segment.seq;
+        }
+        if (!_sealed.empty() && _sealed.front().seq == segment.seq) {
+            _sealed.pop_front();
+            _spare.push_back(segment.data);
+        }
+    }
+    _flushing = false;
+    _idle.notify_all();
+}
+
+// See TieredLRU.h
+const TieredLRU::Segment *TieredLRU::InMemory(uint64_t seq) const {
+    if (seq == _active.seq) {
+        return &_active;
+    }
+    if (!_sealed.empty() && seq >= _sealed.front().seq) {
+        return &_sealed[seq - _sealed.front().seq];
+    }
+    return nullptr;
+}
+
+// See TieredLRU.h
+bool TieredLRU::ReadRecord(int fd, const Location &location, std::string &record) const {
+    off_t offset = static_cast<off_t>((location.segment % _slots) * _segment_size + location.offset);
+    off_t begin = offset / kBlock * kBlock;
+    std::size_t size = (offset + location.size - begin + kBlock - 1) / kBlock * kBlock;
+
+    std::unique_ptr<char, decltype(&std::free)> buffer(allocate_buffer(size), &std::free);
+    std::size_t done = 0;
+    while (done < size) {
+        ssize_t n = pread(fd, buffer.get() + done, size - done, begin + done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            return false;
+        }
+        done += n;
+    }
+    record.assign(buffer.get() + (offset - begin), location.size);
+    return true;
+}
+
+// See TieredLRU.h
+bool TieredLRU::ReadFlash(std::unique_lock<std::mutex> &lk, const std::string &key, uint64_t hash,
+                          std::string &record) {
+    while (true) {
+        Entry *entry = Find(hash);
+        if (entry == nullptr) {
+            return false;
+        }
+
+        Location location{SegmentOf(*entry), entry->offset, entry->size};
+        const Segment *segment = InMemory(location.segment);
+        if (segment != nullptr) {
+            record.assign(segment->data + location.offset, location.size);
+            break;
+        }
+
+        // Disk read doesn't block the others. Slot is overwritten only after its segment is out of the
+        // ring, so the record read is valid if its entry is still there
+        if (_closing) {
+            return false;
+        }
+        int fd = _fd;
+        _reading++;
+        lk.unlock();
+        bool read = ReadRecord(fd, location, record);
+        lk.lock();
+        if (--_reading == 0) {
+            _idle.notify_all();
+        }
+
+        entry = Find(hash);
+        if (entry == nullptr || SegmentOf(*entry) != location.segment || entry->offset != location.offset) {
+            // Item moved meanwhile
+            continue;
+        }
+        if (!read) {
+            entry->size = 0;
+            return false;
+        }
+        break;
+    }
+
+    // Another key with the same hash
+    uint32_t sizes[2];
+    std::memcpy(sizes, record.data(), kRecordHeader);
+    return sizes[0] == key.size() && std::memcmp(record.data() + kRecordHeader, key.data(), key.size()) == 0;
+}
+
+// See TieredLRU.h
+bool TieredLRU::Load(std::unique_lock<std::mutex> &lk, const std::string &key, std::string &value) {
+    if (_memory.Get(key, value)) {
+        return true;
+    }
+
+    uint64_t hash = HashKey(key.data(), key.size());
+    std::string record;
+    if (!ReadFlash(lk, key, hash, record)) {
+        // Memory tier could get the item while the lock was released
+        return _memory.Get(key, value);
+    }
+
+    // Item moves to memory, that could evict others to flash
+    Find(hash)->size = 0;
+    _flash_hits++;
+    uint32_t sizes[2];
+    std::memcpy(sizes, record.data(), kRecordHeader);
+    value.assign(record.data() + kRecordHeader + sizes[0], sizes[1]);
+    _memory.Put(key, value);
+    return true;
+}
+
+} // namespace Backend
+} // namespace Afina
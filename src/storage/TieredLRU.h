@@ -0,0 +1,197 @@
+#ifndef AFINA_STORAGE_TIERED_LRU_H
+#define AFINA_STORAGE_TIERED_LRU_H
+
+#include <cstddef>
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "SimpleLRU.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # LRU with flash tier
+ * Memory tier is SimpleLRU, items evicted from its tail go to the file on local SSD instead of being
+ * lost. File is a ring of large segments: evicted items are packed into the segment buffer in memory,
+ * full buffer is written with one sequential write to the next slot of the ring, overwriting the
+ * oldest segment, so flash tier evicts in FIFO order and the device sees no random writes.
+ *
+ * Flash items are found by a compact index in memory: 64 bit key hash to segment and offset, records
+ * in the file keep the key, so hash collision reads as a miss. Index is a fixed table of buckets sized
+ * from flash_size, an entry of 16 bytes per 128 bytes of flash. Key takes an entry of its bucket, the
+ * one of the oldest segment is reused once bucket is full, so index memory doesn't grow with items and
+ * entries of overwritten segments need no cleanup. Miss in memory reads the record with
+ * pread, through O_DIRECT if file system supports it, without holding the lock, and promotes item
+ * back to memory. Items written to memory drop their flash copy, so key is in one tier at most.
+ *
+ * Segment is written without the lock by the thread that filled it. At most two full segments wait for
+ * the write, items evicted while the writer is that far behind are dropped, so buffers take no more
+ * than three segments. They are counted against max_memory of the memory tier.
+ *
+ * Flash tier is a cache too: file is recreated on Start, Visit enumerates memory tier only.
+ * Methods are thread safe
+ */
+class TieredLRU : public Afina::Storage {
+public:
+    /**
+     * @param max_size of keys and values in memory, see SimpleLRU
+     * @param path of the flash tier file
+     * @param flash_size of the file, rounded down to segments, at least two segments
+     * @param slab for memory tier, see SimpleLRU
+     * @param max_memory of memory tier and segment buffers, see SimpleLRU
+     * @param segment_size unit of writes to the file, multiple of 4KB
+     * @param direct whether to bypass page cache, falls back to buffered I/O if it isn't supported
+     */
+    TieredLRU(std::size_t max_size, const std::string &path, std::size_t flash_size,
+              std::shared_ptr<Allocator::Slab> slab = nullptr, std::size_t max_memory = 0,
+              std::size_t segment_size = 4 << 20, bool direct = true);
+    ~TieredLRU();
+
+    // Create the file, throws std::runtime_error on failure. Evicted items are dropped before that
+    void Start() override;
+
+    // Close the file once writes and reads in progress are done
+    void Stop() override;
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override;
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) override;
+
+    // Implements Afina::Storage interface, memory tier only
+    bool Visit(const Visitor &visitor) override;
+
+    // Implements Afina::Storage interface
+    bool Restore(const std::string &key, const std::string &value) override;
+
+    // Items in the flash tier, hits served from it, evicted items dropped as writes fell behind, whether
+    // O_DIRECT is used
+    std::size_t FlashItems() const;
+    std::size_t FlashHits() const;
+    std::size_t FlashDropped() const;
+    bool Direct() const { return _direct; }
+
+private:
+    TieredLRU(const TieredLRU &) = delete;
+    TieredLRU &operator=(const TieredLRU &) = delete;
+
+    // Place of the record in the file: segment sequence number, offset in it and record size
+    struct Location {
+        uint64_t segment;
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    // Index entry: upper half of the key hash, the whole hash chooses the bucket. Segment sequence number
+    // is kept modulo 2^32, entry with size 0 is empty
+    struct Entry {
+        uint32_t tag;
+        uint32_t segment;
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    // Segment being filled or waiting to be written, records are read from memory meanwhile
+    struct Segment {
+        uint64_t seq;
+        std::size_t used;
+        char *data;
+    };
+
+    // Eviction handler of the memory tier, lock is held
+    void Evict(const char *key, std::size_t key_size, const char *value, std::size_t value_size);
+
+    // Take segment buffer for the next sequence number, lock is held
+    void NextSegment();
+
+    /**
+     * Index entry of the hash, nullptr if there is none. Entry of a segment overwritten or failed to be
+     * written counts as none. Lock is held
+     */
+    Entry *Find(uint64_t hash);
+
+    // First entry of the hash bucket
+    Entry *Bucket(uint64_t hash);
+
+    // Add or replace index entry of the hash, lock is held
+    void Insert(uint64_t hash, const Location &location);
+
+    // Sequence number of the live segment entry points to, or the active one + 1 if there is none
+    uint64_t SegmentOf(const Entry &entry) const;
+
+    /**
+     * Write full segments to the file, one thread at a time. Called without the lock after each
+     * change, so the thread that filled the segment pays for its write
+     */
+    void Flush(std::unique_lock<std::mutex> &lk);
+
+    // Segment in memory with the given sequence number, nullptr if it is in the file only
+    const Segment *InMemory(uint64_t seq) const;
+
+    // Read record from the file, no lock is needed
+    bool ReadRecord(int fd, const Location &location, std::string &record) const;
+
+    /**
+     * Read flash record of the key, lock is released while it is read from the file. Returns false if
+     * there is none, key could be in memory then. Index entry is still there on success
+     */
+    bool ReadFlash(std::unique_lock<std::mutex> &lk, const std::string &key, uint64_t hash, std::string &record);
+
+    /**
+     * Find item in memory, then in flash. Item found in flash moves to memory
+     */
+    bool Load(std::unique_lock<std::mutex> &lk, const std::string &key, std::string &value);
+
+    SimpleLRU _memory;
+
+    std::string _path;
+    std::size_t _segment_size;
+    std::size_t _slots;
+    bool _direct;
+    int _fd;
+
+    mutable std::mutex _mutex;
+
+    // Stop waits for segment write and reads in progress, no new ones start meanwhile
+    bool _closing;
+    std::size_t _reading;
+    std::condition_variable _idle;
+
+    // Buckets of entries, number of buckets is power of 2: 64 - shift bits
+    std::vector<Entry> _index;
+    unsigned _bucket_shift;
+
+    // Sequence number of the segment last written to each slot of the ring, the oldest one still there
+    std::vector<uint64_t> _written;
+    uint64_t _oldest;
+
+    // Segment being filled, full ones waiting for write, spare buffers
+    Segment _active;
+    std::deque<Segment> _sealed;
+    std::vector<char *> _spare;
+    bool _flushing;
+
+    std::size_t _flash_hits;
+    std::size_t _flash_dropped;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_TIERED_LRU_H
@@ -0,0 +1,460 @@
+#include "Wal.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <spdlog/logger.h>
+
+#include <afina/logging/Service.h>
+
+#include "Snapshot.h"
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+constexpr char kMagic[8] = {'A', 'F', 'I', 'N', 'A', 'W', 'A', 'L'};
+constexpr uint32_t kVersion = 1;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+struct RecordHeader {
+    uint32_t crc;
+    uint32_t type;
+    uint32_t key_size;
+    uint32_t value_size;
+};
+
+// File grows by that much, each chunk is a separate mapping
+constexpr std::size_t kChunkSize = 16 << 20;
+
+std::runtime_error io_error(const std::string &what, const std::string &path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+uint32_t record_crc(const RecordHeader &header, const char *key, const char *value) {
+    uint32_t crc = Crc32(&header.type, sizeof(header) - sizeof(header.crc));
+    crc = Crc32(key, header.key_size, crc);
+    return Crc32(value, header.value_size, crc);
+}
+
+} // namespace
+
+constexpr std::size_t WalStorage::kStripes;
+
+// See Wal.h
+WalWriter::WalWriter(const std::string &path) : _path(path), _fd(-1), _written(0) {
+    _fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (_fd == -1) {
+        throw io_error("Failed to create", path);
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.reserved = 0;
+    if (pwrite(_fd, &header, sizeof(header), 0) != sizeof(header)) {
+        close(_fd);
+        throw io_error("Failed to write", path);
+    }
+    _written.store(sizeof(header));
+}
+
+// See Wal.h
+WalWriter::~WalWriter() {
+    for (char *chunk : _chunks) {
+        munmap(chunk, kChunkSize);
+    }
+    fdatasync(_fd);
+
+    // Zero tail is not needed once the file is closed
+    if (ftruncate(_fd, _written.load()) == 0) {
+        fdatasync(_fd);
+    }
+    close(_fd);
+}
+
+// See Wal.h
+void WalWriter::Append(Type type, const std::string &key, const std::string &value) {
+    RecordHeader header;
+    header.type = type;
+    header.key_size = uint32_t(key.size());
+    header.value_size = type == kDelete ? 0 : uint32_t(value.size());
+    header.crc = record_crc(header, key.data(), value.data());
+
+    std::size_t pos = _written.load(std::memory_order_relaxed);
+    std::size_t end = pos + sizeof(header) + header.key_size + header.value_size;
+    while (_chunks.size() * kChunkSize < end) {
+        std::size_t offset = _chunks.size() * kChunkSize;
+        if (ftruncate(_fd, offset + kChunkSize) != 0) {
+            throw io_error("Failed to grow", _path);
+        }
+        void *chunk = mmap(nullptr, kChunkSize, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, offset);
+        if (chunk == MAP_FAILED) {
+            throw io_error("Failed to map", _path);
+        }
+        _chunks.push_back(static_cast<char *>(chunk));
+    }
+
+    // Header goes last: if the process dies in between, the record is zero type and ends the log.
+    // Partially written pages after power loss are caught by the checksum
+    Write(pos + sizeof(header), key.data(), header.key_size);
+    Write(pos + sizeof(header) + header.key_size, value.data(), header.value_size);
+    Write(pos, &header, sizeof(header));
+    _written.store(end, std::memory_order_relaxed);
+}
+
+// See Wal.h
+void WalWriter::Sync() { fdatasync(_fd); }
+
+// See Wal.h
+void WalWriter::Write(std::size_t pos, const void *data, std::size_t size) {
+    const char *p = static_cast<const char *>(data);
+    while (size > 0) {
+        std::size_t offset = pos % kChunkSize;
+        std::size_t n = std::min(size, kChunkSize - offset);
+        std::memcpy(_chunks[pos / kChunkSize] + offset, p, n);
+        pos += n;
+        p += n;
+        size -= n;
+    }
+}
+
+// See Wal.h
+WalReader::WalReader(const std::string &path)
+    : _data(nullptr), _size(0), _pos(sizeof(FileHeader)), _damaged(false) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw io_error("Failed to open", path);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw io_error("Failed to stat", path);
+    }
+    _size = st.st_size;
+    if (_size < sizeof(FileHeader)) {
+        close(fd);
+        throw std::runtime_error("Not a log: " + path);
+    }
+
+    void *data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw io_error("Failed to map", path);
+    }
+    _data = static_cast<const char *>(data);
+    madvise(data, _size, MADV_SEQUENTIAL);
+
+    FileHeader header;
+    std::memcpy(&header, _data, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) {
+        munmap(data, _size);
+        throw std::runtime_error("Not a log or unsupported version: " + path);
+    }
+}
+
+// See Wal.h
+WalReader::~WalReader() { munmap(const_cast<char *>(_data), _size); }
+
+// See Wal.h
+bool WalReader::Next(WalWriter::Type &type, const char *&key, std::size_t &key_size, const char *&value,
+                     std::size_t &value_size) {
+    RecordHeader header;
+    if (_damaged || _size - _pos < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, _data + _pos, sizeof(header));
+    if (header.type == 0) {
+        return false;
+    }
+
+    std::size_t size = sizeof(header) + std::size_t(header.key_size) + header.value_size;
+    if ((header.type != WalWriter::kPut && header.type != WalWriter::kDelete) || _size - _pos < size ||
+        record_crc(header, _data + _pos + sizeof(header), _data + _pos + sizeof(header) + header.key_size) !=
+            header.crc) {
+        _damaged = true;
+        return false;
+    }
+
+    type = WalWriter::Type(header.type);
+    key = _data + _pos + sizeof(header);
+    key_size = header.key_size;
+    value = key + key_size;
+    value_size = header.value_size;
+    _pos += size;
+    return true;
+}
+
+// See Wal.h
+WalStorage::WalStorage(std::shared_ptr<Afina::Storage> storage, const std::string &path,
+                       std::chrono::milliseconds sync_interval, std::size_t compact_size,
+                       std::shared_ptr<Logging::Service> logging)
+    : _storage(std::move(storage)), _path(path), _sync_interval(sync_interval), _compact_size(compact_size),
+      _logging(std::move(logging)), _open(false), _generation(0), _running(false), _replayed(0) {}
+
+// See Wal.h
+WalStorage::~WalStorage() {
+    if (_thread.joinable()) {
+        Stop();
+    }
+}
+
+// See Wal.h
+void WalStorage::Start() {
+    if (_logging) {
+        _logger = _logging->select("storage");
+    }
+    _storage->Start();
+    Recover();
+
+    auto log = std::make_shared<WalWriter>(LogPath(++_generation));
+    {
+        std::lock_guard<std::mutex> lk(_log_mutex);
+        _log = std::move(log);
+    }
+    _open.store(true);
+
+    std::lock_guard<std::mutex> lk(_mutex);
+    _running = true;
+    _thread = std::thread(&WalStorage::OnRun, this);
+}
+
+// See Wal.h
+void WalStorage::Stop() {
+    if (!_thread.joinable()) {
+        _storage->Stop();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _running = false;
+    }
+    _stopped.notify_all();
+    _thread.join();
+
+    // Writer syncs itself on destruction
+    _open.store(false);
+    {
+        std::lock_guard<std::mutex> lk(_log_mutex);
+        _log.reset();
+    }
+    _storage->Stop();
+}
+
+// See Wal.h
+bool WalStorage::Put(const std::string &key, const std::string &value) {
+    return Change(WalWriter::kPut, key, value, [&]() { return _storage->Put(key, value); });
+}
+
+// See Wal.h
+bool WalStorage::PutIfAbsent(const std::string &key, const std::string &value) {
+    return Change(WalWriter::kPut, key, value, [&]() { return _storage->PutIfAbsent(key, value); });
+}
+
+// See Wal.h
+bool WalStorage::Set(const std::string &key, const std::string &value) {
+    return Change(WalWriter::kPut, key, value, [&]() { return _storage->Set(key, value); });
+}
+
+// See Wal.h
+bool WalStorage::Delete(const std::string &key) {
+    return Change(WalWriter::kDelete, key, std::string(), [&]() { return _storage->Delete(key); });
+}
+
+// See Wal.h
+void WalStorage::Compact() {
+    std::lock_guard<std::mutex> compact_lock(_compact_mutex);
+    CompactLocked();
+}
+
+// See Wal.h
+void WalStorage::CompactLocked() {
+    auto start = std::chrono::steady_clock::now();
+    try {
+        // Changes from now on go to the new log, snapshot covers everything before it
+        std::shared_ptr<WalWriter> old;
+        {
+            std::lock_guard<std::mutex> lk(_log_mutex);
+            auto log = std::make_shared<WalWriter>(LogPath(_generation + 1));
+            _generation++;
+            old = std::move(_log);
+            _log = std::move(log);
+        }
+        old.reset();
+
+        std::size_t items = SaveSnapshot(*_storage, _path + ".snapshot");
+        for (uint64_t generation : Logs()) {
+            if (generation < _generation) {
+                unlink(LogPath(generation).c_str());
+            }
+        }
+
+        if (_logger) {
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+            _logger->warn("Compacted log into snapshot of {} items in {} ms", items, ms.count());
+        }
+    } catch (std::runtime_error &ex) {
+        if (_logger) {
+            _logger->error("Failed to compact log: {}", ex.what());
+        }
+    }
+}
+
+// See Wal.h
+std::mutex &WalStorage::StripeOf(const std::string &key) {
+    return _stripes[std::hash<std::string>()(key) % kStripes];
+}
+
+// See Wal.h
+template <typename F>
+bool WalStorage::Change(WalWriter::Type type, const std::string &key, const std::string &value, F apply) {
+    std::lock_guard<std::mutex> stripe(StripeOf(key));
+    if (!_open.load() || !apply()) {
+        return false;
+    }
+
+    // Record not logged isn't durable, but the change is already visible, so it is only reported
+    std::lock_guard<std::mutex> lk(_log_mutex);
+    try {
+        if (_log) {
+            _log->Append(type, key, value);
+        }
+    } catch (std::runtime_error &ex) {
+        if (_logger) {
+            _logger->error("Failed to log change: {}", ex.what());
+        }
+    }
+    return true;
+}
+
+// See Wal.h
+std::string WalStorage::LogPath(uint64_t generation) const { return _path + "." + std::to_string(generation); }
+
+// See Wal.h
+std::vector<uint64_t> WalStorage::Logs() const {
+    std::size_t slash = _path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : _path.substr(0, slash + 1);
+    std::string prefix = (slash == std::string::npos ? _path : _path.substr(slash + 1)) + ".";
+
+    std::vector<uint64_t> result;
+    DIR *d = opendir(dir.c_str());
+    if (d == nullptr) {
+        return result;
+    }
+    for (struct dirent *entry = readdir(d); entry != nullptr; entry = readdir(d)) {
+        std::string name = entry->d_name;
+        if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0 &&
+            name.find_first_not_of("0123456789", prefix.size()) == std::string::npos) {
+            result.push_back(std::stoull(name.substr(prefix.size())));
+        }
+    }
+    closedir(d);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+// See Wal.h
+void WalStorage::Recover() {
+    auto start = std::chrono::steady_clock::now();
+    std::size_t restored = 0;
+    _replayed = 0;
+
+    const char *key, *value;
+    std::size_t key_size, value_size;
+    std::string snapshot = _path + ".snapshot";
+    if (access(snapshot.c_str(), F_OK) == 0) {
+        SnapshotReader reader(snapshot);
+        while (reader.Next(key, key_size, value, value_size)) {
+            restored += _storage->Restore(std::string(key, key_size), std::string(value, value_size));
+        }
+        if (reader.Damaged() && _logger) {
+            _logger->error("Snapshot {} is damaged, loaded items before damaged block", snapshot);
+        }
+    }
+
+    // Logs older than the snapshot could be left if compaction was interrupted, replaying them is harmless
+    std::vector<uint64_t> logs = Logs();
+    for (uint64_t generation : logs) {
+        _generation = std::max(_generation, generation);
+        try {
+            WalReader reader(LogPath(generation));
+            WalWriter::Type type;
+            while (reader.Next(type, key, key_size, value, value_size)) {
+                if (type == WalWriter::kPut) {
+                    _storage->Put(std::string(key, key_size), std::string(value, value_size));
+                } else {
+                    _storage->Delete(std::string(key, key_size));
+                }
+                _replayed++;
+            }
+            if (reader.Damaged() && _logger) {
+                _logger->warn("Log {} ends with damaged record, it was being written on crash", LogPath(generation));
+            }
+        } catch (std::runtime_error &ex) {
+            // Log created right before crash could have no header yet
+            if (_logger) {
+                _logger->error("Failed to replay log: {}", ex.what());
+            }
+        }
+    }
+
+    if (_logger) {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        _logger->warn("Recovered {} items from snapshot and {} records from {} logs in {} ms", restored, _replayed,
+                      logs.size(), ms.count());
+    }
+}
+
+// See Wal.h
+void WalStorage::OnRun() {
+    // Replayed logs are folded into the snapshot right away, so the next start doesn't replay them again
+    if (Logs().size() > 1) {
+        Compact();
+    }
+
+    std::unique_lock<std::mutex> lk(_mutex);
+    while (!_stopped.wait_for(lk, _sync_interval, [this]() { return !_running; })) {
+        lk.unlock();
+        std::shared_ptr<WalWriter> log;
+        {
+            std::lock_guard<std::mutex> log_lock(_log_mutex);
+            log = _log;
+        }
+
+        // Group commit: one sync covers every change logged since the previous one
+        log->Sync();
+        if (log->Size() >= _compact_size) {
+            // Explicit compaction could have started new log meanwhile, that one is not full
+            std::lock_guard<std::mutex> compact_lock(_compact_mutex);
+            bool same;
+            {
+                std::lock_guard<std::mutex> log_lock(_log_mutex);
+                same = _log == log;
+            }
+            if (same) {
+                CompactLocked();
+            }
+        }
+        lk.lock();
+    }
+}
+
+} // namespace Backend
+} // namespace Afina
@@ -0,0 +1,220 @@
+#ifndef AFINA_STORAGE_WAL_H
+#define AFINA_STORAGE_WAL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <afina/Storage.h>
+
+namespace spdlog {
+class logger;
+}
+
+namespace Afina {
+namespace Logging {
+class Service;
+}
+
+namespace Backend {
+
+/**
+ * # Write-ahead log file writer
+ * File is a header followed by records: crc, type, key size, value size, all uint32, then key and
+ * value bytes. Checksum covers everything after itself, so torn record at the end is detected. File
+ * grows by chunks, each chunk is mapped on its own and records are copied there, so appending is a
+ * memcpy, no system call. Unwritten tail of the file is zeros, zero type marks the end.
+ *
+ * Append is not thread safe, Sync could be called concurrently with it: it only flushes pages of
+ * the file to disk
+ */
+class WalWriter {
+public:
+    enum Type : uint32_t { kPut = 1, kDelete = 2 };
+
+    /**
+     * Create new log file, throws std::runtime_error on failure
+     */
+    explicit WalWriter(const std::string &path);
+
+    // Flushes and truncates file to the written records
+    ~WalWriter();
+
+    /**
+     * Append one record, value is ignored for kDelete. Throws std::runtime_error if file can't grow
+     */
+    void Append(Type type, const std::string &key, const std::string &value);
+
+    /**
+     * Write records appended so far to disk, blocks for fdatasync
+     */
+    void Sync();
+
+    // Bytes written including header
+    std::size_t Size() const { return _written.load(std::memory_order_relaxed); }
+
+private:
+    WalWriter(const WalWriter &) = delete;
+    WalWriter &operator=(const WalWriter &) = delete;
+
+    // Copy bytes to the given file position, mapped chunks must cover it
+    void Write(std::size_t pos, const void *data, std::size_t size);
+
+    std::string _path;
+    int _fd;
+    std::vector<char *> _chunks;
+    std::atomic<std::size_t> _written;
+};
+
+/**
+ * # Write-ahead log file reader
+ * File is mapped and records are taken one by one. Reading stops at the end marker, at the end of
+ * file or at a damaged record: the one being written when the process died
+ */
+class WalReader {
+public:
+    /**
+     * Map the file, throws std::runtime_error if it can't be mapped or isn't a log
+     */
+    explicit WalReader(const std::string &path);
+    ~WalReader();
+
+    /**
+     * Take next record, pointers are valid while the reader lives. Returns false at the end
+     */
+    bool Next(WalWriter::Type &type, const char *&key, std::size_t &key_size, const char *&value,
+              std::size_t &value_size);
+
+    // Whether reading stopped at damaged record
+    bool Damaged() const { return _damaged; }
+
+private:
+    WalReader(const WalReader &) = delete;
+    WalReader &operator=(const WalReader &) = delete;
+
+    const char *_data;
+    std::size_t _size;
+    std::size_t _pos;
+    bool _damaged;
+};
+
+/**
+ * # Durable storage
+ * Wraps storage and writes every successful change to the log: path.N, where N is the log generation.
+ * Change is applied first and logged right after under the lock of the key stripe, so log order of
+ * changes of one key matches their order in the storage. Append to the log is a copy to the mapped
+ * file, background thread syncs it to disk every interval, so client threads never wait for disk,
+ * and change is durable once the next sync is done.
+ *
+ * Once the log grows over the compaction size, background thread starts new log, saves whole
+ * storage to the snapshot file path.snapshot and removes older logs. Changes made while snapshot is
+ * saved are in the new log, replaying them over the snapshot gives the same state. Start loads the
+ * snapshot and replays all logs left, so startup time is bounded by the compaction size.
+ *
+ * Evictions are not logged: items evicted before restart could come back after it
+ */
+class WalStorage : public Afina::Storage {
+public:
+    /**
+     * @param storage to be wrapped, must be thread safe and support Visit
+     * @param path prefix of the log and snapshot files
+     * @param sync_interval between syncs of the log
+     * @param compact_size log size to start compaction at
+     * @param logging service to report recovery and compaction, could be null
+     */
+    WalStorage(std::shared_ptr<Afina::Storage> storage, const std::string &path,
+               std::chrono::milliseconds sync_interval = std::chrono::milliseconds(10),
+               std::size_t compact_size = 64 << 20, std::shared_ptr<Logging::Service> logging = nullptr);
+    ~WalStorage();
+
+    // Starts wrapped storage, recovers it from files and starts background thread
+    void Start() override;
+
+    // Syncs the log and stops wrapped storage
+    void Stop() override;
+
+    // see SimpleLRU.h
+    bool Put(const std::string &key, const std::string &value) override;
+
+    // see SimpleLRU.h
+    bool PutIfAbsent(const std::string &key, const std::string &value) override;
+
+    // see SimpleLRU.h
+    bool Set(const std::string &key, const std::string &value) override;
+
+    // see SimpleLRU.h
+    bool Delete(const std::string &key) override;
+
+    // see SimpleLRU.h
+    bool Get(const std::string &key, std::string &value) override { return _storage->Get(key, value); }
+
+    // see SimpleLRU.h
+    bool Visit(const Visitor &visitor) override { return _storage->Visit(visitor); }
+
+    // Start new log and save snapshot, blocks until it is done
+    void Compact();
+
+    // Records replayed from the logs by the last Start
+    std::size_t Replayed() const { return _replayed; }
+
+private:
+    // Changes of keys in one stripe are applied and logged in the same order
+    static constexpr std::size_t kStripes = 64;
+
+    std::mutex &StripeOf(const std::string &key);
+
+    // Apply change to the storage and log it if it succeeded
+    template <typename F> bool Change(WalWriter::Type type, const std::string &key, const std::string &value, F apply);
+
+    std::string LogPath(uint64_t generation) const;
+
+    // Generations of log files present, ascending
+    std::vector<uint64_t> Logs() const;
+
+    void Recover();
+
+    // Compaction itself, compaction mutex is held
+    void CompactLocked();
+
+    // Background thread: syncs log and compacts it
+    void OnRun();
+
+    std::shared_ptr<Afina::Storage> _storage;
+    std::string _path;
+    std::chrono::milliseconds _sync_interval;
+    std::size_t _compact_size;
+    std::shared_ptr<Logging::Service> _logging;
+    std::shared_ptr<spdlog::logger> _logger;
+
+    std::mutex _stripes[kStripes];
+
+    // Changes are accepted between Start and Stop only, otherwise they would be lost
+    std::atomic<bool> _open;
+
+    // Current log, swapped by compaction
+    std::mutex _log_mutex;
+    std::shared_ptr<WalWriter> _log;
+    uint64_t _generation;
+
+    // Only one compaction at a time
+    std::mutex _compact_mutex;
+
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _stopped;
+    bool _running;
+
+    std::size_t _replayed;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_WAL_H
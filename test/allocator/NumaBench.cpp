@@ -0,0 +1,113 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <afina/allocator/Slab.h>
+#include <afina/concurrency/Topology.h>
+
+/**
+ * Placement of storage memory on NUMA machine. Each worker owns a shard: a slab arena filled with
+ * items, then reads and rewrites random items of it. Workers are pinned to nodes round robin, arenas
+ * are either filled by the main thread, so first touch puts all pages on its node, or bound to the
+ * node of the worker owning them. Reports operations per second and share of pages that are on a
+ * different node than the worker using them
+ *
+ * Usage: benchNumaPlacement [operations per worker] [workers] [items per worker]
+ */
+namespace {
+
+using Afina::Allocator::Slab;
+using Afina::Concurrency::Topology;
+
+constexpr std::size_t kItemSize = 256;
+
+struct Shard {
+    std::unique_ptr<Slab> slab;
+    std::vector<char *> items;
+};
+
+void fill(Shard &shard, std::size_t items, int node) {
+    shard.slab.reset(new Slab(items * kItemSize * 2, 1 << 20, 1.25, 16, node));
+    for (std::size_t i = 0; i < items; i++) {
+        char *item = static_cast<char *>(shard.slab->alloc(kItemSize));
+        std::memset(item, int(i), kItemSize);
+        shard.items.push_back(item);
+    }
+}
+
+double remote_share(const Topology &topology, const std::vector<Shard> &shards) {
+    std::size_t remote = 0, total = 0;
+    for (std::size_t w = 0; w < shards.size(); w++) {
+        for (std::size_t i = 0; i < shards[w].items.size(); i += 16) {
+            int node = topology.NodeOfPage(shards[w].items[i]);
+            remote += node >= 0 && std::size_t(node) != w % topology.Nodes();
+            total++;
+        }
+    }
+    return total == 0 ? 0.0 : double(remote) / total;
+}
+
+void run(const char *name, bool bound, long operations, std::size_t workers, std::size_t items) {
+    const Topology &topology = Topology::System();
+    std::vector<Shard> shards(workers);
+
+    // First touch: main thread fills every shard, pages end up on its node
+    if (!bound) {
+        for (auto &shard : shards) {
+            fill(shard, items, Slab::kAnyNode);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t w = 0; w < workers; w++) {
+        threads.emplace_back([&, w]() {
+            std::size_t node = w % topology.Nodes();
+            topology.BindThread(node);
+            if (bound) {
+                fill(shards[w], items, node);
+            }
+
+            char buffer[kItemSize];
+            unsigned seed = w + 1;
+            for (long i = 0; i < operations; i++) {
+                char *item = shards[w].items[rand_r(&seed) % items];
+                if (i % 4 == 0) {
+                    std::memset(item, int(i), kItemSize);
+                } else {
+                    std::memcpy(buffer, item, kItemSize);
+                }
+            }
+            asm volatile("" : : "r"(buffer) : "memory");
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << name << "\t" << workers * operations / seconds / 1e6 << " Mops/s\tremote pages "
+              << 100 * remote_share(topology, shards) << "%" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    long operations = argc > 1 ? std::atol(argv[1]) : 10000000;
+    std::size_t workers = argc > 2 ? std::atol(argv[2]) : std::max(2u, std::thread::hardware_concurrency());
+    std::size_t items = argc > 3 ? std::atol(argv[3]) : 1 << 16;
+
+    const Topology &topology = Topology::System();
+    std::cout << topology.dump();
+    if (topology.Nodes() < 2) {
+        std::cout << "single NUMA node, both placements are local" << std::endl;
+    }
+
+    run("first touch", false, operations, workers, items);
+    run("node bound", true, operations, workers, items);
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "gtest/gtest.h"
+#include <cstdlib>
 #include <iostream>
 #include <set>
 #include <vector>
@@ -28,7 +29,7 @@ TEST(SimpleTest, AllocInRange) {
 static void writeTo(Pointer &p, size_t size) {
     char *v = reinterpret_cast<char *>(p.get());
 
-    for (int i = 0; i < size; i++) {
+    for (size_t i = 0; i < size; i++) {
         v[i] = i % 31;
     }
 }
@@ -36,8 +37,8 @@ static void writeTo(Pointer &p, size_t size) {
 static bool isDataOk(Pointer &p, size_t size) {
     char *v = reinterpret_cast<char *>(p.get());
 
-    for (int i = 0; i < size; i++) {
-        if (v[i] != i % 31) {
+    for (size_t i = 0; i < size; i++) {
+        if (v[i] != char(i % 31)) {
             return false;
         }
     }
@@ -322,3 +323,122 @@ TEST(SimpleTest, ReallocGrow) {
     a.free(p);
     a.free(p2);
 }
+
+TEST(SimpleTest, InvalidFree) {
+    Simple a(buf, sizeof(buf));
+
+    Pointer p = a.alloc(100);
+    Pointer copy = p;
+    a.free(p);
+    EXPECT_EQ(p.get(), nullptr);
+
+    try {
+        a.free(copy);
+        FAIL() << "Double free was not detected";
+    } catch (AllocError &e) {
+        EXPECT_EQ(e.getType(), AllocErrorType::InvalidFree);
+    }
+}
+
+TEST(SimpleTest, RandomOps) {
+    Simple a(buf, sizeof(buf));
+    vector<pair<Pointer, size_t>> live;
+
+    srand(42);
+    for (int i = 0; i < 20000; i++) {
+        int op = rand() % 4;
+        if (op == 0 && !live.empty()) {
+            size_t at = rand() % live.size();
+            EXPECT_TRUE(isDataOk(live[at].first, live[at].second));
+            a.free(live[at].first);
+            live.erase(live.begin() + at);
+        } else if (op == 1 && !live.empty()) {
+            size_t at = rand() % live.size();
+            size_t size = 1 + rand() % 1000;
+            try {
+                a.realloc(live[at].first, size);
+                live[at].second = min(size, live[at].second);
+                EXPECT_TRUE(isDataOk(live[at].first, live[at].second));
+                writeTo(live[at].first, size);
+                live[at].second = size;
+            } catch (AllocError &e) {
+                EXPECT_EQ(e.getType(), AllocErrorType::NoMemory);
+            }
+        } else if (op == 2 && i % 16 == 0) {
+            a.defrag();
+        } else {
+            size_t size = 1 + rand() % 1000;
+            try {
+                live.emplace_back(a.alloc(size), size);
+                writeTo(live.back().first, size);
+            } catch (AllocError &e) {
+                EXPECT_EQ(e.getType(), AllocErrorType::NoMemory);
+            }
+        }
+    }
+
+    for (auto &p : live) {
+        EXPECT_TRUE(isDataOk(p.first, p.second));
+    }
+}
+
+TEST(SimpleTest, DefragStepBounded) {
+    Simple a(buf, sizeof(buf));
+
+    int size = 135;
+    vector<Pointer> ptrs;
+    ASSERT_TRUE(fillUp(a, size, ptrs));
+    for (size_t i = 0; i < ptrs.size(); i += 2) {
+        a.free(ptrs[i]);
+    }
+    EXPECT_GT(a.stats().fragmentation, 0.9);
+
+    int steps = 0;
+    while (!a.defrag_step(4 * size)) {
+        steps++;
+        EXPECT_LE(a.stats().moved, size_t(steps) * 5 * size);
+    }
+    EXPECT_GT(steps, 10);
+    EXPECT_EQ(a.stats().free_blocks, 0);
+    EXPECT_EQ(a.stats().fragmentation, 0.0);
+
+    for (size_t i = 1; i < ptrs.size(); i += 2) {
+        EXPECT_TRUE(isDataOk(ptrs[i], size));
+    }
+    Pointer big = a.alloc(size * ptrs.size() / 3);
+    EXPECT_NE(big.get(), nullptr);
+}
+
+TEST(SimpleTest, DefragStepInterleaved) {
+    Simple a(buf, sizeof(buf));
+
+    vector<pair<Pointer, size_t>> live;
+    srand(7);
+    for (int i = 0; i < 20000; i++) {
+        if (i % 8 == 0) {
+            a.defrag_step(rand() % 512, chrono::microseconds(rand() % 4));
+        } else if (rand() % 2 == 0 && !live.empty()) {
+            size_t at = rand() % live.size();
+            EXPECT_TRUE(isDataOk(live[at].first, live[at].second));
+            a.free(live[at].first);
+            live.erase(live.begin() + at);
+        } else {
+            size_t size = 1 + rand() % 700;
+            try {
+                live.emplace_back(a.alloc(size), size);
+                writeTo(live.back().first, size);
+            } catch (AllocError &e) {
+                EXPECT_EQ(e.getType(), AllocErrorType::NoMemory);
+            }
+        }
+    }
+
+    while (!a.defrag_step(1024)) {
+    }
+    Simple::Stats stats = a.stats();
+    EXPECT_EQ(stats.free_blocks, 0);
+    EXPECT_EQ(stats.used_blocks, live.size());
+    for (auto &p : live) {
+        EXPECT_TRUE(isDataOk(p.first, p.second));
+    }
+}
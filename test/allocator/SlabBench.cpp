@@ -0,0 +1,123 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <malloc.h>
+
+#include <afina/allocator/Slab.h>
+
+/**
+ * Slab allocator compared with malloc on cache items churn. Item sizes follow log-uniform distribution
+ * from 64 bytes to 16KB, like keys with mostly small values and some big ones. Each thread keeps its
+ * own working set of items and replaces random ones with items of random size, so memory gets
+ * fragmented over time. Reports alloc+free pairs per second and memory held by allocator relative to
+ * live requested bytes
+ *
+ * Usage: benchSlabAllocator [operations] [threads] [working set items per thread]
+ */
+namespace {
+
+struct Result {
+    double rate;
+    double live;
+    double held;
+};
+
+std::size_t item_size(unsigned &seed) {
+    seed = seed * 1103515245 + 12345;
+    double r = double((seed >> 8) & 0xffff) / 0x10000;
+    return std::size_t(64 * std::pow(256.0, r));
+}
+
+// Memory is measured with all working sets alive, they are released after that
+template <typename Alloc, typename Free, typename Held>
+Result run(Alloc alloc, Free free, Held held, long operations, int threads, std::size_t items) {
+    std::vector<std::vector<void *>> objects(threads, std::vector<void *>(items));
+    std::vector<std::vector<std::size_t>> sizes(threads, std::vector<std::size_t>(items));
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            unsigned seed = t + 1;
+            for (std::size_t i = 0; i < items; i++) {
+                sizes[t][i] = item_size(seed);
+                objects[t][i] = alloc(sizes[t][i]);
+                std::memset(objects[t][i], 0, 16);
+            }
+            for (long i = 0; i < operations / threads; i++) {
+                seed = seed * 1103515245 + 12345;
+                std::size_t k = (seed >> 4) % items;
+                free(objects[t][k]);
+                sizes[t][k] = item_size(seed);
+                objects[t][k] = alloc(sizes[t][k]);
+                std::memset(objects[t][k], 0, 16);
+            }
+        });
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    Result result;
+    result.rate = operations / std::chrono::duration<double>(end - start).count();
+    result.live = 0;
+    for (int t = 0; t < threads; t++) {
+        for (std::size_t i = 0; i < items; i++) {
+            result.live += sizes[t][i];
+        }
+    }
+    result.held = held();
+
+    for (auto &set : objects) {
+        for (void *p : set) {
+            free(p);
+        }
+    }
+    return result;
+}
+
+void report(const char *name, const Result &r) {
+    std::cout << name << "\t\t" << r.rate << "\t" << r.live / 1e6 << "\t" << r.held / 1e6 << "\t" << r.held / r.live
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    long operations = 2000000;
+    int threads = std::thread::hardware_concurrency();
+    std::size_t items = 20000;
+    if (argc > 1) {
+        operations = std::atol(argv[1]);
+    }
+    if (argc > 2) {
+        threads = std::atoi(argv[2]);
+    }
+    if (argc > 3) {
+        items = std::atol(argv[3]);
+    }
+    if (threads <= 0) {
+        threads = 1;
+    }
+
+    std::cout << "operations: " << operations << ", threads: " << threads << ", items per thread: " << items
+              << std::endl;
+    std::cout << "allocator\talloc+free/s\tlive MB\theld MB\theld/live" << std::endl;
+    report("malloc", run([](std::size_t n) { return std::malloc(n); }, [](void *p) { std::free(p); },
+                         []() {
+                             struct mallinfo2 info = mallinfo2();
+                             return double(info.arena + info.hblkhd);
+                         },
+                         operations, threads, items));
+
+    Afina::Allocator::Slab slab(std::size_t(threads) * items * 16384);
+    report("slab", run([&slab](std::size_t n) { return slab.alloc(n); }, [&slab](void *p) { slab.free(p); },
+                       [&slab]() { return double(slab.used()); }, operations, threads, items));
+    return 0;
+}
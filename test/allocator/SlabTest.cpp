@@ -0,0 +1,176 @@
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <afina/allocator/Error.h>
+#include <afina/allocator/Slab.h>
+#include <afina/allocator/StlAllocator.h>
+
+using namespace Afina::Allocator;
+
+TEST(SlabTest, SizeClasses) {
+    Slab slab(1 << 20, 1 << 16, 1.25, 16);
+
+    ASSERT_EQ(16, slab.footprint(1));
+    ASSERT_EQ(16, slab.footprint(16));
+    ASSERT_EQ(24, slab.footprint(17));
+    ASSERT_EQ(0, slab.footprint(slab.max_size() + 1));
+
+    // Waste is bounded by the factor
+    for (std::size_t n = 16; n <= slab.max_size(); n += 7) {
+        ASSERT_GE(slab.footprint(n), n);
+        ASSERT_LE(slab.footprint(n), n * 1.25 + 8) << n;
+    }
+}
+
+TEST(SlabTest, AllocWriteFree) {
+    Slab slab(1 << 20, 1 << 16);
+
+    std::vector<char *> objects;
+    std::set<char *> unique;
+    for (std::size_t i = 0; i < 1000; i++) {
+        std::size_t size = 1 + i % 300;
+        char *p = static_cast<char *>(slab.alloc(size));
+        ASSERT_EQ(0, reinterpret_cast<uintptr_t>(p) % 8);
+        std::memset(p, int(i % 127), size);
+        objects.push_back(p);
+        ASSERT_TRUE(unique.insert(p).second);
+    }
+
+    for (std::size_t i = 0; i < objects.size(); i++) {
+        std::size_t size = 1 + i % 300;
+        for (std::size_t j = 0; j < size; j++) {
+            ASSERT_EQ(char(i % 127), objects[i][j]);
+        }
+        slab.free(objects[i]);
+    }
+
+    // Everything is back, slabs are returned to arena except one cached per class
+    slab.flush();
+    ASSERT_LE(slab.used(), slab.capacity());
+}
+
+TEST(SlabTest, ArenaIsBounded) {
+    Slab slab(1 << 18, 1 << 16);
+
+    std::vector<void *> objects;
+    try {
+        for (;;) {
+            objects.push_back(slab.alloc(1000));
+        }
+    } catch (AllocError &e) {
+        ASSERT_EQ(AllocErrorType::NoMemory, e.getType());
+    }
+    ASSERT_EQ(slab.capacity(), slab.used());
+    ASSERT_GE(objects.size() * slab.footprint(1000), slab.capacity() * 9 / 10);
+
+    // Freed slabs go to other class
+    for (void *p : objects) {
+        slab.free(p);
+    }
+    slab.flush();
+    void *big = slab.alloc(30000);
+    slab.free(big);
+
+    ASSERT_THROW(slab.alloc(1 << 16), AllocError);
+}
+
+TEST(SlabTest, CrossThreadFree) {
+    Slab slab(1 << 26, 1 << 16);
+
+    const int threads = 4, iterations = 20000;
+    std::vector<std::vector<void *>> allocated(threads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&slab, &allocated, t, iterations]() {
+            for (int i = 0; i < iterations; i++) {
+                void *p = slab.alloc(8 + (i * 13) % 500);
+                if (i % 2 == 0) {
+                    slab.free(p);
+                } else {
+                    allocated[t].push_back(p);
+                }
+            }
+        });
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    // Objects of exited threads are freed by main one
+    for (auto &objects : allocated) {
+        for (void *p : objects) {
+            slab.free(p);
+        }
+    }
+    slab.flush();
+
+    // Only one empty slab per class is kept
+    ASSERT_LE(slab.used(), 64 * (1 << 16));
+}
+
+TEST(SlabTest, StlContainer) {
+    Slab slab(1 << 18, 1 << 16);
+
+    using Map = std::map<int, long, std::less<int>, StlAllocator<std::pair<const int, long>>>;
+    {
+        Map map{Map::allocator_type(&slab)};
+        int i = 0;
+        try {
+            for (;; i++) {
+                map.emplace(i, i * 2);
+            }
+        } catch (std::bad_alloc &) {
+        }
+        ASSERT_EQ(i, map.size());
+        ASSERT_EQ(slab.capacity(), slab.used());
+
+        // Arena exhaustion doesn't break container
+        map.erase(map.begin());
+        map.emplace(i, i * 2);
+        for (auto &kv : map) {
+            ASSERT_EQ(kv.first * 2, kv.second);
+        }
+
+        StlAllocator<char> rebound(map.get_allocator());
+        ASSERT_TRUE(rebound == map.get_allocator());
+        ASSERT_TRUE(rebound != StlAllocator<char>());
+    }
+
+    slab.flush();
+    ASSERT_EQ(0, slab.used());
+
+    // No slab means heap
+    std::vector<int, StlAllocator<int>> heap(1000, 1);
+    ASSERT_EQ(nullptr, heap.get_allocator().slab());
+}
+
+TEST(SlabTest, HugePages) {
+    Slab regular(1 << 22);
+    ASSERT_EQ(Slab::Pages::kRegular, regular.pages());
+    ASSERT_EQ(0, regular.huge_bytes());
+
+    // Explicit pages need reserved pool, without it arena falls back to transparent ones
+    for (Slab::Pages pages : {Slab::Pages::kTransparent, Slab::Pages::kHuge2M}) {
+        Slab slab(1 << 22, 1 << 20, 1.25, 16, Slab::kAnyNode, pages);
+        ASSERT_NE(Slab::Pages::kRegular, slab.pages());
+
+        std::vector<char *> objects;
+        for (int i = 0; i < 10000; i++) {
+            objects.push_back(static_cast<char *>(slab.alloc(256)));
+            std::memset(objects.back(), i, 256);
+        }
+        ASSERT_LE(slab.huge_bytes(), slab.capacity() + (1 << 21));
+        if (slab.pages() == Slab::Pages::kHuge2M) {
+            ASSERT_LE(slab.capacity(), slab.huge_bytes());
+        }
+        for (char *p : objects) {
+            slab.free(p);
+        }
+    }
+}
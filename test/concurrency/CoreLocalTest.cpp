@@ -0,0 +1,55 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <afina/concurrency/CoreLocal.h>
+
+using Afina::Concurrency::CoreLocal;
+using Afina::Concurrency::CurrentCpu;
+
+TEST(CoreLocalTest, SlotsArePadded) {
+    CoreLocal<std::atomic<uint64_t>> counters(4);
+    ASSERT_EQ(4, counters.Size());
+    for (std::size_t i = 0; i < counters.Size(); i++) {
+        ASSERT_EQ(0, counters[i].load());
+        ASSERT_EQ(0, reinterpret_cast<uintptr_t>(&counters[i]) % 64);
+    }
+    ASSERT_GE(reinterpret_cast<char *>(&counters[1]) - reinterpret_cast<char *>(&counters[0]), 64);
+}
+
+TEST(CoreLocalTest, LocalMatchesCpu) {
+    CoreLocal<int> slots;
+    ASSERT_GT(slots.Size(), 0);
+
+    // Thread could migrate between two calls, but not every time
+    bool same = false;
+    for (int i = 0; i < 100 && !same; i++) {
+        same = &slots.Local() == &slots[CurrentCpu() % slots.Size()];
+    }
+    ASSERT_TRUE(same);
+}
+
+TEST(CoreLocalTest, ConcurrentFold) {
+    CoreLocal<std::atomic<uint64_t>> counters;
+    const int threads = 4, iterations = 100000;
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&counters, iterations]() {
+            for (int i = 0; i < iterations; i++) {
+                counters.Local().fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    uint64_t total = counters.Fold(uint64_t(0), [](uint64_t sum, const std::atomic<uint64_t> &value) {
+        return sum + value.load(std::memory_order_relaxed);
+    });
+    ASSERT_EQ(uint64_t(threads) * iterations, total);
+}
@@ -0,0 +1,110 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include <afina/concurrency/Executor.h>
+#include <afina/concurrency/WorkStealingExecutor.h>
+
+/**
+ * Task throughput of thread pools: tiny tasks incrementing counter are either submitted by the single
+ * external thread or spawned recursively by tasks themselves. Work stealing pool is measured both with
+ * and without per task timings
+ *
+ * Usage: benchExecutorThroughput [tasks] [threads]
+ */
+namespace {
+
+std::atomic<long> counter(0);
+
+void tiny() { counter++; }
+
+template <typename E> void fork(E &executor, int depth) {
+    counter++;
+    for (int i = 0; depth > 0 && i < 2; i++) {
+        // Pool threads must not wait for the queue they are supposed to drain
+        if (!executor.Execute(fork<E>, std::ref(executor), depth - 1)) {
+            fork(executor, depth - 1);
+        }
+    }
+}
+
+// Executor has no timings to turn off
+void configure(Afina::Concurrency::Executor &, bool) {}
+void configure(Afina::Concurrency::WorkStealingExecutor &executor, bool timings) { executor.EnableTimings(timings); }
+
+template <typename E> double external(long tasks, std::size_t threads, bool timings = false) {
+    E executor("bench", threads, threads, 4096, 1000);
+    configure(executor, timings);
+    executor.Start();
+    counter = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < tasks; i++) {
+        while (!executor.Execute(tiny)) {
+            std::this_thread::yield();
+        }
+    }
+    while (counter.load() < tasks) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    executor.Stop(true);
+    return tasks / std::chrono::duration<double>(end - start).count();
+}
+
+template <typename E> double nested(long tasks, std::size_t threads, bool timings = false) {
+    int depth = 0;
+    while ((2L << (depth + 1)) - 1 <= tasks) {
+        depth++;
+    }
+    long total = (2L << depth) - 1;
+
+    // Queue is big enough for every task to go through the pool rather than be run by the caller
+    E executor("bench", threads, threads, total, 1000);
+    configure(executor, timings);
+    executor.Start();
+    counter = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    executor.Execute(fork<E>, std::ref(executor), int(depth));
+    while (counter.load() < total) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    executor.Stop(true);
+    return total / std::chrono::duration<double>(end - start).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    long tasks = 1000000;
+    if (argc > 1) {
+        tasks = std::atol(argv[1]);
+    }
+
+    std::size_t threads = std::thread::hardware_concurrency();
+    if (argc > 2) {
+        threads = std::atol(argv[2]);
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    using Afina::Concurrency::Executor;
+    using Afina::Concurrency::WorkStealingExecutor;
+
+    std::cout << "tasks: " << tasks << ", threads: " << threads << std::endl;
+    std::cout << "scenario\tExecutor tasks/s\tWorkStealingExecutor tasks/s\twith timings" << std::endl;
+    std::cout << "external\t" << external<Executor>(tasks, threads) << "\t\t"
+              << external<WorkStealingExecutor>(tasks, threads) << "\t\t\t"
+              << external<WorkStealingExecutor>(tasks, threads, true) << std::endl;
+    std::cout << "nested\t\t" << nested<Executor>(tasks, threads) << "\t\t"
+              << nested<WorkStealingExecutor>(tasks, threads) << "\t\t\t"
+              << nested<WorkStealingExecutor>(tasks, threads, true) << std::endl;
+    return 0;
+}
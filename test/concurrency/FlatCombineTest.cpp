@@ -0,0 +1,120 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <afina/concurrency/FlatCombine.h>
+
+using Afina::Concurrency::FlatCombine;
+
+namespace {
+
+struct Add {
+    long delta;
+    long result;
+};
+
+} // namespace
+
+TEST(FlatCombineTest, SingleThread) {
+    long value = 0;
+    FlatCombine<Add> combiner([&value](Add *const *batch, std::size_t size) {
+        for (std::size_t i = 0; i < size; i++) {
+            value += batch[i]->delta;
+            batch[i]->result = value;
+        }
+    });
+
+    for (long i = 1; i <= 10; i++) {
+        Add op{i, 0};
+        combiner.Apply(op);
+        ASSERT_EQ(i * (i + 1) / 2, op.result);
+    }
+    ASSERT_EQ(10, combiner.Combined());
+}
+
+TEST(FlatCombineTest, ConcurrentApply) {
+    // Plain variable, combiner is the only one who touches it
+    long value = 0;
+    FlatCombine<Add> combiner(
+        [&value](Add *const *batch, std::size_t size) {
+            for (std::size_t i = 0; i < size; i++) {
+                value += batch[i]->delta;
+                batch[i]->result = value;
+            }
+        },
+        4);
+
+    // More threads than records, so some of them wait for free record
+    const int threads = 8, iterations = 20000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&combiner, iterations]() {
+            long last = 0;
+            for (int i = 0; i < iterations; i++) {
+                Add op{1, 0};
+                combiner.Apply(op);
+                ASSERT_GT(op.result, last);
+                last = op.result;
+            }
+        });
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    ASSERT_EQ(long(threads) * iterations, value);
+    ASSERT_EQ(std::size_t(threads) * iterations, combiner.Combined());
+    ASSERT_LE(combiner.Batches(), combiner.Combined());
+}
+
+TEST(FlatCombineTest, CombinerThrows) {
+    // Operation with negative delta fails the whole batch
+    long value = 0;
+    FlatCombine<Add> combiner(
+        [&value](Add *const *batch, std::size_t size) {
+            for (std::size_t i = 0; i < size; i++) {
+                if (batch[i]->delta < 0) {
+                    throw std::runtime_error("negative delta");
+                }
+            }
+            for (std::size_t i = 0; i < size; i++) {
+                value += batch[i]->delta;
+                batch[i]->result = value;
+            }
+        },
+        4);
+
+    Add bad{-1, 0};
+    ASSERT_THROW(combiner.Apply(bad), std::runtime_error);
+
+    // Neither the lock nor records of the failed batches are left behind
+    const int threads = 8, iterations = 20000;
+    std::atomic<long> applied(0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&combiner, &applied, iterations]() {
+            for (int i = 0; i < iterations; i++) {
+                Add op{i % 100 == 0 ? -1 : 1, 0};
+                try {
+                    combiner.Apply(op);
+                    ASSERT_EQ(1, op.delta);
+                    applied++;
+                } catch (std::runtime_error &) {
+                }
+            }
+        });
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+    ASSERT_EQ(applied.load(), value);
+    ASSERT_LT(long(threads) * iterations * 9 / 10, value);
+
+    Add good{1, 0};
+    combiner.Apply(good);
+    ASSERT_EQ(value, good.result);
+}
@@ -0,0 +1,65 @@
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <afina/concurrency/Histogram.h>
+
+using Afina::Concurrency::Histogram;
+
+TEST(HistogramTest, Empty) {
+    Histogram h;
+    ASSERT_EQ(0, h.Count());
+    ASSERT_EQ(0, h.Percentile(99));
+    ASSERT_EQ(0.0, h.Mean());
+}
+
+TEST(HistogramTest, SmallValuesAreExact) {
+    Histogram h;
+    for (uint64_t v = 1; v <= 100; v++) {
+        h.Record(v);
+    }
+    ASSERT_EQ(100, h.Count());
+    ASSERT_EQ(50, h.Percentile(50));
+    ASSERT_EQ(99, h.Percentile(99));
+    ASSERT_EQ(100, h.Max());
+    ASSERT_DOUBLE_EQ(50.5, h.Mean());
+}
+
+TEST(HistogramTest, RelativeError) {
+    Histogram h;
+    for (uint64_t v = 1000; v < (uint64_t(1) << 34); v = v * 3 / 2) {
+        h.Reset();
+        h.Record(v);
+        uint64_t got = h.Percentile(100);
+        ASSERT_GE(got, v);
+        ASSERT_LE(got - v, v / 100) << "value " << v;
+    }
+}
+
+TEST(HistogramTest, ConcurrentRecordAndMerge) {
+    Histogram h;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&h]() {
+            for (uint64_t v = 0; v < 10000; v++) {
+                h.Record(v);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(40000, h.Count());
+
+    Histogram other;
+    other.Record(uint64_t(1) << 40);
+    h.Merge(other);
+    ASSERT_EQ(40001, h.Count());
+    ASSERT_GE(h.Max(), (uint64_t(1) << 36) - 1);
+
+    Histogram copy(h);
+    ASSERT_EQ(h.Count(), copy.Count());
+    ASSERT_EQ(h.Percentile(50), copy.Percentile(50));
+}
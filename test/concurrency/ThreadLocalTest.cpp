@@ -0,0 +1,81 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <afina/concurrency/ThreadLocal.h>
+
+using Afina::Concurrency::ThreadLocal;
+
+TEST(ThreadLocalTest, SameThreadSameInstance) {
+    ThreadLocal<int> value;
+    value.Get() = 42;
+    ASSERT_EQ(42, *value);
+    ASSERT_EQ(&value.Get(), &*value);
+    ASSERT_EQ(1, value.Size());
+
+    // Separate instances for separate objects
+    ThreadLocal<int> other;
+    ASSERT_EQ(0, other.Get());
+}
+
+TEST(ThreadLocalTest, IterateAndCleanup) {
+    std::atomic<long> exited(0);
+    ThreadLocal<long> counters([&exited](long &value) { exited += value; });
+
+    const int threads = 4;
+    std::mutex mutex;
+    std::condition_variable condition;
+    int ready = 0;
+    bool release = false;
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            counters.Get() = t + 1;
+            std::unique_lock<std::mutex> lock(mutex);
+            ready++;
+            condition.notify_all();
+            condition.wait(lock, [&release]() { return release; });
+        });
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [&ready, threads]() { return ready == threads; });
+    }
+
+    // All threads are alive and hold their values
+    long sum = 0;
+    counters.ForEach([&sum](long &value) { sum += value; });
+    ASSERT_EQ(threads, counters.Size());
+    ASSERT_EQ(10, sum);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        release = true;
+        condition.notify_all();
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    // Exited threads are gone from the registry, their values went to the hook
+    ASSERT_EQ(0, counters.Size());
+    ASSERT_EQ(10, exited.load());
+}
+
+TEST(ThreadLocalTest, DestroyWithLiveThreads) {
+    // Instance of the main thread is still alive when ThreadLocal goes away
+    std::unique_ptr<ThreadLocal<std::vector<int>>> values(new ThreadLocal<std::vector<int>>());
+    values->Get().push_back(1);
+    values.reset();
+
+    // Fresh object doesn't see old instance
+    ThreadLocal<std::vector<int>> fresh;
+    ASSERT_TRUE(fresh.Get().empty());
+}
@@ -0,0 +1,92 @@
+#include "gtest/gtest.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <afina/concurrency/Topology.h>
+
+using Afina::Concurrency::ParseCpuList;
+using Afina::Concurrency::Topology;
+
+namespace {
+
+void write_file(const std::string &path, const std::string &content) {
+    std::ofstream out(path);
+    out << content << std::endl;
+}
+
+} // namespace
+
+TEST(TopologyTest, ParseCpuList) {
+    ASSERT_EQ(std::vector<int>({0}), ParseCpuList("0"));
+    ASSERT_EQ(std::vector<int>({0, 1, 2, 3, 8, 10, 11}), ParseCpuList("0-3,8,10-11\n"));
+    ASSERT_TRUE(ParseCpuList("").empty());
+}
+
+TEST(TopologyTest, FakeSysfs) {
+    char root[] = "/tmp/afina_sysfs_XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(root));
+    std::string sysfs = root;
+
+    // Kernel ids have gap, nodes are numbered densely
+    mkdir((sysfs + "/node").c_str(), 0700);
+    mkdir((sysfs + "/node/node0").c_str(), 0700);
+    mkdir((sysfs + "/node/node2").c_str(), 0700);
+    mkdir((sysfs + "/node/possible").c_str(), 0700);
+    write_file(sysfs + "/node/node0/cpulist", "0-1");
+    write_file(sysfs + "/node/node2/cpulist", "2,3");
+
+    Topology topology(sysfs);
+    ASSERT_EQ(2, topology.Nodes());
+    EXPECT_EQ(0, topology.NodeId(0));
+    EXPECT_EQ(2, topology.NodeId(1));
+    EXPECT_EQ(std::vector<int>({0, 1}), topology.Cpus(0));
+    EXPECT_EQ(std::vector<int>({2, 3}), topology.Cpus(1));
+    EXPECT_EQ(1, topology.NodeOf(3));
+    EXPECT_EQ(0, topology.NodeOf(42));
+
+    std::system(("rm -rf " + sysfs).c_str());
+}
+
+TEST(TopologyTest, NoNuma) {
+    char root[] = "/tmp/afina_sysfs_XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(root));
+    std::string sysfs = root;
+
+    mkdir((sysfs + "/cpu").c_str(), 0700);
+    write_file(sysfs + "/cpu/online", "0-5");
+
+    Topology topology(sysfs);
+    ASSERT_EQ(1, topology.Nodes());
+    EXPECT_EQ(6, topology.Cpus(0).size());
+
+    std::system(("rm -rf " + sysfs).c_str());
+}
+
+TEST(TopologyTest, System) {
+    const Topology &topology = Topology::System();
+    ASSERT_LE(1, topology.Nodes());
+    ASSERT_FALSE(topology.Cpus(0).empty());
+
+    // Binding to the node of current CPU always succeeds
+    std::size_t node = topology.NodeOf(sched_getcpu());
+    std::thread([&]() { EXPECT_TRUE(topology.BindThread(node)); }).join();
+
+    // Memory policy could be unsupported by kernel, but page must stay usable either way
+    std::size_t len = 1 << 20;
+    void *region = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ASSERT_NE(MAP_FAILED, region);
+    if (topology.BindMemory(region, len, node)) {
+        static_cast<char *>(region)[0] = 1;
+        EXPECT_EQ(int(node), topology.NodeOfPage(region));
+    }
+    munmap(region, len);
+}
@@ -0,0 +1,284 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <afina/concurrency/Task.h>
+#include <afina/concurrency/WorkStealingExecutor.h>
+
+#include "concurrency/ChaseLevDeque.h"
+
+using Afina::Concurrency::ChaseLevDeque;
+using Afina::Concurrency::Task;
+using Afina::Concurrency::WorkStealingExecutor;
+
+TEST(TaskTest, InlineAndHeap) {
+    int calls = 0;
+    Task small([&calls]() { calls++; });
+    ASSERT_TRUE(small.IsInline());
+
+    char payload[128] = {0};
+    Task large([&calls, payload]() { calls += payload[0] + 1; });
+    ASSERT_FALSE(large.IsInline());
+
+    Task moved(std::move(large));
+    ASSERT_FALSE(bool(large));
+    small();
+    moved();
+    ASSERT_EQ(2, calls);
+
+    moved = std::move(small);
+    moved();
+    ASSERT_EQ(3, calls);
+}
+
+TEST(ChaseLevDequeTest, OwnerLifoThiefFifo) {
+    ChaseLevDeque<int *> deque(2);
+    int items[100];
+    for (int i = 0; i < 100; i++) {
+        deque.Push(&items[i]);
+    }
+    ASSERT_EQ(100, deque.Size());
+
+    int *item;
+    ASSERT_TRUE(deque.Pop(item));
+    ASSERT_EQ(&items[99], item);
+    ASSERT_TRUE(deque.Steal(item));
+    ASSERT_EQ(&items[0], item);
+    ASSERT_EQ(98, deque.Size());
+}
+
+TEST(ChaseLevDequeTest, ConcurrentSteal) {
+    const int count = 100000;
+    ChaseLevDeque<int *> deque;
+    std::vector<int> items(count, 0);
+    std::atomic<bool> done(false);
+    std::atomic<int> taken(0);
+
+    // Every item must be taken exactly once, either by the owner or one of thieves
+    std::vector<std::thread> thieves;
+    for (int i = 0; i < 3; i++) {
+        thieves.emplace_back([&]() {
+            int *item;
+            while (!done.load() || !deque.Empty()) {
+                if (deque.Steal(item)) {
+                    (*item)++;
+                    taken++;
+                }
+            }
+        });
+    }
+
+    int *item;
+    for (int i = 0; i < count; i++) {
+        deque.Push(&items[i]);
+        if (i % 3 == 0 && deque.Pop(item)) {
+            (*item)++;
+            taken++;
+        }
+    }
+    while (deque.Pop(item)) {
+        (*item)++;
+        taken++;
+    }
+    done.store(true);
+    for (auto &t : thieves) {
+        t.join();
+    }
+
+    ASSERT_EQ(count, taken.load());
+    for (int i = 0; i < count; i++) {
+        ASSERT_EQ(1, items[i]);
+    }
+}
+
+void _ws_add(std::atomic<int> &counter, int value) { counter += value; }
+
+TEST(WorkStealingExecutorTest, ExecutesAll) {
+    WorkStealingExecutor executor("test", 2, 4, 64, 100);
+    executor.Start();
+
+    std::atomic<int> counter(0);
+    for (int i = 0; i < 10000; i++) {
+        while (!executor.Execute(_ws_add, std::ref(counter), 1)) {
+            std::this_thread::yield();
+        }
+    }
+    executor.Stop(true);
+
+    ASSERT_EQ(10000, counter.load());
+    ASSERT_EQ(0, executor.Threads());
+    ASSERT_FALSE(executor.Execute(_ws_add, std::ref(counter), 1));
+}
+
+void _ws_fork(WorkStealingExecutor &executor, std::atomic<int> &counter, int depth) {
+    counter++;
+    if (depth > 0) {
+        // Nested tasks go to the local deque and got stolen by others
+        executor.Execute(_ws_fork, std::ref(executor), std::ref(counter), depth - 1);
+        executor.Execute(_ws_fork, std::ref(executor), std::ref(counter), depth - 1);
+    }
+}
+
+TEST(WorkStealingExecutorTest, NestedTasks) {
+    WorkStealingExecutor executor("test", 4, 4, 1, 100);
+    executor.Start();
+
+    std::atomic<int> counter(0);
+    ASSERT_TRUE(executor.Execute(_ws_fork, std::ref(executor), std::ref(counter), 12));
+    for (int i = 0; i < 1000 && counter.load() < (1 << 13) - 1; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    executor.Stop(true);
+
+    ASSERT_EQ((1 << 13) - 1, counter.load());
+}
+
+/**
+ * Task that keeps pool thread busy until released
+ */
+struct Gate {
+    void Wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        started = true;
+        cv.notify_all();
+        while (!released) {
+            cv.wait(lock);
+        }
+    }
+
+    void AwaitStarted() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!started) {
+            cv.wait(lock);
+        }
+    }
+
+    void Release() {
+        std::lock_guard<std::mutex> lock(mutex);
+        released = true;
+        cv.notify_all();
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool started = false, released = false;
+};
+
+TEST(WorkStealingExecutorTest, QueueLimit) {
+    WorkStealingExecutor executor("test", 1, 1, 2, 100);
+    int rejects = 0;
+    executor.SetOverflowPolicy(WorkStealingExecutor::Overflow::kReject, std::chrono::milliseconds(0),
+                               [&rejects]() { rejects++; });
+    executor.Start();
+
+    // Single thread is busy, so only max_queue_size tasks could wait
+    Gate gate;
+    ASSERT_TRUE(executor.Execute(&Gate::Wait, &gate));
+    gate.AwaitStarted();
+
+    std::atomic<int> counter(0);
+    ASSERT_TRUE(executor.Execute(_ws_add, std::ref(counter), 1));
+    ASSERT_TRUE(executor.Execute(_ws_add, std::ref(counter), 1));
+    ASSERT_FALSE(executor.Execute(_ws_add, std::ref(counter), 1));
+    ASSERT_EQ(1, rejects);
+
+    auto stats = executor.GetStats();
+    ASSERT_EQ(2, stats.queue_depth);
+    ASSERT_EQ(1, stats.threads);
+    ASSERT_EQ(3, stats.submitted);
+    ASSERT_EQ(1, stats.rejected);
+
+    gate.Release();
+    executor.Stop(true);
+    ASSERT_EQ(2, counter.load());
+
+    stats = executor.GetStats();
+    ASSERT_EQ(0, stats.queue_depth);
+    ASSERT_EQ(3, stats.completed);
+    ASSERT_EQ(3, executor.QueueTime().Count());
+    ASSERT_GE(executor.TotalTime().Percentile(100), executor.RunTime().Percentile(100));
+}
+
+TEST(WorkStealingExecutorTest, OverflowCallerRuns) {
+    WorkStealingExecutor executor("test", 1, 1, 1, 100);
+    executor.SetOverflowPolicy(WorkStealingExecutor::Overflow::kCallerRuns);
+    executor.Start();
+
+    Gate gate;
+    ASSERT_TRUE(executor.Execute(&Gate::Wait, &gate));
+    gate.AwaitStarted();
+
+    std::atomic<int> counter(0);
+    ASSERT_TRUE(executor.Execute(_ws_add, std::ref(counter), 1));
+    ASSERT_EQ(0, counter.load());
+
+    // Queue is full, so the task runs right here
+    ASSERT_TRUE(executor.Execute(_ws_add, std::ref(counter), 10));
+    ASSERT_EQ(10, counter.load());
+    ASSERT_EQ(1, executor.GetStats().caller_runs);
+
+    gate.Release();
+    executor.Stop(true);
+    ASSERT_EQ(11, counter.load());
+    ASSERT_EQ(0, executor.GetStats().rejected);
+}
+
+TEST(WorkStealingExecutorTest, OverflowBlock) {
+    WorkStealingExecutor executor("test", 1, 1, 1, 100);
+    executor.SetOverflowPolicy(WorkStealingExecutor::Overflow::kBlock, std::chrono::milliseconds(20));
+    executor.Start();
+
+    Gate gate;
+    ASSERT_TRUE(executor.Execute(&Gate::Wait, &gate));
+    gate.AwaitStarted();
+
+    std::atomic<int> counter(0);
+    ASSERT_TRUE(executor.Execute(_ws_add, std::ref(counter), 1));
+
+    // Nobody frees the place in time
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_FALSE(executor.Execute(_ws_add, std::ref(counter), 1));
+    ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+
+    // Place gets free while caller waits
+    std::thread releaser([&gate]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        gate.Release();
+    });
+    ASSERT_TRUE(executor.Execute(_ws_add, std::ref(counter), 1));
+    releaser.join();
+
+    executor.Stop(true);
+    ASSERT_EQ(2, counter.load());
+    ASSERT_EQ(1, executor.GetStats().rejected);
+}
+
+TEST(WorkStealingExecutorTest, IdleThreadsStop) {
+    WorkStealingExecutor executor("test", 1, 4, 64, 10);
+    executor.Start();
+
+    std::atomic<int> counter(0);
+    auto sleeper = [&counter]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        counter++;
+    };
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(executor.Execute(sleeper));
+    }
+    while (counter.load() < 4) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_LE(executor.Threads(), 4);
+
+    // Extra threads go away after idle_time
+    for (int i = 0; i < 100 && executor.Threads() > 1; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(1, executor.Threads());
+    executor.Stop(true);
+}
@@ -1,7 +1,9 @@
 #include "gtest/gtest.h"
 
+#include <chrono>
 #include <iostream>
 #include <sstream>
+#include <thread>
 
 #include <afina/coroutine/Engine.h>
 
@@ -62,3 +64,74 @@ TEST(CoroutineTest, Printer) {
     engine.start(_printer, engine, result);
     ASSERT_STREQ("A1 B1 A2 B2 A3 B3 END", result.c_str());
 }
+
+std::string sleep_log;
+void _sleeper(Afina::Coroutine::Engine &pe, int ms, char name) {
+    pe.sleep_for(std::chrono::milliseconds(ms));
+    sleep_log += name;
+}
+
+void _sleepers(Afina::Coroutine::Engine &pe) {
+    pe.run(_sleeper, pe, 30, 'A');
+    pe.run(_sleeper, pe, 10, 'B');
+}
+
+TEST(CoroutineTest, SleepFor) {
+    Afina::Coroutine::Engine engine;
+    sleep_log.clear();
+
+    auto start = std::chrono::steady_clock::now();
+    engine.start(_sleepers, engine);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    ASSERT_EQ("BA", sleep_log);
+    ASSERT_GE(elapsed, std::chrono::milliseconds(30));
+}
+
+bool block_results[2];
+void *block_waiter = nullptr;
+void _block_waiter(Afina::Coroutine::Engine &pe) {
+    block_results[0] = pe.block_for(std::chrono::milliseconds(10));
+    block_results[1] = pe.block_for(std::chrono::milliseconds(10000));
+}
+
+void _block_main(Afina::Coroutine::Engine &pe) {
+    block_waiter = pe.run(_block_waiter, pe);
+    pe.sched(block_waiter);
+
+    // Let first wait to expire, then wake the second one up
+    pe.sleep_for(std::chrono::milliseconds(20));
+    pe.unblock(block_waiter);
+}
+
+TEST(CoroutineTest, BlockFor) {
+    Afina::Coroutine::Engine engine;
+
+    auto start = std::chrono::steady_clock::now();
+    engine.start(_block_main, engine);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    ASSERT_FALSE(block_results[0]);
+    ASSERT_TRUE(block_results[1]);
+    ASSERT_LT(elapsed, std::chrono::milliseconds(1000));
+}
+
+void _late_waiter(Afina::Coroutine::Engine &pe) { block_results[0] = pe.block_for(std::chrono::milliseconds(10)); }
+
+void _late_main(Afina::Coroutine::Engine &pe) {
+    block_waiter = pe.run(_late_waiter, pe);
+    pe.sched(block_waiter);
+
+    // Waiter is unblocked before its deadline is checked, it must not see a timeout
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    pe.unblock(block_waiter);
+    pe.yield();
+}
+
+TEST(CoroutineTest, BlockForUnblockedBeforeExpiry) {
+    Afina::Coroutine::Engine engine;
+    block_results[0] = false;
+
+    engine.start(_late_main, engine);
+    ASSERT_TRUE(block_results[0]);
+}
@@ -0,0 +1,85 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <afina/coroutine/Scheduler.h>
+
+using Afina::Coroutine::Scheduler;
+
+TEST(SchedulerTest, SpawnMany) {
+    Scheduler scheduler(4);
+    scheduler.Start();
+
+    std::atomic<int> done(0);
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_TRUE(scheduler.Spawn([&done]() {
+            Scheduler::Yield();
+            done++;
+        }));
+    }
+
+    scheduler.Stop();
+    scheduler.Join();
+    ASSERT_EQ(1000, done.load());
+    ASSERT_FALSE(scheduler.Spawn([]() {}));
+}
+
+TEST(SchedulerTest, PipeReadWrite) {
+    int fds[2];
+    ASSERT_EQ(0, pipe2(fds, O_NONBLOCK));
+
+    Scheduler scheduler(2);
+    scheduler.Start();
+
+    // Reader suspends on empty pipe until writer, possibly from another thread, fills it
+    std::string result;
+    ASSERT_TRUE(scheduler.Spawn([&result, &fds]() {
+        char buf[16];
+        ssize_t n;
+        while ((n = Scheduler::Read(fds[0], buf, sizeof(buf))) > 0) {
+            result.append(buf, n);
+        }
+    }));
+    ASSERT_TRUE(scheduler.Spawn([&fds]() {
+        for (int i = 0; i < 100; i++) {
+            ASSERT_EQ(10, Scheduler::Write(fds[1], "0123456789", 10));
+            Scheduler::Yield();
+        }
+        close(fds[1]);
+    }));
+
+    scheduler.Stop();
+    scheduler.Join();
+    close(fds[0]);
+
+    ASSERT_EQ(1000u, result.size());
+    ASSERT_EQ("0123456789", result.substr(990));
+}
+
+TEST(SchedulerTest, ReadTimeout) {
+    int fds[2];
+    ASSERT_EQ(0, pipe2(fds, O_NONBLOCK));
+
+    Scheduler scheduler(1);
+    scheduler.Start();
+
+    ssize_t result = 0;
+    int error = 0;
+    ASSERT_TRUE(scheduler.Spawn([&]() {
+        char buf[16];
+        result = Scheduler::Read(fds[0], buf, sizeof(buf), 20);
+        error = errno;
+    }));
+
+    scheduler.Stop();
+    scheduler.Join();
+    close(fds[0]);
+    close(fds[1]);
+
+    ASSERT_EQ(-1, result);
+    ASSERT_EQ(ETIMEDOUT, error);
+}
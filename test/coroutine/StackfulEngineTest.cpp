@@ -0,0 +1,118 @@
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include <string>
+
+#include <afina/coroutine/StackfulEngine.h>
+
+using Afina::Coroutine::StackfulEngine;
+
+void _stackful_add(int &result, int left, int right) { result = left + right; }
+
+TEST(StackfulEngineTest, SimpleStart) {
+    StackfulEngine engine;
+
+    int result = 0;
+    engine.start(_stackful_add, result, 1, 2);
+
+    ASSERT_EQ(3, result);
+}
+
+void _stackful_print(StackfulEngine &pe, std::stringstream &out, void *&other, char name, int steps) {
+    for (int i = 1; i <= steps; i++) {
+        out << name << i << " ";
+        pe.sched(other);
+    }
+}
+
+void _stackful_printer(StackfulEngine &pe, std::string &result) {
+    std::stringstream out;
+    void *pa = nullptr, *pb = nullptr;
+
+    pa = pe.run(_stackful_print, pe, out, pb, 'A', 3);
+    pb = pe.run(_stackful_print, pe, out, pa, 'B', 3);
+    pe.sched(pa);
+
+    out << "END";
+    result = out.str();
+}
+
+TEST(StackfulEngineTest, Printer) {
+    StackfulEngine engine;
+
+    std::string result;
+    engine.start(_stackful_printer, engine, result);
+    ASSERT_STREQ("A1 B1 A2 B2 A3 B3 END", result.c_str());
+}
+
+void _stackful_sleeper(StackfulEngine &pe, std::string &out) {
+    out += "sleep ";
+    pe.block();
+    out += "wakeup ";
+}
+
+void _stackful_waker(StackfulEngine &pe, std::string &out) {
+    void *sleeper = pe.run(_stackful_sleeper, pe, out);
+    pe.sched(sleeper);
+
+    out += "unblock ";
+    pe.unblock(sleeper);
+    pe.yield();
+    out += "done";
+}
+
+TEST(StackfulEngineTest, BlockUnblock) {
+    StackfulEngine engine;
+
+    std::string result;
+    engine.start(_stackful_waker, engine, result);
+    ASSERT_EQ("sleep unblock wakeup done", result);
+}
+
+void _stackful_blocked(StackfulEngine &pe, int &) { pe.block(); }
+
+TEST(StackfulEngineTest, UnblockerCalled) {
+    int calls = 0;
+    StackfulEngine engine([&calls](StackfulEngine &) { calls++; });
+
+    engine.start(_stackful_blocked, engine, calls);
+    ASSERT_EQ(1, calls);
+}
+
+int _stackful_depth(StackfulEngine &pe, int n) {
+    volatile char frame[1024];
+    frame[0] = char(n);
+    if (n == 0) {
+        // Let others run while the stack is deep
+        pe.yield();
+        return frame[0];
+    }
+    return _stackful_depth(pe, n - 1) + 1;
+}
+
+void _stackful_deep_child(StackfulEngine &pe, int &result, int n) { result = _stackful_depth(pe, n); }
+
+void _stackful_deep(StackfulEngine &pe, int &result) {
+    // Deep enough stack usage in many coroutines, which must not corrupt each other
+    int values[8];
+    for (int i = 0; i < 8; i++) {
+        values[i] = 0;
+        pe.run(_stackful_deep_child, pe, values[i], 16 + i);
+    }
+
+    result = 0;
+    for (int i = 0; i < 8; i++) {
+        while (values[i] == 0) {
+            pe.yield();
+        }
+        result += values[i];
+    }
+}
+
+TEST(StackfulEngineTest, ManyRoutines) {
+    StackfulEngine engine([](StackfulEngine &) {}, 32 * 1024, 2);
+
+    int result = 0;
+    engine.start(_stackful_deep, engine, result);
+    ASSERT_EQ(16 * 8 + 28, result);
+}
@@ -0,0 +1,79 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include <afina/coroutine/Engine.h>
+#include <afina/coroutine/StackfulEngine.h>
+
+/**
+ * Context switch latency: two coroutines ping-pong control, each one has given amount of stack in use
+ * at the switch point. Copy-stack engine pays for that on every switch, stackful one should not
+ *
+ * Usage: benchCoroutineSwitch [switches] [stack bytes]
+ */
+namespace {
+
+long switches = 1000000;
+
+// Copy-stack engine restores whole stack on switch, so state shared between routines can't live there
+int finished = 0;
+void *pa = nullptr, *pb = nullptr;
+
+template <typename E> void pinger(E &pe, void *&other, int &finished, int depth) {
+    if (depth > 0) {
+        volatile char frame[256];
+        frame[0] = 0;
+        pinger(pe, other, finished, depth - 256 + frame[0]);
+        return;
+    }
+
+    for (long i = 0; i < switches / 2; i++) {
+        pe.sched(other);
+    }
+    finished++;
+}
+
+template <typename E> void bench_main(E &pe, int &depth, double &result) {
+    finished = 0;
+    pa = pe.run(pinger<E>, pe, pb, finished, int(depth));
+    pb = pe.run(pinger<E>, pe, pa, finished, int(depth));
+
+    auto start = std::chrono::steady_clock::now();
+    pe.sched(pa);
+    while (finished < 2) {
+        pe.yield();
+    }
+    auto end = std::chrono::steady_clock::now();
+    result = std::chrono::duration<double, std::nano>(end - start).count() / switches;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        switches = std::atol(argv[1]);
+    }
+
+    int depths[] = {0, 1024, 4096, 16384};
+    int ndepths = sizeof(depths) / sizeof(depths[0]);
+    if (argc > 2) {
+        depths[0] = std::atoi(argv[2]);
+        ndepths = 1;
+    }
+
+    std::cout << "switches: " << switches << std::endl;
+    std::cout << "stack bytes\tcopy-stack ns/switch\tstackful ns/switch" << std::endl;
+    for (int i = 0; i < ndepths; i++) {
+        int depth = depths[i];
+        double copy_ns = 0, stackful_ns = 0;
+
+        Afina::Coroutine::Engine copy_engine;
+        copy_engine.start(bench_main<Afina::Coroutine::Engine>, copy_engine, depth, copy_ns);
+
+        Afina::Coroutine::StackfulEngine stackful_engine;
+        stackful_engine.start(bench_main<Afina::Coroutine::StackfulEngine>, stackful_engine, depth, stackful_ns);
+
+        std::cout << depth << "\t\t" << copy_ns << "\t\t\t" << stackful_ns << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include "gtest/gtest.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <afina/coroutine/Channel.h>
+#include <afina/coroutine/ConditionVariable.h>
+#include <afina/coroutine/Engine.h>
+#include <afina/coroutine/Mutex.h>
+#include <afina/coroutine/StackfulEngine.h>
+#include <afina/coroutine/WaitGroup.h>
+
+using namespace Afina::Coroutine;
+
+struct SyncState {
+    SyncState(StackfulEngine &engine)
+        : mutex(engine), cv(engine), channel(engine, 2), group(engine), counter(0), ready(false) {}
+
+    Mutex<StackfulEngine> mutex;
+    ConditionVariable<StackfulEngine> cv;
+    Channel<StackfulEngine, int> channel;
+    WaitGroup<StackfulEngine> group;
+
+    int counter;
+    bool ready;
+    std::string log;
+};
+
+void _sync_incrementer(StackfulEngine &pe, SyncState &state) {
+    for (int i = 0; i < 100; i++) {
+        std::lock_guard<Mutex<StackfulEngine>> lock(state.mutex);
+        int value = state.counter;
+        // Switch while holding the lock, nobody else must get in
+        pe.yield();
+        state.counter = value + 1;
+    }
+    state.group.done();
+}
+
+void _sync_mutex_main(StackfulEngine &pe, SyncState &state) {
+    state.group.add(4);
+    for (int i = 0; i < 4; i++) {
+        pe.run(_sync_incrementer, pe, state);
+    }
+    state.group.wait();
+}
+
+TEST(SyncTest, MutexAndWaitGroup) {
+    StackfulEngine engine;
+    SyncState state(engine);
+
+    engine.start(_sync_mutex_main, engine, state);
+    ASSERT_EQ(400, state.counter);
+}
+
+void _sync_group_waiter(StackfulEngine &, SyncState &state) {
+    state.group.wait();
+    state.log += "woken ";
+}
+
+void _sync_group_main(StackfulEngine &pe, SyncState &state) {
+    state.group.add(1);
+    void *waiter = pe.run(_sync_group_waiter, pe, state);
+    pe.yield();
+
+    // Spurious wakeup doesn't end the wait
+    pe.unblock(waiter);
+    pe.yield();
+    state.log += "done ";
+    state.group.done();
+    pe.yield();
+}
+
+TEST(SyncTest, WaitGroupSpuriousWakeup) {
+    StackfulEngine engine;
+    SyncState state(engine);
+
+    engine.start(_sync_group_main, engine, state);
+    ASSERT_EQ("done woken ", state.log);
+}
+
+void _sync_waiter(StackfulEngine &, SyncState &state) {
+    std::unique_lock<Mutex<StackfulEngine>> lock(state.mutex);
+    state.cv.wait(state.mutex, [&state]() { return state.ready; });
+    state.log += "woken ";
+    state.group.done();
+}
+
+void _sync_cv_main(StackfulEngine &pe, SyncState &state) {
+    state.group.add(3);
+    for (int i = 0; i < 3; i++) {
+        pe.run(_sync_waiter, pe, state);
+    }
+    pe.yield();
+
+    {
+        std::lock_guard<Mutex<StackfulEngine>> lock(state.mutex);
+        state.ready = true;
+        state.log += "notify ";
+    }
+    state.cv.notify_all();
+    state.group.wait();
+}
+
+TEST(SyncTest, ConditionVariable) {
+    StackfulEngine engine;
+    SyncState state(engine);
+
+    engine.start(_sync_cv_main, engine, state);
+    ASSERT_EQ("notify woken woken woken ", state.log);
+}
+
+void _sync_producer(StackfulEngine &, SyncState &state, int base) {
+    for (int i = 0; i < 10; i++) {
+        ASSERT_TRUE(state.channel.send(base + i));
+    }
+    state.group.done();
+}
+
+void _sync_consumer(StackfulEngine &, SyncState &state, std::vector<int> &out) {
+    int value;
+    while (state.channel.recv(value)) {
+        ASSERT_LE(state.channel.size(), 2u);
+        out.push_back(value);
+    }
+}
+
+void _sync_channel_main(StackfulEngine &pe, SyncState &state, std::vector<int> &out) {
+    pe.run(_sync_consumer, pe, state, out);
+    pe.run(_sync_consumer, pe, state, out);
+
+    state.group.add(3);
+    for (int i = 0; i < 3; i++) {
+        pe.run(_sync_producer, pe, state, 100 * i);
+    }
+    state.group.wait();
+    state.channel.close();
+    ASSERT_FALSE(state.channel.send(0));
+}
+
+TEST(SyncTest, Channel) {
+    StackfulEngine engine;
+    SyncState state(engine);
+
+    std::vector<int> out;
+    engine.start(_sync_channel_main, engine, state, out);
+
+    ASSERT_EQ(30u, out.size());
+    int sum = 0;
+    for (int v : out) {
+        sum += v;
+    }
+    ASSERT_EQ(45 * 3 + 10 * 300, sum);
+}
+
+// Copy-stack engine: shared state must live out of coroutine stacks
+Engine *copy_engine;
+Mutex<Engine> *copy_mutex;
+int copy_counter = 0;
+
+void _sync_copy_incrementer(int n) {
+    for (int i = 0; i < n; i++) {
+        copy_mutex->lock();
+        int value = copy_counter;
+        copy_engine->yield();
+        copy_counter = value + 1;
+        copy_mutex->unlock();
+    }
+}
+
+void _sync_copy_main(int n) {
+    copy_engine->run(_sync_copy_incrementer, int(n));
+    copy_engine->run(_sync_copy_incrementer, int(n));
+}
+
+TEST(SyncTest, CopyStackEngineMutex) {
+    Engine engine;
+    Mutex<Engine> mutex(engine);
+    copy_engine = &engine;
+    copy_mutex = &mutex;
+    copy_counter = 0;
+
+    engine.start(_sync_copy_main, 50);
+    ASSERT_EQ(100, copy_counter);
+}
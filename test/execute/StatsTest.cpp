@@ -0,0 +1,41 @@
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#include <afina/execute/Counters.h>
+#include <afina/execute/Get.h>
+#include <afina/execute/Stats.h>
+
+#include "storage/SimpleLRU.h"
+
+using namespace Afina::Execute;
+
+TEST(StatsTest, GetHitsAndMisses) {
+    Afina::Backend::SimpleLRU storage;
+    storage.Put("key", "value");
+
+    uint64_t hits = Counters::Get(Counters::kGetHits);
+    uint64_t misses = Counters::Get(Counters::kGetMisses);
+
+    std::string out;
+    Get get({"key", "other", "key"});
+    get.Execute(storage, "", out);
+
+    ASSERT_EQ(hits + 2, Counters::Get(Counters::kGetHits));
+    ASSERT_EQ(misses + 1, Counters::Get(Counters::kGetMisses));
+}
+
+TEST(StatsTest, Output) {
+    Afina::Backend::SimpleLRU storage;
+    Counters::Add(Counters::kBytesRead, 10);
+    uint64_t read = Counters::Get(Counters::kBytesRead);
+
+    std::string out;
+    Stats stats;
+    stats.Execute(storage, "", out);
+
+    ASSERT_NE(std::string::npos, out.find("STAT bytes_read " + std::to_string(read) + "\r\n"));
+    ASSERT_NE(std::string::npos, out.find("STAT get_hits "));
+    ASSERT_EQ(0, out.compare(out.size() - 3, 3, "END"));
+}
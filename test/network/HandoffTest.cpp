@@ -0,0 +1,152 @@
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <afina/network/Handoff.h>
+
+using namespace Afina::Network;
+
+namespace {
+
+std::string temp_path() {
+    char path[] = "/tmp/afina_handoff_XXXXXX";
+    int fd = mkstemp(path);
+    close(fd);
+    unlink(path);
+    return path;
+}
+
+// Whatever is written to one end comes out of the other
+void expect_connected(int a, int b) {
+    ASSERT_EQ(4, write(a, "ping", 4));
+    char buffer[4];
+    ASSERT_EQ(4, read(b, buffer, 4));
+    EXPECT_EQ("ping", std::string(buffer, 4));
+}
+
+} // namespace
+
+TEST(HandoffTest, NobodyRunning) {
+    std::string path = temp_path();
+    Handoff handoff(path);
+    std::vector<int> fds{42};
+    ASSERT_FALSE(handoff.TakeOver(fds));
+    ASSERT_EQ(std::vector<int>{42}, fds);
+
+    // Nobody to wait for and nobody to tell
+    handoff.WaitPrevious();
+    handoff.Release();
+}
+
+TEST(HandoffTest, TakeOver) {
+    std::string path = temp_path();
+    int pair[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, pair));
+
+    std::promise<void> taken;
+    Handoff previous(path);
+    previous.Listen({pair[0]}, [&taken]() { taken.set_value(); });
+
+    Handoff next(path);
+    std::vector<int> fds;
+    ASSERT_TRUE(next.TakeOver(fds));
+    ASSERT_EQ(1, fds.size());
+    ASSERT_NE(pair[0], fds[0]);
+    ASSERT_EQ(std::future_status::ready, taken.get_future().wait_for(std::chrono::seconds(5)));
+
+    // Descriptor received is the same socket
+    expect_connected(fds[0], pair[1]);
+    expect_connected(pair[1], fds[0]);
+
+    // Next process waits until the previous one is done
+    auto waiting = std::async(std::launch::async, [&next]() { next.WaitPrevious(); });
+    previous.Release();
+    ASSERT_EQ(std::future_status::ready, waiting.wait_for(std::chrono::seconds(5)));
+
+    close(fds[0]);
+    close(pair[0]);
+    close(pair[1]);
+    unlink(path.c_str());
+}
+
+TEST(HandoffTest, SeveralDescriptors) {
+    std::string path = temp_path();
+    int first[2], second[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, first));
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, second));
+
+    Handoff previous(path);
+    previous.Listen({first[0], second[0]}, []() {});
+
+    Handoff next(path);
+    std::vector<int> fds;
+    ASSERT_TRUE(next.TakeOver(fds));
+    ASSERT_EQ(2, fds.size());
+    expect_connected(fds[0], first[1]);
+    expect_connected(fds[1], second[1]);
+
+    previous.Release();
+    next.WaitPrevious();
+    for (int fd : {fds[0], fds[1], first[0], first[1], second[0], second[1]}) {
+        close(fd);
+    }
+    unlink(path.c_str());
+}
+
+TEST(HandoffTest, StrangerIgnored) {
+    std::string path = temp_path();
+    int pair[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, pair));
+
+    Handoff previous(path);
+    previous.Listen({pair[0]}, []() {});
+
+    // Connection that doesn't ask for descriptors gets nothing
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    path.copy(addr.sun_path, sizeof(addr.sun_path) - 1);
+    int stranger = socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_EQ(0, connect(stranger, (struct sockaddr *)&addr, sizeof(addr)));
+    ASSERT_EQ(1, write(stranger, "X", 1));
+    char reply;
+    ASSERT_EQ(0, read(stranger, &reply, 1));
+    close(stranger);
+
+    Handoff next(path);
+    std::vector<int> fds;
+    ASSERT_TRUE(next.TakeOver(fds));
+    ASSERT_EQ(1, fds.size());
+    expect_connected(fds[0], pair[1]);
+
+    previous.Release();
+    close(fds[0]);
+    close(pair[0]);
+    close(pair[1]);
+    unlink(path.c_str());
+}
+
+TEST(HandoffTest, ReleaseWithoutSuccessor) {
+    std::string path = temp_path();
+    int pair[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, pair));
+
+    bool taken = false;
+    Handoff previous(path);
+    previous.Listen({pair[0]}, [&taken]() { taken = true; });
+    previous.Release();
+    EXPECT_FALSE(taken);
+
+    ASSERT_THROW(previous.Listen({}, []() {}), std::invalid_argument);
+    close(pair[0]);
+    close(pair[1]);
+    unlink(path.c_str());
+}
@@ -0,0 +1,91 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "storage/SimpleLRU.h"
+
+/**
+ * Value compression trade-off: LRU with memory limit is filled with JSON documents of the same
+ * schema, then read by random keys, with values kept raw and compressed. Shows how many items fit
+ * into the limit, memory per item and cost of Put and Get, hit rate follows the number of items
+ *
+ * Usage: benchStorageCompression [memory limit]
+ */
+namespace {
+
+// Document of about the given size: array of records with the same fields, values vary
+std::string document(std::mt19937 &random, std::size_t size) {
+    static const char *names[] = {"alice", "bob", "carol", "dave", "eve", "mallory", "trent", "victor"};
+    static const char *states[] = {"active", "blocked", "pending"};
+    std::string result = "[";
+    while (result.size() < size) {
+        result += "{\"id\":" + std::to_string(random() % 1000000) + ",\"name\":\"" + names[random() % 8] +
+                  "\",\"state\":\"" + states[random() % 3] + "\",\"score\":" + std::to_string(random() % 10000) +
+                  ",\"tags\":[\"t" + std::to_string(random() % 50) + "\"]},";
+    }
+    result.back() = ']';
+    return result;
+}
+
+template <typename F> double ns_per_op(std::size_t ops, F f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    return double(ns.count()) / ops;
+}
+
+void run(std::size_t value_size, std::size_t threshold, std::size_t limit) {
+    std::mt19937 random(42);
+    std::vector<std::string> values;
+    for (int i = 0; i < 1000; i++) {
+        values.push_back(document(random, value_size));
+    }
+
+    // Key space is twice as large as raw values fit
+    std::size_t keys = 2 * limit / value_size;
+    Afina::Backend::SimpleLRU storage(std::size_t(1) << 40, nullptr, limit, threshold);
+    double put = ns_per_op(keys, [&]() {
+        for (std::size_t i = 0; i < keys; i++) {
+            storage.Put("key" + std::to_string(i), values[i % values.size()]);
+        }
+    });
+
+    std::size_t items = 0;
+    storage.Visit([&items](const char *, std::size_t, const char *, std::size_t) { items++; });
+
+    std::vector<std::string> lookups;
+    for (std::size_t i = 0; i < keys; i++) {
+        lookups.push_back("key" + std::to_string(random() % keys));
+    }
+    std::size_t hits = 0;
+    std::string value;
+    double get = ns_per_op(keys, [&]() {
+        for (auto &key : lookups) {
+            hits += storage.Get(key, value);
+        }
+    });
+
+    std::cout << value_size << "\t" << (threshold > 0 ? "lz4" : "raw") << "\t" << items << "\t"
+              << storage.MemoryUsed() / items << "\t" << std::size_t(put) << "\t" << std::size_t(get) << "\t"
+              << hits * 100 / keys << "%" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::size_t limit = 64 << 20;
+    if (argc > 1) {
+        limit = std::atol(argv[1]);
+    }
+
+    std::cout << "limit " << limit << " bytes, key space is twice as large as raw values fit" << std::endl;
+    std::cout << "value\tmode\titems\tmemory/item\tput ns\tget ns\thits" << std::endl;
+    for (std::size_t value_size : {256, 1024, 4096, 16384}) {
+        run(value_size, 0, limit);
+        run(value_size, 128, limit);
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "storage/FlatCombineLRU.h"
+#include "storage/ThreadSafeSimpleLRU.h"
+
+/**
+ * Throughput of thread safe LRU under contention: every thread runs the same mix of gets and puts over
+ * small set of keys, so all of them fight for the single structure. Global mutex is compared with flat
+ * combining for the growing number of threads to find the point where batching starts to pay off
+ *
+ * Usage: benchStorageContention [operations] [max threads]
+ */
+namespace {
+
+const int kKeys = 1000;
+
+// Every 10th operation is put, the rest are gets
+void worker(Afina::Storage &storage, long operations, unsigned seed) {
+    std::string value;
+    for (long i = 0; i < operations; i++) {
+        seed = seed * 1103515245 + 12345;
+        std::string key = "key" + std::to_string((seed >> 8) % kKeys);
+        if (i % 10 == 0) {
+            storage.Put(key, "value" + std::to_string(i));
+        } else {
+            storage.Get(key, value);
+        }
+    }
+}
+
+double run(Afina::Storage &storage, long operations, int threads) {
+    for (int i = 0; i < kKeys; i++) {
+        storage.Put("key" + std::to_string(i), "value");
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back(worker, std::ref(storage), operations / threads, unsigned(t + 1));
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return operations / std::chrono::duration<double>(end - start).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    long operations = 2000000;
+    if (argc > 1) {
+        operations = std::atol(argv[1]);
+    }
+
+    int max_threads = 4 * std::thread::hardware_concurrency();
+    if (argc > 2) {
+        max_threads = std::atoi(argv[2]);
+    }
+    if (max_threads <= 0) {
+        max_threads = 1;
+    }
+
+    const std::size_t size = 1024 * 1024;
+    std::cout << "operations: " << operations << ", cpus: " << std::thread::hardware_concurrency() << std::endl;
+    std::cout << "threads\tThreadSafeSimplLRU ops/s\tFlatCombineLRU ops/s\tops per batch" << std::endl;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        Afina::Backend::ThreadSafeSimplLRU locked(size);
+        Afina::Backend::FlatCombineLRU combined(size);
+
+        double locked_rate = run(locked, operations, threads);
+        double combined_rate = run(combined, operations, threads);
+        double batch = combined.Batches() > 0 ? double(combined.Combined()) / combined.Batches() : 0.0;
+        std::cout << threads << "\t" << locked_rate << "\t\t\t" << combined_rate << "\t\t" << batch << std::endl;
+    }
+    return 0;
+}
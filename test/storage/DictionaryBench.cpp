@@ -0,0 +1,114 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "storage/Dictionary.h"
+#include "storage/SimpleLRU.h"
+
+/**
+ * Dictionary compression of small values: LRU is filled with short JSON documents of the same
+ * schema, values are kept raw, compressed one by one and compressed with dictionary trained on the
+ * stored values. Shows bytes kept per item, time to train dictionary and to recompress all items
+ * with it, and cost of Put and Get
+ *
+ * Usage: benchStorageDictionary [items] [dictionary size]
+ */
+namespace {
+
+// Document of 100 to 500 bytes: user profile with optional fields
+std::string document(std::mt19937 &random) {
+    static const char *cities[] = {"Moscow", "Saint Petersburg", "Novosibirsk", "Kazan", "Yekaterinburg"};
+    static const char *plans[] = {"free", "basic", "premium"};
+    std::string result = "{\"id\":" + std::to_string(random() % 10000000) + ",\"login\":\"user" +
+                         std::to_string(random() % 100000) + "\",\"email\":\"user" + std::to_string(random() % 100000) +
+                         "@example.com\",\"plan\":\"" + plans[random() % 3] + "\",\"city\":\"" + cities[random() % 5] +
+                         "\",\"registered\":\"2018-" + std::to_string(10 + random() % 3) + "-" +
+                         std::to_string(10 + random() % 18) + "T" + std::to_string(10 + random() % 14) + ":00:00Z\"";
+    for (int i = random() % 8; i > 0; i--) {
+        result += ",\"visit" + std::to_string(i) + "\":{\"page\":\"/catalog/item" + std::to_string(random() % 1000) +
+                  "\",\"duration\":" + std::to_string(random() % 600) + "}";
+    }
+    return result + "}";
+}
+
+template <typename F> double ns_per_op(std::size_t ops, F f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    return double(ns.count()) / ops;
+}
+
+// Put all values, then Get them by random keys, print bytes kept and time per operation
+void run(const char *mode, Afina::Backend::SimpleLRU &storage, const std::vector<std::string> &values,
+         const std::vector<std::string> &lookups) {
+    double put = ns_per_op(values.size(), [&]() {
+        for (std::size_t i = 0; i < values.size(); i++) {
+            storage.Put("key" + std::to_string(i), values[i]);
+        }
+    });
+    std::string value;
+    double get = ns_per_op(lookups.size(), [&]() {
+        for (auto &key : lookups) {
+            storage.Get(key, value);
+        }
+    });
+    std::cout << mode << "\t" << storage.SizeUsed() / values.size() << "\t" << storage.MemoryUsed() / values.size()
+              << "\t" << std::size_t(put) << "\t" << std::size_t(get) << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::size_t items = 100000;
+    std::size_t size = 16 << 10;
+    if (argc > 1) {
+        items = std::atol(argv[1]);
+    }
+    if (argc > 2) {
+        size = std::atol(argv[2]);
+    }
+
+    std::mt19937 random(42);
+    std::vector<std::string> values;
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < items; i++) {
+        values.push_back(document(random));
+        total += values.back().size();
+    }
+    std::vector<std::string> lookups;
+    for (std::size_t i = 0; i < items; i++) {
+        lookups.push_back("key" + std::to_string(random() % items));
+    }
+
+    std::cout << items << " items, " << total / items << " bytes per value on average, dictionary of " << size
+              << " bytes" << std::endl;
+    std::cout << "mode\tbytes/item\tmemory/item\tput ns\tget ns" << std::endl;
+    Afina::Backend::SimpleLRU raw(std::size_t(1) << 40);
+    run("raw", raw, values, lookups);
+
+    Afina::Backend::SimpleLRU storage(std::size_t(1) << 40, nullptr, 0, 64);
+    run("lz4", storage, values, lookups);
+
+    // Dictionary is trained on stored values, then stored items are recompressed with it
+    std::shared_ptr<Afina::Backend::Lz4::Dictionary> dictionary;
+    double train = ns_per_op(1, [&]() {
+        dictionary = std::make_shared<Afina::Backend::Lz4::Dictionary>(
+            Afina::Backend::TrainDictionary(storage.SampleValues(1024), size));
+    });
+    storage.SetDictionary(dictionary);
+    double recompress = ns_per_op(items, [&]() {
+        while (storage.Recompress(256) > 0) {
+        }
+    });
+    std::cout << "recompressed\t" << storage.SizeUsed() / items << "\t" << storage.MemoryUsed() / items
+              << "\ttrain " << std::size_t(train / 1000) << " us, recompress " << std::size_t(recompress)
+              << " ns/item" << std::endl;
+
+    // Values put once more are compressed with the dictionary right away
+    run("dict", storage, values, lookups);
+    return 0;
+}
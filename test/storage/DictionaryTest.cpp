@@ -0,0 +1,251 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "storage/Dictionary.h"
+#include "storage/FlatCombineLRU.h"
+#include "storage/SimpleLRU.h"
+#include "storage/StripedLockLRU.h"
+#include "storage/ThreadSafeSimpleLRU.h"
+
+#include "TestUtil.h"
+
+using namespace Afina::Backend;
+
+namespace {
+
+// Short record of the same schema, too short to compress well on its own
+std::string record(std::mt19937 &random) {
+    static const char *states[] = {"active", "blocked", "pending"};
+    return "{\"id\": " + std::to_string(random() % 1000000) + ", \"user\": \"user" + std::to_string(random() % 1000) +
+           "\", \"state\": \"" + states[random() % 3] + "\", \"created\": \"2019-0" + std::to_string(random() % 9 + 1) +
+           "-1" + std::to_string(random() % 10) + "T10:00:00Z\", \"score\": " + std::to_string(random() % 100) + "}";
+}
+
+void check_values(Afina::Storage &storage, const std::vector<std::string> &values) {
+    std::string value;
+    for (std::size_t i = 0; i < values.size(); i++) {
+        ASSERT_TRUE(storage.Get("key" + std::to_string(i), value));
+        ASSERT_EQ(values[i], value);
+    }
+}
+
+void recompress(DictionaryCompression &storage) {
+    while (storage.Recompress(10) > 0) {
+    }
+}
+
+} // namespace
+
+TEST(DictionaryTest, Train) {
+    std::mt19937 random(1);
+    std::vector<std::string> samples;
+    for (int i = 0; i < 1000; i++) {
+        samples.push_back(record(random));
+    }
+    ASSERT_TRUE(TrainDictionary({}, 1024).empty());
+    ASSERT_TRUE(TrainDictionary({"abcdefghijklmnop", "0123456789abcdef"}, 1024).empty());
+
+    std::string dictionary = TrainDictionary(samples, 1024);
+    ASSERT_LE(dictionary.size(), 1024);
+    ASSERT_GT(dictionary.size(), 64);
+    EXPECT_NE(std::string::npos, dictionary.find("\", \"state\": \""));
+}
+
+TEST(DictionaryTest, Compress) {
+    std::mt19937 random(1);
+    std::vector<std::string> values;
+    SimpleLRU storage(1 << 20, nullptr, 0, 64);
+    for (int i = 0; i < 1000; i++) {
+        values.push_back(record(random));
+        ASSERT_TRUE(storage.Put("key" + std::to_string(i), values.back()));
+    }
+    std::size_t plain = storage.SizeUsed();
+    std::size_t memory = storage.MemoryUsed();
+
+    storage.SetDictionary(std::make_shared<Lz4::Dictionary>(TrainDictionary(storage.SampleValues(500), 4096)));
+    recompress(storage);
+    check_values(storage, values);
+    EXPECT_GT(plain * 2 / 3, storage.SizeUsed());
+    EXPECT_GT(memory, storage.MemoryUsed());
+
+    // New values are compressed with the dictionary as well
+    std::size_t size = storage.SizeUsed();
+    values[0] = record(random);
+    ASSERT_TRUE(storage.Put("key0", values[0]));
+    EXPECT_GT(size + 50, storage.SizeUsed());
+    check_values(storage, values);
+}
+
+TEST(DictionaryTest, Rotate) {
+    std::mt19937 random(1);
+    std::vector<std::string> values;
+    SimpleLRU storage(1 << 20, std::make_shared<Afina::Allocator::Slab>(1 << 20, 1 << 16), 0, 64);
+    for (int i = 0; i < 500; i++) {
+        values.push_back(record(random));
+        ASSERT_TRUE(storage.Put("key" + std::to_string(i), values.back()));
+    }
+    storage.SetDictionary(std::make_shared<Lz4::Dictionary>(TrainDictionary(storage.SampleValues(500), 2048)));
+    recompress(storage);
+    ASSERT_EQ(1, storage.Dictionaries());
+
+    // Items compressed with the old dictionary stay readable until they are recompressed, items moved
+    // during recompression are not missed
+    storage.SetDictionary(std::make_shared<Lz4::Dictionary>(TrainDictionary(storage.SampleValues(100), 1024)));
+    ASSERT_EQ(2, storage.Dictionaries());
+    check_values(storage, values);
+    ASSERT_GT(storage.Recompress(100), 0);
+    check_values(storage, values);
+    recompress(storage);
+    ASSERT_EQ(1, storage.Dictionaries());
+    check_values(storage, values);
+
+    // Old dictionary is dropped once its last item is gone
+    storage.SetDictionary(std::make_shared<Lz4::Dictionary>(TrainDictionary(storage.SampleValues(100), 512)));
+    ASSERT_EQ(2, storage.Dictionaries());
+    for (std::size_t i = 0; i < values.size(); i++) {
+        ASSERT_TRUE(storage.Delete("key" + std::to_string(i)));
+    }
+    ASSERT_EQ(1, storage.Dictionaries());
+    ASSERT_EQ(0, storage.Recompress(100));
+}
+
+TEST(DictionaryTest, SlabFull) {
+    std::mt19937 random(1);
+    std::vector<std::string> values;
+    SimpleLRU storage(1 << 30, std::make_shared<Afina::Allocator::Slab>(1 << 20, 1 << 16), 0, 64);
+    for (int i = 0; i < 20000; i++) {
+        values.push_back(record(random));
+        ASSERT_TRUE(storage.Put("key" + std::to_string(i), values.back()));
+    }
+    std::vector<std::string> stored = Testing::keys(storage);
+    ASSERT_GT(values.size(), stored.size());
+
+    // Recompression doesn't evict items to move others into smaller blocks
+    storage.SetDictionary(std::make_shared<Lz4::Dictionary>(TrainDictionary(storage.SampleValues(500), 2048)));
+    recompress(storage);
+    ASSERT_EQ(stored, Testing::keys(storage));
+
+    // Items with the old dictionary are released from it even with no memory to rewrite them
+    storage.SetDictionary(std::make_shared<Lz4::Dictionary>(std::string(64, 'x')));
+    recompress(storage);
+    ASSERT_EQ(1, storage.Dictionaries());
+    std::string value;
+    for (auto &key : Testing::keys(storage)) {
+        ASSERT_TRUE(storage.Get(key, value));
+        ASSERT_EQ(values[std::stoul(key.substr(3))], value);
+    }
+}
+
+TEST(DictionaryTest, PackedValue) {
+    std::mt19937 random(1);
+    std::vector<std::string> values;
+    SimpleLRU storage(1 << 20, nullptr, 0, 64);
+    for (int i = 0; i < 500; i++) {
+        values.push_back(record(random));
+        ASSERT_TRUE(storage.Put("key" + std::to_string(i), values.back()));
+    }
+
+    // Value packed with the dictionary that is no longer current is compressed once more
+    SimpleLRU::PackedValue packed;
+    storage.PackValue(values[0], packed);
+    ASSERT_TRUE(packed.compressed);
+    storage.SetDictionary(std::make_shared<Lz4::Dictionary>(TrainDictionary(storage.SampleValues(500), 2048)));
+    ASSERT_TRUE(storage.PutPacked("key0", packed));
+    recompress(storage);
+    ASSERT_EQ(1, storage.Dictionaries());
+
+    std::string value;
+    ASSERT_TRUE(storage.GetPacked("key0", value, packed));
+    ASSERT_TRUE(packed.compressed);
+    ASSERT_TRUE(packed.dictionary != nullptr);
+    SimpleLRU::UnpackValue(packed, value);
+    ASSERT_EQ(values[0], value);
+    check_values(storage, values);
+}
+
+TEST(DictionaryTest, Concurrent) {
+    std::vector<std::string> values;
+    std::mt19937 random(1);
+    for (int i = 0; i < 1000; i++) {
+        values.push_back(record(random));
+    }
+    ThreadSafeSimplLRU storage(1 << 20, nullptr, 0, 64);
+
+    // Clients compress and decompress values while dictionary changes
+    std::atomic<bool> done(false), failed(false);
+    std::vector<std::thread> clients;
+    for (int t = 0; t < 4; t++) {
+        clients.emplace_back([&storage, &values, &done, &failed, t]() {
+            std::mt19937 random(t);
+            std::string value;
+            while (!done.load()) {
+                std::size_t i = random() % values.size();
+                std::string key = "key" + std::to_string(i);
+                storage.Put(key, values[i]);
+                if (storage.Get(key, value) && value != values[i]) {
+                    failed.store(true);
+                }
+            }
+        });
+    }
+    for (std::size_t size = 512; size <= 4096; size *= 2) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        storage.SetDictionary(std::make_shared<Lz4::Dictionary>(TrainDictionary(storage.SampleValues(200), size)));
+        recompress(storage);
+    }
+    done.store(true);
+    for (auto &client : clients) {
+        client.join();
+    }
+    ASSERT_FALSE(failed.load());
+    for (std::size_t i = 0; i < values.size(); i++) {
+        ASSERT_TRUE(storage.Put("key" + std::to_string(i), values[i]));
+    }
+    check_values(storage, values);
+}
+
+TEST(DictionaryTest, Background) {
+    std::mt19937 random(1);
+    std::vector<std::string> values;
+    auto shards = std::make_shared<StripedLockLRU>(4, 4 << 20, nullptr, 0, 64);
+    DictionaryStorage storage(shards, 4096, std::chrono::seconds(3600));
+    storage.Start();
+    for (int i = 0; i < 2000; i++) {
+        values.push_back(record(random));
+        ASSERT_TRUE(storage.Put("key" + std::to_string(i), values.back()));
+    }
+
+    // Clients go on while items are recompressed
+    std::atomic<bool> done(false);
+    std::thread client([&storage, &done]() {
+        std::mt19937 random(2);
+        std::string value;
+        while (!done.load()) {
+            storage.Get("key" + std::to_string(random() % 2000), value);
+        }
+    });
+    bool trained = storage.Train();
+    done.store(true);
+    client.join();
+    ASSERT_TRUE(trained);
+    ASSERT_EQ(1, storage.Rotations());
+    check_values(storage, values);
+
+    // The same dictionary is no better than the current one
+    ASSERT_FALSE(storage.Train());
+    ASSERT_EQ(1, storage.Rotations());
+    storage.Stop();
+}
+
+TEST(DictionaryTest, Unsupported) {
+    ASSERT_THROW(DictionaryStorage(std::make_shared<FlatCombineLRU>(), 1024), std::runtime_error);
+    ASSERT_NO_THROW(DictionaryStorage(std::make_shared<ThreadSafeSimplLRU>(), 1024));
+}
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <afina/allocator/Slab.h>
+
+#include "storage/SimpleLRU.h"
+
+/**
+ * Random key Get latency of LRU holding many small items: heap, slab arena on regular pages, on
+ * transparent and on explicit 2MB huge pages. Items and index nodes are spread over the whole arena,
+ * so with big enough cache most lookups miss TLB on regular pages. Reports latency percentiles and
+ * how much of the arena really was on huge pages
+ *
+ * Usage: benchStorageHugePages [items] [gets]
+ */
+namespace {
+
+using Afina::Allocator::Slab;
+
+constexpr std::size_t kValueSize = 32;
+
+const char *name(Slab::Pages pages) {
+    switch (pages) {
+    case Slab::Pages::kTransparent:
+        return "thp";
+    case Slab::Pages::kHuge2M:
+        return "2M";
+    case Slab::Pages::kHuge1G:
+        return "1G";
+    default:
+        return "regular";
+    }
+}
+
+void run(const std::string &title, std::shared_ptr<Slab> slab, std::size_t items, std::size_t gets) {
+    std::size_t memory = items * (kValueSize + 256);
+    Afina::Backend::SimpleLRU storage(memory, slab, memory);
+    std::string value(kValueSize, 'v');
+    for (std::size_t i = 0; i < items; i++) {
+        storage.Put("key" + std::to_string(i), value);
+    }
+
+    std::mt19937_64 random(42);
+    std::vector<std::string> keys;
+    for (std::size_t i = 0; i < 1 << 16; i++) {
+        keys.push_back("key" + std::to_string(random() % items));
+    }
+
+    // Batches of gets are timed, clock costs about as much as a cache hit
+    constexpr std::size_t kBatch = 16;
+    std::vector<double> latency;
+    std::string got;
+    std::size_t hits = 0;
+    for (std::size_t i = 0; i < gets; i += kBatch) {
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t j = 0; j < kBatch; j++) {
+            hits += storage.Get(keys[(i + j) % keys.size()], got);
+        }
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        latency.push_back(double(ns.count()) / kBatch);
+    }
+    std::sort(latency.begin(), latency.end());
+
+    double sum = 0;
+    for (double l : latency) {
+        sum += l;
+    }
+    std::cout << title << "\t" << std::size_t(sum / latency.size()) << "\t" << std::size_t(latency[latency.size() / 2])
+              << "\t" << std::size_t(latency[latency.size() * 99 / 100]) << "\t" << hits * 100 / gets << "%";
+    if (slab) {
+        std::cout << "\t" << name(slab->pages()) << "\t" << (slab->huge_bytes() >> 20) << "/"
+                  << (slab->used() >> 20) << " MB";
+    }
+    std::cout << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::size_t items = 4000000;
+    std::size_t gets = 4000000;
+    if (argc > 1) {
+        items = std::atol(argv[1]);
+    }
+    if (argc > 2) {
+        gets = std::atol(argv[2]);
+    }
+
+    std::size_t arena = items * (kValueSize + 256);
+    std::cout << items << " items, " << gets << " random gets" << std::endl;
+    std::cout << "memory\tavg ns\tp50 ns\tp99 ns\thits\tpages\thuge/used" << std::endl;
+    run("heap", nullptr, items, gets);
+    for (Slab::Pages pages : {Slab::Pages::kRegular, Slab::Pages::kTransparent, Slab::Pages::kHuge2M}) {
+        run(std::string("slab ") + name(pages),
+            std::make_shared<Slab>(arena, 1 << 20, 1.25, 16, Slab::kAnyNode, pages), items, gets);
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "gtest/gtest.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "storage/Lz4.h"
+
+using namespace Afina::Backend;
+
+namespace {
+
+std::string compress(const std::string &data) {
+    std::string result(Lz4::Bound(data.size()), '\0');
+    result.resize(Lz4::Compress(data.data(), data.size(), &result[0]));
+    return result;
+}
+
+} // namespace
+
+TEST(Lz4Test, RoundTrip) {
+    std::mt19937 random(1);
+    std::string noise;
+    for (int i = 0; i < 100000; i++) {
+        noise += char(random());
+    }
+    std::string json;
+    for (int i = 0; i < 1000; i++) {
+        json += "{\"id\": " + std::to_string(i) + ", \"name\": \"user" + std::to_string(i % 17) + "\"},";
+    }
+
+    // Short inputs, runs overlapping their own output, offsets up to the limit, lengths over 255
+    std::vector<std::string> inputs = {"", "a", "abcdefghijklm", std::string(100000, 'a'), noise, json,
+                                       noise.substr(0, 70000) + noise.substr(0, 70000)};
+    for (auto &input : inputs) {
+        std::string packed = compress(input);
+        ASSERT_LE(packed.size(), Lz4::Bound(input.size()));
+
+        std::string unpacked(input.size(), '\0');
+        ASSERT_TRUE(Lz4::Decompress(packed.data(), packed.size(), &unpacked[0], unpacked.size()));
+        ASSERT_EQ(input, unpacked);
+    }
+    EXPECT_GT(json.size() / 3, compress(json).size());
+    EXPECT_GT(1000, compress(std::string(100000, 'a')).size());
+}
+
+TEST(Lz4Test, Damaged) {
+    std::string json;
+    for (int i = 0; i < 100; i++) {
+        json += "{\"id\": " + std::to_string(i) + "},";
+    }
+    std::string packed = compress(json);
+    std::string unpacked(json.size() + 1, '\0');
+
+    // Wrong size, cut block and garbage never write past the buffer
+    ASSERT_FALSE(Lz4::Decompress(packed.data(), packed.size(), &unpacked[0], json.size() - 1));
+    ASSERT_FALSE(Lz4::Decompress(packed.data(), packed.size(), &unpacked[0], json.size() + 1));
+    for (std::size_t cut = 0; cut < packed.size(); cut++) {
+        ASSERT_FALSE(Lz4::Decompress(packed.data(), cut, &unpacked[0], json.size()));
+    }
+    std::mt19937 random(1);
+    for (int i = 0; i < 1000; i++) {
+        std::string garbage = packed;
+        garbage[random() % garbage.size()] = char(random());
+        Lz4::Decompress(garbage.data(), garbage.size(), &unpacked[0], json.size());
+    }
+}
+
+TEST(Lz4Test, Dictionary) {
+    std::string common;
+    for (int i = 0; i < 10; i++) {
+        common += "{\"name\": \"user" + std::to_string(i) + "\", \"state\": \"active\", \"tags\": [\"x\"]},";
+    }
+    Lz4::Dictionary dictionary(std::string(100000, 'z') + common);
+    ASSERT_EQ(65535, dictionary.Data().size());
+
+    // Matches start in the dictionary and go on into the data
+    std::vector<std::string> inputs = {"", "a", common.substr(17, 100), common + common, common.substr(0, 50) + "zz"};
+    for (auto &input : inputs) {
+        std::string packed(Lz4::Bound(input.size()), '\0');
+        packed.resize(Lz4::Compress(input.data(), input.size(), &packed[0], &dictionary));
+
+        std::string unpacked(input.size(), '\0');
+        ASSERT_TRUE(Lz4::Decompress(packed.data(), packed.size(), &unpacked[0], unpacked.size(), &dictionary));
+        ASSERT_EQ(input, unpacked);
+    }
+
+    std::string value = "{\"name\": \"user3\", \"state\": \"active\", \"tags\": [\"y\"]}";
+    std::string packed(Lz4::Bound(value.size()), '\0');
+    packed.resize(Lz4::Compress(value.data(), value.size(), &packed[0], &dictionary));
+    EXPECT_GT(compress(value).size() / 3, packed.size());
+}
@@ -0,0 +1,61 @@
+#include <cstdlib>
+#include <iostream>
+#include <malloc.h>
+#include <memory>
+#include <string>
+
+#include "storage/SimpleLRU.h"
+
+/**
+ * Memory efficiency of LRU: bytes per item for various key and value sizes. Cache is given a memory
+ * limit and filled with more items than fit, then heap growth is compared with data bytes and with
+ * the accounted memory, so it shows both the overhead and how close the limit is to the real usage
+ *
+ * Usage: benchStorageMemory [memory limit]
+ */
+namespace {
+
+std::size_t heap_used() { return mallinfo2().uordblks; }
+
+void run(std::size_t key_size, std::size_t value_size, std::size_t limit) {
+    std::size_t before = heap_used();
+    std::size_t items;
+    std::size_t accounted;
+    {
+        Afina::Backend::SimpleLRU storage(std::size_t(1) << 40, nullptr, limit);
+        std::string key(key_size, 'k');
+        std::string value(value_size, 'v');
+        long total = 2 * limit / (key_size + value_size) + 1;
+        for (long i = 0; i < total; i++) {
+            std::string n = std::to_string(i);
+            key.replace(0, n.size(), n);
+            storage.Put(key, value);
+        }
+
+        accounted = storage.MemoryUsed();
+        items = accounted / storage.ItemFootprint(key_size + value_size);
+        std::size_t heap = heap_used() - before;
+        std::cout << key_size << "\t" << value_size << "\t" << items << "\t" << key_size + value_size << "\t"
+                  << accounted / items << "\t" << heap / items << "\t" << double(heap) / limit << std::endl;
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::size_t limit = 64 << 20;
+    if (argc > 1) {
+        limit = std::atol(argv[1]);
+    }
+
+    std::cout << "limit " << limit << " bytes" << std::endl;
+    std::cout << "key\tvalue\titems\tdata/item\taccounted/item\theap/item\theap/limit" << std::endl;
+    const std::size_t keys[] = {8, 16, 32, 64};
+    const std::size_t values[] = {8, 64, 512, 4096};
+    for (std::size_t key : keys) {
+        for (std::size_t value : values) {
+            run(key, value, limit);
+        }
+    }
+    return 0;
+}
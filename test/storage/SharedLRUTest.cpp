@@ -0,0 +1,253 @@
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <future>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "storage/SharedLRU.h"
+
+#include "TestUtil.h"
+
+using namespace Afina::Backend;
+using namespace Afina::Backend::Testing;
+
+TEST(SharedLRUTest, Operations) {
+    std::string path = temp_path("afina_shm");
+    SharedLRU storage(path, 4 << 20);
+
+    // Nothing is mapped before start
+    ASSERT_FALSE(storage.Put("a", "1"));
+    storage.Start();
+    ASSERT_EQ(SharedLRU::State::kCreated, storage.GetState());
+
+    std::string value;
+    ASSERT_TRUE(storage.Put("a", "1"));
+    ASSERT_TRUE(storage.PutIfAbsent("b", "2"));
+    ASSERT_FALSE(storage.PutIfAbsent("a", "3"));
+    ASSERT_FALSE(storage.Set("c", "3"));
+    ASSERT_TRUE(storage.Set("a", std::string(1000, 'x')));
+    ASSERT_TRUE(storage.Get("a", value));
+    ASSERT_EQ(std::string(1000, 'x'), value);
+    ASSERT_TRUE(storage.Put("", "empty key"));
+    ASSERT_TRUE(storage.Delete("b"));
+    ASSERT_FALSE(storage.Delete("b"));
+    ASSERT_FALSE(storage.Get("b", value));
+    ASSERT_EQ(2, storage.Items());
+
+    ASSERT_FALSE(storage.Put("big", std::string(storage.MaxItem(), 'x')));
+    ASSERT_TRUE(storage.Put("big", std::string(storage.MaxItem() - 3, 'x')));
+    storage.Stop();
+    unlink(path.c_str());
+}
+
+TEST(SharedLRUTest, Reattach) {
+    std::string path = temp_path("afina_shm");
+    {
+        SharedLRU storage(path, 4 << 20);
+        storage.Start();
+        storage.Put("a", "1");
+        storage.Put("b", std::string(300, 'b'));
+        storage.Put("c", "3");
+
+        std::string value;
+        storage.Get("a", value);
+        storage.Stop();
+    }
+
+    SharedLRU storage(path, 4 << 20);
+    storage.Start();
+    ASSERT_EQ(SharedLRU::State::kAttached, storage.GetState());
+    ASSERT_EQ(2, storage.Epoch());
+
+    // Order is merged across size classes
+    ASSERT_EQ(std::vector<std::string>({"a", "c", "b"}), keys(storage));
+    std::string value;
+    ASSERT_TRUE(storage.Get("b", value));
+    ASSERT_EQ(std::string(300, 'b'), value);
+    storage.Stop();
+    unlink(path.c_str());
+}
+
+TEST(SharedLRUTest, RepairAfterCrash) {
+    std::string path = temp_path("afina_shm");
+    bool repaired = false;
+
+    // Writer spends nearly all its time changing the segment, so it is killed in the middle of
+    // a change, every item found afterwards must be complete
+    std::vector<std::string> keys_written, values;
+    for (int i = 0; i < 5000; i++) {
+        keys_written.push_back("key" + std::to_string(i));
+        values.push_back(keys_written.back() + std::string(i % 300, 'v'));
+    }
+    for (int attempt = 0; attempt < 20 && !repaired; attempt++) {
+        pid_t pid = fork();
+        ASSERT_NE(-1, pid);
+        if (pid == 0) {
+            SharedLRU storage(path, 4 << 20);
+            storage.Start();
+            for (std::size_t i = 0;; i++) {
+                storage.Put(keys_written[i % 5000], values[i % 5000]);
+                storage.Delete(keys_written[(i * 7) % 5000]);
+            }
+        }
+        usleep(100 * 1000);
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+
+        SharedLRU storage(path, 4 << 20);
+        storage.Start();
+        repaired = storage.GetState() == SharedLRU::State::kRepaired;
+
+        std::size_t items = 0;
+        storage.Visit([&items](const char *key, std::size_t key_size, const char *value, std::size_t value_size) {
+            ASSERT_LE(key_size, value_size);
+            ASSERT_EQ(std::string(key, key_size), std::string(value, key_size));
+            ASSERT_EQ(std::string(value_size - key_size, 'v'), std::string(value + key_size, value_size - key_size));
+            items++;
+        });
+        ASSERT_EQ(storage.Items(), items);
+
+        // Index agrees with the lists
+        for (auto &key : keys(storage)) {
+            std::string value;
+            ASSERT_TRUE(storage.Get(key, value));
+        }
+        storage.Stop();
+    }
+    ASSERT_TRUE(repaired);
+    unlink(path.c_str());
+}
+
+TEST(SharedLRUTest, Reinitialize) {
+    std::string path = temp_path("afina_shm");
+    {
+        SharedLRU storage(path, 4 << 20);
+        storage.Start();
+        storage.Put("a", "1");
+    }
+
+    // Different size means different layout
+    {
+        SharedLRU storage(path, 8 << 20);
+        storage.Start();
+        ASSERT_EQ(SharedLRU::State::kCreated, storage.GetState());
+        ASSERT_EQ(0, storage.Items());
+    }
+
+    // Damaged header
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.write("garbage", 7);
+    }
+    SharedLRU storage(path, 8 << 20);
+    storage.Start();
+    ASSERT_EQ(SharedLRU::State::kCreated, storage.GetState());
+    storage.Stop();
+    unlink(path.c_str());
+}
+
+TEST(SharedLRUTest, Locked) {
+    std::string path = temp_path("afina_shm");
+    SharedLRU storage(path, 2 << 20);
+    storage.Start();
+
+    SharedLRU other(path, 2 << 20);
+    ASSERT_THROW(other.Start(), std::runtime_error);
+    storage.Stop();
+    ASSERT_NO_THROW(other.Start());
+    unlink(path.c_str());
+}
+
+TEST(SharedLRUTest, Eviction) {
+    std::string path = temp_path("afina_shm");
+    SharedLRU storage(path, 2 << 20);
+    storage.Start();
+
+    std::string value;
+    for (int i = 0; i < 100000; i++) {
+        ASSERT_TRUE(storage.Put("key" + std::to_string(i), std::string(100, 'v')));
+        if (i % 10 == 0) {
+            ASSERT_TRUE(storage.Get("key0", value));
+        }
+    }
+    ASSERT_GT(100000, storage.Items());
+    ASSERT_TRUE(storage.Get("key0", value));
+    ASSERT_TRUE(storage.Get("key99999", value));
+    ASSERT_FALSE(storage.Get("key1", value));
+
+    // Restore never evicts
+    ASSERT_FALSE(storage.Restore("restored", std::string(100, 'v')));
+    ASSERT_TRUE(storage.Delete("key99999"));
+    ASSERT_TRUE(storage.Restore("restored", std::string(100, 'v')));
+    ASSERT_EQ("restored", keys(storage).back());
+    storage.Stop();
+    unlink(path.c_str());
+}
+
+TEST(SharedLRUTest, SizeMixChanges) {
+    std::string path = temp_path("afina_shm");
+    SharedLRU storage(path, 4 << 20);
+    storage.Start();
+
+    // Small values take all pages, then large ones get pages back from them and the other way round
+    std::string value;
+    for (int round = 0; round < 3; round++) {
+        std::size_t size = round % 2 == 0 ? 100 : 5000;
+        std::string prefix = "round" + std::to_string(round) + "_";
+        for (int i = 0; i < 30000; i++) {
+            ASSERT_TRUE(storage.Put(prefix + std::to_string(i), std::string(size, 'v')));
+        }
+        for (int i = 29900; i < 30000; i++) {
+            ASSERT_TRUE(storage.Get(prefix + std::to_string(i), value));
+            ASSERT_EQ(size, value.size());
+        }
+        ASSERT_GT(storage.Items(), 100);
+    }
+    storage.Stop();
+
+    // Segment with moved pages is consistent
+    storage.Start();
+    ASSERT_EQ(SharedLRU::State::kAttached, storage.GetState());
+    ASSERT_EQ(storage.Items(), keys(storage).size());
+    storage.Stop();
+    unlink(path.c_str());
+}
+
+TEST(SharedLRUTest, VisitInBatches) {
+    std::string path = temp_path("afina_shm");
+    SharedLRU storage(path, 8 << 20);
+    storage.Start();
+    std::string value(100, 'v');
+    for (int i = 0; i < 2000; i++) {
+        ASSERT_TRUE(storage.Put("key" + std::to_string(i), value));
+    }
+
+    // Clients are served while visitor runs, item read ahead of the walk and item replaced ahead of it
+    // are visited once with the values they had
+    std::map<std::string, std::string> items;
+    bool served = false;
+    storage.Visit([&](const char *key, std::size_t key_size, const char *value, std::size_t value_size) {
+        if (items.empty()) {
+            auto client = std::async(std::launch::async, [&storage]() {
+                std::string value;
+                return storage.Get("key0", value) && storage.Set("key1", "new") && storage.Put("other", "1");
+            });
+            served = client.wait_for(std::chrono::seconds(5)) == std::future_status::ready && client.get();
+        }
+        ASSERT_TRUE(items.emplace(std::string(key, key_size), std::string(value, value_size)).second);
+    });
+    EXPECT_TRUE(served);
+    ASSERT_EQ(2000, items.size());
+    EXPECT_EQ(value, items["key0"]);
+    EXPECT_EQ(value, items["key1"]);
+    EXPECT_EQ(0, items.count("other"));
+    storage.Stop();
+    unlink(path.c_str());
+}
@@ -0,0 +1,255 @@
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "storage/FlatCombineLRU.h"
+#include "storage/SimpleLRU.h"
+#include "storage/Snapshot.h"
+#include "storage/StripedLockLRU.h"
+#include "storage/ThreadSafeSimpleLRU.h"
+
+#include "TestUtil.h"
+
+using namespace Afina::Backend;
+using namespace Afina::Backend::Testing;
+
+TEST(SnapshotTest, VisitOrder) {
+    SimpleLRU storage;
+    storage.Put("a", "1");
+    storage.Put("b", "2");
+    storage.Put("c", "3");
+
+    std::string value;
+    storage.Get("a", value);
+    ASSERT_EQ(std::vector<std::string>({"a", "c", "b"}), keys(storage));
+}
+
+TEST(SnapshotTest, RestoreDoesNotEvict) {
+    SimpleLRU storage(6);
+    ASSERT_TRUE(storage.Restore("a", "1"));
+    ASSERT_TRUE(storage.Restore("b", "2"));
+    ASSERT_FALSE(storage.Restore("a", "3"));
+    ASSERT_TRUE(storage.Put("c", "3"));
+
+    // Restored items go to the tail, full cache refuses more
+    ASSERT_FALSE(storage.Restore("d", "4"));
+    ASSERT_EQ(std::vector<std::string>({"c", "a", "b"}), keys(storage));
+
+    std::string value;
+    ASSERT_TRUE(storage.Get("a", value));
+    ASSERT_EQ("1", value);
+}
+
+TEST(SnapshotTest, SaveLoad) {
+    std::string path = temp_path("afina_snapshot");
+    std::string big(200 * 1024, 'x');
+    {
+        SimpleLRU storage(1 << 24);
+        for (int i = 0; i < 10000; i++) {
+            storage.Put("key" + std::to_string(i), "value" + std::to_string(i));
+        }
+        storage.Put("big", big);
+        storage.Put("", "empty key");
+        ASSERT_EQ(10002, SaveSnapshot(storage, path));
+    }
+
+    SimpleLRU storage(1 << 24);
+    SnapshotReader reader(path);
+    const char *key, *value;
+    std::size_t key_size, value_size;
+    while (reader.Next(key, key_size, value, value_size)) {
+        ASSERT_TRUE(storage.Restore(std::string(key, key_size), std::string(value, value_size)));
+    }
+    ASSERT_FALSE(reader.Damaged());
+
+    std::vector<std::string> order = keys(storage);
+    ASSERT_EQ(10002, order.size());
+    EXPECT_EQ("", order[0]);
+    EXPECT_EQ("big", order[1]);
+    EXPECT_EQ("key9999", order[2]);
+    EXPECT_EQ("key0", order.back());
+
+    std::string got;
+    ASSERT_TRUE(storage.Get("big", got));
+    ASSERT_EQ(big, got);
+    unlink(path.c_str());
+}
+
+TEST(SnapshotTest, DamagedBlock) {
+    std::string path = temp_path("afina_snapshot");
+    {
+        SimpleLRU storage(1 << 24);
+        for (int i = 0; i < 100000; i++) {
+            storage.Put("key" + std::to_string(i), std::string(20, 'v'));
+        }
+        SaveSnapshot(storage, path);
+    }
+
+    // Flip a byte in the middle, blocks before it are still loaded
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(0, std::ios::end);
+        std::streamoff middle = file.tellg() / 2;
+        file.seekg(middle);
+        char c = file.get();
+        file.seekp(middle);
+        file.put(c ^ 1);
+    }
+
+    SnapshotReader reader(path);
+    const char *key, *value;
+    std::size_t key_size, value_size, items = 0;
+    while (reader.Next(key, key_size, value, value_size)) {
+        items++;
+    }
+    ASSERT_TRUE(reader.Damaged());
+    ASSERT_LT(0, items);
+    ASSERT_GT(100000, items);
+    unlink(path.c_str());
+}
+
+TEST(SnapshotTest, NotSnapshot) {
+    std::string path = temp_path("afina_snapshot");
+    {
+        std::ofstream file(path);
+        file << "definitely not a snapshot file" << std::endl;
+    }
+    ASSERT_THROW(SnapshotReader reader(path), std::runtime_error);
+    unlink(path.c_str());
+}
+
+TEST(SnapshotTest, WarmRestart) {
+    std::string path = temp_path("afina_snapshot");
+    {
+        auto storage = std::make_shared<SnapshotStorage>(std::make_shared<ThreadSafeSimplLRU>(1 << 20), path);
+        storage->Start();
+        storage->WaitLoaded();
+        ASSERT_EQ(0, storage->Loaded());
+        storage->Put("a", "1");
+        storage->Put("b", "2");
+        storage->Put("c", "3");
+        storage->Put("d", "4");
+        storage->Stop();
+    }
+
+    // Taking over from the running process clients come before Start
+    auto storage = std::make_shared<SnapshotStorage>(std::make_shared<ThreadSafeSimplLRU>(1 << 20), path);
+    storage->Delete("d");
+    storage->Start();
+
+    // Client write wins over the snapshot, deleted key isn't brought back
+    storage->Put("a", "new");
+    storage->Delete("b");
+    storage->WaitLoaded();
+
+    std::string value;
+    ASSERT_TRUE(storage->Get("a", value));
+    EXPECT_EQ("new", value);
+    EXPECT_FALSE(storage->Get("b", value));
+    ASSERT_TRUE(storage->Get("c", value));
+    EXPECT_EQ("3", value);
+    EXPECT_FALSE(storage->Get("d", value));
+    storage->Stop();
+    unlink(path.c_str());
+}
+
+TEST(SnapshotTest, ConcurrentStorages) {
+    std::vector<std::shared_ptr<Afina::Storage>> storages{
+        std::make_shared<ThreadSafeSimplLRU>(1 << 24), std::make_shared<FlatCombineLRU>(1 << 24),
+        std::shared_ptr<Afina::Storage>(StripedLockLRU::create_storage(4, 1 << 24))};
+
+    for (auto &storage : storages) {
+        std::string path = temp_path("afina_snapshot");
+        for (int i = 0; i < 1000; i++) {
+            storage->Put("key" + std::to_string(i), "value" + std::to_string(i));
+        }
+        ASSERT_EQ(1000, SaveSnapshot(*storage, path));
+
+        SnapshotReader reader(path);
+        const char *key, *value;
+        std::size_t key_size, value_size, items = 0;
+        while (reader.Next(key, key_size, value, value_size)) {
+            ASSERT_EQ(std::string("value") + std::string(key + 3, key_size - 3), std::string(value, value_size));
+            items++;
+        }
+        ASSERT_EQ(1000, items);
+        unlink(path.c_str());
+    }
+}
+
+TEST(SnapshotTest, VisitInBatches) {
+    SimpleLRU storage(1 << 20);
+    for (int i = 0; i < 100; i++) {
+        storage.Put("key" + std::to_string(i), "value" + std::to_string(i));
+    }
+    auto walk = [&storage](std::string &batch) {
+        while (storage.NextVisitBatch(batch, 1)) {
+        }
+        std::map<std::string, std::string> items;
+        auto add = [&items](const char *key, std::size_t key_size, const char *value, std::size_t value_size) {
+            EXPECT_TRUE(items.emplace(std::string(key, key_size), std::string(value, value_size)).second);
+        };
+        for (std::size_t offset = 0; offset < batch.size();) {
+            offset = SimpleLRU::VisitRecord(batch, offset, add);
+        }
+        return items;
+    };
+
+    storage.BeginVisit();
+    std::string batch;
+    ASSERT_TRUE(storage.NextVisitBatch(batch, 1));
+
+    // Items moved ahead of the walk are visited with the value they had, new ones aren't visited
+    std::string value;
+    ASSERT_TRUE(storage.Get("key0", value));
+    ASSERT_TRUE(storage.Set("key2", std::string(100, 'x')));
+    ASSERT_TRUE(storage.Delete("key1"));
+    ASSERT_TRUE(storage.Put("new", "1"));
+    auto items = walk(batch);
+    ASSERT_EQ(99, items.size());
+    EXPECT_EQ("value0", items["key0"]);
+    EXPECT_EQ("value2", items["key2"]);
+    EXPECT_EQ(0, items.count("new"));
+
+    // Walk ended halfway doesn't hide items from the next one
+    storage.BeginVisit();
+    batch.clear();
+    ASSERT_TRUE(storage.NextVisitBatch(batch, 1));
+    storage.EndVisit();
+    storage.BeginVisit();
+    batch.clear();
+    ASSERT_EQ(100, walk(batch).size());
+}
+
+TEST(SnapshotTest, VisitorDoesNotBlockClients) {
+    std::vector<std::shared_ptr<Afina::Storage>> storages{
+        std::make_shared<ThreadSafeSimplLRU>(1 << 24), std::make_shared<FlatCombineLRU>(1 << 24),
+        std::shared_ptr<Afina::Storage>(StripedLockLRU::create_storage(4, 1 << 24))};
+
+    for (auto &storage : storages) {
+        for (int i = 0; i < 1000; i++) {
+            storage->Put("key" + std::to_string(i), "value" + std::to_string(i));
+        }
+
+        // Client is served while visitor writes the first item
+        std::size_t items = 0;
+        bool served = false;
+        storage->Visit([&](const char *, std::size_t, const char *, std::size_t) {
+            if (items++ == 0) {
+                auto put = std::async(std::launch::async, [&storage]() { return storage->Put("other", "1"); });
+                served = put.wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+            }
+        });
+        EXPECT_TRUE(served);
+        EXPECT_EQ(1000, items);
+    }
+}
@@ -1,7 +1,9 @@
 #include "gtest/gtest.h"
 #include <iomanip>
 #include <iostream>
+#include <random>
 #include <set>
+#include <thread>
 #include <vector>
 
 #include <afina/execute/Add.h>
@@ -10,6 +12,7 @@
 #include <afina/execute/Get.h>
 #include <afina/execute/Set.h>
 
+#include "storage/FlatCombineLRU.h"
 #include "storage/SimpleLRU.h"
 
 using namespace Afina::Backend;
@@ -260,4 +263,196 @@ TEST(StorageTest, PetrovTest3) {
     EXPECT_FALSE(storage.Get(key2, res));
 
     EXPECT_TRUE(storage.Get(key1, res));
-}
\ No newline at end of file
+}
+
+TEST(StorageTest, FlatCombineConcurrent) {
+    FlatCombineLRU storage(1024 * 1024);
+
+    const int threads = 4, keys = 2000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&storage, t, keys]() {
+            std::string value;
+            for (int i = 0; i < keys; i++) {
+                auto key = "Key " + std::to_string(t) + " " + std::to_string(i);
+                EXPECT_TRUE(storage.Put(key, "Val " + std::to_string(i)));
+                EXPECT_TRUE(storage.Get(key, value));
+                EXPECT_EQ("Val " + std::to_string(i), value);
+            }
+            for (int i = 0; i < keys; i += 2) {
+                EXPECT_TRUE(storage.Delete("Key " + std::to_string(t) + " " + std::to_string(i)));
+            }
+        });
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    std::string value;
+    for (int t = 0; t < threads; t++) {
+        for (int i = 0; i < keys; i++) {
+            auto key = "Key " + std::to_string(t) + " " + std::to_string(i);
+            EXPECT_EQ(i % 2 == 1, storage.Get(key, value));
+        }
+    }
+}
+
+TEST(StorageTest, SlabSetRelocates) {
+    auto slab = std::make_shared<Afina::Allocator::Slab>(1 << 20, 1 << 16);
+    SimpleLRU storage(1 << 20, slab);
+
+    EXPECT_TRUE(storage.Put("KEY1", "v"));
+    EXPECT_TRUE(storage.Put("KEY2", "val2"));
+
+    // Grows out of the block and shrinks back
+    std::string big(5000, 'x');
+    EXPECT_TRUE(storage.Set("KEY1", big));
+    EXPECT_TRUE(storage.Put("KEY1", big + "y"));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ(big + "y", value);
+    EXPECT_TRUE(storage.Put("KEY1", "small"));
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("small", value);
+    EXPECT_TRUE(storage.Get("KEY2", value));
+    EXPECT_EQ("val2", value);
+
+    EXPECT_TRUE(storage.Delete("KEY1"));
+    EXPECT_FALSE(storage.Get("KEY1", value));
+}
+
+TEST(StorageTest, SlabArenaEvicts) {
+    // Byte budget is much larger than arena, so it is the arena that limits the cache. Arena holds
+    // items of several classes and index nodes, so it must have more slabs than classes
+    const size_t length = 20;
+    auto slab = std::make_shared<Afina::Allocator::Slab>(1 << 20, 1 << 16);
+    SimpleLRU storage(1 << 30, slab);
+
+    for (long i = 0; i < 100000; ++i) {
+        auto key = pad_space("Key " + std::to_string(i), length);
+        auto val = pad_space("Val " + std::to_string(i), length * (1 + i % 5));
+        EXPECT_TRUE(storage.Put(key, val));
+        EXPECT_LE(slab->used(), slab->capacity());
+    }
+
+    // The most recent items survived, the oldest ones are gone
+    std::string res;
+    for (long i = 99999; i > 99900; --i) {
+        auto key = pad_space("Key " + std::to_string(i), length);
+        EXPECT_TRUE(storage.Get(key, res));
+        EXPECT_EQ(pad_space("Val " + std::to_string(i), length * (1 + i % 5)), res);
+    }
+    EXPECT_FALSE(storage.Get(pad_space("Key 0", length), res));
+
+    // Item that can't fit into slab at all is rejected
+    EXPECT_FALSE(storage.Put("huge", std::string(1 << 17, 'x')));
+}
+
+TEST(StorageTest, SlabHoldsIndex) {
+    // Items are tiny, so it is mostly index nodes that exhaust the arena
+    auto slab = std::make_shared<Afina::Allocator::Slab>(1 << 18, 1 << 16);
+    SimpleLRU storage(1 << 30, slab);
+
+    for (long i = 0; i < 100000; ++i) {
+        EXPECT_TRUE(storage.Put(std::to_string(i), "v"));
+        EXPECT_TRUE(storage.Set(std::to_string(i), "value"));
+    }
+    EXPECT_EQ(slab->capacity(), slab->used());
+
+    std::string res;
+    for (long i = 99999; i > 99000; --i) {
+        EXPECT_TRUE(storage.Get(std::to_string(i), res));
+        EXPECT_EQ("value", res);
+    }
+    EXPECT_FALSE(storage.Get("0", res));
+}
+
+TEST(StorageTest, MemoryLimit) {
+    // Keys and values are small, so overhead takes more memory than data
+    const size_t length = 20;
+    const size_t limit = 1 << 20;
+    SimpleLRU storage(1 << 30, nullptr, limit);
+
+    for (long i = 0; i < 100000; ++i) {
+        auto key = pad_space("Key " + std::to_string(i), length);
+        auto val = pad_space("Val " + std::to_string(i), length);
+        EXPECT_TRUE(storage.Put(key, val));
+        EXPECT_LE(storage.MemoryUsed(), limit);
+    }
+
+    size_t items = storage.MemoryUsed() / storage.ItemFootprint(2 * length);
+    EXPECT_EQ(items * storage.ItemFootprint(2 * length), storage.MemoryUsed());
+    EXPECT_LT(items * 2 * length, limit / 2);
+
+    std::string res;
+    for (long i = 99999; i >= long(100000 - items); --i) {
+        EXPECT_TRUE(storage.Get(pad_space("Key " + std::to_string(i), length), res));
+    }
+    EXPECT_FALSE(storage.Get(pad_space("Key " + std::to_string(100000 - items - 1), length), res));
+
+    // Set that moves item to the bigger block is charged too
+    EXPECT_TRUE(storage.Set(pad_space("Key 99999", length), std::string(1000, 'x')));
+    EXPECT_LE(storage.MemoryUsed(), limit);
+    EXPECT_FALSE(storage.Put("huge", std::string(limit, 'x')));
+
+    for (long i = 99999; i >= long(100000 - items); --i) {
+        storage.Delete(pad_space("Key " + std::to_string(i), length));
+    }
+    EXPECT_EQ(0, storage.MemoryUsed());
+}
+
+TEST(StorageTest, Compression) {
+    SimpleLRU storage(1 << 20, nullptr, 0, 256);
+    std::string json;
+    for (int i = 0; i < 20; i++) {
+        json += "{\"id\": " + std::to_string(i) + ", \"name\": \"user\", \"active\": true},";
+    }
+    std::mt19937 generator(1);
+    std::string random;
+    for (int i = 0; i < 1000; i++) {
+        random += char(generator());
+    }
+
+    // Small and incompressible values are kept as is, compressible take less than their size
+    ASSERT_TRUE(storage.Put("small", "{\"id\": 1}"));
+    ASSERT_TRUE(storage.Put("json", json));
+    ASSERT_TRUE(storage.Put("random", random));
+    EXPECT_LT(storage.SizeUsed(), 4 + 6 + 9 + 6 + json.size() / 2 + random.size());
+    EXPECT_GE(storage.SizeUsed(), 4 + 6 + 9 + 6 + random.size());
+
+    std::string value;
+    ASSERT_TRUE(storage.Get("json", value));
+    EXPECT_EQ(json, value);
+    ASSERT_TRUE(storage.Get("random", value));
+    EXPECT_EQ(random, value);
+    ASSERT_TRUE(storage.Get("small", value));
+    EXPECT_EQ("{\"id\": 1}", value);
+
+    // Value changes between compressed and raw in place and in new block
+    ASSERT_TRUE(storage.Set("random", json));
+    ASSERT_TRUE(storage.Set("json", random));
+    ASSERT_TRUE(storage.Get("random", value));
+    EXPECT_EQ(json, value);
+    ASSERT_TRUE(storage.Get("json", value));
+    EXPECT_EQ(random, value);
+
+    // Visitor gets original values
+    std::set<std::string> values;
+    storage.Visit([&values](const char *, std::size_t, const char *value, std::size_t value_size) {
+        values.emplace(value, value_size);
+    });
+    EXPECT_EQ(std::set<std::string>({json, random, "{\"id\": 1}"}), values);
+
+    // Items evicted by size of compressed values
+    SimpleLRU small(10 * json.size(), nullptr, 0, 256);
+    for (int i = 0; i < 30; i++) {
+        ASSERT_TRUE(small.Put("key" + std::to_string(i), json));
+    }
+    ASSERT_TRUE(small.Get("key0", value));
+    EXPECT_EQ(json, value);
+    ASSERT_TRUE(storage.Delete("json"));
+    ASSERT_TRUE(storage.Delete("random"));
+    ASSERT_TRUE(storage.Delete("small"));
+    EXPECT_EQ(0, storage.SizeUsed());
+}
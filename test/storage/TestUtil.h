@@ -0,0 +1,38 @@
+#ifndef AFINA_TEST_STORAGE_TEST_UTIL_H
+#define AFINA_TEST_STORAGE_TEST_UTIL_H
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <afina/Storage.h>
+
+namespace Afina {
+namespace Backend {
+namespace Testing {
+
+// Unique path in /tmp starting with the prefix, there is no file there
+inline std::string temp_path(const std::string &prefix) {
+    std::string path = "/tmp/" + prefix + "_XXXXXX";
+    int fd = mkstemp(&path[0]);
+    close(fd);
+    unlink(path.c_str());
+    return path;
+}
+
+// Keys in the order Visit gives them
+inline std::vector<std::string> keys(Afina::Storage &storage) {
+    std::vector<std::string> result;
+    storage.Visit([&result](const char *key, std::size_t key_size, const char *, std::size_t) {
+        result.emplace_back(key, key_size);
+    });
+    return result;
+}
+
+} // namespace Testing
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_TEST_STORAGE_TEST_UTIL_H
@@ -0,0 +1,213 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "storage/TieredLRU.h"
+
+#include "TestUtil.h"
+
+using namespace Afina::Backend;
+using namespace Afina::Backend::Testing;
+
+namespace {
+
+std::string value_of(int i) { return "value" + std::to_string(i) + std::string(i % 200, 'v'); }
+
+} // namespace
+
+TEST(TieredLRUTest, EvictAndPromote) {
+    std::string path = temp_path("afina_flash");
+    TieredLRU storage(4096, path, 1 << 20, nullptr, 0, 64 << 10);
+    storage.Start();
+
+    // Memory holds a few items only, the rest is in flash: in segment buffers and in the file
+    for (int i = 0; i < 3000; i++) {
+        ASSERT_TRUE(storage.Put("key" + std::to_string(i), value_of(i)));
+    }
+    ASSERT_LT(2900, storage.FlashItems());
+
+    std::string value;
+    for (int i = 0; i < 3000; i++) {
+        ASSERT_TRUE(storage.Get("key" + std::to_string(i), value));
+        ASSERT_EQ(value_of(i), value);
+    }
+    ASSERT_LT(2900, storage.FlashHits());
+    ASSERT_FALSE(storage.Get("absent", value));
+    storage.Stop();
+    unlink(path.c_str());
+}
+
+TEST(TieredLRUTest, ChangeFlashItems) {
+    std::string path = temp_path("afina_flash");
+    TieredLRU storage(1024, path, 1 << 20, nullptr, 0, 64 << 10);
+    storage.Start();
+    for (int i = 0; i < 100; i++) {
+        storage.Put("key" + std::to_string(i), std::string(100, 'v'));
+    }
+
+    std::string value;
+    ASSERT_FALSE(storage.PutIfAbsent("key0", "new"));
+    ASSERT_TRUE(storage.Get("key0", value));
+    ASSERT_EQ(std::string(100, 'v'), value);
+
+    ASSERT_TRUE(storage.Set("key1", "set"));
+    ASSERT_TRUE(storage.Get("key1", value));
+    ASSERT_EQ("set", value);
+    ASSERT_FALSE(storage.Set("absent", "set"));
+
+    // Flash copy must not come back after the key is changed in memory
+    ASSERT_TRUE(storage.Put("key2", "put"));
+    for (int i = 100; i < 200; i++) {
+        storage.Put("key" + std::to_string(i), std::string(100, 'v'));
+    }
+    ASSERT_TRUE(storage.Get("key2", value));
+    ASSERT_EQ("put", value);
+
+    // Flash only key isn't brought to memory to be deleted
+    std::size_t hits = storage.FlashHits(), items = storage.FlashItems();
+    ASSERT_TRUE(storage.Delete("key3"));
+    EXPECT_EQ(hits, storage.FlashHits());
+    EXPECT_EQ(items - 1, storage.FlashItems());
+    ASSERT_FALSE(storage.Delete("key3"));
+    ASSERT_FALSE(storage.Get("key3", value));
+    storage.Stop();
+    unlink(path.c_str());
+}
+
+TEST(TieredLRUTest, Wraparound) {
+    std::string path = temp_path("afina_flash");
+    TieredLRU storage(4096, path, 4 * 4096, nullptr, 0, 4096);
+    storage.Start();
+
+    // File is overwritten many times, each item is either gone or has its last value
+    for (int round = 0; round < 5; round++) {
+        for (int i = 0; i < 500; i++) {
+            storage.Put("key" + std::to_string(i), value_of(i + round));
+        }
+    }
+    ASSERT_GT(500, storage.FlashItems());
+
+    std::string value;
+    ASSERT_TRUE(storage.Get("key499", value));
+    int found = 0;
+    for (int i = 0; i < 500; i++) {
+        if (storage.Get("key" + std::to_string(i), value)) {
+            ASSERT_EQ(value_of(i + 4), value);
+            found++;
+        }
+    }
+    ASSERT_LT(0, found);
+    ASSERT_FALSE(storage.Get("key0", value));
+    storage.Stop();
+    unlink(path.c_str());
+}
+
+TEST(TieredLRUTest, IndexBounded) {
+    std::string path = temp_path("afina_flash");
+    TieredLRU storage(64, path, 4 * 4096, nullptr, 0, 4096);
+    storage.Start();
+
+    // Flash holds more tiny records than index has entries for, the most recent ones stay
+    for (int i = 0; i < 2000; i++) {
+        ASSERT_TRUE(storage.Put("k" + std::to_string(i), "v"));
+    }
+    EXPECT_GE(128, storage.FlashItems());
+    EXPECT_LT(64, storage.FlashItems());
+
+    std::string value;
+    for (int i = 1990; i < 2000; i++) {
+        ASSERT_TRUE(storage.Get("k" + std::to_string(i), value));
+        ASSERT_EQ("v", value);
+    }
+    storage.Stop();
+    unlink(path.c_str());
+}
+
+TEST(TieredLRUTest, BuffersBounded) {
+    std::string path = temp_path("afina_flash");
+    ASSERT_THROW(TieredLRU(64 << 10, path, 64 * 4096, nullptr, 3 * 4096, 4096), std::runtime_error);
+    TieredLRU storage(64 << 10, path, 64 * 4096, nullptr, 0, 4096);
+    storage.Start();
+    for (int i = 0; i < 600; i++) {
+        ASSERT_TRUE(storage.Put("key" + std::to_string(i), std::string(100, 'v')));
+    }
+    ASSERT_EQ(0, storage.FlashDropped());
+
+    // One Put evicts many segments of items at once, writer can't keep up: three segments are buffered,
+    // the rest of items is dropped
+    ASSERT_TRUE(storage.Put("big", std::string(60 << 10, 'b')));
+    EXPECT_LT(0, storage.FlashDropped());
+    EXPECT_GE(3 * 4096 / 100, storage.FlashItems());
+
+    std::string value;
+    ASSERT_TRUE(storage.Get("key0", value));
+    ASSERT_EQ(std::string(100, 'v'), value);
+    storage.Stop();
+    unlink(path.c_str());
+}
+
+TEST(TieredLRUTest, Concurrent) {
+    std::string path = temp_path("afina_flash");
+    TieredLRU storage(8192, path, 256 << 10, nullptr, 0, 16 << 10);
+    storage.Start();
+
+    // Each thread owns its keys, so it must read back what it wrote or nothing at all
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&storage, t]() {
+            std::vector<int> written(500, -1);
+            std::string value;
+            for (int i = 0; i < 5000; i++) {
+                int k = (i * 7) % 500;
+                std::string key = "key" + std::to_string(t) + "_" + std::to_string(k);
+                if (i % 3 == 0 && storage.Put(key, value_of(i))) {
+                    written[k] = i;
+                } else if (storage.Get(key, value)) {
+                    ASSERT_NE(-1, written[k]);
+                    ASSERT_EQ(value_of(written[k]), value);
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    storage.Stop();
+    unlink(path.c_str());
+}
+
+TEST(TieredLRUTest, StopWhileBusy) {
+    std::string path = temp_path("afina_flash");
+    TieredLRU storage(8192, path, 256 << 10, nullptr, 0, 16 << 10);
+    storage.Start();
+
+    // Clients keep writing and reading flash while it is closed, then work with memory tier only
+    std::atomic<bool> done(false);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&storage, &done, t]() {
+            std::string value;
+            for (int i = 0; !done.load(); i++) {
+                std::string key = "key" + std::to_string(t) + "_" + std::to_string(i % 500);
+                storage.Put(key, value_of(i));
+                storage.Get("key" + std::to_string(t) + "_" + std::to_string((i * 7) % 500), value);
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    storage.Stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    done.store(true);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(0, storage.FlashItems());
+    unlink(path.c_str());
+}
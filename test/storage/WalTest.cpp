@@ -0,0 +1,183 @@
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "storage/ThreadSafeSimpleLRU.h"
+#include "storage/Wal.h"
+
+using namespace Afina::Backend;
+
+namespace {
+
+std::string temp_dir() {
+    char path[] = "/tmp/afina_wal_XXXXXX";
+    return std::string(mkdtemp(path)) + "/wal";
+}
+
+void remove_all(const std::string &path) {
+    std::string dir = path.substr(0, path.rfind('/'));
+    std::system(("rm -rf " + dir).c_str());
+}
+
+bool exists(const std::string &path) { return access(path.c_str(), F_OK) == 0; }
+
+std::shared_ptr<WalStorage> make_storage(const std::string &path, std::size_t compact_size = 64 << 20) {
+    return std::make_shared<WalStorage>(std::make_shared<ThreadSafeSimplLRU>(1 << 24), path,
+                                        std::chrono::milliseconds(5), compact_size);
+}
+
+} // namespace
+
+TEST(WalTest, WriteRead) {
+    std::string path = temp_dir();
+    {
+        WalWriter writer(path + ".1");
+        writer.Append(WalWriter::kPut, "a", "1");
+        writer.Append(WalWriter::kDelete, "a", "ignored");
+        writer.Append(WalWriter::kPut, "big", std::string(20 << 20, 'x'));
+        writer.Append(WalWriter::kPut, "", "");
+    }
+
+    WalReader reader(path + ".1");
+    WalWriter::Type type;
+    const char *key, *value;
+    std::size_t key_size, value_size;
+    ASSERT_TRUE(reader.Next(type, key, key_size, value, value_size));
+    EXPECT_EQ(WalWriter::kPut, type);
+    EXPECT_EQ("a", std::string(key, key_size));
+    EXPECT_EQ("1", std::string(value, value_size));
+    ASSERT_TRUE(reader.Next(type, key, key_size, value, value_size));
+    EXPECT_EQ(WalWriter::kDelete, type);
+    EXPECT_EQ(0, value_size);
+    ASSERT_TRUE(reader.Next(type, key, key_size, value, value_size));
+    EXPECT_EQ(std::string(20 << 20, 'x'), std::string(value, value_size));
+    ASSERT_TRUE(reader.Next(type, key, key_size, value, value_size));
+    EXPECT_EQ(0, key_size);
+    ASSERT_FALSE(reader.Next(type, key, key_size, value, value_size));
+    ASSERT_FALSE(reader.Damaged());
+    remove_all(path);
+}
+
+TEST(WalTest, TornRecord) {
+    std::string path = temp_dir();
+    {
+        WalWriter writer(path + ".1");
+        writer.Append(WalWriter::kPut, "a", "1");
+        writer.Append(WalWriter::kPut, "b", std::string(100, 'x'));
+    }
+
+    // Last record cut in the middle
+    struct stat st;
+    ASSERT_EQ(0, stat((path + ".1").c_str(), &st));
+    ASSERT_EQ(0, truncate((path + ".1").c_str(), st.st_size - 10));
+
+    WalReader reader(path + ".1");
+    WalWriter::Type type;
+    const char *key, *value;
+    std::size_t key_size, value_size;
+    ASSERT_TRUE(reader.Next(type, key, key_size, value, value_size));
+    ASSERT_FALSE(reader.Next(type, key, key_size, value, value_size));
+    ASSERT_TRUE(reader.Damaged());
+    remove_all(path);
+}
+
+TEST(WalTest, Recover) {
+    std::string path = temp_dir();
+    {
+        auto storage = make_storage(path);
+
+        // Nothing is logged before start, so nothing is accepted
+        ASSERT_FALSE(storage->Put("early", "1"));
+        storage->Start();
+        ASSERT_TRUE(storage->Put("a", "1"));
+        ASSERT_TRUE(storage->Put("b", "2"));
+        ASSERT_TRUE(storage->PutIfAbsent("c", "3"));
+        ASSERT_FALSE(storage->PutIfAbsent("c", "4"));
+        ASSERT_TRUE(storage->Set("a", "new"));
+        ASSERT_TRUE(storage->Delete("b"));
+        storage->Stop();
+    }
+
+    auto storage = make_storage(path);
+    storage->Start();
+    ASSERT_EQ(5, storage->Replayed());
+
+    std::string value;
+    ASSERT_TRUE(storage->Get("a", value));
+    EXPECT_EQ("new", value);
+    EXPECT_FALSE(storage->Get("b", value));
+    ASSERT_TRUE(storage->Get("c", value));
+    EXPECT_EQ("3", value);
+    storage->Stop();
+    remove_all(path);
+}
+
+TEST(WalTest, Crash) {
+    std::string path = temp_dir();
+    pid_t pid = fork();
+    ASSERT_NE(-1, pid);
+    if (pid == 0) {
+        auto storage = make_storage(path);
+        storage->Start();
+        for (int i = 0; i < 1000; i++) {
+            storage->Put("key" + std::to_string(i), "value" + std::to_string(i));
+        }
+
+        // Killed after the group commit, but without Stop
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        kill(getpid(), SIGKILL);
+    }
+    waitpid(pid, nullptr, 0);
+
+    auto storage = make_storage(path);
+    storage->Start();
+    ASSERT_EQ(1000, storage->Replayed());
+    for (int i = 0; i < 1000; i++) {
+        std::string value;
+        ASSERT_TRUE(storage->Get("key" + std::to_string(i), value));
+        ASSERT_EQ("value" + std::to_string(i), value);
+    }
+    storage->Stop();
+    remove_all(path);
+}
+
+TEST(WalTest, Compaction) {
+    std::string path = temp_dir();
+    {
+        auto storage = make_storage(path, 64 << 10);
+        storage->Start();
+        for (int i = 0; i < 10000; i++) {
+            storage->Put("key" + std::to_string(i % 100), "value" + std::to_string(i));
+        }
+        storage->Compact();
+        storage->Delete("key0");
+        storage->Stop();
+    }
+
+    // Only the log written after the last snapshot is left
+    ASSERT_TRUE(exists(path + ".snapshot"));
+    ASSERT_FALSE(exists(path + ".1"));
+
+    auto storage = make_storage(path);
+    storage->Start();
+    ASSERT_EQ(1, storage->Replayed());
+
+    std::string value;
+    ASSERT_FALSE(storage->Get("key0", value));
+    for (int i = 1; i < 100; i++) {
+        ASSERT_TRUE(storage->Get("key" + std::to_string(i), value));
+        ASSERT_EQ("value" + std::to_string(9900 + i), value);
+    }
+    storage->Stop();
+    remove_all(path);
+}